@@ -169,6 +169,13 @@ ItemWidget *ItemDataLoader::create(const QModelIndex &index, QWidget *parent) co
     return new ItemData( index, m_settings.value("max_bytes", defaultMaxBytes).toInt(), parent );
 }
 
+ItemRenderer *ItemDataLoader::createRenderer(const QModelIndex &index, bool *handled) const
+{
+    const QStringList formats = index.data(contentType::data).toMap().keys();
+    *handled = !emptyIntersection(formats, formatsToSave());
+    return NULL;
+}
+
 QStringList ItemDataLoader::formatsToSave() const
 {
     return m_settings.contains("formats")
@@ -64,6 +64,8 @@ public:
 
     virtual ItemWidget *create(const QModelIndex &index, QWidget *parent) const;
 
+    virtual ItemRenderer *createRenderer(const QModelIndex &index, bool *handled) const;
+
     virtual QString id() const { return "itemdata"; }
     virtual QString name() const { return tr("Data"); }
     virtual QString author() const { return QString(); }
@@ -78,6 +80,8 @@ public:
 
     virtual QWidget *createSettingsWidget(QWidget *parent);
 
+    virtual bool providesSearchableText() const { return true; }
+
 private slots:
     void on_treeWidgetFormats_itemActivated(QTreeWidgetItem *item, int column);
 
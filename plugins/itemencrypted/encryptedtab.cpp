@@ -0,0 +1,161 @@
+/*
+    Copyright (c) 2016, Lukas Holecek <hluk@email.cz>
+
+    This file is part of CopyQ.
+
+    CopyQ is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    CopyQ is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with CopyQ.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "encryptedtab.h"
+
+#include "common/contenttype.h"
+
+#include <QAbstractItemModel>
+#include <QDataStream>
+#include <QStringList>
+
+namespace {
+
+const char dataFileHeader[] = "CopyQ_encrypted_tab";
+const char dataFileHeaderV2[] = "CopyQ_encrypted_tab v2";
+const char dataFileHeaderV3[] = "CopyQ_encrypted_tab v3";
+
+/// Average number of items in separately encrypted chunk.
+const int averageChunkItemCount = 32;
+
+/// Maximum number of items in separately encrypted chunk.
+const int maxChunkItemCount = 4 * averageChunkItemCount;
+
+QByteArray createChunk(quint32 itemCount, const QByteArray &itemsBytes)
+{
+    QByteArray chunk;
+    QDataStream stream(&chunk, QIODevice::WriteOnly);
+    stream.setVersion(QDataStream::Qt_4_7);
+    stream << itemCount;
+    stream.writeRawData( itemsBytes.constData(), itemsBytes.size() );
+    return chunk;
+}
+
+bool appendItem(const QVariantMap &dataMap, QAbstractItemModel *model)
+{
+    const int row = model->rowCount();
+    return model->insertRow(row)
+            && model->setData( model->index(row, 0), dataMap, contentType::data );
+}
+
+} // namespace
+
+int readEncryptedTabVersion(QDataStream *stream)
+{
+    QString header;
+    *stream >> header;
+    if ( stream->status() != QDataStream::Ok )
+        return 0;
+
+    const QStringList headers = QStringList()
+            << dataFileHeader << dataFileHeaderV2 << dataFileHeaderV3;
+    return headers.indexOf(header) + 1;
+}
+
+bool writeEncryptedChunks(QDataStream *stream, const QList<QByteArray> &encryptedChunks)
+{
+    *stream << QString(dataFileHeaderV3)
+            << static_cast<quint32>( encryptedChunks.size() );
+
+    foreach (const QByteArray &bytes, encryptedChunks)
+        *stream << bytes;
+
+    return stream->status() == QDataStream::Ok;
+}
+
+bool readEncryptedChunks(QDataStream *stream, QList<QByteArray> *encryptedChunks)
+{
+    quint32 chunkCount;
+    *stream >> chunkCount;
+
+    for (quint32 i = 0; i < chunkCount && stream->status() == QDataStream::Ok; ++i) {
+        QByteArray bytes;
+        *stream >> bytes;
+        encryptedChunks->append(bytes);
+    }
+
+    return stream->status() == QDataStream::Ok;
+}
+
+QList<QByteArray> serializeItemChunks(const QAbstractItemModel &model)
+{
+    QList<QByteArray> chunks;
+    QByteArray itemsBytes;
+    quint32 itemCount = 0;
+
+    for (int row = 0; row < model.rowCount(); ++row) {
+        QByteArray itemBytes;
+        {
+            QDataStream stream(&itemBytes, QIODevice::WriteOnly);
+            stream.setVersion(QDataStream::Qt_4_7);
+            stream << model.index(row, 0).data(contentType::data).toMap();
+        }
+
+        itemsBytes.append(itemBytes);
+        ++itemCount;
+
+        if ( qHash(itemBytes) % averageChunkItemCount == 0
+             || itemCount == maxChunkItemCount
+             || row + 1 == model.rowCount() )
+        {
+            chunks.append( createChunk(itemCount, itemsBytes) );
+            itemsBytes.clear();
+            itemCount = 0;
+        }
+    }
+
+    return chunks;
+}
+
+bool deserializeItemChunk(const QByteArray &chunk, QAbstractItemModel *model, int maxItems)
+{
+    QDataStream stream(chunk);
+    stream.setVersion(QDataStream::Qt_4_7);
+
+    quint32 itemCount;
+    stream >> itemCount;
+
+    for ( quint32 i = 0; i < itemCount && model->rowCount() < maxItems; ++i ) {
+        QVariantMap dataMap;
+        stream >> dataMap;
+        if ( stream.status() != QDataStream::Ok || !appendItem(dataMap, model) )
+            return false;
+    }
+
+    return stream.status() == QDataStream::Ok;
+}
+
+bool deserializeItems(const QByteArray &bytes, QAbstractItemModel *model, int maxItems)
+{
+    QDataStream stream(bytes);
+
+    quint64 length;
+    stream >> length;
+    if ( length == 0 || stream.status() != QDataStream::Ok )
+        return false;
+
+    for ( quint64 i = 0; i < length && model->rowCount() < maxItems; ++i ) {
+        QVariantMap dataMap;
+        stream >> dataMap;
+        if ( stream.status() != QDataStream::Ok || !appendItem(dataMap, model) )
+            return false;
+    }
+
+    return true;
+}
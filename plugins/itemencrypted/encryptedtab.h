@@ -0,0 +1,60 @@
+/*
+    Copyright (c) 2016, Lukas Holecek <hluk@email.cz>
+
+    This file is part of CopyQ.
+
+    CopyQ is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    CopyQ is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with CopyQ.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef ENCRYPTEDTAB_H
+#define ENCRYPTEDTAB_H
+
+#include <QByteArray>
+#include <QList>
+
+class QAbstractItemModel;
+class QDataStream;
+
+/**
+ * Read header of encrypted tab file.
+ *
+ * @return format version (1, 2 or 3) or 0 if this is not an encrypted tab
+ */
+int readEncryptedTabVersion(QDataStream *stream);
+
+/**
+ * Write encrypted tab file in current format (version 3).
+ *
+ * The file contains separately encrypted chunks (see serializeItemChunks()).
+ */
+bool writeEncryptedChunks(QDataStream *stream, const QList<QByteArray> &encryptedChunks);
+
+/// Read encrypted chunks from tab file after header (version 3).
+bool readEncryptedChunks(QDataStream *stream, QList<QByteArray> *encryptedChunks);
+
+/**
+ * Serialize items into chunks which are encrypted separately.
+ *
+ * Chunk boundaries depend only on content of items so adding, removing or
+ * changing an item usually changes only single chunk.
+ */
+QList<QByteArray> serializeItemChunks(const QAbstractItemModel &model);
+
+/// Append items from decrypted chunk to @a model (until it has @a maxItems).
+bool deserializeItemChunk(const QByteArray &chunk, QAbstractItemModel *model, int maxItems);
+
+/// Append items from decrypted tab saved in older format (version 1 or 2).
+bool deserializeItems(const QByteArray &bytes, QAbstractItemModel *model, int maxItems);
+
+#endif // ENCRYPTEDTAB_H
@@ -0,0 +1,330 @@
+/*
+    Copyright (c) 2016, Lukas Holecek <hluk@email.cz>
+
+    This file is part of CopyQ.
+
+    CopyQ is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    CopyQ is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with CopyQ.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#include "gpgsession.h"
+
+#include "common/log.h"
+
+#include <QMutexLocker>
+#include <QProcess>
+
+namespace {
+
+/// Don't ask gpg-agent whether key is still unlocked if it was used recently.
+const int keyInfoIntervalMs = 5000;
+
+bool isDecryptRequest(const GpgRequestPtr &request)
+{
+    return request->args.contains("--decrypt");
+}
+
+void startProcess(QProcess *p, const QString &program, const QStringList &args, const QByteArray &input)
+{
+    p->start(program, args);
+    p->write(input);
+    while ( p->bytesToWrite() > 0 && p->waitForBytesWritten(-1) ) {}
+    p->closeWriteChannel();
+}
+
+} // namespace
+
+GpgSession::GpgSession(const QStringList &gpgArguments, QObject *parent)
+    : QObject(parent)
+    , m_gpgArguments(gpgArguments)
+    , m_maxRunning( qMax(1, QThread::idealThreadCount()) )
+    , m_mutex()
+    , m_queueChanged()
+    , m_requestFinished()
+    , m_queue()
+    , m_stop(false)
+    , m_unlocked(false)
+    , m_unlockTimeoutSeconds(-1)
+    , m_lastDecrypt()
+    , m_keyGrips()
+    , m_thread(this)
+{
+    m_thread.start();
+}
+
+GpgSession::~GpgSession()
+{
+    {
+        QMutexLocker lock(&m_mutex);
+        m_stop = true;
+        foreach (const GpgRequestPtr &request, m_queue)
+            request->status = GpgRequest::Cancelled;
+        m_queue.clear();
+        m_queueChanged.wakeAll();
+        m_requestFinished.wakeAll();
+    }
+
+    m_thread.wait();
+}
+
+void GpgSession::setUnlockTimeout(int seconds)
+{
+    QMutexLocker lock(&m_mutex);
+    m_unlockTimeoutSeconds = seconds;
+    m_queueChanged.wakeAll();
+}
+
+GpgRequestPtr GpgSession::enqueue(const QStringList &args, const QByteArray &input)
+{
+    GpgRequestPtr request(new GpgRequest(args, input));
+
+    QMutexLocker lock(&m_mutex);
+    if (m_stop) {
+        request->status = GpgRequest::Cancelled;
+    } else {
+        m_queue.append(request);
+        m_queueChanged.wakeAll();
+    }
+
+    return request;
+}
+
+bool GpgSession::waitForFinished(const GpgRequestPtr &request)
+{
+    QMutexLocker lock(&m_mutex);
+    while (request->status == GpgRequest::Queued || request->status == GpgRequest::Running)
+        m_requestFinished.wait(&m_mutex);
+
+    return request->status == GpgRequest::Finished && request->exitCode == 0;
+}
+
+void GpgSession::cancel(const GpgRequestPtr &request)
+{
+    QMutexLocker lock(&m_mutex);
+    if ( request->status == GpgRequest::Queued && m_queue.removeOne(request) ) {
+        request->status = GpgRequest::Cancelled;
+        m_requestFinished.wakeAll();
+    }
+}
+
+QByteArray GpgSession::run(const QStringList &args, const QByteArray &input)
+{
+    const GpgRequestPtr request = enqueue(args, input);
+    return waitForFinished(request) ? request->output : QByteArray();
+}
+
+QVariantMap GpgSession::gpgRun(const QString &gpgArgument, const QString &inputBase64)
+{
+    const GpgRequestPtr request =
+            enqueue( QStringList(gpgArgument), QByteArray::fromBase64(inputBase64.toLatin1()) );
+    waitForFinished(request);
+
+    QVariantMap result;
+    result.insert( "stdout", QString::fromLatin1(request->output.toBase64()) );
+    result.insert( "stderr", request->errorOutput );
+    result.insert( "exit_code", request->exitCode );
+    return result;
+}
+
+void GpgSession::processRequests()
+{
+    QList<GpgRequestPtr> requests;
+    while ( takeRequests(&requests) )
+        runRequests(requests);
+}
+
+bool GpgSession::takeRequests(QList<GpgRequestPtr> *requests)
+{
+    requests->clear();
+
+    QMutexLocker lock(&m_mutex);
+
+    while ( !m_stop && m_queue.isEmpty() ) {
+        if ( !m_unlocked || m_unlockTimeoutSeconds < 0 ) {
+            m_queueChanged.wait(&m_mutex);
+            continue;
+        }
+
+        const qint64 remainingMs = m_unlockTimeoutSeconds * 1000LL - m_lastDecrypt.elapsed();
+        if (remainingMs > 0) {
+            m_queueChanged.wait( &m_mutex, static_cast<unsigned long>(remainingMs) );
+        } else {
+            m_unlocked = false;
+            lock.unlock();
+            lockKeys();
+            lock.relock();
+        }
+    }
+
+    if (m_stop)
+        return false;
+
+    // Password could have expired in gpg-agent so check before decrypting in parallel,
+    // otherwise each process would ask for the password.
+    if ( m_unlocked && m_lastDecrypt.elapsed() > keyInfoIntervalMs && hasMoreDecryptRequests() ) {
+        lock.unlock();
+        const bool unlocked = isKeyUnlocked();
+        lock.relock();
+
+        if (m_stop)
+            return false;
+
+        if (!unlocked) {
+            COPYQ_LOG("ItemEncrypt: Password expired in gpg-agent");
+            m_unlocked = false;
+        }
+    }
+
+    // Decrypt alone until the key is unlocked so that password is asked only once.
+    const bool decryptAlone = !m_unlocked;
+
+    while ( !m_queue.isEmpty() && requests->size() < m_maxRunning ) {
+        const GpgRequestPtr &request = m_queue.first();
+        const bool isDecrypt = decryptAlone && isDecryptRequest(request);
+        if ( isDecrypt && !requests->isEmpty() )
+            break;
+
+        request->status = GpgRequest::Running;
+        requests->append( m_queue.takeFirst() );
+
+        if (isDecrypt)
+            break;
+    }
+
+    return true;
+}
+
+void GpgSession::runRequests(const QList<GpgRequestPtr> &requests)
+{
+    QList<QProcess*> processes;
+    foreach (const GpgRequestPtr &request, requests) {
+        QProcess *p = new QProcess();
+        processes.append(p);
+        startProcess( p, "gpg", m_gpgArguments + request->args, request->input );
+    }
+
+    for (int i = 0; i < requests.size(); ++i) {
+        QProcess *p = processes[i];
+        const GpgRequestPtr &request = requests[i];
+
+        while ( !p->waitForFinished(1000) && p->state() != QProcess::NotRunning ) {
+            QMutexLocker lock(&m_mutex);
+            if (m_stop)
+                p->kill();
+        }
+
+        request->output = p->readAllStandardOutput();
+        if ( p->exitStatus() != QProcess::NormalExit || p->error() == QProcess::FailedToStart ) {
+            request->exitCode = -1;
+            request->errorOutput = p->errorString();
+            COPYQ_LOG( "ItemEncrypt ERROR: Failed to run GnuPG: " + p->errorString() );
+        } else {
+            request->exitCode = p->exitCode();
+            request->errorOutput = QString::fromUtf8( p->readAllStandardError() );
+            if ( request->exitCode != 0 && !request->errorOutput.isEmpty() )
+                COPYQ_LOG( "ItemEncrypt ERROR: GnuPG stderr:\n" + request->errorOutput );
+        }
+
+        delete p;
+
+        QMutexLocker lock(&m_mutex);
+        request->status = GpgRequest::Finished;
+        if ( isDecryptRequest(request) ) {
+            // Failed decryption may mean that password was not entered or it expired.
+            m_unlocked = request->exitCode == 0;
+            if (m_unlocked)
+                m_lastDecrypt.start();
+        }
+        m_requestFinished.wakeAll();
+    }
+}
+
+bool GpgSession::hasMoreDecryptRequests() const
+{
+    int count = 0;
+    foreach (const GpgRequestPtr &request, m_queue) {
+        if ( isDecryptRequest(request) && ++count > 1 )
+            return true;
+    }
+    return false;
+}
+
+QStringList GpgSession::keyGrips()
+{
+    if ( !m_keyGrips.isEmpty() )
+        return m_keyGrips;
+
+    QProcess p;
+    const QStringList args = QStringList()
+            << "--with-colons" << "--with-keygrip" << "--list-secret-keys" << "copyq";
+    startProcess( &p, "gpg", m_gpgArguments + args, QByteArray() );
+    p.waitForFinished(-1);
+
+    foreach ( const QByteArray &line, p.readAllStandardOutput().split('\n') ) {
+        // Key grip is in 10th field of "grp" records.
+        const QList<QByteArray> fields = line.split(':');
+        if ( fields.size() > 9 && fields[0] == "grp" && !fields[9].isEmpty() )
+            m_keyGrips.append( QString::fromLatin1(fields[9]) );
+    }
+
+    return m_keyGrips;
+}
+
+bool GpgSession::isKeyUnlocked()
+{
+    const QStringList grips = keyGrips();
+    if ( grips.isEmpty() )
+        return true;
+
+    QStringList agentCommands;
+    foreach (const QString &grip, grips)
+        agentCommands.append("KEYINFO " + grip);
+
+    QProcess agent;
+    startProcess( &agent, "gpg-connect-agent", agentCommands << "/bye", QByteArray() );
+    agent.waitForFinished(-1);
+    if ( agent.exitStatus() != QProcess::NormalExit || agent.exitCode() != 0 )
+        return true;
+
+    bool hasKeyInfo = false;
+    foreach ( const QByteArray &line, agent.readAllStandardOutput().split('\n') ) {
+        // Line is "S KEYINFO <grip> <type> <serial> <id> <cached> ...",
+        // where cached is "1" if password is in gpg-agent.
+        const QList<QByteArray> fields = line.trimmed().split(' ');
+        if ( fields.size() > 6 && fields[0] == "S" && fields[1] == "KEYINFO" ) {
+            if (fields[6] == "1")
+                return true;
+            hasKeyInfo = true;
+        }
+    }
+
+    // Assume unlocked key if gpg-agent doesn't report key info.
+    return !hasKeyInfo;
+}
+
+void GpgSession::lockKeys()
+{
+    QStringList agentCommands;
+    foreach ( const QString &grip, keyGrips() )
+        agentCommands.append("CLEAR_PASSPHRASE --mode=normal " + grip);
+
+    if ( agentCommands.isEmpty() )
+        return;
+
+    COPYQ_LOG("ItemEncrypt: Removing password from gpg-agent");
+
+    QProcess agent;
+    startProcess( &agent, "gpg-connect-agent", agentCommands << "/bye", QByteArray() );
+    agent.waitForFinished(-1);
+}
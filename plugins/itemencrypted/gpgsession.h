@@ -0,0 +1,166 @@
+/*
+    Copyright (c) 2016, Lukas Holecek <hluk@email.cz>
+
+    This file is part of CopyQ.
+
+    CopyQ is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    CopyQ is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with CopyQ.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#ifndef GPGSESSION_H
+#define GPGSESSION_H
+
+#include <QElapsedTimer>
+#include <QList>
+#include <QMutex>
+#include <QObject>
+#include <QSharedPointer>
+#include <QStringList>
+#include <QThread>
+#include <QVariantMap>
+#include <QWaitCondition>
+
+/**
+ * Request for GnuPG processed by GpgSession.
+ *
+ * Results are valid after GpgSession::waitForFinished() returns.
+ */
+struct GpgRequest {
+    enum Status {
+        Queued,
+        Running,
+        Finished,
+        Cancelled
+    };
+
+    GpgRequest(const QStringList &args, const QByteArray &input)
+        : args(args)
+        , input(input)
+        , output()
+        , errorOutput()
+        , exitCode(-1)
+        , status(Queued)
+    {
+    }
+
+    QStringList args;
+    QByteArray input;
+    QByteArray output;
+    QString errorOutput;
+    int exitCode;
+    Status status;
+};
+
+typedef QSharedPointer<GpgRequest> GpgRequestPtr;
+
+/**
+ * Long-lived session processing GnuPG requests in a queue.
+ *
+ * Requests are processed in a worker thread with at most QThread::idealThreadCount()
+ * GnuPG processes running at once.
+ *
+ * Until a secret key is unlocked, decryption requests are processed one at a
+ * time so that user is asked for password only once. This is also the case after
+ * a decryption fails or gpg-agent no longer has the password. After the key is
+ * not used for given time (see setUnlockTimeout()), the password is removed from
+ * gpg-agent.
+ *
+ * All methods are thread-safe.
+ */
+class GpgSession : public QObject
+{
+    Q_OBJECT
+
+public:
+    /// Creates session; @a gpgArguments are passed to each GnuPG process.
+    explicit GpgSession(const QStringList &gpgArguments, QObject *parent = NULL);
+
+    /// Cancels queued requests and waits for running ones.
+    ~GpgSession();
+
+    /**
+     * Set time in seconds to keep secret key unlocked after last use.
+     *
+     * Negative value means that password stays in gpg-agent until it expires there.
+     */
+    void setUnlockTimeout(int seconds);
+
+    /// Add request to the queue.
+    GpgRequestPtr enqueue(const QStringList &args, const QByteArray &input);
+
+    /// Wait for request to finish; returns true only if GnuPG succeeded.
+    bool waitForFinished(const GpgRequestPtr &request);
+
+    /// Remove request from the queue if it's not yet running.
+    void cancel(const GpgRequestPtr &request);
+
+    /// Run GnuPG and return its output (empty on error).
+    QByteArray run(const QStringList &args, const QByteArray &input);
+
+public slots:
+    /**
+     * Run GnuPG from script (see ItemEncryptedLoader::script()).
+     *
+     * Input and "stdout" in result are encoded in Base64. Result contains also
+     * "stderr" and "exit_code".
+     */
+    QVariantMap gpgRun(const QString &gpgArgument, const QString &inputBase64);
+
+private:
+    class WorkerThread : public QThread {
+    public:
+        explicit WorkerThread(GpgSession *session) : m_session(session) {}
+    protected:
+        void run() { m_session->processRequests(); }
+    private:
+        GpgSession *m_session;
+    };
+
+    void processRequests();
+
+    /// Take next requests to run; returns false if session is stopping.
+    bool takeRequests(QList<GpgRequestPtr> *requests);
+
+    void runRequests(const QList<GpgRequestPtr> &requests);
+
+    /// Return true if more than one decryption request is queued (call with locked mutex).
+    bool hasMoreDecryptRequests() const;
+
+    /// Return key grips of secret keys (cached after first call).
+    QStringList keyGrips();
+
+    /// Ask gpg-agent if password of a secret key is cached.
+    bool isKeyUnlocked();
+
+    /// Remove passwords of secret keys from gpg-agent.
+    void lockKeys();
+
+    QStringList m_gpgArguments;
+    int m_maxRunning;
+
+    QMutex m_mutex;
+    QWaitCondition m_queueChanged;
+    QWaitCondition m_requestFinished;
+    QList<GpgRequestPtr> m_queue;
+    bool m_stop;
+
+    bool m_unlocked;
+    int m_unlockTimeoutSeconds;
+    QElapsedTimer m_lastDecrypt;
+    QStringList m_keyGrips;
+
+    WorkerThread m_thread;
+};
+
+#endif // GPGSESSION_H
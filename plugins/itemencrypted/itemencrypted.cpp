@@ -20,6 +20,9 @@
 #include "itemencrypted.h"
 #include "ui_itemencryptedsettings.h"
 
+#include "encryptedtab.h"
+#include "gpgsession.h"
+
 #include "common/command.h"
 #include "common/common.h"
 #include "common/config.h"
@@ -30,9 +33,16 @@
 #include "gui/iconwidget.h"
 #include "item/serialize.h"
 
+#ifdef HAS_TESTS
+#   include "tests/itemencryptedtests.h"
+#endif
+
+#include <QCryptographicHash>
 #include <QDir>
 #include <QFile>
 #include <QLabel>
+#include <QMutexLocker>
+#include <QSet>
 #include <QTextEdit>
 #include <QtPlugin>
 #include <QVBoxLayout>
@@ -41,9 +51,6 @@ namespace {
 
 const char mimeEncryptedData[] = "application/x-copyq-encrypted";
 
-const char dataFileHeader[] = "CopyQ_encrypted_tab";
-const char dataFileHeaderV2[] = "CopyQ_encrypted_tab v2";
-
 struct KeyPairPaths {
     KeyPairPaths()
     {
@@ -131,22 +138,64 @@ bool keysExist()
     return !readGpgOutput( QStringList("--list-keys") ).isEmpty();
 }
 
-bool decryptMimeData(QVariantMap *detinationData, const QModelIndex &index)
+/// Requests for GnuPG which are cancelled if not used.
+class GpgRequests
+{
+public:
+    explicit GpgRequests(GpgSession *session)
+        : m_session(session)
+        , m_requests()
+    {
+    }
+
+    ~GpgRequests()
+    {
+        foreach (const GpgRequestPtr &request, m_requests)
+            m_session->cancel(request);
+    }
+
+    void enqueue(const QStringList &args, const QByteArray &input)
+    {
+        m_requests.append( m_session->enqueue(args, input) );
+    }
+
+    /// Waits for next request and returns its output (empty on error).
+    QByteArray takeNextOutput()
+    {
+        if ( m_requests.isEmpty() )
+            return QByteArray();
+
+        const GpgRequestPtr request = m_requests.takeFirst();
+        return m_session->waitForFinished(request) ? request->output : QByteArray();
+    }
+
+private:
+    GpgSession *m_session;
+    QList<GpgRequestPtr> m_requests;
+};
+
+QByteArray chunkHash(const QByteArray &chunk)
+{
+    return QCryptographicHash::hash(chunk, QCryptographicHash::Sha1);
+}
+
+bool decryptMimeData(GpgSession *session, QVariantMap *detinationData, const QModelIndex &index)
 {
     const QVariantMap data = index.data(contentType::data).toMap();
     if ( !data.contains(mimeEncryptedData) )
         return false;
 
     const QByteArray encryptedBytes = data.value(mimeEncryptedData).toByteArray();
-    const QByteArray bytes = readGpgOutput( QStringList() << "--decrypt", encryptedBytes );
+    const QByteArray bytes = session->run( QStringList("--decrypt"), encryptedBytes );
 
     return deserializeData(detinationData, bytes);
 }
 
-void encryptMimeData(const QVariantMap &data, const QModelIndex &index, QAbstractItemModel *model)
+void encryptMimeData(
+        GpgSession *session, const QVariantMap &data, const QModelIndex &index, QAbstractItemModel *model)
 {
     const QByteArray bytes = serializeData(data);
-    const QByteArray encryptedBytes = readGpgOutput( QStringList("--encrypt"), bytes );
+    const QByteArray encryptedBytes = session->run( QStringList("--encrypt"), bytes );
     QVariantMap dataMap;
     dataMap.insert(mimeEncryptedData, encryptedBytes);
     model->setData(index, dataMap, contentType::data);
@@ -154,9 +203,10 @@ void encryptMimeData(const QVariantMap &data, const QModelIndex &index, QAbstrac
 
 } // namespace
 
-ItemEncrypted::ItemEncrypted(QWidget *parent)
+ItemEncrypted::ItemEncrypted(GpgSession *session, QWidget *parent)
     : QWidget(parent)
     , ItemWidget(this)
+    , m_session(session)
 {
     QVBoxLayout *layout = new QVBoxLayout(this);
     layout->setMargin(6);
@@ -172,7 +222,7 @@ void ItemEncrypted::setEditorData(QWidget *editor, const QModelIndex &index) con
     QTextEdit *textEdit = qobject_cast<QTextEdit *>(editor);
     if (textEdit != NULL) {
         QVariantMap data;
-        if ( decryptMimeData(&data, index) ) {
+        if ( decryptMimeData(m_session, &data, index) ) {
             textEdit->setPlainText( getTextData(data, mimeText) );
             textEdit->selectAll();
         }
@@ -185,14 +235,18 @@ void ItemEncrypted::setModelData(QWidget *editor, QAbstractItemModel *model,
     // Encrypt after editing.
     QTextEdit *textEdit = qobject_cast<QTextEdit*>(editor);
     if (textEdit != NULL)
-        encryptMimeData( createDataMap(mimeText, textEdit->toPlainText()), index, model );
+        encryptMimeData( m_session, createDataMap(mimeText, textEdit->toPlainText()), index, model );
 }
 
 ItemEncryptedLoader::ItemEncryptedLoader()
     : ui()
     , m_settings()
+    , m_gpgMutex()
     , m_gpgProcessStatus(GpgNotRunning)
     , m_gpgProcess(NULL)
+    , m_session( new GpgSession(getDefaultEncryptCommandArguments(KeyPairPaths().pub), this) )
+    , m_encryptedChunks()
+    , m_encryptedChunksMutex()
 {
 }
 
@@ -204,7 +258,13 @@ ItemEncryptedLoader::~ItemEncryptedLoader()
 ItemWidget *ItemEncryptedLoader::create(const QModelIndex &index, QWidget *parent) const
 {
     const QVariantMap dataMap = index.data(contentType::data).toMap();
-    return dataMap.contains(mimeEncryptedData) ? new ItemEncrypted(parent) : NULL;
+    return dataMap.contains(mimeEncryptedData) ? new ItemEncrypted(m_session, parent) : NULL;
+}
+
+ItemRenderer *ItemEncryptedLoader::createRenderer(const QModelIndex &index, bool *handled) const
+{
+    *handled = index.data(contentType::data).toMap().contains(mimeEncryptedData);
+    return NULL;
 }
 
 QStringList ItemEncryptedLoader::formatsToSave() const
@@ -216,9 +276,17 @@ QVariantMap ItemEncryptedLoader::applySettings()
 {
     Q_ASSERT(ui != NULL);
     m_settings.insert( "encrypt_tabs", ui->plainTextEditEncryptTabs->toPlainText().split('\n') );
+    m_settings.insert( "unlock_timeout", ui->spinBoxUnlockTimeout->value() );
+    updateUnlockTimeout();
     return m_settings;
 }
 
+void ItemEncryptedLoader::loadSettings(const QVariantMap &settings)
+{
+    m_settings = settings;
+    updateUnlockTimeout();
+}
+
 QWidget *ItemEncryptedLoader::createSettingsWidget(QWidget *parent)
 {
     ui.reset(new Ui::ItemEncryptedSettings);
@@ -227,6 +295,7 @@ QWidget *ItemEncryptedLoader::createSettingsWidget(QWidget *parent)
 
     ui->plainTextEditEncryptTabs->setPlainText(
                 m_settings.value("encrypt_tabs").toStringList().join("\n") );
+    ui->spinBoxUnlockTimeout->setValue( m_settings.value("unlock_timeout", -1).toInt() );
 
     // Check if gpg application is available.
     QProcess p;
@@ -234,7 +303,7 @@ QWidget *ItemEncryptedLoader::createSettingsWidget(QWidget *parent)
     p.closeWriteChannel();
     p.waitForFinished();
     if ( !verifyProcess(&p) ) {
-        m_gpgProcessStatus = GpgNotInstalled;
+        setGpgProcessStatus(GpgNotInstalled);
     } else {
         KeyPairPaths keys;
         ui->labelShareInfo->setTextFormat(Qt::RichText);
@@ -261,12 +330,7 @@ QWidget *ItemEncryptedLoader::createSettingsWidget(QWidget *parent)
 bool ItemEncryptedLoader::canLoadItems(QFile *file) const
 {
     QDataStream stream(file);
-
-    QString header;
-    stream >> header;
-
-    return stream.status() == QDataStream::Ok
-            && (header == dataFileHeader || header == dataFileHeaderV2);
+    return readEncryptedTabVersion(&stream) != 0;
 }
 
 bool ItemEncryptedLoader::canSaveItems(const QAbstractItemModel &model) const
@@ -298,27 +362,31 @@ bool ItemEncryptedLoader::canSaveItems(const QAbstractItemModel &model) const
 
 bool ItemEncryptedLoader::loadItems(QAbstractItemModel *model, QFile *file)
 {
-    // This is needed to skip header.
-    if ( !canLoadItems(file) )
+    QDataStream stream(file);
+
+    const int version = readEncryptedTabVersion(&stream);
+    if (version == 0)
         return false;
 
-    if (m_gpgProcessStatus == GpgNotInstalled) {
+    if (gpgProcessStatus() == GpgNotInstalled) {
         emit error( tr("GnuPG must be installed to view encrypted tabs.") );
         return false;
     }
 
-    if (!importGpgKey())
+    if ( !importSecretKey() )
     {
         COPYQ_LOG("ItemEncrypted ERROR: Failte to import GPG key");
         return false;
     }
 
+    if (version == 3)
+        return loadItemChunks(model, &stream);
+
     QProcess p;
     startGpgProcess( &p, QStringList("--decrypt") );
 
     char encryptedBytes[4096];
 
-    QDataStream stream(file);
     while ( !stream.atEnd() ) {
         const int bytesRead = stream.readRawData(encryptedBytes, 4096);
         if (bytesRead == -1) {
@@ -340,79 +408,127 @@ bool ItemEncryptedLoader::loadItems(QAbstractItemModel *model, QFile *file)
         return false;
     }
 
-    QDataStream stream2(bytes);
+    const int maxItems = model->property("maxItems").toInt();
+    if ( !deserializeItems(bytes, model, maxItems) ) {
+        emitDecryptFailed();
+        COPYQ_LOG("ItemEncrypt ERROR: Failed to decrypt items!");
+        return false;
+    }
+
+    return true;
+}
 
-    quint64 maxItems = model->property("maxItems").toInt();
-    quint64 length;
-    stream2 >> length;
-    if ( length <= 0 || stream2.status() != QDataStream::Ok ) {
-        emitEncryptFailed();
-        COPYQ_LOG("ItemEncrypt ERROR: Failed to parse item count!");
+bool ItemEncryptedLoader::saveItems(const QAbstractItemModel &model, QFile *file)
+{
+    if (gpgProcessStatus() == GpgNotInstalled)
         return false;
+
+    if (model.rowCount() == 0)
+        return false; // No need to encode empty tab.
+
+    const QString tabName = model.property("tabName").toString();
+    const QList<QByteArray> chunks = serializeItemChunks(model);
+
+    // Reuse encrypted chunks which didn't change since last time.
+    EncryptedChunks oldEncryptedChunks;
+    {
+        QMutexLocker lock(&m_encryptedChunksMutex);
+        oldEncryptedChunks = m_encryptedChunks.value(tabName);
     }
-    length = qMin(length, maxItems) - model->rowCount();
 
-    for ( quint64 i = 0; i < length && stream2.status() == QDataStream::Ok; ++i ) {
-        if ( !model->insertRow(i) ) {
+    QList<QByteArray> hashes;
+    QSet<QByteArray> hashesToEncrypt;
+    QList<QByteArray> chunksToEncrypt;
+    foreach (const QByteArray &chunk, chunks) {
+        const QByteArray hash = chunkHash(chunk);
+        hashes.append(hash);
+        if ( !oldEncryptedChunks.contains(hash) && !hashesToEncrypt.contains(hash) ) {
+            hashesToEncrypt.insert(hash);
+            chunksToEncrypt.append(chunk);
+        }
+    }
+
+    COPYQ_LOG( QString("ItemEncrypt: Encrypting %1 of %2 chunks")
+               .arg(chunksToEncrypt.size())
+               .arg(chunks.size()) );
+
+    GpgRequests requests(m_session);
+    foreach (const QByteArray &chunk, chunksToEncrypt)
+        requests.enqueue( QStringList("--encrypt"), chunk );
+
+    EncryptedChunks encryptedChunks;
+    QList<QByteArray> encryptedChunkList;
+
+    foreach (const QByteArray &hash, hashes) {
+        QByteArray bytes = oldEncryptedChunks.value(hash);
+        if ( bytes.isEmpty() )
+            bytes = encryptedChunks.value(hash);
+        if ( bytes.isEmpty() )
+            bytes = requests.takeNextOutput();
+        if ( bytes.isEmpty() ) {
             emitEncryptFailed();
-            COPYQ_LOG("ItemEncrypt ERROR: Failed to insert item!");
+            COPYQ_LOG("ItemEncrypt ERROR: Failed to read encrypted data");
             return false;
         }
-        QVariantMap dataMap;
-        stream2 >> dataMap;
-        model->setData( model->index(i, 0), dataMap, contentType::data );
+
+        encryptedChunks[hash] = bytes;
+        encryptedChunkList.append(bytes);
     }
 
-    if ( stream2.status() != QDataStream::Ok ) {
+    QDataStream stream(file);
+    if ( !writeEncryptedChunks(&stream, encryptedChunkList) ) {
         emitEncryptFailed();
-        COPYQ_LOG("ItemEncrypt ERROR: Failed to decrypt item!");
+        COPYQ_LOG("ItemEncrypt ERROR: Failed to write encrypted data");
         return false;
     }
 
+    QMutexLocker lock(&m_encryptedChunksMutex);
+    m_encryptedChunks[tabName] = encryptedChunks;
+
     return true;
 }
 
-bool ItemEncryptedLoader::saveItems(const QAbstractItemModel &model, QFile *file)
+bool ItemEncryptedLoader::loadItemChunks(QAbstractItemModel *model, QDataStream *stream)
 {
-    if (m_gpgProcessStatus == GpgNotInstalled)
+    QList<QByteArray> encryptedChunks;
+    if ( !readEncryptedChunks(stream, &encryptedChunks) ) {
+        emitDecryptFailed();
+        COPYQ_LOG("ItemEncrypt ERROR: Failed to read encrypted data");
         return false;
+    }
 
-    quint64 length = model.rowCount();
-    if (length == 0)
-        return false; // No need to encode empty tab.
-
-    QByteArray bytes;
+    const QString tabName = model->property("tabName").toString();
+    const int maxItems = model->property("maxItems").toInt();
 
-    {
-        QDataStream stream(&bytes, QIODevice::WriteOnly);
-        stream.setVersion(QDataStream::Qt_4_7);
+    GpgRequests requests(m_session);
+    foreach (const QByteArray &chunk, encryptedChunks)
+        requests.enqueue( QStringList("--decrypt"), chunk );
 
-        stream << length;
+    EncryptedChunks decryptedChunks;
 
-        for (quint64 i = 0; i < length && stream.status() == QDataStream::Ok; ++i) {
-            QModelIndex index = model.index(i, 0);
-            const QVariantMap dataMap = index.data(contentType::data).toMap();
-            stream << dataMap;
+    for ( int i = 0; i < encryptedChunks.size() && model->rowCount() < maxItems; ++i ) {
+        const QByteArray bytes = requests.takeNextOutput();
+        if ( bytes.isEmpty() ) {
+            emitDecryptFailed();
+            COPYQ_LOG("ItemEncrypt ERROR: Failed to read decrypted data.");
+            return false;
         }
-    }
 
-    bytes = readGpgOutput(QStringList("--encrypt"), bytes);
-    if ( bytes.isEmpty() ) {
-        emitDecryptFailed();
-        COPYQ_LOG("ItemEncrypt ERROR: Failed to read encrypted data");
-        return false;
-    }
+        decryptedChunks.insert( chunkHash(bytes), encryptedChunks[i] );
 
-    QDataStream stream(file);
-    stream << QString(dataFileHeaderV2);
-    stream.writeRawData( bytes.data(), bytes.size() );
+        if ( !deserializeItemChunk(bytes, model, maxItems) ) {
+            emitDecryptFailed();
+            COPYQ_LOG("ItemEncrypt ERROR: Failed to decrypt item!");
+            return false;
+        }
 
-    if ( stream.status() != QDataStream::Ok ) {
-        emitDecryptFailed();
-        COPYQ_LOG("ItemEncrypt ERROR: Failed to write encrypted data");
-        return false;
+        // Show decrypted items before rest is decrypted.
+        model->submit();
     }
 
+    QMutexLocker lock(&m_encryptedChunksMutex);
+    m_encryptedChunks[tabName] = decryptedChunks;
+
     return true;
 }
 
@@ -431,7 +547,13 @@ QString ItemEncryptedLoader::script() const
         "\n" "  mime: '" + QString(mimeEncryptedData) + "',"
 
         "\n" "  gpgRun: function(gpgArg, bytes) {"
-        "\n" "    var cmd = execute('gpg', " + args + ", gpgArg, null, bytes)"
+        "\n" "    var cmd"
+        "\n" "    if (typeof(pluginObjects) != 'undefined' && pluginObjects." + id() + ") {"
+        "\n" "      cmd = pluginObjects." + id() + ".gpgRun(gpgArg, toBase64(bytes))"
+        "\n" "      cmd.stdout = fromBase64(cmd.stdout)"
+        "\n" "    } else {"
+        "\n" "      cmd = execute('gpg', " + args + ", gpgArg, null, bytes)"
+        "\n" "    }"
         "\n" "    if (!cmd)"
         "\n" "      throw 'Failed to execute GPG!'"
         "\n" "    if (cmd.exit_code != 0)"
@@ -450,6 +572,11 @@ QString ItemEncryptedLoader::script() const
         "\n" "}";
 }
 
+QObject *ItemEncryptedLoader::scriptableObject()
+{
+    return m_session;
+}
+
 QList<Command> ItemEncryptedLoader::commands() const
 {
     QList<Command> commands;
@@ -491,9 +618,19 @@ QList<Command> ItemEncryptedLoader::commands() const
     return commands;
 }
 
+QObject *ItemEncryptedLoader::tests(const TestInterfacePtr &test) const
+{
+#ifdef HAS_TESTS
+    return new ItemEncryptedTests(test);
+#else
+    Q_UNUSED(test);
+    return NULL;
+#endif
+}
+
 void ItemEncryptedLoader::setPassword()
 {
-    if (m_gpgProcessStatus == GpgGeneratingKeys)
+    if (gpgProcessStatus() == GpgGeneratingKeys)
         return;
 
     if (m_gpgProcess != NULL) {
@@ -504,7 +641,7 @@ void ItemEncryptedLoader::setPassword()
     if ( !keysExist() ) {
         // Generate keys if they don't exist.
         const KeyPairPaths keys;
-        m_gpgProcessStatus = GpgGeneratingKeys;
+        setGpgProcessStatus(GpgGeneratingKeys);
         m_gpgProcess = new QProcess(this);
         startGpgProcess( m_gpgProcess, QStringList() << "--batch" << "--gen-key" );
         m_gpgProcess->write( "\nKey-Type: RSA"
@@ -518,7 +655,7 @@ void ItemEncryptedLoader::setPassword()
         m_gpgProcess->closeWriteChannel();
     } else {
         // Change password.
-        m_gpgProcessStatus = GpgChangingPassword;
+        setGpgProcessStatus(GpgChangingPassword);
         m_gpgProcess = new QProcess(this);
         startGpgProcess( m_gpgProcess, QStringList() << "--edit-key" << "copyq" << "passwd" << "save");
     }
@@ -542,7 +679,7 @@ void ItemEncryptedLoader::terminateGpgProcess()
     p->terminate();
     p->waitForFinished();
     p->deleteLater();
-    m_gpgProcessStatus = GpgNotRunning;
+    setGpgProcessStatus(GpgNotRunning);
     updateUi();
 }
 
@@ -569,11 +706,11 @@ void ItemEncryptedLoader::onGpgProcessFinished(int exitCode, QProcess::ExitStatu
         m_gpgProcess = NULL;
     }
 
-    GpgProcessStatus oldStatus = m_gpgProcessStatus;
-    m_gpgProcessStatus = GpgNotRunning;
+    GpgProcessStatus oldStatus = gpgProcessStatus();
+    setGpgProcessStatus(GpgNotRunning);
 
     if ( oldStatus == GpgGeneratingKeys && error.isEmpty() ) {
-        importGpgKey();
+        importSecretKey();
         setPassword();
     } else {
         updateUi();
@@ -586,17 +723,18 @@ void ItemEncryptedLoader::updateUi()
     if (ui == NULL)
         return;
 
-    if (m_gpgProcessStatus == GpgNotInstalled) {
+    const GpgProcessStatus status = gpgProcessStatus();
+    if (status == GpgNotInstalled) {
         ui->labelInfo->setText("To use item encryption, install"
                                " <a href=\"http://www.gnupg.org/\">GnuPG</a>"
                                " application and restart CopyQ.");
         ui->pushButtonPassword->hide();
         ui->groupBoxEncryptTabs->hide();
         ui->groupBoxShareInfo->hide();
-    } else if (m_gpgProcessStatus == GpgGeneratingKeys) {
+    } else if (status == GpgGeneratingKeys) {
         ui->labelInfo->setText( tr("Creating new keys (this may take a few minutes)...") );
         ui->pushButtonPassword->setText( tr("Cancel") );
-    } else if (m_gpgProcessStatus == GpgChangingPassword) {
+    } else if (status == GpgChangingPassword) {
         ui->labelInfo->setText( tr("Setting new password...") );
         ui->pushButtonPassword->setText( tr("Cancel") );
     } else if ( !keysExist() ) {
@@ -608,6 +746,31 @@ void ItemEncryptedLoader::updateUi()
     }
 }
 
+ItemEncryptedLoader::GpgProcessStatus ItemEncryptedLoader::gpgProcessStatus()
+{
+    QMutexLocker lock(&m_gpgMutex);
+    return m_gpgProcessStatus;
+}
+
+void ItemEncryptedLoader::setGpgProcessStatus(GpgProcessStatus status)
+{
+    QMutexLocker lock(&m_gpgMutex);
+    m_gpgProcessStatus = status;
+}
+
+bool ItemEncryptedLoader::importSecretKey()
+{
+    // Concurrent GnuPG processes could modify the keyring at the same time.
+    QMutexLocker lock(&m_gpgMutex);
+    return importGpgKey();
+}
+
+void ItemEncryptedLoader::updateUnlockTimeout()
+{
+    const int minutes = m_settings.value("unlock_timeout", -1).toInt();
+    m_session->setUnlockTimeout(minutes < 0 ? -1 : minutes * 60);
+}
+
 void ItemEncryptedLoader::emitEncryptFailed()
 {
     emit error( tr("Encryption failed!") );
@@ -23,6 +23,8 @@
 #include "item/itemwidget.h"
 #include "gui/icons.h"
 
+#include <QHash>
+#include <QMutex>
 #include <QProcess>
 #include <QScopedPointer>
 #include <QWidget>
@@ -31,6 +33,8 @@ namespace Ui {
 class ItemEncryptedSettings;
 }
 
+class GpgSession;
+class QDataStream;
 class QFile;
 
 class ItemEncrypted : public QWidget, public ItemWidget
@@ -38,12 +42,15 @@ class ItemEncrypted : public QWidget, public ItemWidget
     Q_OBJECT
 
 public:
-    ItemEncrypted(QWidget *parent);
+    ItemEncrypted(GpgSession *session, QWidget *parent);
 
     virtual void setEditorData(QWidget *editor, const QModelIndex &index) const;
 
     virtual void setModelData(QWidget *editor, QAbstractItemModel *model,
                               const QModelIndex &index) const;
+
+private:
+    GpgSession *m_session;
 };
 
 class ItemEncryptedLoader : public QObject, public ItemLoaderInterface
@@ -59,6 +66,8 @@ public:
 
     virtual ItemWidget *create(const QModelIndex &index, QWidget *parent) const;
 
+    virtual ItemRenderer *createRenderer(const QModelIndex &index, bool *handled) const;
+
     virtual QString id() const { return "itemencrypted"; }
     virtual QString name() const { return tr("Encryption"); }
     virtual QString author() const { return QString(); }
@@ -69,7 +78,7 @@ public:
 
     virtual QVariantMap applySettings();
 
-    virtual void loadSettings(const QVariantMap &settings) { m_settings = settings; }
+    virtual void loadSettings(const QVariantMap &settings);
 
     virtual QWidget *createSettingsWidget(QWidget *parent);
 
@@ -79,6 +88,8 @@ public:
 
     virtual bool loadItems(QAbstractItemModel *model, QFile *file);
 
+    virtual bool canLoadItemsInBackground() const { return true; }
+
     virtual bool saveItems(const QAbstractItemModel &model, QFile *file);
 
     virtual bool initializeTab(QAbstractItemModel *model);
@@ -87,8 +98,16 @@ public:
 
     virtual QString script() const;
 
+    virtual QObject *scriptableObject();
+
     virtual QList<Command> commands() const;
 
+    virtual QObject *tests(const TestInterfacePtr &test) const;
+
+    virtual bool providesSearchableText() const { return true; }
+
+    virtual bool canSaveItemsInBackground() const { return true; }
+
 signals:
     void error(const QString &);
 
@@ -105,16 +124,40 @@ private:
         GpgChangingPassword
     };
 
+    /// Encrypted chunks of items by hash of decrypted chunk.
+    typedef QHash<QByteArray, QByteArray> EncryptedChunks;
+
+    bool loadItemChunks(QAbstractItemModel *model, QDataStream *stream);
+
+    GpgProcessStatus gpgProcessStatus();
+    void setGpgProcessStatus(GpgProcessStatus status);
+
+    /// Import secret key to keyring (one GnuPG process at a time).
+    bool importSecretKey();
+
     void updateUi();
 
+    void updateUnlockTimeout();
+
     void emitEncryptFailed();
     void emitDecryptFailed();
 
     QScopedPointer<Ui::ItemEncryptedSettings> ui;
     QVariantMap m_settings;
 
+    /**
+     * Guards m_gpgProcessStatus and importing the key since items are loaded
+     * and saved in other threads. Other GnuPG state is used only in main thread.
+     */
+    QMutex m_gpgMutex;
     GpgProcessStatus m_gpgProcessStatus;
     QProcess *m_gpgProcess;
+
+    GpgSession *m_session;
+
+    /// Encrypted chunks last saved or loaded for each tab.
+    QHash<QString, EncryptedChunks> m_encryptedChunks;
+    QMutex m_encryptedChunksMutex;
 };
 
 #endif // ITEMENCRYPTED_H
@@ -1,16 +1,29 @@
 include(../plugins_common.pri)
 
 HEADERS += itemencrypted.h \
+    encryptedtab.h \
+    gpgsession.h \
     ../../src/gui/iconwidget.h
-SOURCES += itemencrypted.cpp
+SOURCES += itemencrypted.cpp \
+    encryptedtab.cpp \
+    gpgsession.cpp
 SOURCES += \
     ../../src/common/common.cpp \
+    ../../src/common/datafingerprint.cpp \
     ../../src/common/config.cpp \
     ../../src/common/log.cpp \
     ../../src/common/mimetypes.cpp \
     ../../src/gui/iconfont.cpp \
     ../../src/gui/iconwidget.cpp \
+    ../../src/item/itemblobstore.cpp \
+    ../../src/item/mappeditemdata.cpp \
     ../../src/item/serialize.cpp
 FORMS   += itemencryptedsettings.ui
+
+CONFIG(debug, debug|release) {
+    SOURCES += tests/itemencryptedtests.cpp
+    HEADERS += tests/itemencryptedtests.h
+}
+
 TARGET   = $$qtLibraryTarget(itemencrypted)
 
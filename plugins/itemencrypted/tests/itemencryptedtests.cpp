@@ -0,0 +1,151 @@
+/*
+    Copyright (c) 2016, Lukas Holecek <hluk@email.cz>
+
+    This file is part of CopyQ.
+
+    CopyQ is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    CopyQ is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with CopyQ.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "itemencryptedtests.h"
+
+#include "common/contenttype.h"
+#include "common/mimetypes.h"
+#include "tests/test_utils.h"
+#include "../encryptedtab.h"
+
+#include <QBuffer>
+#include <QDataStream>
+#include <QStandardItemModel>
+
+namespace {
+
+QVariantMap testItem(int i)
+{
+    QVariantMap data;
+    data.insert( mimeText, QString("item %1").arg(i).toUtf8() );
+    if (i % 3 == 0)
+        data.insert( mimeHtml, QString("<b>item %1</b>").arg(i).toUtf8() );
+    return data;
+}
+
+void addTestItems(QStandardItemModel *model, int count)
+{
+    for (int i = 0; i < count; ++i) {
+        model->insertRow(i);
+        model->setData( model->index(i, 0), testItem(i), contentType::data );
+    }
+}
+
+QVariantMap itemData(const QAbstractItemModel &model, int row)
+{
+    return model.index(row, 0).data(contentType::data).toMap();
+}
+
+} // namespace
+
+ItemEncryptedTests::ItemEncryptedTests(const TestInterfacePtr &test, QObject *parent)
+    : QObject(parent)
+    , m_test(test)
+{
+}
+
+void ItemEncryptedTests::chunksRoundTrip()
+{
+    const int itemCount = 500;
+    QStandardItemModel model;
+    addTestItems(&model, itemCount);
+
+    const QList<QByteArray> chunks = serializeItemChunks(model);
+    QVERIFY( chunks.size() > 1 );
+
+    // Chunks are written unencrypted here; GnuPG only transforms their bytes.
+    QBuffer file;
+    QVERIFY( file.open(QIODevice::ReadWrite) );
+    {
+        QDataStream stream(&file);
+        QVERIFY( writeEncryptedChunks(&stream, chunks) );
+    }
+
+    QVERIFY( file.seek(0) );
+    QDataStream stream(&file);
+    QCOMPARE( readEncryptedTabVersion(&stream), 3 );
+
+    QList<QByteArray> chunks2;
+    QVERIFY( readEncryptedChunks(&stream, &chunks2) );
+    QCOMPARE( chunks2, chunks );
+
+    QStandardItemModel model2;
+    foreach (const QByteArray &chunk, chunks2)
+        QVERIFY( deserializeItemChunk(chunk, &model2, itemCount) );
+
+    QCOMPARE( model2.rowCount(), itemCount );
+    for (int row = 0; row < itemCount; ++row)
+        QCOMPARE( itemData(model2, row), testItem(row) );
+
+    // Serialization is stable so unchanged chunks can be reused.
+    QCOMPARE( serializeItemChunks(model2), chunks );
+}
+
+void ItemEncryptedTests::chunksMaxItems()
+{
+    QStandardItemModel model;
+    addTestItems(&model, 300);
+
+    const int maxItems = 100;
+    QStandardItemModel model2;
+    foreach ( const QByteArray &chunk, serializeItemChunks(model) )
+        QVERIFY( deserializeItemChunk(chunk, &model2, maxItems) );
+
+    QCOMPARE( model2.rowCount(), maxItems );
+    for (int row = 0; row < maxItems; ++row)
+        QCOMPARE( itemData(model2, row), testItem(row) );
+}
+
+void ItemEncryptedTests::loadVersion2()
+{
+    const int itemCount = 50;
+
+    // Header and decrypted data as saved by older versions.
+    QBuffer file;
+    QVERIFY( file.open(QIODevice::ReadWrite) );
+    {
+        QDataStream stream(&file);
+        stream << QString("CopyQ_encrypted_tab v2");
+    }
+
+    QByteArray bytes;
+    {
+        QDataStream stream(&bytes, QIODevice::WriteOnly);
+        stream << static_cast<quint64>(itemCount);
+        for (int i = 0; i < itemCount; ++i)
+            stream << testItem(i);
+    }
+
+    QVERIFY( file.seek(0) );
+    QDataStream stream(&file);
+    QCOMPARE( readEncryptedTabVersion(&stream), 2 );
+
+    QStandardItemModel model;
+    QVERIFY( deserializeItems(bytes, &model, itemCount) );
+    QCOMPARE( model.rowCount(), itemCount );
+    for (int row = 0; row < itemCount; ++row)
+        QCOMPARE( itemData(model, row), testItem(row) );
+
+    QStandardItemModel model2;
+    QVERIFY( deserializeItems(bytes, &model2, 10) );
+    QCOMPARE( model2.rowCount(), 10 );
+
+    QStandardItemModel model3;
+    QVERIFY( !deserializeItems(bytes.left(bytes.size() / 2), &model3, itemCount) );
+}
@@ -587,6 +587,11 @@ ItemWidget *ItemFakeVimLoader::transform(ItemWidget *itemWidget, const QModelInd
     return m_enabled ? new ItemFakeVim(itemWidget, m_sourceFileName) : NULL;
 }
 
+bool ItemFakeVimLoader::transformsItem(const QModelIndex &) const
+{
+    return m_enabled;
+}
+
 QObject *ItemFakeVimLoader::tests(const TestInterfacePtr &test) const
 {
 #ifdef HAS_TESTS
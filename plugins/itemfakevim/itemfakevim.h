@@ -85,8 +85,12 @@ public:
 
     virtual ItemWidget *transform(ItemWidget *itemWidget, const QModelIndex &index);
 
+    virtual bool transformsItem(const QModelIndex &index) const;
+
     virtual QObject *tests(const TestInterfacePtr &test) const;
 
+    virtual bool providesSearchableText() const { return true; }
+
 private:
     bool m_enabled;
     QString m_sourceFileName;
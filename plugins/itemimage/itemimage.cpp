@@ -21,16 +21,21 @@
 #include "ui_itemimagesettings.h"
 
 #include "common/contenttype.h"
+#include "gui/thumbnailcache.h"
 #include "item/itemeditor.h"
 
 #include <QHBoxLayout>
 #include <QModelIndex>
+#include <QPainter>
 #include <QPixmap>
 #include <QtPlugin>
 #include <QVariant>
 
 namespace {
 
+/// Margin around thumbnail (same as in ItemImage).
+const int imageMargin = 4;
+
 QString findImageFormat(const QList<QString> &formats)
 {
     // Check formats in this order.
@@ -62,29 +67,40 @@ bool getImageData(const QModelIndex &index, QByteArray *data, QString *mime)
     return true;
 }
 
-bool getPixmapFromData(const QModelIndex &index, QPixmap *pix)
+/// Return only image data of item (empty if there is no image).
+QVariantMap getImageItemData(const QModelIndex &index)
 {
-    QString mime;
-    QByteArray data;
-    if ( !getImageData(index, &data, &mime) )
-        return false;
-
-    pix->loadFromData( data, mime.toLatin1() );
-
-    return true;
+    QVariantMap data = index.data(contentType::data).toMap();
+    const QString mime = findImageFormat(data.keys());
+    if ( mime.isEmpty() )
+        return QVariantMap();
+
+    const QByteArray bytes = data[mime].toByteArray();
+    data.clear();
+    data.insert(mime, bytes);
+    return data;
 }
 
 } // namespace
 
-ItemImage::ItemImage(const QPixmap &pix, const QString &imageEditor, const QString &svgEditor,
-                     QWidget *parent)
+ItemImage::ItemImage(uint itemHash, const QVariantMap &data, const QSize &maxSize, bool cacheOnDisk,
+                     const QString &imageEditor, const QString &svgEditor, QWidget *parent)
     : QLabel(parent)
     , ItemWidget(this)
+    , m_itemHash(itemHash)
+    , m_data(data)
+    , m_maxSize(maxSize)
+    , m_cacheOnDisk(cacheOnDisk)
     , m_editor(imageEditor)
     , m_svgEditor(svgEditor)
 {
-    setMargin(4);
-    setPixmap(pix);
+    setMargin(imageMargin);
+
+    QObject *cache = sharedThumbnailCache();
+    if ( cache && !trySetThumbnail() ) {
+        connect( cache, SIGNAL(thumbnailReady(uint)),
+                 this, SLOT(onThumbnailReady(uint)) );
+    }
 }
 
 QObject *ItemImage::createExternalEditor(const QModelIndex &index, QWidget *parent) const
@@ -99,6 +115,64 @@ QObject *ItemImage::createExternalEditor(const QModelIndex &index, QWidget *pare
     return cmd.isEmpty() ? NULL : new ItemEditor(data, mime, cmd, parent);
 }
 
+void ItemImage::onThumbnailReady(uint itemHash)
+{
+    if (itemHash == m_itemHash && trySetThumbnail()) {
+        disconnect( sharedThumbnailCache(), SIGNAL(thumbnailReady(uint)),
+                    this, SLOT(onThumbnailReady(uint)) );
+        resize( sizeHint() );
+    }
+}
+
+bool ItemImage::trySetThumbnail()
+{
+    const QPixmap pix =
+            thumbnailFromSharedCache(m_itemHash, m_data, m_maxSize, false, m_cacheOnDisk);
+    if ( pix.isNull() )
+        return false;
+
+    setPixmap(pix);
+
+    // Image data are no longer needed.
+    m_data.clear();
+
+    return true;
+}
+
+ItemImageRenderer::ItemImageRenderer(
+        uint itemHash, const QVariantMap &data, const QSize &maxSize, bool cacheOnDisk)
+    : m_itemHash(itemHash)
+    , m_data(data)
+    , m_maxSize(maxSize)
+    , m_cacheOnDisk(cacheOnDisk)
+    , m_pixmap()
+{
+}
+
+QSize ItemImageRenderer::layout(const QFont &, const QSize &, int)
+{
+    if ( m_pixmap.isNull() ) {
+        m_pixmap = thumbnailFromSharedCache(m_itemHash, m_data, m_maxSize, false, m_cacheOnDisk);
+        if ( m_pixmap.isNull() )
+            return QSize();
+
+        // Image data are no longer needed.
+        m_data.clear();
+    }
+
+#if QT_VERSION >= 0x050000
+    const QSize size = m_pixmap.size() / m_pixmap.devicePixelRatio();
+#else
+    const QSize size = m_pixmap.size();
+#endif
+    return size + QSize(2 * imageMargin, 2 * imageMargin);
+}
+
+void ItemImageRenderer::paint(QPainter *painter, const QPoint &position)
+{
+    painter->drawPixmap( position + QPoint(imageMargin, imageMargin), m_pixmap );
+}
+
 ItemImageLoader::ItemImageLoader()
 {
 }
@@ -109,24 +183,36 @@ ItemImageLoader::~ItemImageLoader()
 
 ItemWidget *ItemImageLoader::create(const QModelIndex &index, QWidget *parent) const
 {
-    // TODO: Just check if image provided and load it in different thread.
-    QPixmap pix;
-    if ( !getPixmapFromData(index, &pix) )
+    // Image is decoded and scaled in background.
+    const QVariantMap data = getImageItemData(index);
+    if ( data.isEmpty() )
         return NULL;
 
-    // scale pixmap
     const int w = m_settings.value("max_image_width", 320).toInt();
     const int h = m_settings.value("max_image_height", 240).toInt();
-    if ( w > 0 && pix.width() > w && (h <= 0 || pix.width()/w > pix.height()/h) ) {
-        pix = pix.scaledToWidth(w);
-    } else if (h > 0 && pix.height() > h) {
-        pix = pix.scaledToHeight(h);
-    }
+    const uint itemHash = index.data(contentType::hash).toUInt();
+    const bool cacheOnDisk = index.model() && index.model()->property("cacheOnDisk").toBool();
 
-    return new ItemImage(pix, m_settings.value("image_editor").toString(),
+    return new ItemImage(itemHash, data, QSize(w, h), cacheOnDisk,
+                         m_settings.value("image_editor").toString(),
                          m_settings.value("svg_editor").toString(), parent);
 }
 
+ItemRenderer *ItemImageLoader::createRenderer(const QModelIndex &index, bool *handled) const
+{
+    const QVariantMap data = getImageItemData(index);
+    *handled = !data.isEmpty();
+    if (!*handled)
+        return NULL;
+
+    const int w = m_settings.value("max_image_width", 320).toInt();
+    const int h = m_settings.value("max_image_height", 240).toInt();
+    const uint itemHash = index.data(contentType::hash).toUInt();
+    const bool cacheOnDisk = index.model() && index.model()->property("cacheOnDisk").toBool();
+
+    return new ItemImageRenderer(itemHash, data, QSize(w, h), cacheOnDisk);
+}
+
 QStringList ItemImageLoader::formatsToSave() const
 {
     return QStringList("image/svg+xml") << QString("image/bmp") << QString("image/png")
@@ -24,7 +24,10 @@
 #include "item/itemwidget.h"
 
 #include <QLabel>
+#include <QPixmap>
 #include <QScopedPointer>
+#include <QSize>
+#include <QVariantMap>
 
 namespace Ui {
 class ItemImageSettings;
@@ -35,18 +38,53 @@ class ItemImage : public QLabel, public ItemWidget
     Q_OBJECT
 
 public:
-    ItemImage(const QPixmap &pix, const QString &imageEditor, const QString &svgEditor,
-              QWidget *parent);
+    /**
+     * Show thumbnail of image in @a data (loaded in background if not cached).
+     *
+     * Thumbnail is stored on disk only if @a cacheOnDisk is true.
+     */
+    ItemImage(uint itemHash, const QVariantMap &data, const QSize &maxSize, bool cacheOnDisk,
+              const QString &imageEditor, const QString &svgEditor, QWidget *parent);
 
     virtual QWidget *createEditor(QWidget *) const { return NULL; }
 
     virtual QObject *createExternalEditor(const QModelIndex &index, QWidget *parent) const;
 
+private slots:
+    void onThumbnailReady(uint itemHash);
+
 private:
+    bool trySetThumbnail();
+
+    uint m_itemHash;
+    QVariantMap m_data;
+    QSize m_maxSize;
+    bool m_cacheOnDisk;
     QString m_editor;
     QString m_svgEditor;
 };
 
+/**
+ * Paints image thumbnail without widget (same as ItemImage).
+ */
+class ItemImageRenderer : public ItemRenderer
+{
+public:
+    ItemImageRenderer(uint itemHash, const QVariantMap &data, const QSize &maxSize, bool cacheOnDisk);
+
+    /// Returns invalid size until thumbnail is loaded in background.
+    virtual QSize layout(const QFont &font, const QSize &maximumSize, int idealWidth);
+
+    virtual void paint(QPainter *painter, const QPoint &position);
+
+private:
+    uint m_itemHash;
+    QVariantMap m_data;
+    QSize m_maxSize;
+    bool m_cacheOnDisk;
+    QPixmap m_pixmap;
+};
+
 class ItemImageLoader : public QObject, public ItemLoaderInterface
 {
     Q_OBJECT
@@ -59,6 +97,8 @@ public:
 
     virtual ItemWidget *create(const QModelIndex &index, QWidget *parent) const;
 
+    virtual ItemRenderer *createRenderer(const QModelIndex &index, bool *handled) const;
+
     virtual int priority() const { return 10; }
 
     virtual QString id() const { return "itemimage"; }
@@ -75,6 +115,8 @@ public:
 
     virtual QWidget *createSettingsWidget(QWidget *parent);
 
+    virtual bool providesSearchableText() const { return true; }
+
 private:
     QVariantMap m_settings;
     QScopedPointer<Ui::ItemImageSettings> ui;
@@ -21,6 +21,7 @@
 #include "ui_itemnotessettings.h"
 
 #include "common/contenttype.h"
+#include "common/mimetypes.h"
 #include "gui/iconfont.h"
 #include "gui/iconwidget.h"
 
@@ -331,10 +332,21 @@ ItemWidget *ItemNotesLoader::transform(ItemWidget *itemWidget, const QModelIndex
             m_settings["show_tooltip"].toBool() );
 }
 
+bool ItemNotesLoader::transformsItem(const QModelIndex &index) const
+{
+    return index.data(contentType::hasNotes).toBool();
+}
+
 bool ItemNotesLoader::matches(const QModelIndex &index, const QRegExp &re) const
 {
     const QString text = index.data(contentType::notes).toString();
     return re.indexIn(text) != -1;
 }
 
+QString ItemNotesLoader::searchableText(const QVariantMap &itemData) const
+{
+    const QByteArray notes = itemData.value(mimeItemNotes).toByteArray();
+    return QString::fromUtf8( notes.constData(), notes.size() );
+}
+
 Q_EXPORT_PLUGIN2(itemnotes, ItemNotesLoader)
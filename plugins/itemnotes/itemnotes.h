@@ -102,8 +102,14 @@ public:
 
     virtual ItemWidget *transform(ItemWidget *itemWidget, const QModelIndex &index);
 
+    virtual bool transformsItem(const QModelIndex &index) const;
+
     virtual bool matches(const QModelIndex &index, const QRegExp &re) const;
 
+    virtual QString searchableText(const QVariantMap &itemData) const;
+
+    virtual bool providesSearchableText() const { return true; }
+
 private:
     QVariantMap m_settings;
     QScopedPointer<Ui::ItemNotesSettings> ui;
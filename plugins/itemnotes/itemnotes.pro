@@ -3,6 +3,7 @@ include(../plugins_common.pri)
 HEADERS += itemnotes.h \
     ../../src/gui/iconwidget.h
 SOURCES += itemnotes.cpp \
+    ../../src/common/mimetypes.cpp \
     ../../src/gui/iconfont.cpp \
     ../../src/gui/iconwidget.cpp
 FORMS   += itemnotessettings.ui
@@ -0,0 +1,262 @@
+/*
+    Copyright (c) 2016, Lukas Holecek <hluk@email.cz>
+
+    This file is part of CopyQ.
+
+    CopyQ is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    CopyQ is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with CopyQ.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#include "directorywatcher.h"
+
+#include "common/log.h"
+
+#include <QFile>
+#include <QFileSystemWatcher>
+#include <QSocketNotifier>
+
+#ifdef Q_OS_LINUX
+#   include <errno.h>
+#   include <limits.h>
+#   include <string.h>
+#   include <sys/inotify.h>
+#   include <unistd.h>
+#endif
+
+namespace {
+
+/// Interval to try to watch directory with inotify again if it failed.
+const int pollIntervalMs = 10000;
+
+} // namespace
+
+DirectoryWatcher::DirectoryWatcher(const QString &path, int intervalMs, QObject *parent)
+    : QObject(parent)
+    , m_path(path)
+    , m_inotifyFd(-1)
+    , m_inotifyWatch(-1)
+    , m_notifier(NULL)
+    , m_fallbackWatcher(NULL)
+    , m_watchedFiles()
+    , m_pollTimer()
+    , m_changedFiles()
+    , m_rescan(false)
+    , m_timer()
+{
+    m_timer.setInterval(intervalMs);
+    m_timer.setSingleShot(true);
+    connect( &m_timer, SIGNAL(timeout()),
+             this, SLOT(emitChanges()) );
+
+    m_pollTimer.setInterval(pollIntervalMs);
+    connect( &m_pollTimer, SIGNAL(timeout()),
+             this, SLOT(pollDirectory()) );
+
+    if ( !startInotify() )
+        startFallbackWatcher();
+}
+
+DirectoryWatcher::~DirectoryWatcher()
+{
+    stopInotify();
+}
+
+void DirectoryWatcher::watchFile(const QString &filePath)
+{
+    if ( m_fallbackWatcher && !m_watchedFiles.contains(filePath) ) {
+        m_watchedFiles.insert(filePath);
+        m_fallbackWatcher->addPath(filePath);
+    }
+}
+
+void DirectoryWatcher::unwatchFile(const QString &filePath)
+{
+    if ( m_fallbackWatcher && m_watchedFiles.remove(filePath) )
+        m_fallbackWatcher->removePath(filePath);
+}
+
+void DirectoryWatcher::readEvents()
+{
+#ifdef Q_OS_LINUX
+    // Buffer for at least one event with longest file name.
+    char buffer[4096 + sizeof(struct inotify_event) + NAME_MAX + 1]
+            __attribute__ ((aligned(__alignof__(struct inotify_event))));
+
+    bool rewatch = false;
+
+    for (;;) {
+        const ssize_t size = ::read(m_inotifyFd, buffer, sizeof(buffer));
+        if (size <= 0) {
+            if (size == -1 && errno == EINTR)
+                continue;
+            break;
+        }
+
+        for ( const char *p = buffer; p < buffer + size; ) {
+            const struct inotify_event *event = reinterpret_cast<const struct inotify_event *>(p);
+            p += sizeof(struct inotify_event) + event->len;
+
+            if ( (event->mask & IN_Q_OVERFLOW)
+                 || (event->wd == m_inotifyWatch && (event->mask & (IN_DELETE_SELF | IN_MOVE_SELF | IN_IGNORED))) )
+            {
+                // Watch is removed (or points to moved directory) or events were lost.
+                rewatch = true;
+                if (event->mask & IN_IGNORED)
+                    m_inotifyWatch = -1;
+            } else if (event->len > 0) {
+                m_changedFiles.insert( m_path + '/' + QFile::decodeName(event->name) );
+            }
+        }
+    }
+
+    if (rewatch) {
+        COPYQ_LOG( QString("ItemSync: Rescanning directory \"%1\"").arg(m_path) );
+        m_rescan = true;
+        if ( !rewatchDirectory() ) {
+            log( QString("ItemSync: Failed to watch directory \"%1\" again, polling for changes")
+                 .arg(m_path), LogWarning );
+            stopInotify();
+            startFallbackWatcher();
+        }
+    }
+
+    onChanged();
+#endif
+}
+
+void DirectoryWatcher::onChanged()
+{
+    if ( !m_timer.isActive() )
+        m_timer.start();
+}
+
+void DirectoryWatcher::emitChanges()
+{
+    if (m_rescan || m_fallbackWatcher) {
+        m_rescan = false;
+        m_changedFiles.clear();
+        emit directoryChanged();
+    } else if ( !m_changedFiles.isEmpty() ) {
+        const QStringList filePaths = m_changedFiles.toList();
+        m_changedFiles.clear();
+        emit filesChanged(filePaths);
+    }
+}
+
+void DirectoryWatcher::pollDirectory()
+{
+    // Failures are logged only once when falling back to polling.
+    if ( QFile::exists(m_path) && startInotify(false) ) {
+        COPYQ_LOG( QString("ItemSync: Watching directory \"%1\" with inotify again").arg(m_path) );
+        stopFallbackWatcher();
+    } else if ( !m_fallbackWatcher->directories().contains(m_path) && QFile::exists(m_path) ) {
+        m_fallbackWatcher->addPath(m_path);
+    } else {
+        // Directory is still watched or still missing.
+        return;
+    }
+
+    // Directory could have been created again or changed while not watched.
+    m_rescan = true;
+    onChanged();
+}
+
+bool DirectoryWatcher::startInotify(bool logFailure)
+{
+#ifdef Q_OS_LINUX
+    m_inotifyFd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if (m_inotifyFd == -1) {
+        if (logFailure)
+            log( QString("ItemSync: Failed to initialize inotify: %1").arg(strerror(errno)), LogWarning );
+        return false;
+    }
+
+    if ( !rewatchDirectory() ) {
+        if (logFailure) {
+            log( QString("ItemSync: Failed to watch directory \"%1\": %2")
+                 .arg(m_path).arg(strerror(errno)), LogWarning );
+        }
+        stopInotify();
+        return false;
+    }
+
+    m_notifier = new QSocketNotifier(m_inotifyFd, QSocketNotifier::Read, this);
+    connect( m_notifier, SIGNAL(activated(int)),
+             this, SLOT(readEvents()) );
+
+    return true;
+#else
+    Q_UNUSED(logFailure);
+    return false;
+#endif
+}
+
+void DirectoryWatcher::stopInotify()
+{
+#ifdef Q_OS_LINUX
+    // Notifier can be removed from its own signal handler.
+    if (m_notifier != NULL) {
+        m_notifier->setEnabled(false);
+        m_notifier->deleteLater();
+        m_notifier = NULL;
+    }
+
+    if (m_inotifyFd != -1) {
+        ::close(m_inotifyFd);
+        m_inotifyFd = -1;
+    }
+
+    m_inotifyWatch = -1;
+#endif
+}
+
+bool DirectoryWatcher::rewatchDirectory()
+{
+#ifdef Q_OS_LINUX
+    if (m_inotifyWatch != -1) {
+        inotify_rm_watch(m_inotifyFd, m_inotifyWatch);
+        m_inotifyWatch = -1;
+    }
+
+    const uint32_t mask = IN_CLOSE_WRITE | IN_CREATE | IN_DELETE | IN_MOVED_FROM | IN_MOVED_TO
+            | IN_ATTRIB | IN_DELETE_SELF | IN_MOVE_SELF | IN_ONLYDIR;
+    m_inotifyWatch = inotify_add_watch(m_inotifyFd, QFile::encodeName(m_path).constData(), mask);
+    return m_inotifyWatch != -1;
+#else
+    return false;
+#endif
+}
+
+void DirectoryWatcher::startFallbackWatcher()
+{
+    m_fallbackWatcher = new QFileSystemWatcher(this);
+    if ( QFile::exists(m_path) )
+        m_fallbackWatcher->addPath(m_path);
+    connect( m_fallbackWatcher, SIGNAL(directoryChanged(QString)),
+             this, SLOT(onChanged()) );
+    connect( m_fallbackWatcher, SIGNAL(fileChanged(QString)),
+             this, SLOT(onChanged()) );
+
+#ifdef Q_OS_LINUX
+    m_pollTimer.start();
+#endif
+}
+
+void DirectoryWatcher::stopFallbackWatcher()
+{
+    m_pollTimer.stop();
+    delete m_fallbackWatcher;
+    m_fallbackWatcher = NULL;
+    m_watchedFiles.clear();
+}
@@ -0,0 +1,107 @@
+/*
+    Copyright (c) 2016, Lukas Holecek <hluk@email.cz>
+
+    This file is part of CopyQ.
+
+    CopyQ is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    CopyQ is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with CopyQ.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#ifndef DIRECTORYWATCHER_H
+#define DIRECTORYWATCHER_H
+
+#include <QObject>
+#include <QSet>
+#include <QStringList>
+#include <QTimer>
+
+class QFileSystemWatcher;
+class QSocketNotifier;
+
+/**
+ * Watches files in a directory.
+ *
+ * On Linux, single inotify watch for the directory is used (no watches for
+ * individual files) and changed files are reported in batches.
+ *
+ * Elsewhere (or if inotify is not available), QFileSystemWatcher is used and
+ * any change is reported as directoryChanged().
+ *
+ * If the directory is removed or moved, the inotify watch is created again.
+ * If that fails, QFileSystemWatcher is used and the directory is polled until
+ * it can be watched with inotify again. Directory is scanned again only once
+ * it's watched again or it reappears.
+ *
+ * Changes are coalesced and reported at most once per given interval.
+ */
+class DirectoryWatcher : public QObject
+{
+    Q_OBJECT
+
+public:
+    DirectoryWatcher(const QString &path, int intervalMs, QObject *parent = NULL);
+
+    ~DirectoryWatcher();
+
+    const QString &path() const { return m_path; }
+
+    /// Return true if changed files are reported with filesChanged().
+    bool reportsChangedFiles() const { return m_inotifyFd != -1; }
+
+    /// Watch file for changes (no-op if changed files are reported).
+    void watchFile(const QString &filePath);
+
+    /// Stop watching file (no-op if changed files are reported).
+    void unwatchFile(const QString &filePath);
+
+signals:
+    /// Files (absolute paths) were added, modified, moved or removed.
+    void filesChanged(const QStringList &filePaths);
+
+    /// Any file could have changed and directory needs to be scanned.
+    void directoryChanged();
+
+private slots:
+    void readEvents();
+    void onChanged();
+    void emitChanges();
+    void pollDirectory();
+
+private:
+    /// Create inotify watch for the directory; return false on failure.
+    bool startInotify(bool logFailure = true);
+    void stopInotify();
+
+    /// Remove and add inotify watch for the directory; return false on failure.
+    bool rewatchDirectory();
+
+    void startFallbackWatcher();
+    void stopFallbackWatcher();
+
+    QString m_path;
+
+    int m_inotifyFd;
+    int m_inotifyWatch;
+    QSocketNotifier *m_notifier;
+
+    QFileSystemWatcher *m_fallbackWatcher;
+    QSet<QString> m_watchedFiles;
+    QTimer m_pollTimer;
+
+    QSet<QString> m_changedFiles;
+    bool m_rescan;
+    QTimer m_timer;
+};
+
+#endif // DIRECTORYWATCHER_H
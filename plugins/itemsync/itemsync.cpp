@@ -20,6 +20,8 @@
 #include "itemsync.h"
 #include "ui_itemsyncsettings.h"
 
+#include "directorywatcher.h"
+
 #include "common/log.h"
 #include "common/mimetypes.h"
 #include "common/contenttype.h"
@@ -37,20 +39,25 @@
 #include <QCryptographicHash>
 #include <QDir>
 #include <QFile>
-#include <QFileSystemWatcher>
 #include <QFileDialog>
+#include <QHash>
 #include <QLabel>
 #include <QMessageBox>
 #include <QMimeData>
 #include <QMouseEvent>
 #include <QPushButton>
 #include <QScopedPointer>
+#include <QSet>
 #include <QTextEdit>
 #include <QTimer>
 #include <QtPlugin>
 #include <QUrl>
 #include <QVariantMap>
 
+#ifdef Q_OS_UNIX
+#   include <sys/stat.h>
+#endif
+
 struct FileFormat {
     bool isValid() const { return !extensions.isEmpty(); }
     QStringList extensions;
@@ -384,6 +391,63 @@ QStringList listFiles(const QDir &dir, const QDir::SortFlags &sortFlags = QDir::
     return files;
 }
 
+QFileInfoList listFileInfos(const QDir &dir, const QDir::SortFlags &sortFlags)
+{
+    QFileInfoList infos;
+
+    const QDir::Filters itemFileFilter = QDir::Files | QDir::Readable | QDir::Writable;
+    foreach ( QFileInfo info, dir.entryInfoList(itemFileFilter, sortFlags) ) {
+        if ( canUseFile(info) )
+            infos.append(info);
+    }
+
+    return infos;
+}
+
+/// File metadata and item base name cached to find changed files quickly.
+struct FileState {
+    FileState()
+        : size(-1)
+        , lastModified(0)
+        , inode(0)
+        , isItemFile(false)
+        , baseName()
+        , ext()
+    {}
+
+    /// Return true if file wasn't modified or replaced since @a other state.
+    bool isSameFile(const FileState &other) const
+    {
+        return size == other.size && lastModified == other.lastModified && inode == other.inode;
+    }
+
+    qint64 size;
+    qint64 lastModified;
+    quint64 inode;
+
+    bool isItemFile;
+    QString baseName;
+    Ext ext;
+};
+
+/// File states by absolute file path.
+typedef QHash<QString, FileState> FileStates;
+
+FileState getFileState(const QFileInfo &info)
+{
+    FileState state;
+    state.size = info.size();
+    state.lastModified = info.lastModified().toMSecsSinceEpoch();
+
+#ifdef Q_OS_UNIX
+    struct stat buf;
+    if ( ::stat(QFile::encodeName(info.absoluteFilePath()).constData(), &buf) == 0 )
+        state.inode = buf.st_ino;
+#endif
+
+    return state;
+}
+
 /// Return true only if no file name in @a fileNames starts with @a baseName.
 bool isUniqueBaseName(const QString &baseName, const QStringList &fileNames,
                       const QStringList &baseNames = QStringList())
@@ -755,24 +819,19 @@ public:
     FileWatcher(const QString &path, const QStringList &paths, QAbstractItemModel *model,
                 const QList<FileFormat> &formatSettings, QObject *parent)
         : QObject(parent)
-        , m_watcher()
+        , m_watcher(path, updateItemsIntervalMs)
         , m_model(model)
         , m_formatSettings(formatSettings)
         , m_path(path)
         , m_valid(false)
         , m_indexData()
+        , m_fileStates()
+        , m_baseNameFiles()
     {
-        m_watcher.addPath(path);
-
-        m_updateTimer.setInterval(updateItemsIntervalMs);
-        m_updateTimer.setSingleShot(true);
-        connect( &m_updateTimer, SIGNAL(timeout()),
+        connect( &m_watcher, SIGNAL(directoryChanged()),
                  SLOT(updateItems()) );
-
-        connect( &m_watcher, SIGNAL(directoryChanged(QString)),
-                 &m_updateTimer, SLOT(start()) );
-        connect( &m_watcher, SIGNAL(fileChanged(QString)),
-                 &m_updateTimer, SLOT(start()) );
+        connect( &m_watcher, SIGNAL(filesChanged(QStringList)),
+                 SLOT(updateFiles(QStringList)) );
 
         connect( m_model.data(), SIGNAL(rowsInserted(QModelIndex, int, int)),
                  this, SLOT(onRowsInserted(QModelIndex, int, int)), Qt::UniqueConnection );
@@ -839,49 +898,48 @@ public slots:
     }
 
     /**
-     * Check for new files.
+     * Check for new, changed and removed files in whole directory.
+     *
+     * Only files with changed size, modification time or inode since these were
+     * last read or saved are read again.
      */
     void updateItems()
     {
         if ( m_model.isNull() )
             return;
 
-        lock();
-
-        QDir dir( m_watcher.directories().value(0) );
-        const QStringList files = listFiles(dir, QDir::Time | QDir::Reversed);
-        BaseNameExtensionsList fileList = listFiles(files, m_formatSettings);
-
-        for ( int row = 0; row < m_model->rowCount(); ++row ) {
-            const QModelIndex index = m_model->index(row, 0);
-            const QString baseName = getBaseName(index);
-
-            int i = 0;
-            for ( i = 0; i < fileList.size() && fileList[i].baseName != baseName; ++i ) {}
+        QSet<QString> changedBaseNames;
+        QSet<QString> filePaths;
 
-            QVariantMap dataMap;
-            QVariantMap mimeToExtension;
-
-            if ( i < fileList.size() ) {
-                updateDataAndWatchFile(dir, fileList[i], &dataMap, &mimeToExtension);
-                fileList.removeAt(i);
-            }
+        foreach ( const QFileInfo &info, listFileInfos(QDir(m_path), QDir::NoSort) ) {
+            const QString filePath = info.absoluteFilePath();
+            filePaths.insert(filePath);
+            updateFileState(filePath, &changedBaseNames);
+        }
 
-            if ( mimeToExtension.isEmpty() ) {
-                m_model->removeRow(row--);
-            } else {
-                dataMap.insert(mimeBaseName, baseName);
-                dataMap.insert(mimeExtensionMap, mimeToExtension);
-                updateIndexData(index, dataMap);
-            }
+        // Removed files.
+        foreach ( const QString &filePath, m_fileStates.keys() ) {
+            if ( !filePaths.contains(filePath) )
+                updateFileState(filePath, &changedBaseNames);
         }
 
-        createItemsFromFiles(dir, fileList);
+        updateItemsForBaseNames(changedBaseNames);
+    }
 
-        foreach (const QString &fileName, files)
-            watchPath( dir.absoluteFilePath(fileName) );
+    /**
+     * Check given files for changes (see DirectoryWatcher::filesChanged()).
+     */
+    void updateFiles(const QStringList &filePaths)
+    {
+        if ( m_model.isNull() )
+            return;
 
-        unlock();
+        QSet<QString> changedBaseNames;
+        foreach (const QString &filePath, filePaths)
+            updateFileState(filePath, &changedBaseNames);
+
+        if ( !changedBaseNames.isEmpty() )
+            updateItemsForBaseNames(changedBaseNames);
     }
 
 private slots:
@@ -933,8 +991,148 @@ private:
 
     void watchPath(const QString &path)
     {
-        if ( !m_watcher.files().contains(path) )
-            m_watcher.addPath(path);
+        m_watcher.watchFile(path);
+    }
+
+    /**
+     * Update cached state of file.
+     *
+     * @return true if file was added, changed or removed since last time
+     */
+    bool updateFileState(const QString &filePath, QSet<QString> *changedBaseNames = NULL)
+    {
+        QFileInfo info(filePath);
+        const bool exists = info.exists() && canUseFile(info);
+
+        const FileStates::iterator oldState = m_fileStates.find(filePath);
+        const bool hadState = oldState != m_fileStates.end();
+
+        FileState state;
+        if (exists) {
+            state = getFileState(info);
+            if ( hadState && oldState->isSameFile(state) )
+                return false;
+            state.isItemFile = getBaseNameExtension(
+                        filePath, m_formatSettings, &state.baseName, &state.ext);
+        } else if (!hadState) {
+            return false;
+        }
+
+        if (hadState) {
+            if (oldState->isItemFile) {
+                removeBaseNameFile(oldState->baseName, filePath);
+                if (changedBaseNames)
+                    changedBaseNames->insert(oldState->baseName);
+            }
+            m_fileStates.erase(oldState);
+        }
+
+        if (exists) {
+            if (state.isItemFile) {
+                m_baseNameFiles[state.baseName].insert(filePath);
+                if (changedBaseNames)
+                    changedBaseNames->insert(state.baseName);
+            }
+            m_fileStates.insert(filePath, state);
+            watchPath(filePath);
+        } else {
+            m_watcher.unwatchFile(filePath);
+        }
+
+        return true;
+    }
+
+    void removeBaseNameFile(const QString &baseName, const QString &filePath)
+    {
+        const QHash< QString, QSet<QString> >::iterator it = m_baseNameFiles.find(baseName);
+        if ( it != m_baseNameFiles.end() ) {
+            it->remove(filePath);
+            if ( it->isEmpty() )
+                m_baseNameFiles.erase(it);
+        }
+    }
+
+    /// Return current files for item base name (oldest first).
+    BaseNameExtensions baseNameExtensions(const QString &baseName) const
+    {
+        QList< QPair<qint64, QString> > files;
+        foreach ( const QString &filePath, m_baseNameFiles.value(baseName) )
+            files.append( qMakePair(m_fileStates[filePath].lastModified, filePath) );
+        qSort(files);
+
+        BaseNameExtensions baseNameWithExts(baseName);
+        for (int i = 0; i < files.size(); ++i)
+            baseNameWithExts.exts.append( m_fileStates[files[i].second].ext );
+
+        return baseNameWithExts;
+    }
+
+    /// Newest modification time of files for item base name.
+    qint64 lastModified(const QString &baseName) const
+    {
+        qint64 time = 0;
+        foreach ( const QString &filePath, m_baseNameFiles.value(baseName) )
+            time = qMax(time, m_fileStates[filePath].lastModified);
+        return time;
+    }
+
+    /**
+     * Update items for changed base names, remove items without files
+     * and create items for new files.
+     */
+    void updateItemsForBaseNames(const QSet<QString> &changedBaseNames)
+    {
+        lock();
+
+        const QDir dir(m_path);
+
+        QSet<QString> existingBaseNames;
+        QList<int> rowsToRemove;
+
+        for ( int row = 0; row < m_model->rowCount(); ++row ) {
+            const QModelIndex index = m_model->index(row, 0);
+            const QString baseName = getBaseName(index);
+            existingBaseNames.insert(baseName);
+
+            if ( !m_baseNameFiles.contains(baseName) ) {
+                rowsToRemove.append(row);
+                continue;
+            }
+
+            if ( !changedBaseNames.contains(baseName) )
+                continue;
+
+            QVariantMap dataMap;
+            QVariantMap mimeToExtension;
+            updateDataAndWatchFile(dir, baseNameExtensions(baseName), &dataMap, &mimeToExtension);
+
+            if ( mimeToExtension.isEmpty() ) {
+                rowsToRemove.append(row);
+            } else {
+                dataMap.insert(mimeBaseName, baseName);
+                dataMap.insert(mimeExtensionMap, mimeToExtension);
+                updateIndexData(index, dataMap);
+            }
+        }
+
+        for (int i = rowsToRemove.size() - 1; i >= 0; --i)
+            m_model->removeRow( rowsToRemove[i] );
+
+        // Create items for new files (oldest first so newest are on top).
+        QList< QPair<qint64, QString> > newBaseNames;
+        foreach (const QString &baseName, changedBaseNames) {
+            if ( !existingBaseNames.contains(baseName) && m_baseNameFiles.contains(baseName) )
+                newBaseNames.append( qMakePair(lastModified(baseName), baseName) );
+        }
+        qSort(newBaseNames);
+
+        BaseNameExtensionsList fileList;
+        for (int i = 0; i < newBaseNames.size(); ++i)
+            fileList.append( baseNameExtensions(newBaseNames[i].second) );
+
+        createItemsFromFiles(dir, fileList);
+
+        unlock();
     }
 
     bool createItem(const QVariantMap &dataMap, int targetRow)
@@ -1066,6 +1264,10 @@ private:
                 // Remove files of removed formats.
                 removeFormatFiles(filePath, oldMimeToExtension);
             }
+
+            // Avoid reading saved files again in updateItems().
+            foreach ( const QVariant &ext, mimeToExtension.values() )
+                updateFileState( filePath + ext.toString() );
         }
 
         unlock();
@@ -1177,6 +1379,9 @@ private:
 
             const QString fileName = basePath + ext.extension;
 
+            // Get file state before reading so later changes are not missed.
+            updateFileState(fileName);
+
             QFile f( dir.absoluteFilePath(fileName) );
             if ( !f.open(QIODevice::ReadOnly) )
                 continue;
@@ -1235,13 +1440,15 @@ private:
         return copied;
     }
 
-    QFileSystemWatcher m_watcher;
+    DirectoryWatcher m_watcher;
     QPointer<QAbstractItemModel> m_model;
-    QTimer m_updateTimer;
     const QList<FileFormat> &m_formatSettings;
     QString m_path;
     bool m_valid;
     IndexDataList m_indexData;
+    FileStates m_fileStates;
+    /// File paths by item base name (only for files in m_fileStates).
+    QHash< QString, QSet<QString> > m_baseNameFiles;
 };
 
 ItemSyncLoader::ItemSyncLoader()
@@ -1451,6 +1658,11 @@ ItemWidget *ItemSyncLoader::transform(ItemWidget *itemWidget, const QModelIndex
     return new ItemSync(baseName, iconForItem(index, m_formatSettings), itemWidget);
 }
 
+bool ItemSyncLoader::transformsItem(const QModelIndex &index) const
+{
+    return !getBaseName(index).isEmpty();
+}
+
 bool ItemSyncLoader::canRemoveItems(const QList<QModelIndex> &indexList)
 {
     return !containsItemsWithFiles(indexList)
@@ -1562,6 +1774,11 @@ bool ItemSyncLoader::matches(const QModelIndex &index, const QRegExp &re) const
     return re.indexIn(text) != -1;
 }
 
+QString ItemSyncLoader::searchableText(const QVariantMap &itemData) const
+{
+    return itemData.value(mimeBaseName).toString();
+}
+
 QObject *ItemSyncLoader::tests(const TestInterfacePtr &test) const
 {
 #ifdef HAS_TESTS
@@ -122,6 +122,8 @@ public:
 
     virtual ItemWidget *transform(ItemWidget *itemWidget, const QModelIndex &index);
 
+    virtual bool transformsItem(const QModelIndex &index) const;
+
     virtual bool canRemoveItems(const QList<QModelIndex> &indexList);
 
     virtual bool canMoveItems(const QList<QModelIndex> &indexList);
@@ -132,6 +134,10 @@ public:
 
     virtual bool matches(const QModelIndex &index, const QRegExp &re) const;
 
+    virtual QString searchableText(const QVariantMap &itemData) const;
+
+    virtual bool providesSearchableText() const { return true; }
+
     virtual QObject *tests(const TestInterfacePtr &test) const;
 
     virtual const QObject *signaler() const { return this; }
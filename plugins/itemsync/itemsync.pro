@@ -1,12 +1,15 @@
 include(../plugins_common.pri)
 
 HEADERS += itemsync.h \
+    directorywatcher.h \
     ../../src/gui/iconselectbutton.h \
     ../../src/gui/iconselectdialog.h \
     ../../src/gui/iconwidget.h
-SOURCES += itemsync.cpp
+SOURCES += itemsync.cpp \
+    directorywatcher.cpp
 SOURCES += \
     ../../src/common/common.cpp \
+    ../../src/common/datafingerprint.cpp \
     ../../src/common/config.cpp \
     ../../src/common/log.cpp \
     ../../src/common/mimetypes.cpp \
@@ -14,6 +17,8 @@ SOURCES += \
     ../../src/gui/iconselectbutton.cpp \
     ../../src/gui/iconselectdialog.cpp \
     ../../src/gui/iconwidget.cpp \
+    ../../src/item/itemblobstore.cpp \
+    ../../src/item/mappeditemdata.cpp \
     ../../src/item/serialize.cpp
 FORMS   += itemsyncsettings.ui
 
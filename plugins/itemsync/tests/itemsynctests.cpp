@@ -367,6 +367,50 @@ void ItemSyncTests::modifyFiles()
     RUN(args << "size", "4\n");
 }
 
+void ItemSyncTests::replaceFiles()
+{
+    TestDir dir1(1);
+    const QString tab1 = testTab(1);
+    const Args args = Args() << "separator" << "," << "tab" << tab1;
+
+    RUN(args << "add" << "A" << "B" << "C", "");
+
+    const QString fileB = fileNameForId(1);
+
+    // Replace file with other one with same size (hidden files are ignored).
+    const QString tmpFile = ".copyq_replace.txt";
+    QCOMPARE( createFile(dir1, tmpFile, "X"), QByteArray() );
+    QVERIFY( dir1.remove(fileB) );
+    QVERIFY( QFile::rename(dir1.filePath(tmpFile), dir1.filePath(fileB)) );
+
+    WAIT_ON_OUTPUT(args << "read" << "0" << "1" << "2", "C,X,A");
+    RUN(args << "size", "3\n");
+}
+
+void ItemSyncTests::manyFiles()
+{
+    TestDir dir1(1);
+    const QString tab1 = testTab(1);
+    const Args args = Args() << "tab" << tab1;
+
+    const int fileCount = 100;
+    for (int i = 0; i < fileCount; ++i)
+        TEST( createFile(dir1, QString("test_%1.txt").arg(i, 5, 10, QChar('0')), QByteArray::number(i)) );
+
+    RUN(args << "size", QString::number(fileCount) + "\n");
+
+    TEST( createFile(dir1, "test_new.txt", "NEW") );
+    WAIT_ON_OUTPUT(args << "read" << "0", "NEW");
+
+    FilePtr file = dir1.file("test_new.txt");
+    QVERIFY(file->open(QIODevice::WriteOnly));
+    file->write("CHANGED");
+    file->close();
+    WAIT_ON_OUTPUT(args << "read" << "0", "CHANGED");
+
+    RUN(args << "size", QString::number(fileCount + 1) + "\n");
+}
+
 void ItemSyncTests::notes()
 {
     TestDir dir1(1);
@@ -493,3 +537,31 @@ void ItemSyncTests::customFormats()
         data5 + data6 + ";" + data3 + ";" + data1 + data4);
     RUN(args << "size", "3\n");
 }
+
+void ItemSyncTests::benchmarkManyFiles()
+{
+    if ( !property("CopyQ_benchmarks").toBool() )
+        SKIP("Run with \"copyq benchmarks\".");
+
+    TestDir dir1(1);
+    const QString tab1 = testTab(1);
+    const Args args = Args() << "tab" << tab1;
+
+    const int fileCount = 50000;
+    for (int i = 0; i < fileCount; ++i)
+        TEST( createFile(dir1, QString("test_%1.txt").arg(i, 5, 10, QChar('0')), QByteArray::number(i)) );
+
+    // Measure time to load the tab and to pick up new and modified file.
+    QBENCHMARK_ONCE {
+        QCOMPARE( m_test->run(args << "size"), 0 );
+
+        TEST( createFile(dir1, "test_new.txt", "NEW") );
+        WAIT_ON_OUTPUT(args << "read" << "0", "NEW");
+
+        FilePtr file = dir1.file("test_new.txt");
+        QVERIFY(file->open(QIODevice::WriteOnly));
+        file->write("CHANGED");
+        file->close();
+        WAIT_ON_OUTPUT(args << "read" << "0", "CHANGED");
+    }
+}
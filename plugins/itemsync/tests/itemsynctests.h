@@ -50,11 +50,17 @@ private slots:
 
     void modifyItems();
     void modifyFiles();
+    void replaceFiles();
+
+    void manyFiles();
 
     void notes();
 
     void customFormats();
 
+    /// Run only with "copyq benchmarks".
+    void benchmarkManyFiles();
+
 private:
     TestInterfacePtr m_test;
 };
@@ -477,11 +477,22 @@ ItemWidget *ItemTagsLoader::transform(ItemWidget *itemWidget, const QModelIndex
     return new ItemTags(itemWidget, tags);
 }
 
+bool ItemTagsLoader::transformsItem(const QModelIndex &index) const
+{
+    // Same as checking result of toTags() but without looking up tag styles.
+    return !tags(index).split(',', QString::SkipEmptyParts).isEmpty();
+}
+
 bool ItemTagsLoader::matches(const QModelIndex &index, const QRegExp &re) const
 {
     return re.indexIn(tags(index)) != -1;
 }
 
+QString ItemTagsLoader::searchableText(const QVariantMap &itemData) const
+{
+    return getTextData(itemData, mimeTags);
+}
+
 QObject *ItemTagsLoader::tests(const TestInterfacePtr &test) const
 {
 #ifdef HAS_TESTS
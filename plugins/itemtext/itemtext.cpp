@@ -23,9 +23,12 @@
 #include "common/contenttype.h"
 #include "common/mimetypes.h"
 
+#include <QApplication>
 #include <QContextMenuEvent>
+#include <QDesktopWidget>
 #include <QModelIndex>
 #include <QMouseEvent>
+#include <QPainter>
 #include <QScrollBar>
 #include <QTextBlock>
 #include <QTextCursor>
@@ -33,6 +36,8 @@
 #include <QAbstractTextDocumentLayout>
 #include <QtPlugin>
 
+#include <qmath.h>
+
 namespace {
 
 // Limit number of characters for performance reasons.
@@ -44,6 +49,9 @@ const char optionMaximumHeight[] = "max_height";
 
 const char mimeRichText[] = "text/richtext";
 
+/// Mark shown after last line if some lines are not shown (same as in ItemText).
+const QString moreLinesMark = QString(" ") + QChar(0x2026) + " ";
+
 // Some applications insert \0 teminator at the end of text data.
 // It needs to be removed because QTextBrowser can render the character.
 void removeTrailingNull(QString *text)
@@ -197,6 +205,119 @@ bool ItemText::eventFilter(QObject *, QEvent *event)
     return ItemWidget::filterMouseEvents(this, event);
 }
 
+ItemTextRenderer::ItemTextRenderer(const QString &text, int maxLines, int maximumHeight)
+    : m_layout()
+    , m_maxLines(maxLines)
+    , m_maximumHeight(maximumHeight)
+    , m_size()
+    , m_moreLinesRect()
+    , m_re()
+    , m_highlight()
+{
+    // Paragraphs are separated by line separators in single layout.
+    QString layoutText = normalizeText(text);
+    layoutText.replace("\r\n", QString(QChar::LineSeparator));
+    layoutText.replace('\n', QChar::LineSeparator);
+    layoutText.replace('\r', QChar::LineSeparator);
+    m_layout.setText(layoutText);
+    m_layout.setCacheEnabled(true);
+}
+
+QSize ItemTextRenderer::layout(const QFont &font, const QSize &maximumSize, int idealWidth)
+{
+    m_layout.setFont(font);
+
+    QTextOption option = m_layout.textOption();
+    option.setWrapMode( maximumSize.width() > idealWidth
+                        ? QTextOption::NoWrap : QTextOption::WrapAtWordBoundaryOrAnywhere );
+    m_layout.setTextOption(option);
+
+    const int maximumHeight = 0 < m_maximumHeight && m_maximumHeight < maximumSize.height()
+            ? m_maximumHeight : maximumSize.height();
+
+    // Lay out only lines which can be visible.
+    qreal width = 0;
+    qreal height = 0;
+    int lineCount = 0;
+    int textEnd = 0;
+    m_layout.beginLayout();
+    while ( (m_maxLines <= 0 || lineCount < m_maxLines) && height < maximumHeight ) {
+        QTextLine line = m_layout.createLine();
+        if ( !line.isValid() )
+            break;
+        line.setLineWidth(idealWidth);
+        line.setPosition( QPointF(0, height) );
+        height += line.height();
+        width = qMax( width, line.naturalTextWidth() );
+        textEnd = line.textStart() + line.textLength();
+        ++lineCount;
+    }
+    m_layout.endLayout();
+
+    m_moreLinesRect = QRectF();
+    if ( lineCount > 0 && textEnd < m_layout.text().size() ) {
+        const QTextLine lastLine = m_layout.lineAt(lineCount - 1);
+        const QFontMetricsF metrics(font);
+        m_moreLinesRect = QRectF(
+                    lastLine.naturalTextWidth(), lastLine.y(),
+                    metrics.width(moreLinesMark), lastLine.height() );
+        width = qMax( width, m_moreLinesRect.right() );
+    }
+
+    // Same bottom margin as in ItemText.
+    const int h = qCeil(height) + 4 * QApplication::desktop()->logicalDpiY() / 96;
+    m_size = QSize( qCeil(width), qMin(h, maximumHeight) );
+    return m_size;
+}
+
+void ItemTextRenderer::paint(QPainter *painter, const QPoint &position)
+{
+    const QRect rect(position, m_size);
+    painter->setClipRect(rect, Qt::IntersectClip);
+    m_layout.draw(painter, position, m_highlight, rect);
+
+    if ( m_moreLinesRect.isValid() ) {
+        const QRectF markRect = m_moreLinesRect.translated(position);
+        painter->save();
+        painter->setPen(Qt::NoPen);
+        painter->setBrush( QColor(0, 0, 0, 30) );
+        painter->drawRoundedRect(markRect, 4, 4);
+        painter->restore();
+        painter->drawText(markRect, Qt::AlignCenter, moreLinesMark);
+    }
+}
+
+void ItemTextRenderer::setHighlight(
+        const QRegExp &re, const QFont &, const QPalette &highlightPalette)
+{
+    if (m_re == re)
+        return;
+
+    m_re = re;
+    m_highlight.clear();
+
+    if ( re.isEmpty() )
+        return;
+
+    // Highlight font would change text layout so only colors are used.
+    QTextLayout::FormatRange range;
+    range.format.setBackground( highlightPalette.base() );
+    range.format.setForeground( highlightPalette.text() );
+
+    const QString &text = m_layout.text();
+    for ( int i = re.indexIn(text); i != -1; i = re.indexIn(text, i) ) {
+        const int length = re.matchedLength();
+        if (length > 0) {
+            range.start = i;
+            range.length = length;
+            m_highlight.append(range);
+        }
+        i += qMax(1, length);
+        if ( i >= text.size() )
+            break;
+    }
+}
+
 ItemTextLoader::ItemTextLoader()
 {
 }
@@ -219,6 +340,23 @@ ItemWidget *ItemTextLoader::create(const QModelIndex &index, QWidget *parent) co
     return new ItemText(text, isRichText, maxLines, maxHeight, parent);
 }
 
+ItemRenderer *ItemTextLoader::createRenderer(const QModelIndex &index, bool *handled) const
+{
+    QString text;
+    const bool isRichText = m_settings.value(optionUseRichText, true).toBool()
+            && getRichText(index, &text);
+
+    *handled = isRichText || getText(index, &text);
+
+    // Rich text is shown only in widget.
+    if (isRichText || !*handled)
+        return NULL;
+
+    const int maxLines = m_settings.value(optionMaximumLines, 0).toInt();
+    const int maxHeight = m_settings.value(optionMaximumHeight, 0).toInt();
+    return new ItemTextRenderer(text, maxLines, maxHeight);
+}
+
 QStringList ItemTextLoader::formatsToSave() const
 {
     return m_settings.value(optionUseRichText, true).toBool()
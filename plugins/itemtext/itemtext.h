@@ -23,9 +23,13 @@
 #include "gui/icons.h"
 #include "item/itemwidget.h"
 
+#include <QRegExp>
 #include <QScopedPointer>
+#include <QSize>
 #include <QTextDocument>
 #include <QTextBrowser>
+#include <QTextLayout>
+#include <QVector>
 
 namespace Ui {
 class ItemTextSettings;
@@ -51,6 +55,32 @@ private:
     int m_maximumHeight;
 };
 
+/**
+ * Paints plain text item without widget (same as ItemText without rich text).
+ */
+class ItemTextRenderer : public ItemRenderer
+{
+public:
+    ItemTextRenderer(const QString &text, int maxLines, int maximumHeight);
+
+    virtual QSize layout(const QFont &font, const QSize &maximumSize, int idealWidth);
+
+    virtual void paint(QPainter *painter, const QPoint &position);
+
+    virtual void setHighlight(const QRegExp &re, const QFont &highlightFont,
+                              const QPalette &highlightPalette);
+
+private:
+    QTextLayout m_layout;
+    int m_maxLines;
+    int m_maximumHeight;
+    QSize m_size;
+    /// Position of mark after last line if some lines are not shown (invalid if all are shown).
+    QRectF m_moreLinesRect;
+    QRegExp m_re;
+    QVector<QTextLayout::FormatRange> m_highlight;
+};
+
 class ItemTextLoader : public QObject, public ItemLoaderInterface
 {
     Q_OBJECT
@@ -63,6 +93,8 @@ public:
 
     virtual ItemWidget *create(const QModelIndex &index, QWidget *parent) const;
 
+    virtual ItemRenderer *createRenderer(const QModelIndex &index, bool *handled) const;
+
     virtual QString id() const { return "itemtext"; }
     virtual QString name() const { return tr("Text"); }
     virtual QString author() const { return QString(); }
@@ -77,6 +109,8 @@ public:
 
     virtual QWidget *createSettingsWidget(QWidget *parent);
 
+    virtual bool providesSearchableText() const { return true; }
+
 private:
     QVariantMap m_settings;
     QScopedPointer<Ui::ItemTextSettings> ui;
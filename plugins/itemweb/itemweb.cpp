@@ -220,6 +220,14 @@ ItemWidget *ItemWebLoader::create(const QModelIndex &index, QWidget *parent) con
     return NULL;
 }
 
+ItemRenderer *ItemWebLoader::createRenderer(const QModelIndex &index, bool *handled) const
+{
+    // Web page is always shown in widget.
+    QString html;
+    *handled = getHtml(index, &html);
+    return NULL;
+}
+
 QStringList ItemWebLoader::formatsToSave() const
 {
     return QStringList("text/plain") << QString("text/html");
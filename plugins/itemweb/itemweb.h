@@ -84,6 +84,8 @@ public:
 
     virtual ItemWidget *create(const QModelIndex &index, QWidget *parent) const;
 
+    virtual ItemRenderer *createRenderer(const QModelIndex &index, bool *handled) const;
+
     virtual int priority() const { return 10; }
 
     virtual QString id() const { return "itemweb"; }
@@ -100,6 +102,8 @@ public:
 
     virtual QWidget *createSettingsWidget(QWidget *parent);
 
+    virtual bool providesSearchableText() const { return true; }
+
 private:
     QVariantMap m_settings;
     QScopedPointer<Ui::ItemWebSettings> ui;
@@ -0,0 +1,309 @@
+/*
+    Copyright (c) 2016, Lukas Holecek <hluk@email.cz>
+
+    This file is part of CopyQ.
+
+    CopyQ is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    CopyQ is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with CopyQ.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#include "clipboardbatchclient.h"
+
+#include "common/arguments.h"
+#include "common/clientsocket.h"
+#include "common/client_server.h"
+#include "common/commandstatus.h"
+#include "common/log.h"
+#include "platform/platformnativeinterface.h"
+#include "platform/platformwindow.h"
+
+#include <QCoreApplication>
+#include <QDataStream>
+#include <QFile>
+#include <QSocketNotifier>
+#include <QStringList>
+#include <QThread>
+
+#ifdef Q_OS_UNIX
+#   include <errno.h>
+#   include <unistd.h>
+#endif
+
+namespace {
+
+QByteArray escapeOutput(const QByteArray &output)
+{
+    QByteArray result;
+    result.reserve( output.size() );
+
+    foreach (char c, output) {
+        if (c == '\\')
+            result.append("\\\\");
+        else if (c == '\n')
+            result.append("\\n");
+        else if (c == '\t')
+            result.append("\\t");
+        else if (c == '\r')
+            result.append("\\r");
+        else
+            result.append(c);
+    }
+
+    return result;
+}
+
+QByteArray unescapeInput(const QByteArray &input)
+{
+    QByteArray result;
+    result.reserve( input.size() );
+
+    for (int i = 0; i < input.size(); ++i) {
+        const char c = input[i];
+        if (c != '\\' || i + 1 == input.size()) {
+            result.append(c);
+            continue;
+        }
+
+        const char next = input[++i];
+        if (next == 'n')
+            result.append('\n');
+        else if (next == 't')
+            result.append('\t');
+        else if (next == 'r')
+            result.append('\r');
+        else
+            result.append(next);
+    }
+
+    return result;
+}
+
+void writeResponse(const QByteArray &id, int exitCode, const QByteArray &output)
+{
+    QFile f;
+    f.open(stdout, QIODevice::WriteOnly);
+    f.write(id + '\t' + QByteArray::number(exitCode) + '\t' + escapeOutput(output) + '\n');
+    f.flush();
+}
+
+} // namespace
+
+void LineReader::readLines()
+{
+    QFile in;
+    in.open(stdin, QIODevice::ReadOnly);
+
+    for (;;) {
+        const QByteArray line = in.readLine();
+        if ( line.isEmpty() )
+            break;
+        emit lineRead(line);
+    }
+
+    emit finished();
+}
+
+ClipboardBatchClient::ClipboardBatchClient(int &argc, char **argv, const QString &sessionName)
+    : QObject()
+    , App(createPlatformNativeInterface()->createClientApplication(argc, argv), sessionName)
+    , m_socket(new ClientSocket(clipboardServerName()))
+    , m_inputNotifier(NULL)
+    , m_input()
+    , m_requests()
+    , m_lastRequestId(0)
+    , m_inputFinished(false)
+{
+    restoreSettings();
+
+    connect( m_socket, SIGNAL(disconnected()),
+             this, SLOT(onDisconnected()) );
+    connect( m_socket, SIGNAL(connectionFailed()),
+             this, SLOT(onConnectionFailed()) );
+
+    connect( m_socket, SIGNAL(disconnected()),
+             m_socket, SLOT(deleteAfterDisconnected()) );
+    connect( m_socket, SIGNAL(connectionFailed()),
+             m_socket, SLOT(deleteAfterDisconnected()) );
+    connect( qApp, SIGNAL(aboutToQuit()),
+             m_socket, SLOT(deleteAfterDisconnected()) );
+
+    m_socket->start();
+
+    if ( !wasClosed() ) {
+        m_socket->startBatchMode();
+        startInputReader();
+    }
+}
+
+void ClipboardBatchClient::exit(int exitCode)
+{
+    stopInputReader();
+    App::exit(exitCode);
+}
+
+void ClipboardBatchClient::readInput()
+{
+#ifdef Q_OS_UNIX
+    // Notifier reports that single read() won't block.
+    char buffer[4096];
+    ssize_t size;
+    do {
+        size = ::read(STDIN_FILENO, buffer, sizeof(buffer));
+    } while (size == -1 && errno == EINTR);
+
+    if (size > 0) {
+        onInputRead( QByteArray(buffer, static_cast<int>(size)) );
+    } else {
+        stopInputReader();
+        onInputFinished();
+    }
+#endif
+}
+
+void ClipboardBatchClient::onInputRead(const QByteArray &data)
+{
+    m_input.append(data);
+
+    int start = 0;
+    for ( int end = m_input.indexOf('\n'); end != -1; end = m_input.indexOf('\n', start) ) {
+        QByteArray line = m_input.mid(start, end - start);
+        start = end + 1;
+
+        if ( line.endsWith('\r') )
+            line.chop(1);
+
+        if ( !line.isEmpty() )
+            runRequest(line);
+    }
+
+    m_input.remove(0, start);
+}
+
+void ClipboardBatchClient::runRequest(const QByteArray &line)
+{
+    if ( wasClosed() )
+        return;
+
+    const QList<QByteArray> fields = line.split('\t');
+
+    Request request;
+    request.id = fields.value(0);
+
+    QStringList arguments;
+    for (int i = 1; i < fields.size(); ++i)
+        arguments.append( QString::fromUtf8(unescapeInput(fields[i])) );
+
+    const Arguments args(arguments);
+
+    ClientSocket *channel = new ClientSocket(m_socket, ++m_lastRequestId);
+    channel->setParent(this);
+    connect( channel, SIGNAL(messageReceived(QByteArray,int)),
+             this, SLOT(onMessageReceived(QByteArray,int)) );
+    m_requests.insert(channel, request);
+
+    QByteArray msg;
+    QDataStream out(&msg, QIODevice::WriteOnly);
+    out << args;
+    channel->sendMessage(msg, 0);
+}
+
+void ClipboardBatchClient::onInputFinished()
+{
+    if (m_inputFinished)
+        return;
+
+    // Last line doesn't need to end with new line.
+    onInputRead("\n");
+
+    COPYQ_LOG("Standard input closed.");
+    m_inputFinished = true;
+    exitIfFinished();
+}
+
+void ClipboardBatchClient::onMessageReceived(const QByteArray &data, int messageCode)
+{
+    ClientSocket *channel = qobject_cast<ClientSocket*>(sender());
+    if ( !m_requests.contains(channel) )
+        return;
+
+    if (messageCode == CommandActivateWindow) {
+        COPYQ_LOG("Activating window.");
+        PlatformWindowPtr window = createPlatformNativeInterface()->deserialize(data);
+        if (window)
+            window->raise();
+    } else if (messageCode == CommandReadInput) {
+        // Commands in batch mode have no standard input.
+        channel->sendMessage(QByteArray(), 0);
+    } else {
+        m_requests[channel].output.append(data);
+    }
+
+    if (messageCode == CommandFinished || messageCode == CommandBadSyntax || messageCode == CommandError) {
+        const Request request = m_requests.take(channel);
+        writeResponse(request.id, messageCode, request.output);
+        channel->deleteLater();
+        exitIfFinished();
+    }
+}
+
+void ClipboardBatchClient::onDisconnected()
+{
+    if ( wasClosed() )
+        return;
+
+    log( tr("Connection lost!"), LogError );
+    exit(1);
+}
+
+void ClipboardBatchClient::onConnectionFailed()
+{
+    log( tr("Cannot connect to server! Start CopyQ server first."), LogError );
+    exit(1);
+}
+
+void ClipboardBatchClient::startInputReader()
+{
+#ifdef Q_OS_UNIX
+    m_inputNotifier = new QSocketNotifier(STDIN_FILENO, QSocketNotifier::Read, this);
+    connect( m_inputNotifier, SIGNAL(activated(int)), this, SLOT(readInput()) );
+#else
+    // Standard input cannot be watched with QSocketNotifier on other platforms.
+    // Reader thread ends when input is closed, or it's stopped with the process.
+    LineReader *reader = new LineReader;
+    QThread *thread = new QThread;
+    reader->moveToThread(thread);
+    connect( thread, SIGNAL(started()), reader, SLOT(readLines()) );
+    connect( reader, SIGNAL(finished()), thread, SLOT(quit()) );
+    connect( thread, SIGNAL(finished()), reader, SLOT(deleteLater()) );
+    connect( thread, SIGNAL(finished()), thread, SLOT(deleteLater()) );
+    connect( reader, SIGNAL(lineRead(QByteArray)), this, SLOT(onInputRead(QByteArray)) );
+    connect( reader, SIGNAL(finished()), this, SLOT(onInputFinished()) );
+    thread->start();
+#endif
+}
+
+void ClipboardBatchClient::stopInputReader()
+{
+    if (m_inputNotifier) {
+        m_inputNotifier->setEnabled(false);
+        m_inputNotifier->deleteLater();
+        m_inputNotifier = NULL;
+    }
+}
+
+void ClipboardBatchClient::exitIfFinished()
+{
+    if (m_inputFinished && m_requests.isEmpty())
+        exit(0);
+}
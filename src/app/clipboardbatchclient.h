@@ -0,0 +1,106 @@
+/*
+    Copyright (c) 2016, Lukas Holecek <hluk@email.cz>
+
+    This file is part of CopyQ.
+
+    CopyQ is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    CopyQ is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with CopyQ.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#ifndef CLIPBOARDBATCHCLIENT_H
+#define CLIPBOARDBATCHCLIENT_H
+
+#include "app.h"
+
+#include <QHash>
+#include <QObject>
+
+class ClientSocket;
+class QSocketNotifier;
+
+/// Reads lines from standard input in a thread where stdin cannot be watched with QSocketNotifier.
+class LineReader : public QObject
+{
+    Q_OBJECT
+
+public slots:
+    void readLines();
+
+signals:
+    void lineRead(const QByteArray &line);
+    void finished();
+};
+
+/**
+ * Application client running multiple commands over single connection.
+ *
+ * Reads requests from standard input, each on separate line:
+ *
+ *     ID<TAB>COMMAND<TAB>ARGUMENT...
+ *
+ * Commands are sent to server without waiting for previous ones to finish.
+ * For each finished command a line is printed on standard output:
+ *
+ *     ID<TAB>EXIT_CODE<TAB>OUTPUT
+ *
+ * where backslash, new line, tab and carriage return characters in output are
+ * escaped. Arguments in requests are unescaped the same way (e.g. "\t" is tab
+ * and "\\" is backslash). Responses can be printed in different order than
+ * requests.
+ *
+ * Application exits after standard input is closed and all commands finish.
+ */
+class ClipboardBatchClient : public QObject, public App
+{
+    Q_OBJECT
+
+public:
+    ClipboardBatchClient(int &argc, char **argv, const QString &sessionName = QString());
+
+    void exit(int exitCode = 0);
+
+private slots:
+    void readInput();
+
+    void onInputRead(const QByteArray &data);
+
+    void onInputFinished();
+
+    void onMessageReceived(const QByteArray &data, int messageCode);
+
+    void onDisconnected();
+
+    void onConnectionFailed();
+
+private:
+    struct Request {
+        Request() : id(), output() {}
+        QByteArray id;
+        QByteArray output;
+    };
+
+    void runRequest(const QByteArray &line);
+    void startInputReader();
+    void stopInputReader();
+    void exitIfFinished();
+
+    ClientSocket *m_socket;
+    QSocketNotifier *m_inputNotifier;
+    QByteArray m_input;
+    QHash<ClientSocket*, Request> m_requests;
+    int m_lastRequestId;
+    bool m_inputFinished;
+};
+
+#endif // CLIPBOARDBATCHCLIENT_H
@@ -19,45 +19,83 @@
 
 #include "clipboardmonitor.h"
 
+#include "common/common.h"
 #include "common/log.h"
 #include "common/mimetypes.h"
 #include "common/monitormessagecode.h"
-#include "item/serialize.h"
+#include "common/trace.h"
 #include "platform/platformclipboard.h"
 
 #include <QApplication>
+#include <QRunnable>
 
 namespace {
 
-bool hasSameData(const QVariantMap &data, const QVariantMap &lastData)
+bool hasSameData(const DataFingerprints &data, const DataFingerprints &lastData)
 {
     foreach (const QString &format, lastData.keys()) {
-        if ( !format.startsWith(COPYQ_MIME_PREFIX)
-             && !data.contains(format) )
-        {
+        if ( !data.contains(format) )
             return false;
-        }
     }
 
-    foreach (const QString &format, data.keys()) {
-        if ( !format.startsWith(COPYQ_MIME_PREFIX)
-             && !data[format].toByteArray().isEmpty()
-             && data[format] != lastData.value(format) )
-        {
+    for (DataFingerprints::const_iterator it = data.constBegin(); it != data.constEnd(); ++it) {
+        if ( it.value().size != 0 && it.value() != lastData.value(it.key()) )
             return false;
-        }
     }
 
     return true;
 }
 
+/// Converts clipboard image to requested formats outside GUI thread.
+class ImageConverter : public QRunnable
+{
+public:
+    ImageConverter(
+            ClipboardMonitor *monitor, int mode, int captureId, const QVariantMap &data,
+            const QImage &image, const QStringList &imageFormats)
+        : m_monitor(monitor)
+        , m_mode(mode)
+        , m_captureId(captureId)
+        , m_data(data)
+        , m_image(image)
+        , m_imageFormats(imageFormats)
+    {
+    }
+
+    void run()
+    {
+        {
+            TraceScope trace(m_data, "monitor: convert image");
+            convertImageData(m_image, m_imageFormats, &m_data);
+        }
+
+        QMetaObject::invokeMethod(
+                    m_monitor, "onClipboardDataReady", Qt::QueuedConnection,
+                    Q_ARG(int, m_mode), Q_ARG(int, m_captureId), Q_ARG(QVariantMap, m_data) );
+    }
+
+private:
+    ClipboardMonitor *m_monitor;
+    int m_mode;
+    int m_captureId;
+    QVariantMap m_data;
+    QImage m_image;
+    QStringList m_imageFormats;
+};
+
 } // namespace
 
 ClipboardMonitor::ClipboardMonitor(int &argc, char **argv)
     : Client()
     , App(createPlatformNativeInterface()->createMonitorApplication(argc, argv))
     , m_clipboard(createPlatformNativeInterface()->clipboard())
+    , m_sharedDataTransfer( "monitor-" + QString::fromUtf8(argv[2]) )
 {
+    for (int i = 0; i < 3; ++i)
+        m_captureId[i] = 0;
+
+    m_imageConverterPool.setMaxThreadCount(1);
+
     restoreSettings();
 
     Q_ASSERT(argc == 3);
@@ -71,15 +109,26 @@ ClipboardMonitor::ClipboardMonitor(int &argc, char **argv)
     startClientSocket(serverName, argc, argv);
 }
 
+ClipboardMonitor::~ClipboardMonitor()
+{
+    m_imageConverterPool.waitForDone();
+}
+
 void ClipboardMonitor::onClipboardChanged(PlatformClipboard::Mode mode)
 {
-    QVariantMap data = m_clipboard->data(mode, m_formats);
-    QVariantMap &lastData = m_lastData[mode];
+    // Newer clipboard content makes any pending image conversion obsolete.
+    const int captureId = ++m_captureId[mode];
 
-    if ( hasSameData(data, lastData) ) {
-        COPYQ_LOG("Ignoring unchanged clipboard content");
-        return;
-    }
+    const QByteArray traceId = newTraceId();
+    TraceScope trace(traceId, "monitor: capture clipboard");
+
+    QImage image;
+    QStringList imageFormats;
+    QVariantMap data = m_clipboard->dataWithoutImageConversion(
+                mode, m_formats, &image, &imageFormats);
+
+    if ( !traceId.isEmpty() )
+        data.insert(mimeTraceId, traceId);
 
     if (mode != PlatformClipboard::Clipboard) {
         const QString modeName = mode == PlatformClipboard::Selection
@@ -96,8 +145,40 @@ void ClipboardMonitor::onClipboardChanged(PlatformClipboard::Mode mode)
             data.insert( mimeWindowTitle, currentWindow->getTitle().toUtf8() );
     }
 
-    sendMessage( serializeData(data), MonitorClipboardChanged );
-    lastData = data;
+    if ( imageFormats.isEmpty() ) {
+        onClipboardDataReady(mode, captureId, data);
+    } else {
+        COPYQ_LOG("Converting clipboard image in background");
+        m_imageConverterPool.start(
+                    new ImageConverter(this, mode, captureId, data, image, imageFormats) );
+    }
+}
+
+void ClipboardMonitor::onClipboardDataReady(int mode, int captureId, const QVariantMap &data)
+{
+    if (captureId != m_captureId[mode]) {
+        COPYQ_LOG("Dropping outdated clipboard content");
+        return;
+    }
+
+    const DataFingerprints fingerprints = dataFingerprints(data);
+    DataFingerprints &lastFingerprints = m_lastFingerprints[mode];
+
+    if ( hasSameData(fingerprints, lastFingerprints) ) {
+        COPYQ_LOG("Ignoring unchanged clipboard content");
+        return;
+    }
+
+    if ( isTracing() ) {
+        traceInstant(data, "monitor: send to server");
+        QVariantMap tracedData = data;
+        attachTraceEvents(&tracedData);
+        sendMessage( m_sharedDataTransfer.serializeData(tracedData), MonitorClipboardChanged );
+    } else {
+        sendMessage( m_sharedDataTransfer.serializeData(data), MonitorClipboardChanged );
+    }
+
+    lastFingerprints = fingerprints;
 }
 
 void ClipboardMonitor::onMessageReceived(const QByteArray &message, int messageCode)
@@ -122,6 +203,11 @@ void ClipboardMonitor::onMessageReceived(const QByteArray &message, int messageC
         if ( settings.contains("formats") )
             m_formats = settings["formats"].toStringList();
 
+        if ( settings.value("trace").toBool() )
+            startTracing("CopyQ monitor");
+        else
+            stopTracing();
+
         connect( m_clipboard.data(), SIGNAL(changed(PlatformClipboard::Mode)),
                  this, SLOT(onClipboardChanged(PlatformClipboard::Mode)),
                  Qt::UniqueConnection );
@@ -133,11 +219,16 @@ void ClipboardMonitor::onMessageReceived(const QByteArray &message, int messageC
             || messageCode == MonitorChangeSelection)
     {
         QVariantMap data;
-        deserializeData(&data, message);
+        QByteArray transferId;
+        deserializeSharedData(&data, message, &transferId);
+        if ( !transferId.isEmpty() )
+            sendMessage(transferId, MonitorReleaseSharedData);
         if (messageCode == MonitorChangeClipboard)
             m_clipboard->setData(PlatformClipboard::Clipboard, data);
         if (messageCode == MonitorChangeSelection)
             m_clipboard->setData(PlatformClipboard::Selection, data);
+    } else if (messageCode == MonitorReleaseSharedData) {
+        m_sharedDataTransfer.release(message);
     } else {
         log( QString("Unknown message code %1!").arg(messageCode), LogError );
     }
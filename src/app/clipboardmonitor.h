@@ -23,8 +23,12 @@
 #include "app.h"
 #include "client.h"
 
+#include "app/shareddatatransfer.h"
+#include "common/datafingerprint.h"
 #include "platform/platformnativeinterface.h"
 
+#include <QThreadPool>
+
 /**
  * Monitors clipboard and sends new clipboard data to server.
  * Server can send back new data for clipboard.
@@ -33,6 +37,10 @@
  *
  * After monitor is executed it needs to be configured by sending special data
  * packet containing configuration.
+ *
+ * Images which need to be converted to other formats are processed in
+ * a worker thread; clipboard content which changes in the meantime
+ * supersedes the pending conversion.
  */
 class ClipboardMonitor : public Client, public App
 {
@@ -41,9 +49,14 @@ class ClipboardMonitor : public Client, public App
 public:
     ClipboardMonitor(int &argc, char **argv);
 
+    ~ClipboardMonitor();
+
 private slots:
     void onClipboardChanged(PlatformClipboard::Mode mode);
 
+    /// Send captured clipboard data to server unless newer data were captured.
+    void onClipboardDataReady(int mode, int captureId, const QVariantMap &data);
+
     void onMessageReceived(const QByteArray &message, int messageCode);
 
     void onDisconnected();
@@ -53,7 +66,10 @@ private slots:
 private:
     PlatformClipboardPtr m_clipboard;
     QStringList m_formats;
-    QVariantMap m_lastData[3]; /// Last data sent for each clipboard mode
+    DataFingerprints m_lastFingerprints[3]; /// Fingerprints of last data sent for each clipboard mode
+    int m_captureId[3]; /// Last clipboard capture for each clipboard mode
+    QThreadPool m_imageConverterPool;
+    SharedDataTransfer m_sharedDataTransfer;
 };
 
 #endif // CLIPBOARDMONITOR_H
@@ -27,14 +27,15 @@
 #include "common/log.h"
 #include "common/mimetypes.h"
 #include "common/monitormessagecode.h"
+#include "common/trace.h"
 #include "gui/clipboardbrowser.h"
 #include "gui/commanddialog.h"
 #include "gui/configtabshortcuts.h"
 #include "gui/iconfactory.h"
 #include "gui/mainwindow.h"
 #include "item/itemfactory.h"
-#include "item/serialize.h"
 #include "scriptable/scriptableworker.h"
+#include "scriptable/scriptenginepool.h"
 
 #include <QAction>
 #include <QApplication>
@@ -43,6 +44,7 @@
 #include <QMessageBox>
 #include <QMimeData>
 #include <QProxyStyle>
+#include <QRunnable>
 #include <QScreen>
 #include <QSessionManager>
 #include <QThread>
@@ -98,6 +100,22 @@ public:
     }
 };
 
+class ScriptEngineWarmUp : public QRunnable {
+public:
+    explicit ScriptEngineWarmUp(const QString &pluginScript)
+        : m_pluginScript(pluginScript)
+    {
+    }
+
+    void run()
+    {
+        warmUpScriptEngine(m_pluginScript);
+    }
+
+private:
+    QString m_pluginScript;
+};
+
 } // namespace
 
 ClipboardServer::ClipboardServer(int &argc, char **argv, const QString &sessionName)
@@ -106,6 +124,7 @@ ClipboardServer::ClipboardServer(int &argc, char **argv, const QString &sessionN
           sessionName)
     , m_wnd(NULL)
     , m_monitor(NULL)
+    , m_monitorDataTransfer("server")
     , m_shortcutActions()
     , m_clientThreads()
     , m_ignoreKeysTimer()
@@ -132,6 +151,7 @@ ClipboardServer::ClipboardServer(int &argc, char **argv, const QString &sessionN
 
     m_itemFactory = new ItemFactory(this);
     m_wnd = new MainWindow(m_itemFactory);
+    m_wnd->setActionScriptRunner(this);
 
     connect( server, SIGNAL(newConnection(Arguments,ClientSocket*)),
              this, SLOT(doCommand(Arguments,ClientSocket*)) );
@@ -153,6 +173,8 @@ ClipboardServer::ClipboardServer(int &argc, char **argv, const QString &sessionN
     // notify window if configuration changes
     connect( m_wnd, SIGNAL(configurationChanged()),
              this, SLOT(loadSettings()) );
+    connect( m_wnd, SIGNAL(tracingChanged()),
+             this, SLOT(loadSettings()) );
 
 #ifndef NO_GLOBAL_SHORTCUTS
     connect( m_wnd, SIGNAL(commandsSaved()),
@@ -163,6 +185,11 @@ ClipboardServer::ClipboardServer(int &argc, char **argv, const QString &sessionN
     // Allow to run at least few client and internal threads concurrently.
     m_clientThreads.setMaxThreadCount( qMax(m_clientThreads.maxThreadCount(), 8) );
 
+    // Keep threads with initialized script engines (see scriptenginepool.h).
+    m_clientThreads.setExpiryTimeout(-1);
+    setScriptablePluginObjects( m_itemFactory->scriptableObjects() );
+    m_clientThreads.start( new ScriptEngineWarmUp(m_itemFactory->scripts()) );
+
     // run clipboard monitor
     startMonitoring();
 
@@ -192,6 +219,8 @@ void ClipboardServer::stopMonitoring()
     delete m_monitor;
     m_monitor = NULL;
 
+    m_monitorDataTransfer.releaseAll();
+
     COPYQ_LOG("Clipboard Monitor: Terminated");
 }
 
@@ -203,6 +232,8 @@ void ClipboardServer::startMonitoring()
         m_monitor = new RemoteProcess(this);
         connect( m_monitor, SIGNAL(newMessage(QByteArray)),
                  this, SLOT(newMonitorMessage(QByteArray)) );
+        connect( m_monitor, SIGNAL(sharedDataReleased(QByteArray)),
+                 this, SLOT(onMonitorSharedDataReleased(QByteArray)) );
         connect( m_monitor, SIGNAL(connectionError()),
                  this, SLOT(monitorConnectionError()) );
         connect( m_monitor, SIGNAL(connected()),
@@ -227,6 +258,7 @@ void ClipboardServer::loadMonitorSettings()
 #ifdef HAS_MOUSE_SELECTIONS
     settings["check_selection"] = AppConfig().option<Config::check_selection>();
 #endif
+    settings["trace"] = isTracing();
 
     QByteArray settingsData;
     QDataStream settingsOut(&settingsData, QIODevice::WriteOnly);
@@ -323,6 +355,13 @@ void ClipboardServer::terminateThreads()
 {
     COPYQ_LOG( QString("Active client threads: %1").arg(m_clientThreads.activeThreadCount()) );
 
+    const ScriptEngineStats stats = scriptEngineStats();
+    COPYQ_LOG( QString("Script engines initialized: %1 (%2 ms total, %3 ms max), reused: %4")
+               .arg(stats.createdCount)
+               .arg(stats.totalInitTimeMs)
+               .arg(stats.maxInitTimeMs)
+               .arg(stats.reusedCount) );
+
     COPYQ_LOG("Terminating remaining threads.");
     emit terminateClientThreads();
     while ( !m_clientThreads.waitForDone(0) )
@@ -345,14 +384,35 @@ void ClipboardServer::doCommand(const Arguments &args, ClientSocket *client)
     m_clientThreads.start(worker);
 }
 
+void ClipboardServer::runScript(Action *action, const Arguments &arguments)
+{
+    ScriptableWorker *worker =
+            new ScriptableWorker(m_wnd, arguments, action, m_itemFactory->scripts());
+
+    // Terminate worker at application exit.
+    connect( this, SIGNAL(terminateClientThreads()),
+             action, SLOT(terminate()) );
+
+    m_clientThreads.start(worker);
+}
+
 void ClipboardServer::newMonitorMessage(const QByteArray &message)
 {
-    if ( !m_wnd->isMonitoringEnabled() )
-        return;
+    const qint64 receivedUs = traceTimestamp();
 
     QVariantMap data;
+    QByteArray transferId;
+    const bool ok = deserializeSharedData(&data, message, &transferId);
+    importTraceEvents(&data);
+    traceSpan(data, "server: read monitor message", receivedUs);
 
-    if ( !deserializeData(&data, message) ) {
+    if ( !transferId.isEmpty() && isMonitoring() )
+        m_monitor->writeMessage(transferId, MonitorReleaseSharedData);
+
+    if ( !m_wnd->isMonitoringEnabled() )
+        return;
+
+    if (!ok) {
         log("Failed to read message from monitor.", LogError);
         return;
     }
@@ -366,6 +426,11 @@ void ClipboardServer::monitorConnectionError()
     startMonitoring();
 }
 
+void ClipboardServer::onMonitorSharedDataReleased(const QByteArray &transferId)
+{
+    m_monitorDataTransfer.release(transferId);
+}
+
 void ClipboardServer::changeClipboard(const QVariantMap &data, QClipboard::Mode mode)
 {
     if ( !isMonitoring() ) {
@@ -378,7 +443,7 @@ void ClipboardServer::changeClipboard(const QVariantMap &data, QClipboard::Mode
     const MonitorMessageCode code =
             mode == QClipboard::Clipboard ? MonitorChangeClipboard : MonitorChangeSelection;
 
-    m_monitor->writeMessage( serializeData(data), code );
+    m_monitor->writeMessage( m_monitorDataTransfer.serializeData(data), code );
 }
 
 void ClipboardServer::createGlobalShortcut(const QKeySequence &shortcut, const Command &command)
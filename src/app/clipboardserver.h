@@ -21,6 +21,8 @@
 #define CLIPBOARDSERVER_H
 
 #include "app.h"
+#include "app/shareddatatransfer.h"
+#include "common/action.h"
 #include "common/server.h"
 #include "gui/configtabshortcuts.h"
 #include "gui/mainwindow.h"
@@ -46,7 +48,7 @@ class QSessionManager;
  *
  * If user already run this server isListening() returns false.
  */
-class ClipboardServer : public QObject, public App
+class ClipboardServer : public QObject, public App, public ActionScriptRunner
 {
     Q_OBJECT
 
@@ -70,6 +72,14 @@ public:
      */
     void createGlobalShortcut(const QKeySequence &shortcut, const Command &command);
 
+    /**
+     * Run "copyq:" script of an action in client thread pool.
+     *
+     * This avoids starting new process and connecting to server for scripts
+     * of automatic and menu commands.
+     */
+    void runScript(Action *action, const Arguments &arguments);
+
 public slots:
     /** Load @a item data to clipboard. */
     void changeClipboard(const QVariantMap &data, QClipboard::Mode mode);
@@ -101,6 +111,9 @@ private slots:
     /** An error occurred on monitor connection. */
     void monitorConnectionError();
 
+    /** Monitor has read data passed in shared memory. */
+    void onMonitorSharedDataReleased(const QByteArray &transferId);
+
     /** Shortcut was pressed on host system. */
     void shortcutActivated(QxtGlobalShortcut *shortcut);
 
@@ -127,6 +140,7 @@ private:
 
     MainWindow* m_wnd;
     RemoteProcess *m_monitor;
+    SharedDataTransfer m_monitorDataTransfer;
     QMap<QxtGlobalShortcut*, Command> m_shortcutActions;
     QThreadPool m_clientThreads;
     QTimer m_ignoreKeysTimer;
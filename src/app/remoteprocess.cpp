@@ -136,6 +136,8 @@ void RemoteProcess::onMessageReceived(const QByteArray &message, int messageCode
         log( getTextData(message).trimmed(), LogNote );
     } else if (messageCode == MonitorClipboardChanged) {
         emit newMessage(message);
+    } else if (messageCode == MonitorReleaseSharedData) {
+        emit sharedDataReleased(message);
     } else {
         log( QString("Unknown message code %1 from remote process!").arg(messageCode), LogError );
     }
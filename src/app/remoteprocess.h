@@ -61,6 +61,11 @@ signals:
      */
     void newMessage(const QByteArray &message);
 
+    /**
+     * Remote process has read data passed in shared memory.
+     */
+    void sharedDataReleased(const QByteArray &transferId);
+
     /**
      * Sends message to monitor.
      */
@@ -0,0 +1,297 @@
+/*
+    Copyright (c) 2016, Lukas Holecek <hluk@email.cz>
+
+    This file is part of CopyQ.
+
+    CopyQ is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    CopyQ is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with CopyQ.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#include "shareddatatransfer.h"
+
+#include "common/config.h"
+#include "common/log.h"
+#include "common/mimetypes.h"
+#include "item/serialize.h"
+
+#include <QCoreApplication>
+#include <QDataStream>
+#include <QDateTime>
+#include <QFile>
+#include <QRegExp>
+#include <QSharedMemory>
+#include <QStringList>
+
+#include <string.h>
+
+#if QT_VERSION < 0x050000 && defined(Q_OS_UNIX)
+#   include <sys/ipc.h>
+#   include <sys/shm.h>
+#endif
+
+namespace {
+
+/// Contains transfer ID and keys of shared memory segments for formats.
+const char mimeSharedData[] = COPYQ_MIME_PREFIX "shared-data";
+
+/// Format data bigger than this are passed in shared memory.
+const int minSharedDataSize = 512 * 1024;
+
+/// Data are sent inline if receiver hasn't released this many transfers yet.
+const int maxPendingTransfers = 8;
+
+QByteArray newTransferId()
+{
+    static int lastId = 0;
+    return QByteArray::number(QCoreApplication::applicationPid())
+            + '_' + QByteArray::number(++lastId);
+}
+
+QByteArray randomBytes(int count)
+{
+    QByteArray bytes;
+
+#ifdef Q_OS_UNIX
+    QFile urandom("/dev/urandom");
+    if ( urandom.open(QIODevice::ReadOnly) )
+        bytes = urandom.read(count);
+#endif
+
+    if (bytes.size() != count) {
+        static bool seeded = false;
+        if (!seeded) {
+            qsrand( static_cast<uint>(QDateTime::currentMSecsSinceEpoch())
+                    ^ static_cast<uint>(QCoreApplication::applicationPid()) );
+            seeded = true;
+        }
+
+        bytes.resize(count);
+        for (int i = 0; i < count; ++i)
+            bytes[i] = static_cast<char>(qrand() & 0xff);
+    }
+
+    return bytes;
+}
+
+/// Return random key so other processes cannot guess it.
+QString newSharedMemoryKey()
+{
+    return "copyq_data_" + QString::fromLatin1( randomBytes(16).toHex() );
+}
+
+/**
+ * Allow only owner to access shared memory segment.
+ *
+ * Qt 4 creates System V segments readable and writable by anyone.
+ * Returns false if permissions cannot be changed or if another process
+ * attached to the segment in the meantime.
+ */
+bool restrictAccess(const QSharedMemory &sharedMemory)
+{
+#if QT_VERSION < 0x050000 && defined(Q_OS_UNIX)
+    const key_t key = ftok( QFile::encodeName(sharedMemory.nativeKey()).constData(), 'Q' );
+    const int id = key == -1 ? -1 : shmget(key, 0, 0);
+    struct shmid_ds info;
+    if ( id == -1 || shmctl(id, IPC_STAT, &info) == -1 )
+        return false;
+
+    info.shm_perm.mode = 0600;
+    if ( shmctl(id, IPC_SET, &info) == -1 || shmctl(id, IPC_STAT, &info) == -1 )
+        return false;
+
+    return info.shm_nattch == 1;
+#else
+    Q_UNUSED(sharedMemory);
+    return true;
+#endif
+}
+
+} // namespace
+
+SharedDataTransfer::SharedDataTransfer(const QString &name)
+    : m_transfers()
+    , m_keysFilePath()
+{
+    QString fileName = name;
+    fileName.replace( QRegExp("[^a-zA-Z0-9_-]"), "_" );
+    m_keysFilePath = settingsDirectoryPath() + "/.shared-data-" + fileName + ".dat";
+
+    removeStaleSegments();
+}
+
+SharedDataTransfer::~SharedDataTransfer()
+{
+    releaseAll();
+}
+
+QByteArray SharedDataTransfer::serializeData(const QVariantMap &data)
+{
+    if (m_transfers.size() >= maxPendingTransfers) {
+        COPYQ_LOG("Receiver hasn't released shared memory; sending data inline");
+        return ::serializeData(data);
+    }
+
+    QVariantMap dataToSend = data;
+    Transfer transfer;
+
+    QByteArray sharedFormats;
+    QDataStream stream(&sharedFormats, QIODevice::WriteOnly);
+
+    for (QVariantMap::const_iterator it = data.constBegin(); it != data.constEnd(); ++it) {
+        const QByteArray bytes = it.value().toByteArray();
+        if (bytes.size() < minSharedDataSize)
+            continue;
+
+        if ( transfer.first.isEmpty() )
+            transfer.first = newTransferId();
+
+        const QString key = newSharedMemoryKey();
+        SharedMemoryPtr sharedMemory(new QSharedMemory(key));
+        if ( !sharedMemory->create(bytes.size()) ) {
+            COPYQ_LOG( QString("Failed to create shared memory for \"%1\": %2")
+                       .arg(it.key())
+                       .arg(sharedMemory->errorString()) );
+            continue;
+        }
+
+        if ( !restrictAccess(*sharedMemory) ) {
+            log( QString("Failed to restrict access to shared memory for \"%1\"").arg(it.key()),
+                 LogWarning );
+            continue;
+        }
+
+        sharedMemory->lock();
+        memcpy( sharedMemory->data(), bytes.constData(), bytes.size() );
+        sharedMemory->unlock();
+
+        stream << it.key() << key << static_cast<qint32>(bytes.size());
+        transfer.second.append(sharedMemory);
+        dataToSend.remove( it.key() );
+    }
+
+    if ( transfer.second.isEmpty() )
+        return ::serializeData(data);
+
+    QByteArray header;
+    QDataStream headerStream(&header, QIODevice::WriteOnly);
+    headerStream << transfer.first << static_cast<qint32>(transfer.second.size());
+    dataToSend.insert(mimeSharedData, header + sharedFormats);
+
+    m_transfers.append(transfer);
+    saveKeys();
+
+    return ::serializeData(dataToSend);
+}
+
+void SharedDataTransfer::release(const QByteArray &transferId)
+{
+    for (int i = 0; i < m_transfers.size(); ++i) {
+        if (m_transfers[i].first == transferId) {
+            m_transfers.removeAt(i);
+            saveKeys();
+            return;
+        }
+    }
+}
+
+void SharedDataTransfer::releaseAll()
+{
+    m_transfers.clear();
+    QFile::remove(m_keysFilePath);
+}
+
+void SharedDataTransfer::removeStaleSegments()
+{
+    QFile file(m_keysFilePath);
+    if ( !file.open(QIODevice::ReadOnly) )
+        return;
+
+    const QList<QByteArray> keys = file.readAll().split('\n');
+    file.close();
+
+    foreach (const QByteArray &key, keys) {
+        if ( key.isEmpty() )
+            continue;
+
+        // Segment is destroyed after last process detaches.
+        QSharedMemory sharedMemory( QString::fromLatin1(key) );
+        if ( sharedMemory.attach(QSharedMemory::ReadOnly) ) {
+            COPYQ_LOG( QString("Removing stale shared memory \"%1\"").arg(sharedMemory.key()) );
+            sharedMemory.detach();
+        }
+    }
+
+    file.remove();
+}
+
+void SharedDataTransfer::saveKeys()
+{
+    if ( m_transfers.isEmpty() ) {
+        QFile::remove(m_keysFilePath);
+        return;
+    }
+
+    QByteArray keys;
+    foreach (const Transfer &transfer, m_transfers) {
+        foreach (const SharedMemoryPtr &sharedMemory, transfer.second)
+            keys.append( sharedMemory->key().toLatin1() + '\n' );
+    }
+
+    QFile file(m_keysFilePath);
+    if ( !file.open(QIODevice::WriteOnly | QIODevice::Truncate) ) {
+        COPYQ_LOG( QString("Failed to save shared memory keys: %1").arg(file.errorString()) );
+        return;
+    }
+
+    file.setPermissions(QFile::ReadOwner | QFile::WriteOwner);
+    file.write(keys);
+}
+
+bool deserializeSharedData(QVariantMap *data, const QByteArray &bytes, QByteArray *transferId)
+{
+    transferId->clear();
+
+    if ( !deserializeData(data, bytes) )
+        return false;
+
+    if ( !data->contains(mimeSharedData) )
+        return true;
+
+    QDataStream stream( data->take(mimeSharedData).toByteArray() );
+    qint32 count;
+    stream >> *transferId >> count;
+
+    for (qint32 i = 0; i < count && stream.status() == QDataStream::Ok; ++i) {
+        QString mime;
+        QString key;
+        qint32 size;
+        stream >> mime >> key >> size;
+        if (stream.status() != QDataStream::Ok)
+            break;
+
+        QSharedMemory sharedMemory(key);
+        if ( !sharedMemory.attach(QSharedMemory::ReadOnly) || sharedMemory.size() < size ) {
+            COPYQ_LOG( QString("Failed to read shared memory for \"%1\": %2")
+                       .arg(mime)
+                       .arg(sharedMemory.errorString()) );
+            return false;
+        }
+
+        sharedMemory.lock();
+        data->insert( mime, QByteArray(static_cast<const char *>(sharedMemory.constData()), size) );
+        sharedMemory.unlock();
+    }
+
+    return stream.status() == QDataStream::Ok;
+}
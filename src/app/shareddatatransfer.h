@@ -0,0 +1,89 @@
+/*
+    Copyright (c) 2016, Lukas Holecek <hluk@email.cz>
+
+    This file is part of CopyQ.
+
+    CopyQ is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    CopyQ is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with CopyQ.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#ifndef SHAREDDATATRANSFER_H
+#define SHAREDDATATRANSFER_H
+
+#include <QByteArray>
+#include <QList>
+#include <QPair>
+#include <QSharedPointer>
+#include <QVariantMap>
+
+class QSharedMemory;
+
+/**
+ * Passes big clipboard data between monitor and server in shared memory.
+ *
+ * Data in formats bigger than a threshold are copied to shared memory
+ * segments and only the segment keys are sent over the socket.
+ *
+ * Receiver reads the data with deserializeSharedData() and sends back the
+ * transfer ID (in MonitorReleaseSharedData message) so the sender can free
+ * the segments with release(). Segments are never freed before that; if too
+ * many transfers are pending, data are sent inline instead.
+ *
+ * Segment keys are random and only the owner can access the segments.
+ * Keys of existing segments are saved in a file so segments left after
+ * a crash are removed when a sender with same name starts again.
+ */
+class SharedDataTransfer
+{
+public:
+    /**
+     * Sender @a name must be unique for configuration directory
+     * (keys of segments are saved in a file with the name).
+     */
+    explicit SharedDataTransfer(const QString &name);
+
+    ~SharedDataTransfer();
+
+    /// Serialize data for sending; big formats are moved to shared memory.
+    QByteArray serializeData(const QVariantMap &data);
+
+    /// Free shared memory of a transfer after receiver has read it.
+    void release(const QByteArray &transferId);
+
+    /// Free shared memory of all transfers (e.g. if the receiver disconnects).
+    void releaseAll();
+
+private:
+    typedef QSharedPointer<QSharedMemory> SharedMemoryPtr;
+    typedef QPair< QByteArray, QList<SharedMemoryPtr> > Transfer;
+
+    /// Remove segments left by previous sender with same name.
+    void removeStaleSegments();
+
+    /// Save keys of existing segments.
+    void saveKeys();
+
+    QList<Transfer> m_transfers;
+    QString m_keysFilePath;
+};
+
+/**
+ * Deserialize data created with SharedDataTransfer::serializeData().
+ *
+ * If @a transferId is not empty afterwards, it must be sent back to sender
+ * (even on failure) so the shared memory can be freed.
+ */
+bool deserializeSharedData(QVariantMap *data, const QByteArray &bytes, QByteArray *transferId);
+
+#endif // SHAREDDATATRANSFER_H
@@ -19,12 +19,15 @@
 
 #include "action.h"
 
+#include "common/arguments.h"
+#include "common/commandstatus.h"
 #include "common/common.h"
 #include "common/log.h"
 #include "common/mimetypes.h"
 #include "item/serialize.h"
 
 #include <QCoreApplication>
+#include <QElapsedTimer>
 #include <QProcessEnvironment>
 #include <QPointer>
 
@@ -200,6 +203,9 @@ Action::Action(QObject *parent)
     : QObject(parent)
     , m_failed(false)
     , m_currentLine(-1)
+    , m_scriptRunner(NULL)
+    , m_scriptRunning(false)
+    , m_scriptAborted(0)
     , m_exitCode(0)
 {
     setProperty("COPYQ_ACTION_ID", actionId(this));
@@ -268,6 +274,11 @@ void Action::start()
 
     Q_ASSERT( !cmds.isEmpty() );
 
+    if ( cmds.size() == 1 && canRunScript(cmds[0]) ) {
+        startScript(cmds[0]);
+        return;
+    }
+
     QProcessEnvironment env = QProcessEnvironment::systemEnvironment();
     env.insert("COPYQ_ACTION_ID", QString::number(actionId(this)));
 
@@ -307,18 +318,29 @@ void Action::start()
 
 bool Action::waitForStarted(int msecs)
 {
-    return !m_processes.isEmpty() && m_processes.last()->waitForStarted(msecs);
+    return m_scriptRunning
+            || (!m_processes.isEmpty() && m_processes.last()->waitForStarted(msecs));
 }
 
 bool Action::waitForFinished(int msecs)
 {
     QCoreApplication::processEvents();
+
+    if (m_scriptRunning) {
+        QElapsedTimer t;
+        t.start();
+        while ( m_scriptRunning && t.elapsed() < msecs )
+            QCoreApplication::processEvents(QEventLoop::AllEvents, 10);
+        return !m_scriptRunning;
+    }
+
     return m_processes.isEmpty() || m_processes.last()->waitForFinished(msecs);
 }
 
 bool Action::isRunning() const
 {
-    return !m_processes.isEmpty() && m_processes.last()->state() != QProcess::NotRunning;
+    return m_scriptRunning
+            || (!m_processes.isEmpty() && m_processes.last()->state() != QProcess::NotRunning);
 }
 
 void Action::setData(const QVariantMap &data)
@@ -375,7 +397,11 @@ void Action::actionStarted()
 void Action::actionFinished()
 {
     actionOutput();
+    finishCommandLine();
+}
 
+void Action::finishCommandLine()
+{
     if (hasTextOutput()) {
         if (canEmitNewItems()) {
             m_items.append(m_lastOutput);
@@ -402,8 +428,11 @@ void Action::actionOutput()
     QProcess *p = qobject_cast<QProcess*>(sender());
     Q_ASSERT(p);
 
-    const QByteArray output = p->readAll();
+    appendOutput( p->readAll() );
+}
 
+void Action::appendOutput(const QByteArray &output)
+{
     if (hasTextOutput()) {
         m_lastOutput.append( getTextData(output) );
         if ( !m_lastOutput.isEmpty() && !m_sep.isEmpty() ) {
@@ -441,8 +470,23 @@ bool Action::hasTextOutput() const
     return !m_outputFormat.isEmpty() && m_outputFormat == mimeText;
 }
 
+bool Action::isScriptAborted() const
+{
+#if QT_VERSION < 0x050000
+    return m_scriptAborted != 0;
+#else
+    return m_scriptAborted.loadAcquire() != 0;
+#endif
+}
+
 void Action::terminate()
 {
+    if (m_scriptRunning) {
+        m_scriptAborted.fetchAndStoreOrdered(1);
+        emit scriptAborted();
+        return;
+    }
+
     if (m_processes.isEmpty())
         return;
 
@@ -475,3 +519,48 @@ void Action::closeSubCommands()
 
     m_processes.clear();
 }
+
+bool Action::canRunScript(const QStringList &command) const
+{
+    return m_scriptRunner
+            && command.size() > 2
+            && command[0] == "copyq"
+            && command[1] == "eval";
+}
+
+void Action::startScript(const QStringList &command)
+{
+    Arguments args( command.mid(1) );
+    args.setArgument( Arguments::ActionId, QByteArray::number(actionId(this)) );
+
+    m_scriptRunning = true;
+    m_scriptAborted.fetchAndStoreOrdered(0);
+    m_exitCode = 0;
+
+    if (m_currentLine == 0)
+        emit actionStarted(this);
+
+    m_scriptRunner->runScript(this, args);
+}
+
+void Action::onScriptMessage(const QByteArray &message, int messageCode)
+{
+    if (!m_scriptRunning)
+        return;
+
+    if (messageCode == CommandSuccess || messageCode == CommandFinished) {
+        appendOutput(message);
+    } else if (messageCode == CommandError || messageCode == CommandBadSyntax) {
+        m_errstr.append( getTextData(message) );
+    } else {
+        // Input is passed to script before it starts and
+        // window is activated directly from current process.
+        return;
+    }
+
+    if (messageCode != CommandSuccess) {
+        m_scriptRunning = false;
+        m_exitCode = messageCode;
+        finishCommandLine();
+    }
+}
@@ -20,6 +20,7 @@
 #ifndef ACTION_H
 #define ACTION_H
 
+#include <QAtomicInt>
 #include <QModelIndex>
 #include <QMutex>
 #include <QProcess>
@@ -27,8 +28,28 @@
 #include <QVariantMap>
 #include <QVector>
 
+class Action;
+class Arguments;
 class QAction;
 
+/**
+ * Runs "copyq:" scripts of actions in current process instead of starting
+ * new "copyq eval" process (see Action::setScriptRunner()).
+ */
+class ActionScriptRunner
+{
+public:
+    virtual ~ActionScriptRunner() {}
+
+    /**
+     * Start script with command line @a arguments for @a action.
+     *
+     * Messages from script must be passed to Action::onScriptMessage()
+     * and script must be aborted on Action::scriptAborted().
+     */
+    virtual void runScript(Action *action, const Arguments &arguments) = 0;
+};
+
 /**
  * Execute external program.
  */
@@ -107,10 +128,27 @@ public:
     static QVariantMap data(quintptr id);
     static void setData(quintptr id, const QVariantMap &data);
 
+    /**
+     * Run "copyq:" script commands using @a runner (if not NULL).
+     *
+     * This is used only for command lines with single "copyq eval" command.
+     */
+    void setScriptRunner(ActionScriptRunner *runner) { m_scriptRunner = runner; }
+
+    /**
+     * Return true if script started by ActionScriptRunner was terminated.
+     *
+     * This is thread-safe so script can check it after connecting to scriptAborted().
+     */
+    bool isScriptAborted() const;
+
 public slots:
     /** Terminate (kill) process. */
     void terminate();
 
+    /** Handle message from script started by ActionScriptRunner (same as message for client). */
+    void onScriptMessage(const QByteArray &message, int messageCode);
+
 signals:
     /** Emitted on error. */
     void actionError(Action *act);
@@ -127,6 +165,8 @@ signals:
     void newItem(const QByteArray &data, const QString &format,
                  const QModelIndex &index);
     void dataChanged(const QVariantMap &data);
+    /** Emitted if script started by ActionScriptRunner should be aborted. */
+    void scriptAborted();
 
 private slots:
     void actionError(QProcess::ProcessError error);
@@ -143,6 +183,12 @@ private:
     bool hasTextOutput() const;
     bool canEmitNewItems() const;
 
+    bool canRunScript(const QStringList &command) const;
+    void startScript(const QStringList &command);
+
+    void appendOutput(const QByteArray &output);
+    void finishCommandLine();
+
     void closeSubCommands();
 
     QByteArray m_input;
@@ -161,6 +207,9 @@ private:
     QStringList m_items;
     QVariantMap m_data;
     QVector<QProcess*> m_processes;
+    ActionScriptRunner *m_scriptRunner;
+    bool m_scriptRunning;
+    QAtomicInt m_scriptAborted;
 
     int m_exitCode;
     QString m_errorString;
@@ -21,8 +21,76 @@
 
 #include "platform/platformnativeinterface.h"
 
-#include <QObject>
-#include <QString>
+#include <QCoreApplication>
+#include <QMap>
+#include <QMutex>
+#include <QMutexLocker>
+#include <QPointer>
+#include <QStringList>
+
+/// Options from settings at some point in time (shouldn't be modified after published).
+struct AppConfigSnapshot {
+    QVariantMap options[2];
+};
+
+namespace {
+
+QMutex configMutex(QMutex::Recursive);
+
+/// True while saving changes so the current snapshot is not invalidated.
+bool savingChanges = false;
+
+QString groupName(AppConfig::Category category)
+{
+    return category == AppConfig::OptionsCategory ? "Options" : "Theme";
+}
+
+/// Current snapshot (null if options need to be reloaded).
+QSharedPointer<const AppConfigSnapshot> &snapshot()
+{
+    static QSharedPointer<const AppConfigSnapshot> currentSnapshot;
+    return currentSnapshot;
+}
+
+/// Options changed but not yet saved (invalid value for removed option).
+QMap<QString, QVariant> &pendingChanges()
+{
+    static QMap<QString, QVariant> changes;
+    return changes;
+}
+
+QSharedPointer<const AppConfigSnapshot> loadSnapshot()
+{
+    QSharedPointer<AppConfigSnapshot> newSnapshot(new AppConfigSnapshot);
+
+    Settings settings;
+    for (int i = 0; i < 2; ++i) {
+        const AppConfig::Category category = static_cast<AppConfig::Category>(i);
+        QVariantMap &options = newSnapshot->options[category];
+        settings.beginGroup( groupName(category) );
+        foreach ( const QString &name, settings.allKeys() )
+            options.insert( name, settings.value(name) );
+        settings.endGroup();
+    }
+
+    return newSnapshot;
+}
+
+QSharedPointer<const AppConfigSnapshot> currentSnapshot()
+{
+    QMutexLocker lock(&configMutex);
+
+    if ( snapshot().isNull() ) {
+        // Save pending changes first so they are not lost.
+        if ( !pendingChanges().isEmpty() )
+            AppConfig::saveChanges();
+        snapshot() = loadSnapshot();
+    }
+
+    return snapshot();
+}
+
+} // namespace
 
 Config::Config<QString>::Value Config::editor::defaultValue()
 {
@@ -40,24 +108,112 @@ QString defaultClipboardTabName()
                 "&clipboard", "Default name of the tab that automatically stores new clipboard content");
 }
 
-QVariant AppConfig::option(const QString &name) const
+AppConfigNotifier *AppConfigNotifier::instance()
 {
-    return m_settings.value(name);
+    static QPointer<AppConfigNotifier> notifier;
+    if (!notifier)
+        notifier = new AppConfigNotifier(qApp);
+    return notifier;
+}
+
+void AppConfigNotifier::saveChanges()
+{
+    QMutexLocker lock(&configMutex);
+
+    QMap<QString, QVariant> &changes = pendingChanges();
+    if ( changes.isEmpty() )
+        return;
+
+    savingChanges = true;
+    {
+        Settings settings;
+        for (QMap<QString, QVariant>::const_iterator it = changes.constBegin(); it != changes.constEnd(); ++it) {
+            if ( it.value().isValid() )
+                settings.setValue( it.key(), it.value() );
+            else
+                settings.remove( it.key() );
+        }
+    }
+    savingChanges = false;
+
+    changes.clear();
+}
+
+AppConfigNotifier::AppConfigNotifier(QObject *parent)
+    : QObject(parent)
+{
+    // Changes would be lost after event loop ends.
+    connect( qApp, SIGNAL(aboutToQuit()), this, SLOT(saveChanges()) );
 }
 
 AppConfig::AppConfig(AppConfig::Category category)
+    : m_category(category)
+    , m_snapshot(currentSnapshot())
+{
+}
+
+AppConfig::~AppConfig()
 {
-    m_settings.beginGroup(
-                category == OptionsCategory ? "Options" : "Theme");
+}
+
+QVariant AppConfig::option(const QString &name) const
+{
+    return m_snapshot->options[m_category].value(name);
 }
 
 void AppConfig::setOption(const QString &name, const QVariant &value)
 {
     if ( option(name) != value )
-        m_settings.setValue(name, value);
+        setChange(name, value);
 }
 
 void AppConfig::removeOption(const QString &name)
 {
-    m_settings.remove(name);
+    if ( option(name).isValid() )
+        setChange(name, QVariant());
+}
+
+void AppConfig::saveChanges()
+{
+    AppConfigNotifier::instance()->saveChanges();
+}
+
+void AppConfig::invalidate()
+{
+    QMutexLocker lock(&configMutex);
+
+    if ( savingChanges || snapshot().isNull() )
+        return;
+
+    // Options are reloaded on next access.
+    snapshot().clear();
+
+    if (qApp)
+        QMetaObject::invokeMethod(AppConfigNotifier::instance(), "optionsReloaded", Qt::QueuedConnection);
+}
+
+void AppConfig::setChange(const QString &name, const QVariant &value)
+{
+    const QString key = groupName(m_category) + '/' + name;
+
+    {
+        QMutexLocker lock(&configMutex);
+
+        // Publish new snapshot; instances created earlier keep the old one.
+        QSharedPointer<AppConfigSnapshot> newSnapshot(new AppConfigSnapshot(*currentSnapshot()));
+        if ( value.isValid() )
+            newSnapshot->options[m_category].insert(name, value);
+        else
+            newSnapshot->options[m_category].remove(name);
+        snapshot() = newSnapshot;
+        m_snapshot = newSnapshot;
+
+        QMap<QString, QVariant> &changes = pendingChanges();
+        if ( changes.isEmpty() && qApp )
+            QMetaObject::invokeMethod(AppConfigNotifier::instance(), "saveChanges", Qt::QueuedConnection);
+        changes.insert(key, value);
+    }
+
+    if (qApp)
+        emit AppConfigNotifier::instance()->optionChanged(name);
 }
@@ -22,9 +22,12 @@
 
 #include "common/settings.h"
 
+#include <QObject>
+#include <QSharedPointer>
 #include <QVariant>
 
 class QString;
+struct AppConfigSnapshot;
 
 QString defaultClipboardTabName();
 
@@ -236,6 +239,14 @@ struct command_history_size : Config<int> {
     static Value defaultValue() { return 100; }
 };
 
+struct map_item_data : Config<bool> {
+    static QString name() { return "map_item_data"; }
+};
+
+struct deduplicate_item_data : Config<bool> {
+    static QString name() { return "deduplicate_item_data"; }
+};
+
 struct check_selection : Config<bool> {
     static QString name() { return "check_selection"; }
 };
@@ -271,6 +282,39 @@ struct tabs : Config<QStringList> {
 
 } // namespace Config
 
+/**
+ * Notifies about option changes and saves changed options.
+ */
+class AppConfigNotifier : public QObject
+{
+    Q_OBJECT
+public:
+    static AppConfigNotifier *instance();
+
+signals:
+    /// Emitted after option is changed or removed using AppConfig.
+    void optionChanged(const QString &name);
+
+    /// Emitted after options are reloaded because settings were changed directly.
+    void optionsReloaded();
+
+public slots:
+    /// Save options changed using AppConfig (see AppConfig::saveChanges()).
+    void saveChanges();
+
+private:
+    explicit AppConfigNotifier(QObject *parent);
+};
+
+/**
+ * Access to application options.
+ *
+ * Options are read from in-memory snapshot of settings which is loaded
+ * on first access and shared by all instances.
+ *
+ * Changes are published immediately in new snapshot and saved to settings
+ * together after returning to event loop or when saveChanges() is called.
+ */
 class AppConfig
 {
 public:
@@ -281,6 +325,8 @@ public:
 
     explicit AppConfig(Category category = OptionsCategory);
 
+    ~AppConfig();
+
     QVariant option(const QString &name) const;
 
     template <typename T>
@@ -307,8 +353,17 @@ public:
 
     void removeOption(const QString &name);
 
+    /// Save changed options to settings.
+    static void saveChanges();
+
+    /// Reload options on next access (called if settings are changed directly).
+    static void invalidate();
+
 private:
-    Settings m_settings;
+    void setChange(const QString &name, const QVariant &value);
+
+    Category m_category;
+    QSharedPointer<const AppConfigSnapshot> m_snapshot;
 };
 
 #endif // APPCONFIG_H
@@ -22,6 +22,15 @@
 
 class QString;
 
+/**
+ * Code of first message from client to start batch mode.
+ *
+ * In batch mode, client can send multiple commands over single connection.
+ * Each message is wrapped in message with request ID as message code
+ * (see ClientSocket::commandReceived()).
+ */
+const int batchModeMessageCode = -1;
+
 QString serverName(const QString &name);
 QString clipboardServerName();
 
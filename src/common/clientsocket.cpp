@@ -21,6 +21,7 @@
 
 #include "common/arguments.h"
 #include "common/client_server.h"
+#include "common/commandstatus.h"
 #include "common/log.h"
 
 #include <QDataStream>
@@ -30,22 +31,42 @@
 
 namespace {
 
+/// Messages longer than this are rejected (length is received from the peer).
+const qint64 maxMessageSize = 1 << 30;
+
 bool readBytes(QLocalSocket *socket, qint64 size, QByteArray *bytes)
 {
-    qint64 remaining = size;
     bytes->clear();
-    while (remaining > 0) {
+
+    if (size < 0 || size > maxMessageSize) {
+        COPYQ_LOG( QString("ERROR: Invalid message size (%1 bytes)!").arg(size) );
+        return false;
+    }
+
+    // Read directly to the buffer to avoid copying big messages repeatedly.
+    // The buffer grows only by the amount of data actually received.
+    qint64 offset = 0;
+    while (offset < size) {
         if ( socket->bytesAvailable() == 0 && !socket->waitForReadyRead(4000) )
             return false;
 
-        const qint64 avail = qMin( socket->bytesAvailable(), remaining );
-        if (avail == 0)
+        const qint64 chunk = qMin( socket->bytesAvailable(), size - offset );
+        if (chunk <= 0)
+            return false;
+
+        const int newSize = static_cast<int>(offset + chunk);
+        bytes->resize(newSize);
+        if (bytes->size() != newSize)
+            return false;
+
+        const qint64 read = socket->read( bytes->data() + offset, chunk );
+        if (read <= 0)
             return false;
 
-        bytes->append( socket->read(avail) );
-        remaining -= avail;
+        offset += read;
     }
 
+    bytes->resize( static_cast<int>(offset) );
     return true;
 }
 
@@ -70,6 +91,36 @@ bool readMessage(QLocalSocket *socket, QByteArray *msg)
     return false;
 }
 
+QByteArray createMessage(const QByteArray &message, int messageCode)
+{
+    QByteArray msg;
+    QDataStream out(&msg, QIODevice::WriteOnly);
+    out << static_cast<qint32>(messageCode);
+    out.writeRawData( message.constData(), message.length() );
+    return msg;
+}
+
+bool parseMessage(const QByteArray &msg, int *messageCode, QByteArray *message)
+{
+    QDataStream stream(msg);
+    qint32 code;
+    stream >> code;
+    if (stream.status() != QDataStream::Ok)
+        return false;
+
+    *messageCode = code;
+    const int i = sizeof(code);
+    *message = QByteArray( msg.constData() + i, msg.length() - i );
+    return true;
+}
+
+bool deserializeArguments(const QByteArray &message, Arguments *args)
+{
+    QDataStream input(message);
+    input >> *args;
+    return input.status() == QDataStream::Ok && !args->isEmpty();
+}
+
 bool writeMessage(QLocalSocket *socket, const QByteArray &msg)
 {
     COPYQ_LOG_VERBOSE( QString("Write message (%1 bytes).").arg(msg.size()) );
@@ -94,6 +145,11 @@ ClientSocket::ClientSocket()
     , m_socket(NULL)
     , m_deleteAfterDisconnected(false)
     , m_closed(true)
+    , m_batchMode(false)
+    , m_acceptsRequests(false)
+    , m_channels()
+    , m_batchSocket()
+    , m_requestId(0)
 {
 }
 
@@ -102,6 +158,11 @@ ClientSocket::ClientSocket(const QString &serverName, QObject *parent)
     , m_socket(new QLocalSocket(this))
     , m_deleteAfterDisconnected(false)
     , m_closed(false)
+    , m_batchMode(false)
+    , m_acceptsRequests(false)
+    , m_channels()
+    , m_batchSocket()
+    , m_requestId(0)
 {
     m_socket->connectToServer(serverName);
 }
@@ -111,18 +172,54 @@ ClientSocket::ClientSocket(QLocalSocket *socket, QObject *parent)
     , m_socket(socket)
     , m_deleteAfterDisconnected(false)
     , m_closed(false)
+    , m_batchMode(false)
+    , m_acceptsRequests(false)
+    , m_channels()
+    , m_batchSocket()
+    , m_requestId(0)
 {
     socket->setParent(this);
 }
 
+ClientSocket::ClientSocket(ClientSocket *batchSocket, int requestId)
+    : QObject()
+    , m_socket(NULL)
+    , m_deleteAfterDisconnected(false)
+    , m_closed( batchSocket->isClosed() )
+    , m_batchMode(false)
+    , m_acceptsRequests(false)
+    , m_channels()
+    , m_batchSocket(batchSocket)
+    , m_requestId(requestId)
+{
+    Q_ASSERT(requestId != 0);
+    batchSocket->m_channels.insert(requestId, this);
+    connect( batchSocket, SIGNAL(disconnected()),
+             this, SLOT(onBatchSocketDisconnected()) );
+}
+
 ClientSocket::~ClientSocket()
 {
     SOCKET_LOG("Destroying socket.");
+
+    if ( isChannel() && m_batchSocket )
+        m_batchSocket->m_channels.remove(m_requestId);
+
     close();
 }
 
+void ClientSocket::startBatchMode()
+{
+    sendMessage(QByteArray(), batchModeMessageCode);
+    m_batchMode = true;
+}
+
 void ClientSocket::start()
 {
+    // Channel receives messages from batch socket.
+    if ( isChannel() )
+        return;
+
     if ( !m_socket || !m_socket->waitForConnected(4000) )
     {
         emit connectionFailed();
@@ -148,16 +245,17 @@ void ClientSocket::sendMessage(const QByteArray &message, int messageCode)
 {
     SOCKET_LOG( QString("Sending message to client (exit code: %1).").arg(messageCode) );
 
-    if (!m_socket) {
+    if ( isChannel() ) {
+        if ( m_closed || !m_batchSocket )
+            SOCKET_LOG("Client disconnected!");
+        else
+            m_batchSocket->sendMessage( createMessage(message, messageCode), m_requestId );
+    } else if (!m_socket) {
         SOCKET_LOG("Cannot send message to client. Socket is already deleted.");
     } else if (m_closed) {
         SOCKET_LOG("Client disconnected!");
     } else {
-        QByteArray msg;
-        QDataStream out(&msg, QIODevice::WriteOnly);
-        out << static_cast<qint32>(messageCode);
-        out.writeRawData( message.constData(), message.length() );
-        if ( writeMessage(m_socket, msg) )
+        if ( writeMessage(m_socket, createMessage(message, messageCode)) )
             SOCKET_LOG("Message sent to client.");
         else
             SOCKET_LOG("Failed to send message to client!");
@@ -166,7 +264,11 @@ void ClientSocket::sendMessage(const QByteArray &message, int messageCode)
 
 void ClientSocket::deleteAfterDisconnected()
 {
-    if (!m_socket) {
+    if ( isChannel() ) {
+        // Channel is not needed after request finishes.
+        SOCKET_LOG("Delete channel.");
+        deleteLater();
+    } else if (!m_socket) {
         SOCKET_LOG("Socket is already deleted.");
         deleteLater();
     } else if (m_closed) {
@@ -180,7 +282,9 @@ void ClientSocket::deleteAfterDisconnected()
 
 void ClientSocket::close()
 {
-    if (m_socket) {
+    if ( isChannel() ) {
+        onStateChanged(QLocalSocket::UnconnectedState);
+    } else if (m_socket) {
         SOCKET_LOG("Disconnecting socket.");
         m_socket->disconnectFromServer();
         m_socket->deleteLater();
@@ -216,12 +320,17 @@ void ClientSocket::onReadyRead()
             return;
         }
 
-        QDataStream stream(msg);
-        qint32 messageCode;
-        stream >> messageCode;
-        const int i = sizeof(messageCode);
-        const QByteArray data( msg.constData() + i, msg.length() - i );
-        emit messageReceived(data, messageCode);
+        int messageCode;
+        QByteArray data;
+        if ( !parseMessage(msg, &messageCode, &data) ) {
+            log( tr("Failed to read message from client!"), LogError );
+            continue;
+        }
+
+        if (m_batchMode)
+            onBatchMessageReceived(data, messageCode);
+        else
+            emit messageReceived(data, messageCode);
     }
 
     connect( m_socket, SIGNAL(readyRead()),
@@ -260,15 +369,60 @@ Arguments ClientSocket::readArguments()
 
     if ( readMessage(m_socket, &msg) ) {
         SOCKET_LOG("Message received from client.");
-        QDataStream input(msg);
-        qint32 exitCode;
-        Arguments args;
-        input >> exitCode >> args;
-        if ( input.status() == QDataStream::Ok && exitCode == 0 && !args.isEmpty() )
-            return args;
+        int messageCode;
+        QByteArray data;
+        if ( parseMessage(msg, &messageCode, &data) ) {
+            if (messageCode == batchModeMessageCode) {
+                SOCKET_LOG("Batch mode started.");
+                m_batchMode = true;
+                m_acceptsRequests = true;
+                return Arguments();
+            }
+
+            Arguments args;
+            if ( messageCode == 0 && deserializeArguments(data, &args) )
+                return args;
+        }
     }
 
     log( tr("Failed to read message from client!"), LogError );
 
     return Arguments();
 }
+
+void ClientSocket::onBatchSocketDisconnected()
+{
+    onStateChanged(QLocalSocket::UnconnectedState);
+}
+
+void ClientSocket::onBatchMessageReceived(const QByteArray &message, int requestId)
+{
+    int messageCode;
+    QByteArray data;
+    if ( !parseMessage(message, &messageCode, &data) ) {
+        log( tr("Failed to read message from client!"), LogError );
+        return;
+    }
+
+    ClientSocket *channel = m_channels.value(requestId);
+    if (channel) {
+        emit channel->messageReceived(data, messageCode);
+        return;
+    }
+
+    // Only server accepts new requests (client creates channels itself).
+    if (!m_acceptsRequests || requestId == 0) {
+        SOCKET_LOG( QString("Ignoring message for request %1.").arg(requestId) );
+        return;
+    }
+
+    Arguments args;
+    if ( messageCode != 0 || !deserializeArguments(data, &args) ) {
+        SOCKET_LOG( QString("Bad request %1.").arg(requestId) );
+        sendMessage( createMessage(QByteArray(), CommandBadSyntax), requestId );
+        return;
+    }
+
+    channel = new ClientSocket(this, requestId);
+    emit commandReceived(args, channel);
+}
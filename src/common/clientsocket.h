@@ -20,6 +20,7 @@
 #ifndef CLIENTSOCKET_H
 #define CLIENTSOCKET_H
 
+#include <QHash>
 #include <QLocalSocket>
 #include <QObject>
 #include <QPointer>
@@ -37,8 +38,21 @@ public:
 
     explicit ClientSocket(QLocalSocket *socket, QObject *parent = NULL);
 
+    /**
+     * Create channel for request with @a requestId in batch mode.
+     *
+     * Messages for the channel are sent and received over @a batchSocket.
+     */
+    ClientSocket(ClientSocket *batchSocket, int requestId);
+
     ~ClientSocket();
 
+    /** Send first message to server to start batch mode. */
+    void startBatchMode();
+
+    /** Return true if batch mode was started by client (see readArguments()). */
+    bool isBatchMode() const { return m_batchMode; }
+
 public slots:
     /// Start emiting messageReceived().
     void start();
@@ -59,18 +73,40 @@ signals:
     void disconnected();
     void connectionFailed();
 
+    /** Emitted on server for each new request (with new channel) in batch mode. */
+    void commandReceived(const Arguments &args, ClientSocket *channel);
+
 private slots:
     void onReadyRead();
     void onError(QLocalSocket::LocalSocketError error);
     void onStateChanged(QLocalSocket::LocalSocketState state);
+    void onBatchSocketDisconnected();
 
 private:
-    /// Receive arguments from client.
+    /**
+     * Receive arguments from client.
+     *
+     * Returns empty arguments if client starts batch mode.
+     */
     Arguments readArguments();
 
+    void onBatchMessageReceived(const QByteArray &message, int requestId);
+
+    bool isChannel() const { return m_requestId != 0; }
+
     QLocalSocket *m_socket;
     bool m_deleteAfterDisconnected;
     bool m_closed;
+
+    bool m_batchMode;
+    /// True on server if client started batch mode.
+    bool m_acceptsRequests;
+    /// Channels for requests in batch mode.
+    QHash< int, QPointer<ClientSocket> > m_channels;
+
+    /// Socket for channel in batch mode.
+    QPointer<ClientSocket> m_batchSocket;
+    int m_requestId;
 };
 
 #endif // CLIENTSOCKET_H
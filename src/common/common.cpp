@@ -19,6 +19,7 @@
 
 #include "common/common.h"
 
+#include "common/datafingerprint.h"
 #include "common/log.h"
 #include "common/mimetypes.h"
 
@@ -178,6 +179,22 @@ QString escapeHtml(const QString &str)
 #endif
 }
 
+QString jsonString(const QString &str)
+{
+    QString result("\"");
+
+    foreach (const QChar &c, str) {
+        if ( c == '"' || c == '\\' )
+            result.append('\\').append(c);
+        else if ( c.unicode() < 0x20 )
+            result.append( QString("\\u%1").arg(c.unicode(), 4, 16, QChar('0')) );
+        else
+            result.append(c);
+    }
+
+    return result + "\"";
+}
+
 bool isMainThread()
 {
     return QThread::currentThread() == qApp->thread();
@@ -197,20 +214,34 @@ uint hash(const QVariantMap &data)
 {
     uint hash = 0;
 
-    foreach ( const QString &mime, data.keys() ) {
-        // Skip some special data.
-        if (mime == mimeWindowTitle || mime == mimeOwner)
-            continue;
-#ifdef HAS_MOUSE_SELECTIONS
-        if (mime == mimeClipboardMode)
-            continue;
-#endif
-        hash ^= qHash(data[mime].toByteArray()) + qHash(mime);
+    for ( QVariantMap::const_iterator it = data.constBegin(); it != data.constEnd(); ++it ) {
+        if ( isHashedFormat(it.key()) )
+            hash ^= formatHash( it.key(), fingerprintHash(it.value().toByteArray()) );
     }
 
     return hash;
 }
 
+bool isHashedFormat(const QString &mime)
+{
+    // Skip some special data.
+    if (mime == mimeWindowTitle || mime == mimeOwner
+            || mime == mimeTraceId || mime == mimeTraceEvents)
+    {
+        return false;
+    }
+#ifdef HAS_MOUSE_SELECTIONS
+    if (mime == mimeClipboardMode)
+        return false;
+#endif
+    return true;
+}
+
+uint formatHash(const QString &mime, quint64 dataFingerprint)
+{
+    return static_cast<uint>(dataFingerprint ^ (dataFingerprint >> 32)) + qHash(mime);
+}
+
 QByteArray getUtf8Data(const QMimeData &data, const QString &format)
 {
     if (format == mimeText || format == mimeHtml)
@@ -256,38 +287,62 @@ void setTextData(QVariantMap *data, const QString &text)
 }
 
 QVariantMap cloneData(const QMimeData &data, const QStringList &formats)
+{
+    QImage image;
+    QStringList imageFormats;
+    QVariantMap newdata = cloneData(data, formats, &image, &imageFormats);
+    convertImageData(image, imageFormats, &newdata);
+    return newdata;
+}
+
+QVariantMap cloneData(
+        const QMimeData &data, const QStringList &formats,
+        QImage *imageToConvert, QStringList *imageFormats)
 {
     static const QStringList internalMimeTypes = QStringList()
             << mimeOwner << mimeWindowTitle << mimeItemNotes << mimeHidden;
 
     QVariantMap newdata;
 
-    QImage image;
-    bool imageLoaded = false;
+    // Probe available formats first so that formats which are not offered
+    // are not requested from clipboard owner.
+    const QStringList availableFormats = data.formats();
+    bool hasImage = false;
+    foreach (const QString &format, availableFormats) {
+        if ( format.startsWith("image/") || format == "application/x-qt-image" ) {
+            hasImage = true;
+            break;
+        }
+    }
 
     foreach (const QString &mime, formats) {
-        const QByteArray bytes = getUtf8Data(data, mime);
-        if ( !bytes.isEmpty() ) {
-            newdata.insert(mime, bytes);
-        } else if ( !imageLoaded || !image.isNull() ) {
-            const QString format = getImageFormatFromMime(mime);
-            if ( !format.isEmpty() ) {
-                if (!imageLoaded) {
-                    image = getImageData(data);
-                    imageLoaded = true;
-                }
-                cloneImageData(image, format, mime, &newdata);
+        // Text and URLs can be converted from other formats.
+        const bool canConvert = mime == mimeText || mime == mimeHtml || mime == mimeUriList;
+        if ( canConvert || availableFormats.contains(mime) ) {
+            const QByteArray bytes = getUtf8Data(data, mime);
+            if ( !bytes.isEmpty() ) {
+                newdata.insert(mime, bytes);
+                continue;
             }
         }
+
+        if ( hasImage && !getImageFormatFromMime(mime).isEmpty() )
+            imageFormats->append(mime);
+    }
+
+    if ( !imageFormats->isEmpty() ) {
+        *imageToConvert = getImageData(data);
+        if ( imageToConvert->isNull() )
+            imageFormats->clear();
     }
 
     foreach (const QString &internalMime, internalMimeTypes) {
-        if ( data.hasFormat(internalMime) )
+        if ( availableFormats.contains(internalMime) )
             newdata.insert( internalMime, data.data(internalMime) );
     }
 
     if ( hasLogLevel(LogTrace) ) {
-        foreach (const QString &format, data.formats()) {
+        foreach (const QString &format, availableFormats) {
             if ( !formats.contains(format) )
                 COPYQ_LOG_VERBOSE(QString("Skipping format: %1").arg(format));
         }
@@ -296,6 +351,12 @@ QVariantMap cloneData(const QMimeData &data, const QStringList &formats)
     return newdata;
 }
 
+void convertImageData(const QImage &image, const QStringList &imageFormats, QVariantMap *dataMap)
+{
+    foreach (const QString &mime, imageFormats)
+        cloneImageData(image, getImageFormatFromMime(mime), mime, dataMap);
+}
+
 QVariantMap cloneData(const QMimeData &data)
 {
     QStringList formats;
@@ -500,6 +561,8 @@ bool containsAnyData(const QVariantMap &data)
         if (mime != mimeOwner
                 && mime != mimeWindowTitle
                 && mime != mimeHidden
+                && mime != mimeTraceId
+                && mime != mimeTraceEvents
         #ifdef HAS_MOUSE_SELECTIONS
                 && mime != mimeClipboardMode
         #endif
@@ -28,6 +28,7 @@
 
 class QAction;
 class QByteArray;
+class QImage;
 class QIODevice;
 class QKeyEvent;
 class QKeySequence;
@@ -60,12 +61,34 @@ QString quoteString(const QString &str);
 
 QString escapeHtml(const QString &str);
 
+/// Return @a str quoted and escaped as JSON string.
+QString jsonString(const QString &str);
+
 bool isMainThread();
 
 const QMimeData *clipboardData(QClipboard::Mode mode = QClipboard::Clipboard);
 
+/**
+ * Version of hash() algorithm.
+ *
+ * Must be increased whenever hash() changes so that saved data keyed by item hash
+ * (e.g. item heights) are dropped instead of being matched to wrong items.
+ */
+const qint32 dataHashVersion = 2;
+
 uint hash(const QVariantMap &data);
 
+/// Return true if format data are part of hash() (e.g. window title is not).
+bool isHashedFormat(const QString &mime);
+
+/**
+ * Return hash of format with data fingerprint (see fingerprintHash()).
+ *
+ * Item hash (see hash()) is XOR of hashes of all hashed formats so it can be
+ * computed without loading data if fingerprints are known.
+ */
+uint formatHash(const QString &mime, quint64 dataFingerprint);
+
 QByteArray getUtf8Data(const QMimeData &data, const QString &format);
 
 QString getTextData(const QByteArray &data);
@@ -86,6 +109,24 @@ void setTextData(QVariantMap *data, const QString &text);
 /** Clone data for given formats (text or HTML will be UTF8 encoded). */
 QVariantMap cloneData(const QMimeData &data, const QStringList &formats);
 
+/**
+ * Clone data for given formats but don't convert image.
+ *
+ * Image formats which are not available but can be converted from image data
+ * are added to @a imageFormats and the image is returned in @a imageToConvert.
+ * Use convertImageData() to add these formats later.
+ */
+QVariantMap cloneData(
+        const QMimeData &data, const QStringList &formats,
+        QImage *imageToConvert, QStringList *imageFormats);
+
+/**
+ * Add image in given formats to @a dataMap.
+ *
+ * This can be slow for big images but it's safe to call from any thread.
+ */
+void convertImageData(const QImage &image, const QStringList &imageFormats, QVariantMap *dataMap);
+
 /** Clone all data as is. */
 QVariantMap cloneData(const QMimeData &data);
 
@@ -0,0 +1,148 @@
+/*
+    Copyright (c) 2016, Lukas Holecek <hluk@email.cz>
+
+    This file is part of CopyQ.
+
+    CopyQ is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    CopyQ is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with CopyQ.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#include "common/datafingerprint.h"
+
+#include "common/mimetypes.h"
+
+#include <QByteArray>
+#include <QtEndian>
+
+#include <string.h>
+
+namespace {
+
+const quint64 prime1 = Q_UINT64_C(11400714785074694791);
+const quint64 prime2 = Q_UINT64_C(14029467366897019727);
+const quint64 prime3 = Q_UINT64_C(1609587929392839161);
+const quint64 prime4 = Q_UINT64_C(9650029242287828579);
+const quint64 prime5 = Q_UINT64_C(2870177450012600261);
+
+inline quint64 rotateLeft(quint64 value, int bits)
+{
+    return (value << bits) | (value >> (64 - bits));
+}
+
+inline quint64 read64(const uchar *data)
+{
+    quint64 value;
+    memcpy(&value, data, sizeof(value));
+    return qFromLittleEndian(value);
+}
+
+inline quint32 read32(const uchar *data)
+{
+    quint32 value;
+    memcpy(&value, data, sizeof(value));
+    return qFromLittleEndian(value);
+}
+
+inline quint64 hashRound(quint64 acc, quint64 input)
+{
+    acc += input * prime2;
+    acc = rotateLeft(acc, 31);
+    return acc * prime1;
+}
+
+inline quint64 mergeRound(quint64 acc, quint64 value)
+{
+    acc ^= hashRound(0, value);
+    return acc * prime1 + prime4;
+}
+
+} // namespace
+
+quint64 fingerprintHash(const QByteArray &bytes)
+{
+    const uchar *p = reinterpret_cast<const uchar *>(bytes.constData());
+    const uchar *end = p + bytes.size();
+    quint64 h;
+
+    if (bytes.size() >= 32) {
+        // Process four independent lanes so the loop pipelines well.
+        quint64 v1 = prime1 + prime2;
+        quint64 v2 = prime2;
+        quint64 v3 = 0;
+        quint64 v4 = 0 - prime1;
+
+        const uchar *limit = end - 32;
+        do {
+            v1 = hashRound(v1, read64(p));
+            v2 = hashRound(v2, read64(p + 8));
+            v3 = hashRound(v3, read64(p + 16));
+            v4 = hashRound(v4, read64(p + 24));
+            p += 32;
+        } while (p <= limit);
+
+        h = rotateLeft(v1, 1) + rotateLeft(v2, 7) + rotateLeft(v3, 12) + rotateLeft(v4, 18);
+        h = mergeRound(h, v1);
+        h = mergeRound(h, v2);
+        h = mergeRound(h, v3);
+        h = mergeRound(h, v4);
+    } else {
+        h = prime5;
+    }
+
+    h += static_cast<quint64>(bytes.size());
+
+    for (; p + 8 <= end; p += 8) {
+        h ^= hashRound(0, read64(p));
+        h = rotateLeft(h, 27) * prime1 + prime4;
+    }
+
+    if (p + 4 <= end) {
+        h ^= static_cast<quint64>(read32(p)) * prime1;
+        h = rotateLeft(h, 23) * prime2 + prime3;
+        p += 4;
+    }
+
+    for (; p < end; ++p) {
+        h ^= (*p) * prime5;
+        h = rotateLeft(h, 11) * prime1;
+    }
+
+    h ^= h >> 33;
+    h *= prime2;
+    h ^= h >> 29;
+    h *= prime3;
+    h ^= h >> 32;
+
+    return h;
+}
+
+DataFingerprint dataFingerprint(const QByteArray &bytes)
+{
+    DataFingerprint fingerprint;
+    fingerprint.size = bytes.size();
+    fingerprint.hash = fingerprintHash(bytes);
+    return fingerprint;
+}
+
+DataFingerprints dataFingerprints(const QVariantMap &data)
+{
+    DataFingerprints fingerprints;
+
+    foreach ( const QString &format, data.keys() ) {
+        if ( !format.startsWith(COPYQ_MIME_PREFIX) )
+            fingerprints.insert( format, dataFingerprint(data[format].toByteArray()) );
+    }
+
+    return fingerprints;
+}
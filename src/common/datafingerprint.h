@@ -0,0 +1,60 @@
+/*
+    Copyright (c) 2016, Lukas Holecek <hluk@email.cz>
+
+    This file is part of CopyQ.
+
+    CopyQ is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    CopyQ is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with CopyQ.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#ifndef DATAFINGERPRINT_H
+#define DATAFINGERPRINT_H
+
+#include <QMap>
+#include <QString>
+#include <QVariantMap>
+
+class QByteArray;
+
+/**
+ * Compact fingerprint of data in single format.
+ *
+ * Used to detect changed data without keeping copy of the data.
+ */
+struct DataFingerprint {
+    DataFingerprint() : size(0), hash(0) {}
+
+    bool operator==(const DataFingerprint &other) const
+    {
+        return size == other.size && hash == other.hash;
+    }
+
+    bool operator!=(const DataFingerprint &other) const { return !(*this == other); }
+
+    int size;
+    quint64 hash;
+};
+
+/// Fingerprints for each format.
+typedef QMap<QString, DataFingerprint> DataFingerprints;
+
+/// Fast 64-bit non-cryptographic hash of @a bytes (XXH64).
+quint64 fingerprintHash(const QByteArray &bytes);
+
+DataFingerprint dataFingerprint(const QByteArray &bytes);
+
+/// Return fingerprints of all formats in @a data except internal ones.
+DataFingerprints dataFingerprints(const QVariantMap &data);
+
+#endif // DATAFINGERPRINT_H
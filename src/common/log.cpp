@@ -19,13 +19,21 @@
 
 #include "log.h"
 
+#include <QAtomicInt>
+#include <QAtomicPointer>
 #include <QCoreApplication>
+#include <QDataStream>
 #include <QDateTime>
 #include <QDir>
 #include <QFile>
+#include <QFileInfo>
+#include <QMutex>
+#include <QSemaphore>
 #include <QSharedPointer>
 #include <QString>
 #include <QSystemSemaphore>
+#include <QThread>
+#include <QWaitCondition>
 #include <QtGlobal>
 
 #if QT_VERSION < 0x050000
@@ -39,6 +47,131 @@ namespace {
 const int logFileSize = 128 * 1024;
 const int logFileCount = 4;
 
+/// Maximum number of messages waiting for log writer thread (power of two).
+const int logQueueSize = 4096;
+
+/// Log writer thread writes pending messages at least this often.
+const int logWriteIntervalMs = 100;
+
+/// Maximum time to wait for log writer thread to write pending messages.
+const int logFlushTimeoutMs = 1000;
+
+/// Suffix for log files in binary format.
+const char binaryLogFileSuffix[] = ".bin";
+
+struct LogRecord {
+    LogRecord() : text(), level(LogNote), msecs(0) {}
+
+    LogRecord(const QString &text, LogLevel level)
+        : text(text)
+        , level(level)
+        , msecs( QDateTime::currentMSecsSinceEpoch() )
+    {
+    }
+
+    QString text;
+    LogLevel level;
+    qint64 msecs;
+};
+
+inline int loadAcquire(QAtomicInt &value)
+{
+#if QT_VERSION >= 0x050000
+    return value.loadAcquire();
+#else
+    return value.fetchAndAddAcquire(0);
+#endif
+}
+
+inline void storeRelease(QAtomicInt &value, int newValue)
+{
+#if QT_VERSION >= 0x050000
+    value.storeRelease(newValue);
+#else
+    value.fetchAndStoreRelease(newValue);
+#endif
+}
+
+/// Difference of two positions in queue (positions can overflow).
+inline int positionDiff(int a, int b)
+{
+    return static_cast<int>( static_cast<uint>(a) - static_cast<uint>(b) );
+}
+
+/**
+ * Bounded lock-free queue with multiple producers and single consumer.
+ *
+ * Each slot has a sequence number which tells whether the slot is free
+ * for position being enqueued or contains record for position being dequeued.
+ */
+class LogQueue {
+public:
+    LogQueue()
+        : m_slots(new Slot[logQueueSize])
+        , m_enqueuePos(0)
+        , m_dequeuePos(0)
+    {
+        for (int i = 0; i < logQueueSize; ++i)
+            storeRelease(m_slots[i].sequence, i);
+    }
+
+    ~LogQueue()
+    {
+        delete[] m_slots;
+    }
+
+    /// Add record; returns false if queue is full.
+    bool enqueue(const LogRecord &record)
+    {
+        int pos = loadAcquire(m_enqueuePos);
+        forever {
+            Slot &slot = m_slots[pos & (logQueueSize - 1)];
+            const int diff = positionDiff( loadAcquire(slot.sequence), pos );
+            if (diff == 0) {
+                if ( m_enqueuePos.testAndSetOrdered(pos, pos + 1) ) {
+                    slot.record = record;
+                    storeRelease(slot.sequence, pos + 1);
+                    return true;
+                }
+                pos = loadAcquire(m_enqueuePos);
+            } else if (diff < 0) {
+                return false;
+            } else {
+                pos = loadAcquire(m_enqueuePos);
+            }
+        }
+    }
+
+    /// Take oldest record; returns false if there is none. Called only from consumer thread.
+    bool dequeue(LogRecord *record)
+    {
+        const int pos = loadAcquire(m_dequeuePos);
+        Slot &slot = m_slots[pos & (logQueueSize - 1)];
+        if ( positionDiff(loadAcquire(slot.sequence), pos + 1) < 0 )
+            return false;
+
+        *record = slot.record;
+        slot.record = LogRecord();
+        storeRelease(slot.sequence, pos + logQueueSize);
+        storeRelease(m_dequeuePos, pos + 1);
+        return true;
+    }
+
+    int enqueuedCount() { return loadAcquire(m_enqueuePos); }
+
+    int dequeuedCount() { return loadAcquire(m_dequeuePos); }
+
+private:
+    struct Slot {
+        QAtomicInt sequence;
+        LogRecord record;
+    };
+
+    Slot *m_slots;
+    QAtomicInt m_enqueuePos;
+    QAtomicInt m_dequeuePos;
+};
+
 int getLogLevel()
 {
     const QByteArray logLevelString = qgetenv("COPYQ_LOG_LEVEL").toUpper();
@@ -67,6 +200,13 @@ QString envString(const char *varName)
     return QString::fromUtf8( bytes.constData(), bytes.size() );
 }
 
+/// Binary log is enabled with COPYQ_LOG_BINARY=1; it's decoded in readLogFile().
+bool isBinaryLogEnabled()
+{
+    static const bool enabled = qgetenv("COPYQ_LOG_BINARY") == "1";
+    return enabled;
+}
+
 /// System-wide mutex
 class SystemMutex {
 public:
@@ -105,6 +245,9 @@ private:
 typedef QSharedPointer<SystemMutex> SystemMutexPtr;
 SystemMutexPtr sessionMutex;
 
+/// Guards sessionMutex which is also used from log writer thread.
+QMutex sessionMutexGuard;
+
 /// Lock guard for SystemMutex.
 class SystemMutexLocker {
 public:
@@ -132,9 +275,14 @@ private:
 void initSessionMutex(QSystemSemaphore::AccessMode accessMode)
 {
     const QString mutexName = QCoreApplication::applicationName() + "_mutex";
-    sessionMutex = SystemMutexPtr(new SystemMutex(mutexName, accessMode));
+    const SystemMutexPtr mutex(new SystemMutex(mutexName, accessMode));
 
-    const QString error = sessionMutex->error();
+    {
+        QMutexLocker lock(&sessionMutexGuard);
+        sessionMutex = mutex;
+    }
+
+    const QString error = mutex->error();
     const bool create = accessMode == QSystemSemaphore::Create;
     if ( !error.isEmpty() ) {
         const QString action = create ? "create" : "open";
@@ -145,11 +293,17 @@ void initSessionMutex(QSystemSemaphore::AccessMode accessMode)
     }
 }
 
-const SystemMutexPtr &getSessionMutex()
+SystemMutexPtr getSessionMutex()
 {
-    if (sessionMutex.isNull())
-        initSessionMutex(QSystemSemaphore::Open);
+    {
+        QMutexLocker lock(&sessionMutexGuard);
+        if ( !sessionMutex.isNull() )
+            return sessionMutex;
+    }
+
+    initSessionMutex(QSystemSemaphore::Open);
 
+    QMutexLocker lock(&sessionMutexGuard);
     return sessionMutex;
 }
 
@@ -175,23 +329,355 @@ QString readLogFile(const QString &fileName)
     return QString::fromUtf8(content);
 }
 
-QString logFileName(int i)
+QString logFileName(const QString &baseName, int i)
 {
     if (i <= 0)
-        return ::logFileName();
-    return ::logFileName() + "." + QString::number(i);
+        return baseName;
+    return baseName + "." + QString::number(i);
+}
+
+QString logFileBaseName()
+{
+    return isBinaryLogEnabled() ? ::logFileName() + binaryLogFileSuffix : ::logFileName();
 }
 
-void rotateLogFiles()
+void rotateLogFiles(const QString &baseName)
 {
     for (int i = logFileCount - 1; i > 0; --i) {
-        const QString sourceFileName = logFileName(i - 1);
-        const QString targetFileName = logFileName(i);
+        const QString sourceFileName = logFileName(baseName, i - 1);
+        const QString targetFileName = logFileName(baseName, i);
         QFile::remove(targetFileName);
         QFile::rename(sourceFileName, targetFileName);
     }
 }
 
+/// Rotate log files if other process haven't done it already.
+void rotateLogFilesIfNeeded(const QString &baseName)
+{
+    SystemMutexLocker lock(getSessionMutex());
+    if ( QFileInfo(baseName).size() > logFileSize )
+        rotateLogFiles(baseName);
+}
+
+QString formatLogMessage(const QString &text, const LogLevel level, const QDateTime &time)
+{
+    const QString timeStamp = time.toString(" [yyyy-MM-dd hh:mm:ss.zzz]");
+
+    const QString label = "CopyQ " + logLevelLabel(level) + timeStamp + ": ";
+
+    return label + QString(text).replace("\n", "\n" + label + "   ") + "\n";
+}
+
+QString formatLogMessage(const LogRecord &record)
+{
+    return formatLogMessage(
+                record.text, record.level, QDateTime::fromMSecsSinceEpoch(record.msecs) );
+}
+
+void writeBinaryLogRecord(QDataStream *stream, const LogRecord &record)
+{
+    *stream << static_cast<quint8>(record.level) << record.msecs << record.text.toUtf8();
+}
+
+QString decodeBinaryLog(const QByteArray &bytes)
+{
+    QDataStream stream(bytes);
+    QString content;
+
+    while ( !stream.atEnd() ) {
+        quint8 level;
+        qint64 msecs;
+        QByteArray text;
+        stream >> level >> msecs >> text;
+        if ( stream.status() != QDataStream::Ok )
+            break;
+
+        content.append( formatLogMessage(
+                    QString::fromUtf8(text), static_cast<LogLevel>(level),
+                    QDateTime::fromMSecsSinceEpoch(msecs)) );
+    }
+
+    return content;
+}
+
+QByteArray serializeLogRecord(const LogRecord &record)
+{
+    if ( !isBinaryLogEnabled() )
+        return formatLogMessage(record).toUtf8();
+
+    QByteArray bytes;
+    QDataStream stream(&bytes, QIODevice::WriteOnly);
+    writeBinaryLogRecord(&stream, record);
+    return bytes;
+}
+
+void writeToStandardError(const QByteArray &msg)
+{
+    QFile ferr;
+    ferr.open(stderr, QIODevice::WriteOnly);
+    ferr.write(msg);
+}
+
+/// Write to log file directly (used if log writer thread is not available).
+void writeLogRecordNow(const LogRecord &record)
+{
+    SystemMutexLocker lock(getSessionMutex());
+
+    const QString baseName = logFileBaseName();
+    const QByteArray msg = serializeLogRecord(record);
+
+    QFile f(baseName);
+    const bool writtenToLogFile = f.open(QIODevice::Append) && f.write(msg);
+    if (writtenToLogFile)
+        f.close();
+    else if (record.level > LogWarning) // Otherwise already printed in log().
+        writeToStandardError( formatLogMessage(record).toUtf8() );
+
+    if ( writtenToLogFile && f.size() > logFileSize )
+        rotateLogFiles(baseName);
+}
+
+/**
+ * Thread which writes log messages from all threads of the process.
+ *
+ * Messages are passed in lock-free queue and written in batches to log
+ * file which is kept open.
+ *
+ * Log files are rotated while holding session mutex. If the current log
+ * file was rotated by other process, it's reopened.
+ */
+class LogWriter : public QThread {
+public:
+    LogWriter()
+        : m_queue()
+        , m_baseName( logFileBaseName() )
+        , m_file(m_baseName)
+        , m_wake()
+        , m_stopping(0)
+        , m_producers(0)
+        , m_writtenCount(0)
+        , m_flushMutex()
+        , m_flushed()
+    {
+    }
+
+    /// Add message to queue; returns false if message needs to be written directly.
+    bool enqueue(const LogRecord &record)
+    {
+        // Producer is counted before checking the stop flag so either it sees
+        // the flag or stop() waits for it and writes its message.
+        m_producers.fetchAndAddOrdered(1);
+        const bool queued = tryEnqueue(record);
+        m_producers.fetchAndAddOrdered(-1);
+        return queued;
+    }
+
+    /// Wait for writer to write all queued messages.
+    void flush()
+    {
+        if ( QThread::currentThread() == this || !isRunning() )
+            return;
+
+        const int target = m_queue.enqueuedCount();
+
+        QMutexLocker lock(&m_flushMutex);
+        m_wake.release();
+        for ( int waitMs = 0;
+              waitMs < logFlushTimeoutMs && positionDiff(loadAcquire(m_writtenCount), target) < 0;
+              waitMs += logWriteIntervalMs )
+        {
+            m_flushed.wait(&m_flushMutex, logWriteIntervalMs);
+        }
+    }
+
+    /// Write pending messages and stop thread.
+    void stop()
+    {
+        m_stopping.fetchAndStoreOrdered(1);
+        m_wake.release();
+        wait();
+
+        // Write messages queued after the thread wrote the last batch.
+        while ( loadAcquire(m_producers) != 0 )
+            QThread::yieldCurrentThread();
+
+        LogRecord record;
+        while ( m_queue.dequeue(&record) )
+            writeLogRecordNow(record);
+    }
+
+protected:
+    void run()
+    {
+        forever {
+            m_wake.tryAcquire(1, logWriteIntervalMs);
+            m_wake.tryAcquire( m_wake.available() );
+
+            writePending();
+
+            if ( loadAcquire(m_stopping) != 0 ) {
+                writePending();
+                break;
+            }
+        }
+
+        m_file.close();
+    }
+
+private:
+    bool tryEnqueue(const LogRecord &record)
+    {
+        if ( loadAcquire(m_stopping) != 0 )
+            return false;
+
+        // Writer thread cannot wait for itself.
+        const bool canWait = QThread::currentThread() != this;
+
+        while ( !m_queue.enqueue(record) ) {
+            if ( !canWait || loadAcquire(m_stopping) != 0 || !isRunning() )
+                return false;
+            m_wake.release();
+            QThread::yieldCurrentThread();
+        }
+
+        // Wake writer early if queue is getting full.
+        if ( positionDiff(m_queue.enqueuedCount(), loadAcquire(m_writtenCount)) > logQueueSize / 2 )
+            m_wake.release();
+
+        return true;
+    }
+
+    void writePending()
+    {
+        QByteArray bytes;
+        LogRecord record;
+
+        if ( isBinaryLogEnabled() ) {
+            QDataStream stream(&bytes, QIODevice::WriteOnly);
+            while ( m_queue.dequeue(&record) )
+                writeBinaryLogRecord(&stream, record);
+        } else {
+            while ( m_queue.dequeue(&record) )
+                bytes.append( formatLogMessage(record).toUtf8() );
+        }
+
+        if ( !bytes.isEmpty() )
+            write(bytes);
+
+        storeRelease( m_writtenCount, m_queue.dequeuedCount() );
+
+        QMutexLocker lock(&m_flushMutex);
+        m_flushed.wakeAll();
+    }
+
+    void write(const QByteArray &bytes)
+    {
+        if ( !m_file.isOpen()
+             && !m_file.open(QIODevice::WriteOnly | QIODevice::Append | QIODevice::Unbuffered) )
+        {
+            writeToStandardError( isBinaryLogEnabled() ? decodeBinaryLog(bytes).toUtf8() : bytes );
+            return;
+        }
+
+        if ( m_file.write(bytes) != bytes.size() ) {
+            m_file.close();
+            writeToStandardError( isBinaryLogEnabled() ? decodeBinaryLog(bytes).toUtf8() : bytes );
+            return;
+        }
+
+        const qint64 size = m_file.size();
+
+#ifdef Q_OS_WIN
+        // Log file cannot be rotated on Windows while other process has it open.
+        m_file.close();
+#endif
+
+        if (size > logFileSize) {
+            rotateLogFilesIfNeeded(m_baseName);
+            m_file.close();
+        } else if ( m_file.isOpen() && QFileInfo(m_baseName).size() < size ) {
+            // Log file was rotated by other process.
+            m_file.close();
+        }
+    }
+
+    LogQueue m_queue;
+    QString m_baseName;
+    QFile m_file;
+    QSemaphore m_wake;
+    QAtomicInt m_stopping;
+    QAtomicInt m_producers;
+    QAtomicInt m_writtenCount;
+    QMutex m_flushMutex;
+    QWaitCondition m_flushed;
+};
+
+QAtomicPointer<LogWriter> logWriterInstance;
+QMutex logWriterMutex;
+bool logWriterStopped = false;
+
+void stopLogWriter()
+{
+    LogWriter *writer;
+    {
+        QMutexLocker lock(&logWriterMutex);
+        logWriterStopped = true;
+        writer = logWriterInstance.fetchAndStoreOrdered(NULL);
+    }
+
+    // Messages logged from writer thread while stopping are written directly.
+    if (writer != NULL)
+        writer->stop();
+
+    // Writer is not deleted since other threads may still hold pointer to it;
+    // after stop() it rejects new messages which are then written directly.
+}
+
+/// Return log writer thread or NULL if messages should be written directly.
+LogWriter *logWriter()
+{
+#if QT_VERSION >= 0x050000
+    LogWriter *writer = logWriterInstance.loadAcquire();
+#else
+    LogWriter *writer = logWriterInstance;
+#endif
+    if (writer != NULL)
+        return writer;
+
+    // Writer is stopped with application object.
+    if ( QCoreApplication::instance() == NULL )
+        return NULL;
+
+    QMutexLocker lock(&logWriterMutex);
+    if (logWriterStopped)
+        return NULL;
+
+#if QT_VERSION >= 0x050000
+    writer = logWriterInstance.loadAcquire();
+#else
+    writer = logWriterInstance;
+#endif
+    if (writer == NULL) {
+        writer = new LogWriter();
+        writer->start();
+        logWriterInstance.fetchAndStoreOrdered(writer);
+        qAddPostRoutine(stopLogWriter);
+    }
+
+    return writer;
+}
+
+void flushLog()
+{
+#if QT_VERSION >= 0x050000
+    LogWriter *writer = logWriterInstance.loadAcquire();
+#else
+    LogWriter *writer = logWriterInstance;
+#endif
+    if (writer != NULL)
+        writer->flush();
+}
+
 } // namespace
 
 QString logFileName()
@@ -209,13 +695,27 @@ QString logFileName()
 
 QString readLogFile()
 {
+    flushLog();
+
     SystemMutexLocker lock(getSessionMutex());
 
+    const QString baseName = ::logFileName();
     QString content;
     for (int i = 0; i < logFileCount; ++i)
-        content.prepend( readLogFile(logFileName(i)) );
+        content.prepend( readLogFile(logFileName(baseName, i)) );
+
+    content.prepend(baseName + "\n\n");
 
-    content.prepend(logFileName() + "\n\n");
+    const QString binaryBaseName = baseName + binaryLogFileSuffix;
+    QString binaryContent;
+    for (int i = 0; i < logFileCount; ++i) {
+        QFile f( logFileName(binaryBaseName, i) );
+        if ( f.open(QIODevice::ReadOnly) )
+            binaryContent.prepend( decodeBinaryLog(f.readAll()) );
+    }
+
+    if ( !binaryContent.isEmpty() )
+        content.append("\n" + binaryBaseName + "\n\n" + binaryContent);
 
     return content;
 }
@@ -249,12 +749,7 @@ QString logLevelLabel(LogLevel level)
 
 QString createLogMessage(const QString &text, const LogLevel level)
 {
-    const QString timeStamp =
-            QDateTime::currentDateTime().toString(" [yyyy-MM-dd hh:mm:ss.zzz]");
-
-    const QString label = "CopyQ " + logLevelLabel(level) + timeStamp + ": ";
-
-    return label + QString(text).replace("\n", "\n" + label + "   ") + "\n";
+    return formatLogMessage( text, level, QDateTime::currentDateTime() );
 }
 
 void log(const QString &text, const LogLevel level)
@@ -262,22 +757,17 @@ void log(const QString &text, const LogLevel level)
     if ( !hasLogLevel(level) )
         return;
 
-    SystemMutexLocker lock(getSessionMutex());
-
-    const QByteArray msg = createLogMessage(text, level).toUtf8();
-
-    QFile f( logFileName() );
-    const bool writtenToLogFile = f.open(QIODevice::Append) && f.write(msg);
-    if (writtenToLogFile)
-        f.close();
+    const LogRecord record(text, level);
 
     // Log to file and if needed to stderr.
-    if ( !writtenToLogFile || level <= LogWarning ) {
-        QFile ferr;
-        ferr.open(stderr, QIODevice::WriteOnly);
-        ferr.write(msg);
+    if (level <= LogWarning)
+        writeToStandardError( formatLogMessage(record).toUtf8() );
+
+    LogWriter *writer = logWriter();
+    if ( writer == NULL || !writer->enqueue(record) ) {
+        writeLogRecordNow(record);
+    } else if (level <= LogError) {
+        // Make sure errors are in log file if the process crashes.
+        writer->flush();
     }
-
-    if ( writtenToLogFile && f.size() > logFileSize )
-        rotateLogFiles();
 }
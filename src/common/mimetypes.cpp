@@ -33,3 +33,5 @@ const char mimeCurrentItem[] = COPYQ_MIME_PREFIX "current-item";
 const char mimeHidden[] = COPYQ_MIME_PREFIX "hidden";
 const char mimeShortcut[] = COPYQ_MIME_PREFIX "shortcut";
 const char mimeColor[] = COPYQ_MIME_PREFIX "color";
+const char mimeTraceId[] = COPYQ_MIME_PREFIX "trace-id";
+const char mimeTraceEvents[] = COPYQ_MIME_PREFIX "trace-events";
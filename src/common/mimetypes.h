@@ -35,5 +35,7 @@ extern const char mimeCurrentItem[];
 extern const char mimeHidden[];
 extern const char mimeShortcut[];
 extern const char mimeColor[];
+extern const char mimeTraceId[];
+extern const char mimeTraceEvents[];
 
 #endif // MIMETYPES_H
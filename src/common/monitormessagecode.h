@@ -29,7 +29,9 @@ enum MonitorMessageCode {
     MonitorChangeSelection,
     MonitorClipboardChanged,
     MonitorIgnoreClipboard,
-    MonitorLog
+    MonitorLog,
+    /// Receiver has read data passed in shared memory (see SharedDataTransfer).
+    MonitorReleaseSharedData
 };
 
 #endif // MONITORMESSAGECODE_H
@@ -137,22 +137,32 @@ void Server::onNewConnection()
         QScopedPointer<ClientSocket> clientSocket( new ClientSocket(socket) );
 
         const Arguments args = clientSocket->readArguments();
-        if ( !args.isEmpty() ) {
-            ++m_socketCount;
-            connect( clientSocket.data(), SIGNAL(destroyed()),
-                     this, SLOT(onSocketClosed()) );
-            connect( this, SIGNAL(destroyed()),
-                     clientSocket.data(), SLOT(close()) );
-            connect( this, SIGNAL(destroyed()),
-                     clientSocket.data(), SLOT(deleteAfterDisconnected()) );
-            connect( clientSocket.data(), SIGNAL(disconnected()),
-                     clientSocket.data(), SLOT(deleteAfterDisconnected()) );
-
+        if ( clientSocket->isBatchMode() ) {
+            // Each command received in batch mode is handled as new connection.
+            connect( clientSocket.data(), SIGNAL(commandReceived(Arguments,ClientSocket*)),
+                     this, SIGNAL(newConnection(Arguments,ClientSocket*)) );
+            watchClientSocket( clientSocket.data() );
+            clientSocket.take()->start();
+        } else if ( !args.isEmpty() ) {
+            watchClientSocket( clientSocket.data() );
             emit newConnection( args, clientSocket.take() );
         }
     }
 }
 
+void Server::watchClientSocket(ClientSocket *clientSocket)
+{
+    ++m_socketCount;
+    connect( clientSocket, SIGNAL(destroyed()),
+             this, SLOT(onSocketClosed()) );
+    connect( this, SIGNAL(destroyed()),
+             clientSocket, SLOT(close()) );
+    connect( this, SIGNAL(destroyed()),
+             clientSocket, SLOT(deleteAfterDisconnected()) );
+    connect( clientSocket, SIGNAL(disconnected()),
+             clientSocket, SLOT(deleteAfterDisconnected()) );
+}
+
 void Server::onSocketClosed()
 {
     Q_ASSERT(m_socketCount > 0);
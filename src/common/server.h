@@ -45,6 +45,8 @@ private slots:
     void close();
 
 private:
+    void watchClientSocket(ClientSocket *clientSocket);
+
     QLocalServer *m_server;
     int m_socketCount;
 };
@@ -19,6 +19,7 @@
 
 #include "settings.h"
 
+#include "common/appconfig.h"
 #include "common/common.h"
 #include "common/config.h"
 #include "common/log.h"
@@ -102,6 +103,10 @@ Settings::Settings()
 
 Settings::~Settings()
 {
+    // Options cached in AppConfig may be outdated.
+    if (m_changed)
+        AppConfig::invalidate();
+
     // Only main application is allowed to change settings.
     if (canModifySettings() && m_changed) {
         m_settings.sync();
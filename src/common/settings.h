@@ -62,6 +62,8 @@ public:
 
     QVariant value(const QString &name) const { return m_settings.value(name); }
 
+    QStringList allKeys() const { return m_settings.allKeys(); }
+
     void setValue(const QString &name, const QVariant &value) {
         m_changed = true;
         m_settings.setValue(name, value);
@@ -0,0 +1,315 @@
+/*
+    Copyright (c) 2016, Lukas Holecek <hluk@email.cz>
+
+    This file is part of CopyQ.
+
+    CopyQ is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    CopyQ is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with CopyQ.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#include "trace.h"
+
+#include "common/common.h"
+#include "common/mimetypes.h"
+
+#include <QAtomicInt>
+#include <QCoreApplication>
+#include <QDataStream>
+#include <QDateTime>
+#include <QElapsedTimer>
+#include <QList>
+#include <QMap>
+#include <QMutex>
+#include <QStringList>
+#include <QThread>
+
+namespace {
+
+/// Limit number of events kept in memory if tracing is left enabled.
+const int maxTraceEvents = 100000;
+
+/// Duration of events without duration.
+const qint64 instantEvent = -1;
+
+struct TraceEvent {
+    QByteArray name;
+    QByteArray traceId;
+    QString detail;
+    qint64 startUs;
+    qint64 durationUs;
+    qint64 pid;
+    quint64 tid;
+};
+
+QDataStream &operator<<(QDataStream &out, const TraceEvent &event)
+{
+    return out << event.name << event.traceId << event.detail
+               << event.startUs << event.durationUs << event.pid << event.tid;
+}
+
+QDataStream &operator>>(QDataStream &in, TraceEvent &event)
+{
+    return in >> event.name >> event.traceId >> event.detail
+              >> event.startUs >> event.durationUs >> event.pid >> event.tid;
+}
+
+QAtomicInt tracing(0);
+
+/// Guards members of Tracer.
+QMutex tracerMutex;
+
+struct Tracer {
+    Tracer() : startUs(0), timer(), lastId(0), events(), processNames() {}
+
+    qint64 startUs;
+    QElapsedTimer timer;
+    int lastId;
+    QList<TraceEvent> events;
+    QMap<qint64, QString> processNames;
+};
+
+Tracer &tracer()
+{
+    static Tracer instance;
+    return instance;
+}
+
+void addEvent(const QByteArray &traceId, const char *name, const QString &detail,
+              qint64 startUs, qint64 durationUs)
+{
+    TraceEvent event;
+    event.name = name;
+    event.traceId = traceId;
+    event.detail = detail;
+    event.startUs = startUs;
+    event.durationUs = durationUs;
+    event.pid = QCoreApplication::applicationPid();
+    event.tid = reinterpret_cast<quintptr>( QThread::currentThreadId() );
+
+    QMutexLocker lock(&tracerMutex);
+    QList<TraceEvent> &events = tracer().events;
+    if ( events.size() < maxTraceEvents )
+        events.append(event);
+}
+
+QByteArray eventToJson(const TraceEvent &event)
+{
+    QByteArray json = "{\"name\": " + jsonString(QString::fromUtf8(event.name)).toUtf8()
+            + ", \"cat\": \"clipboard\"";
+
+    if (event.durationUs == instantEvent) {
+        json.append(", \"ph\": \"i\", \"s\": \"t\"");
+    } else {
+        json.append(", \"ph\": \"X\", \"dur\": ");
+        json.append( QByteArray::number(event.durationUs) );
+    }
+
+    json.append(", \"ts\": " + QByteArray::number(event.startUs));
+    json.append(", \"pid\": " + QByteArray::number(event.pid));
+    json.append(", \"tid\": " + QByteArray::number(event.tid));
+
+    QByteArray args;
+    if ( !event.traceId.isEmpty() )
+        args.append("\"id\": " + jsonString(QString::fromUtf8(event.traceId)).toUtf8());
+    if ( !event.detail.isEmpty() ) {
+        if ( !args.isEmpty() )
+            args.append(", ");
+        args.append("\"detail\": " + jsonString(event.detail).toUtf8());
+    }
+    if ( !args.isEmpty() )
+        json.append(", \"args\": {" + args + "}");
+
+    return json + "}";
+}
+
+QByteArray processNameToJson(qint64 pid, const QString &name)
+{
+    return "{\"name\": \"process_name\", \"ph\": \"M\", \"pid\": " + QByteArray::number(pid)
+            + ", \"args\": {\"name\": " + jsonString(name).toUtf8() + "}}";
+}
+
+} // namespace
+
+bool isTracing()
+{
+#if QT_VERSION >= 0x050000
+    return tracing.load() != 0;
+#else
+    return tracing != 0;
+#endif
+}
+
+void startTracing(const QString &processName)
+{
+    if ( isTracing() )
+        return;
+
+    {
+        QMutexLocker lock(&tracerMutex);
+        Tracer &t = tracer();
+        t.startUs = QDateTime::currentMSecsSinceEpoch() * 1000;
+        t.timer.start();
+        t.events.clear();
+        t.processNames.clear();
+        t.processNames.insert( QCoreApplication::applicationPid(), processName );
+    }
+
+    tracing.fetchAndStoreOrdered(1);
+}
+
+void stopTracing()
+{
+    tracing.fetchAndStoreOrdered(0);
+
+    QMutexLocker lock(&tracerMutex);
+    tracer().events.clear();
+    tracer().processNames.clear();
+}
+
+QByteArray traceEventsToJson()
+{
+    QList<QByteArray> items;
+
+    QMutexLocker lock(&tracerMutex);
+    const Tracer &t = tracer();
+
+    for ( QMap<qint64, QString>::const_iterator it = t.processNames.constBegin();
+          it != t.processNames.constEnd(); ++it )
+    {
+        items.append( processNameToJson(it.key(), it.value()) );
+    }
+
+    foreach (const TraceEvent &event, t.events)
+        items.append( eventToJson(event) );
+
+    QByteArray json = "{\"traceEvents\": [\n";
+    for (int i = 0; i < items.size(); ++i) {
+        json.append("  " + items[i]);
+        json.append(i + 1 < items.size() ? ",\n" : "\n");
+    }
+    json.append("], \"displayTimeUnit\": \"ms\"}\n");
+
+    return json;
+}
+
+qint64 traceTimestamp()
+{
+    if ( !isTracing() )
+        return 0;
+
+    QMutexLocker lock(&tracerMutex);
+    const Tracer &t = tracer();
+#if QT_VERSION >= 0x040800
+    return t.startUs + t.timer.nsecsElapsed() / 1000;
+#else
+    return t.startUs + t.timer.elapsed() * 1000;
+#endif
+}
+
+QByteArray newTraceId()
+{
+    if ( !isTracing() )
+        return QByteArray();
+
+    QMutexLocker lock(&tracerMutex);
+    return QByteArray::number(QCoreApplication::applicationPid())
+            + "-" + QByteArray::number(++tracer().lastId);
+}
+
+QByteArray traceId(const QVariantMap &data)
+{
+    if ( !isTracing() )
+        return QByteArray();
+
+    return data.value(mimeTraceId).toByteArray();
+}
+
+void traceInstant(const QVariantMap &data, const char *name, const QString &detail)
+{
+    if ( isTracing() )
+        traceInstant( traceId(data), name, detail );
+}
+
+void traceInstant(const QByteArray &traceId, const char *name, const QString &detail)
+{
+    if ( isTracing() )
+        addEvent( traceId, name, detail, traceTimestamp(), instantEvent );
+}
+
+void traceSpan(const QVariantMap &data, const char *name, qint64 startUs)
+{
+    if ( isTracing() && startUs != 0 )
+        addEvent( traceId(data), name, QString(), startUs, traceTimestamp() - startUs );
+}
+
+void attachTraceEvents(QVariantMap *data)
+{
+    if ( !isTracing() )
+        return;
+
+    QByteArray bytes;
+    {
+        QDataStream stream(&bytes, QIODevice::WriteOnly);
+
+        QMutexLocker lock(&tracerMutex);
+        Tracer &t = tracer();
+        const qint64 pid = QCoreApplication::applicationPid();
+        stream << pid << t.processNames.value(pid) << t.events;
+        t.events.clear();
+    }
+
+    data->insert(mimeTraceEvents, bytes);
+}
+
+void importTraceEvents(QVariantMap *data)
+{
+    const QByteArray bytes = data->take(mimeTraceEvents).toByteArray();
+    if ( bytes.isEmpty() || !isTracing() )
+        return;
+
+    QDataStream stream(bytes);
+    qint64 pid;
+    QString processName;
+    QList<TraceEvent> events;
+    stream >> pid >> processName >> events;
+    if ( stream.status() != QDataStream::Ok )
+        return;
+
+    QMutexLocker lock(&tracerMutex);
+    Tracer &t = tracer();
+    t.processNames.insert(pid, processName);
+    t.events.append( events.mid(0, qMax(0, maxTraceEvents - t.events.size())) );
+}
+
+TraceScope::TraceScope(const QVariantMap &data, const char *name, const QString &detail)
+    : m_traceId( traceId(data) )
+    , m_name(name)
+    , m_detail( isTracing() ? detail : QString() )
+    , m_startUs( traceTimestamp() )
+{
+}
+
+TraceScope::TraceScope(const QByteArray &traceId, const char *name, const QString &detail)
+    : m_traceId( isTracing() ? traceId : QByteArray() )
+    , m_name(name)
+    , m_detail( isTracing() ? detail : QString() )
+    , m_startUs( traceTimestamp() )
+{
+}
+
+TraceScope::~TraceScope()
+{
+    if ( isTracing() && m_startUs != 0 )
+        addEvent( m_traceId, m_name, m_detail, m_startUs, traceTimestamp() - m_startUs );
+}
@@ -0,0 +1,94 @@
+/*
+    Copyright (c) 2016, Lukas Holecek <hluk@email.cz>
+
+    This file is part of CopyQ.
+
+    CopyQ is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    CopyQ is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with CopyQ.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#ifndef TRACE_H
+#define TRACE_H
+
+#include <QByteArray>
+#include <QString>
+#include <QVariantMap>
+
+/**
+ * Tracing of clipboard change processing in monitor and server.
+ *
+ * While tracing is enabled, each captured clipboard change gets a correlation
+ * ID (mimeTraceId in clipboard data) and each processing stage records an event
+ * with the ID. Events recorded in monitor are passed to server with clipboard
+ * data (mimeTraceEvents).
+ *
+ * Recorded events can be exported in Chrome trace event format
+ * (chrome://tracing).
+ *
+ * All functions return immediately if tracing is disabled.
+ */
+
+/// Return true if tracing is enabled in current process.
+bool isTracing();
+
+/// Start recording events in current process (named @a processName in trace).
+void startTracing(const QString &processName);
+
+/// Stop recording and drop recorded events.
+void stopTracing();
+
+/// Return events recorded in all processes in Chrome trace event JSON format.
+QByteArray traceEventsToJson();
+
+/// Return current time in microseconds for trace events.
+qint64 traceTimestamp();
+
+/// Return new correlation ID for a traced clipboard change (empty if not tracing).
+QByteArray newTraceId();
+
+/// Return correlation ID from @a data (empty if not tracing).
+QByteArray traceId(const QVariantMap &data);
+
+/// Record event which has no duration.
+void traceInstant(const QVariantMap &data, const char *name, const QString &detail = QString());
+void traceInstant(const QByteArray &traceId, const char *name, const QString &detail = QString());
+
+/// Record event which started at @a startUs (see traceTimestamp()) and ends now.
+void traceSpan(const QVariantMap &data, const char *name, qint64 startUs);
+
+/// Move events recorded in current process to @a data (to pass them to other process).
+void attachTraceEvents(QVariantMap *data);
+
+/// Remove events from @a data and add them to events recorded in current process.
+void importTraceEvents(QVariantMap *data);
+
+/**
+ * Records event with duration of the object's lifetime.
+ */
+class TraceScope {
+public:
+    TraceScope(const QVariantMap &data, const char *name, const QString &detail = QString());
+
+    TraceScope(const QByteArray &traceId, const char *name, const QString &detail = QString());
+
+    ~TraceScope();
+
+private:
+    QByteArray m_traceId;
+    const char *m_name;
+    QString m_detail;
+    qint64 m_startUs;
+};
+
+#endif // TRACE_H
@@ -39,6 +39,7 @@ ActionHandler::ActionHandler(MainWindow *mainWindow)
     , m_wnd(mainWindow)
     , m_actionCounter(0)
     , m_activeActionDialog(new ProcessManagerDialog(mainWindow))
+    , m_scriptRunner(NULL)
 {
     Q_ASSERT(mainWindow);
 }
@@ -76,6 +77,7 @@ void ActionHandler::addFinishedAction(const QString &name)
 void ActionHandler::action(Action *action)
 {
     action->setParent(this);
+    action->setScriptRunner(m_scriptRunner);
 
     m_lastAction = action;
 
@@ -30,6 +30,7 @@
 
 class Action;
 class ActionDialog;
+class ActionScriptRunner;
 class ProcessManagerDialog;
 class ClipboardBrowser;
 class QDialog;
@@ -60,6 +61,9 @@ public:
 
     void addFinishedAction(const QString &name);
 
+    /** Run "copyq:" scripts of executed actions using @a runner (see Action::setScriptRunner()). */
+    void setScriptRunner(ActionScriptRunner *runner) { m_scriptRunner = runner; }
+
 public slots:
     /** Execute action. */
     void action(Action *action);
@@ -89,6 +93,7 @@ private:
     ProcessManagerDialog *m_activeActionDialog;
     QString m_currentTabName;
     Command m_lastActionDialogCommand;
+    ActionScriptRunner *m_scriptRunner;
 };
 
 #endif // ACTIONHANDLER_H
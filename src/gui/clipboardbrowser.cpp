@@ -25,6 +25,7 @@
 #include "common/contenttype.h"
 #include "common/log.h"
 #include "common/mimetypes.h"
+#include "common/trace.h"
 #include "gui/clipboarddialog.h"
 #include "gui/iconfactory.h"
 #include "gui/icons.h"
@@ -50,6 +51,13 @@
 
 namespace {
 
+void updateProgressGeometry(QProgressBar *progress, const QAbstractScrollArea &area)
+{
+    const int margin = 8;
+    progress->setGeometry( margin, area.height() - progress->height() - margin,
+                           area.viewport()->width() - 2 * margin, progress->height() );
+}
+
 bool alphaSort(const QModelIndex &lhs, const QModelIndex &rhs)
 {
     const QString lhsText = lhs.data(contentType::text).toString();
@@ -150,6 +158,8 @@ private:
 ClipboardBrowserShared::ClipboardBrowserShared(ItemFactory *itemFactory)
     : editor()
     , maxItems(100)
+    , mapItemData(false)
+    , deduplicateItemData(false)
     , textWrap(true)
     , viMode(false)
     , saveOnReturnKey(false)
@@ -165,6 +175,8 @@ void ClipboardBrowserShared::loadFromConfiguration()
     AppConfig appConfig;
     editor = appConfig.option<Config::editor>();
     maxItems = appConfig.option<Config::maxitems>();
+    mapItemData = appConfig.option<Config::map_item_data>();
+    deduplicateItemData = appConfig.option<Config::deduplicate_item_data>();
     textWrap = appConfig.option<Config::text_wrap>();
     viMode = appConfig.option<Config::vi>();
     saveOnReturnKey = !appConfig.option<Config::edit_ctrl_return>();
@@ -177,15 +189,20 @@ ClipboardBrowser::ClipboardBrowser(const ClipboardBrowserSharedPtr &sharedData,
     : QListView(parent)
     , m_itemLoader(NULL)
     , m_tabName()
-    , m_lastFiltered(-1)
     , m(this)
     , d(this, sharedData->itemFactory)
+    , m_journal(&m)
+    , m_backgroundLoader(&m)
+    , m_backgroundSaver(&m)
+    , m_textIndex(&m, sharedData->itemFactory)
+    , m_search(&m, sharedData->itemFactory)
     , m_invalidateCache(false)
     , m_expireAfterEditing(false)
     , m_editor(NULL)
     , m_sharedData(sharedData)
     , m_loadButton(NULL)
     , m_searchProgress(NULL)
+    , m_loadProgress(NULL)
     , m_dragTargetRow(-1)
     , m_dragStartPosition()
     , m_spinLock(0)
@@ -206,7 +223,6 @@ ClipboardBrowser::ClipboardBrowser(const ClipboardBrowserSharedPtr &sharedData,
     initSingleShotTimer( &m_timerSave, 30000, this, SLOT(saveItems()) );
     initSingleShotTimer( &m_timerScroll, 50 );
     initSingleShotTimer( &m_timerUpdate, 10, this, SLOT(doUpdateCurrentPage()) );
-    initSingleShotTimer( &m_timerFilter, 10, this, SLOT(filterItems()) );
     initSingleShotTimer( &m_timerExpire, 0, this, SLOT(expire()) );
 
     // ScrollPerItem doesn't work well with hidden items
@@ -219,6 +235,14 @@ ClipboardBrowser::ClipboardBrowser(const ClipboardBrowserSharedPtr &sharedData,
 
     setAcceptDrops(true);
 
+    connect( &m_backgroundLoader, SIGNAL(progressChanged()),
+             SLOT(updateLoadProgress()) );
+    connect( &m_backgroundLoader, SIGNAL(finished(ItemLoaderInterface*,bool)),
+             SLOT(onItemsLoadedInBackground(ItemLoaderInterface*,bool)) );
+
+    connect( &m_search, SIGNAL(itemsMatched(QList<int>)),
+             SLOT(onItemsMatched(QList<int>)) );
+
     connectModelAndDelegate();
 }
 
@@ -237,6 +261,13 @@ void ClipboardBrowser::closeExternalEditor(QObject *editor)
     editor->deleteLater();
 }
 
+void ClipboardBrowser::saveRowHeights()
+{
+    // Item hashes are saved with heights so don't save them for encrypted items.
+    const QVector<int> heights = m.cacheOnDisk() ? d.rowHeights(m.rowCount()) : QVector<int>();
+    saveItemHeights(tabName(), m, heights, &m_savedRowHeights);
+}
+
 bool ClipboardBrowser::isFiltered(int row) const
 {
     if ( d.searchExpression().isEmpty() || !m_itemLoader)
@@ -295,24 +326,35 @@ void ClipboardBrowser::preload(int minY, int maxY)
     int offset = verticalOffset();
 
     // Find first index to preload.
-    forever {
+    if ( d.searchExpression().isEmpty() ) {
+        // No rows are hidden so use prefix sums of row heights.
+        i = d.rowAt(offset - spacing() + s - 1, s);
         ind = index(i);
         if ( !ind.isValid() )
             return;
 
-        if ( !isIndexHidden(ind) ) {
-            const int h = d.sizeHint(ind).height();
-            y += h; // bottom of item
-            if (y >= offset)
-                break;
-            y += s; // top of next item
-        }
+        y += d.rowOffset(i, s); // top of item
+        y += d.sizeHint(ind).height(); // bottom of item
+    } else {
+        forever {
+            ind = index(i);
+            if ( !ind.isValid() )
+                return;
 
-        d.setRowVisible(i, false);
+            if ( !isIndexHidden(ind) ) {
+                const int h = d.sizeHint(ind).height();
+                y += h; // bottom of item
+                if (y >= offset)
+                    break;
+                y += s; // top of next item
+            }
 
-        ++i;
+            ++i;
+        }
     }
 
+    d.beginPreload();
+
     // Absolute to relative.
     y -= offset;
 
@@ -332,7 +374,7 @@ void ClipboardBrowser::preload(int minY, int maxY)
         const QRect oldRect(visualRect(ind));
 
         // Fetch item.
-        d.cache(ind);
+        d.preloadRow(ind);
         const int h = d.sizeHint(ind).height();
 
         // Re-layout rows afterwards if size has changed.
@@ -354,13 +396,13 @@ void ClipboardBrowser::preload(int minY, int maxY)
 
     // Render visible items, re-layout rows and correct scroll offset.
     forever {
-        if (m_lastFiltered != -1 && m_lastFiltered < i)
+        if ( m_search.isSearching() && m_search.lastSearchedRow() < i )
             break;
 
         const QRect oldRect(update ? QRect() : visualRect(ind));
 
         // Fetch item.
-        d.cache(ind);
+        d.preloadRow(ind);
         const int h = d.sizeHint(ind).height();
 
         // Re-layout rows afterwards if row position or size has changed.
@@ -391,8 +433,7 @@ void ClipboardBrowser::preload(int minY, int maxY)
     }
 
     // Hide the rest.
-    for ( ; i < m.rowCount(); ++i )
-        d.setRowVisible(i, false);
+    d.endPreload();
 
     if (update)
         scheduleDelayedItemsLayout();
@@ -453,6 +494,8 @@ void ClipboardBrowser::editItem(const QModelIndex &index, bool editNotes, bool c
     if (!index.isValid())
         return;
 
+    finishLoadingItems();
+
     ItemEditorWidget *editor = d.createCustomEditor(this, index, editNotes);
     if (editor != NULL) {
         if ( editor->isValid() )
@@ -506,17 +549,15 @@ QModelIndex ClipboardBrowser::indexNear(int offset) const
 
 void ClipboardBrowser::updateSearchProgress()
 {
-    if ( !d.searchExpression().isEmpty() && m_lastFiltered != -1 && m_lastFiltered < length() ) {
+    if ( !d.searchExpression().isEmpty() && m_search.isSearching() ) {
         if (m_searchProgress == NULL) {
             m_searchProgress = new QProgressBar(this);
         }
         m_searchProgress->setFormat( tr("Searching %p%...",
                                         "Text in progress bar for searching/filtering items; %p is amount in percent") );
-        m_searchProgress->setRange(0, length());
-        m_searchProgress->setValue(m_lastFiltered);
-        const int margin = 8;
-        m_searchProgress->setGeometry( margin, height() - m_searchProgress->height() - margin,
-                                       viewport()->width() - 2 * margin, m_searchProgress->height() );
+        m_searchProgress->setRange(0, m_search.itemCount());
+        m_searchProgress->setValue( m_search.searchedItemCount() );
+        updateProgressGeometry(m_searchProgress, *this);
         m_searchProgress->show();
     } else {
         delete m_searchProgress;
@@ -524,6 +565,25 @@ void ClipboardBrowser::updateSearchProgress()
     }
 }
 
+void ClipboardBrowser::updateLoadProgress()
+{
+    if ( m_backgroundLoader.isLoading() ) {
+        if (m_loadProgress == NULL) {
+            m_loadProgress = new QProgressBar(this);
+        }
+        m_loadProgress->setFormat( tr("Loading %p%...",
+                                      "Text in progress bar for loading items; %p is amount in percent") );
+        // Show busy indicator until number of items is known.
+        m_loadProgress->setRange( 0, qMax(0, m_backgroundLoader.itemCount()) );
+        m_loadProgress->setValue( m_backgroundLoader.loadedItemCount() );
+        updateProgressGeometry(m_loadProgress, *this);
+        m_loadProgress->show();
+    } else {
+        delete m_loadProgress;
+        m_loadProgress = NULL;
+    }
+}
+
 int ClipboardBrowser::getDropRow(const QPoint &position)
 {
     const QModelIndex index = indexNear( position.y() );
@@ -627,8 +687,27 @@ void ClipboardBrowser::refilterItems()
         setRowHidden(row, !showAll);
     }
 
-    m_lastFiltered = -1;
-    filterItems();
+    // Search items in other threads, skip items which cannot match the filter.
+    m_textIndex.setFilter( d.searchExpression() );
+    if (showAll) {
+        m_search.abort();
+    } else {
+        // Index contains only text provided by plugins (see ItemLoaderInterface::providesSearchableText()).
+        const bool useIndex = m_sharedData->itemFactory->loadersWithoutSearchableText().isEmpty();
+
+        QList<int> rows;
+        for ( int row = 0; row < length(); ++row ) {
+            if ( !useIndex || m_textIndex.mayMatch(row) )
+                rows.append(row);
+        }
+
+        // First matching row is selected once found.
+        setCurrentIndex( QModelIndex() );
+        m_search.start( d.searchExpression(), rows );
+    }
+
+    updateSearchProgress();
+    updateCurrentPage();
 
     // Select row by number specified in search.
     bool rowSpecified;
@@ -692,6 +771,8 @@ int ClipboardBrowser::removeIndexes(const QModelIndexList &indexes)
     if ( indexes.isEmpty() )
         return -1;
 
+    finishLoadingItems();
+
     Q_ASSERT(m_itemLoader);
     m_itemLoader->itemsRemovedByUser(indexes);
 
@@ -718,6 +799,8 @@ int ClipboardBrowser::removeIndexes(const QModelIndexList &indexes)
 
 void ClipboardBrowser::paste(const QVariantMap &data, int destinationRow)
 {
+    finishLoadingItems();
+
     ClipboardBrowser::Lock lock(this);
 
     int count = 0;
@@ -829,15 +912,25 @@ void ClipboardBrowser::onTabNameChanged(const QString &tabName)
         return;
     }
 
+    // Items loaded so far would be saved with new tab name.
+    const bool reload = m_backgroundLoader.isLoading();
+    cancelLoadingItems();
+    m_backgroundSaver.waitForFinished();
+
     // Just move last saved file if tab is not loaded yet.
-    if ( isLoaded() && saveItemsWithOther(m, m_itemLoader, m_sharedData->itemFactory) ) {
+    if ( isLoaded() && saveItemsWithOther(m, m_itemLoader, m_sharedData->itemFactory, &m_journal) ) {
         m_timerSave.stop();
         removeItems(m_tabName);
+        m_savedRowHeights.clear();
     } else {
+        m_journal.abortCompaction();
         moveItems(m_tabName, tabName);
     }
 
     m_tabName = tabName;
+
+    if (reload)
+        loadItemsInBackground();
 }
 
 void ClipboardBrowser::updateCurrentPage()
@@ -875,10 +968,13 @@ void ClipboardBrowser::expire()
 
         saveUnsavedItems();
 
+        if ( isLoaded() && !tabName().isEmpty() )
+            saveRowHeights();
+
         m.unloadItems();
 
         if ( isVisible() )
-            loadItems();
+            loadItemsInBackground();
     }
 }
 
@@ -903,7 +999,9 @@ void ClipboardBrowser::onEditorCancel()
 
 void ClipboardBrowser::onModelUnloaded()
 {
+    cancelLoadingItems();
     m_itemLoader = NULL;
+    m.setCacheOnDisk(false);
 }
 
 void ClipboardBrowser::onEditorNeedsChangeClipboard()
@@ -918,41 +1016,20 @@ void ClipboardBrowser::onEditorNeedsChangeClipboard(const QByteArray &bytes, con
     emit changeClipboard(createDataMap(mime, bytes));
 }
 
-void ClipboardBrowser::filterItems()
+void ClipboardBrowser::onItemsMatched(const QList<int> &rows)
 {
-    m_timerFilter.stop();
-
-    if ( d.searchExpression().isEmpty() )
-        return;
-
-    // row to select
-    QModelIndex current = currentIndex();
-    int first = current.isValid() && d.searchExpression().isEmpty() ? current.row() : -1;
-
     {
         ClipboardBrowser::Lock lock(this);
 
-        // batch search
-        QElapsedTimer t;
-        t.start();
-
-        for ( ++m_lastFiltered ; m_lastFiltered < length(); ++m_lastFiltered ) {
-            if ( isRowHidden(m_lastFiltered) && !hideFiltered(m_lastFiltered) && first == -1 )
-                first = m_lastFiltered;
-
-            if ( t.elapsed() > 25 ) {
-                m_timerFilter.start();
-                break;
-            }
+        foreach (int row, rows) {
+            d.setRowVisible(row, false); // show in preload()
+            setRowHidden(row, false);
         }
-
-        if ( m_lastFiltered >= length() )
-            m_lastFiltered = -1;
     }
 
-    // Select row specified by search or first visible.
-    if (!currentIndex().isValid() || sender() != &m_timerFilter)
-        setCurrentIndex( index(first) );
+    // Select first matching row unless other row was selected.
+    if ( !currentIndex().isValid() && !rows.isEmpty() )
+        setCurrentIndex( index(rows.first()) );
 
     updateSearchProgress();
 
@@ -989,6 +1066,7 @@ void ClipboardBrowser::resizeEvent(QResizeEvent *event)
         m_loadButton->resize( event->size() );
 
     updateSearchProgress();
+    updateLoadProgress();
 
     updateEditorGeometry();
 }
@@ -997,7 +1075,7 @@ void ClipboardBrowser::showEvent(QShowEvent *event)
 {
     stopExpiring();
 
-    loadItems();
+    loadItemsInBackground();
 
     if (!currentIndex().isValid())
         setCurrent(0);
@@ -1019,10 +1097,8 @@ void ClipboardBrowser::currentChanged(const QModelIndex &current, const QModelIn
 {
     QListView::currentChanged(current, previous);
 
-    if ( previous.isValid() && d.hasCache(previous) ) {
-        ItemWidget *item = d.cache(previous);
-        item->setCurrent(false);
-    }
+    if ( previous.isValid() )
+        d.releaseItemWidget(previous);
 
     updateCurrentItem();
 }
@@ -1143,6 +1219,8 @@ void ClipboardBrowser::mouseMoveEvent(QMouseEvent *event)
     if ( !index.isValid() )
         return;
 
+    finishLoadingItems();
+
     QModelIndexList selected = selectedIndexes();
     if ( !selected.contains(index) ) {
         setCurrentIndex(index);
@@ -1261,6 +1339,7 @@ void ClipboardBrowser::removeRow(int row)
 
     bool removingCurrent = indexToRemove == currentIndex();
 
+    finishLoadingItems();
     Q_ASSERT(m_itemLoader);
     m_itemLoader->itemsRemovedByUser(QList<QModelIndex>() << indexToRemove);
     m.removeRow(row);
@@ -1271,6 +1350,33 @@ void ClipboardBrowser::removeRow(int row)
         setCurrentIndex( index(qMin(row, length() - 1)) );
 }
 
+void ClipboardBrowser::removeRows(int row, int count)
+{
+    const int first = qMax(0, row);
+    const int last = qMin(row + count, length()) - 1;
+    if (first > last)
+        return;
+
+    const int current = currentIndex().row();
+    bool removingCurrent = first <= current && current <= last;
+
+    finishLoadingItems();
+
+    QList<QModelIndex> indexesToRemove;
+    indexesToRemove.reserve(last - first + 1);
+    for (int i = first; i <= last; ++i)
+        indexesToRemove.append( index(i) );
+
+    Q_ASSERT(m_itemLoader);
+    m_itemLoader->itemsRemovedByUser(indexesToRemove);
+    m.removeRows(first, last - first + 1);
+
+    delayedSaveItems();
+
+    if (removingCurrent)
+        setCurrentIndex( index(qMin(first, length() - 1)) );
+}
+
 void ClipboardBrowser::editNotes()
 {
     QModelIndex ind = currentIndex();
@@ -1312,6 +1418,8 @@ void ClipboardBrowser::moveToClipboard(const QModelIndex &ind)
     if ( !ind.isValid() )
         return;
 
+    finishLoadingItems();
+
     QPersistentModelIndex index = ind;
 
     if (m_sharedData->moveItemOnReturnKey && index.row() != 0) {
@@ -1508,6 +1616,8 @@ void ClipboardBrowser::editSelected()
 
 void ClipboardBrowser::remove()
 {
+    finishLoadingItems();
+
     const QModelIndexList toRemove = selectedIndexes();
     Q_ASSERT(m_itemLoader);
     if ( !toRemove.isEmpty() && m_itemLoader->canRemoveItems(toRemove) ) {
@@ -1519,6 +1629,8 @@ void ClipboardBrowser::remove()
 
 bool ClipboardBrowser::select(uint itemHash, SelectActions selectActions)
 {
+    finishLoadingItems();
+
     int row = m.findItem(itemHash);
     if (row < 0)
         return false;
@@ -1539,11 +1651,13 @@ bool ClipboardBrowser::select(uint itemHash, SelectActions selectActions)
 
 void ClipboardBrowser::sortItems(const QModelIndexList &indexes)
 {
+    finishLoadingItems();
     m.sortItems(indexes, &alphaSort);
 }
 
 void ClipboardBrowser::reverseItems(const QModelIndexList &indexes)
 {
+    finishLoadingItems();
     m.sortItems(indexes, &reverseSort);
 }
 
@@ -1589,8 +1703,50 @@ bool ClipboardBrowser::add(const QVariantMap &data, int row)
     return true;
 }
 
+bool ClipboardBrowser::add(const QList<QVariantMap> &items, int row)
+{
+    if ( m.isDisabled() )
+        return false;
+    if ( !isLoaded() ) {
+        loadItems();
+        if ( !isLoaded() )
+            return false;
+    }
+
+    if ( items.isEmpty() )
+        return true;
+
+    ClipboardBrowser::Lock lock(this);
+
+    // Insert all items at once.
+    const int newRow = row < 0 ? m.rowCount() : qMin(row, m.rowCount());
+    m.insertItems(items, newRow);
+
+    // filter items
+    for (int i = newRow; i < newRow + items.size(); ++i) {
+        if ( isFiltered(i) )
+            setRowHidden(i, true);
+    }
+
+    // list size limit
+    const int excess = m.rowCount() - m_sharedData->maxItems;
+    if (excess > 0)
+        m.removeRows(m.rowCount() - excess, excess);
+
+    delayedSaveItems();
+
+    return true;
+}
+
 void ClipboardBrowser::addUnique(const QVariantMap &data)
 {
+    TraceScope trace(data, "server: add item");
+
+    // Trace saving the item to disk.
+    const QByteArray id = traceId(data);
+    if ( !id.isEmpty() )
+        m_traceIdToSave = id;
+
     if ( select(hash(data), MoveToTop) ) {
         COPYQ_LOG("New item: Moving existing to top");
         return;
@@ -1607,6 +1763,8 @@ void ClipboardBrowser::addUnique(const QVariantMap &data)
     newData.remove(mimeCurrentItem);
     newData.remove(mimeHidden);
     newData.remove(mimeShortcut);
+    newData.remove(mimeTraceId);
+    newData.remove(mimeTraceEvents);
 
 #ifdef HAS_MOUSE_SELECTIONS
     // When selecting text under X11, clipboard data may change whenever selection changes.
@@ -1657,6 +1815,11 @@ void ClipboardBrowser::loadSettings()
 
     // restore configuration
     m.setMaxItems(m_sharedData->maxItems);
+    m.setMapItemData(m_sharedData->mapItemData);
+    m.setDeduplicateItemData(m_sharedData->deduplicateItemData);
+
+    // Searched text can change with enabled plugins.
+    m_textIndex.invalidate();
 
     updateItemMaximumSize();
 
@@ -1696,22 +1859,92 @@ void ClipboardBrowser::loadItemsAgain()
     if ( isLoaded() )
         return;
 
+    if ( m_backgroundLoader.isLoading() ) {
+        // Calls onItemsLoadedInBackground().
+        m_backgroundLoader.waitForFinished();
+        return;
+    }
+
     m_timerSave.stop();
+    m_backgroundSaver.waitForFinished();
 
     m.blockSignals(true);
-    m_itemLoader = ::loadItems(m, m_sharedData->itemFactory);
+    m_itemLoader = ::loadItems(m, m_sharedData->itemFactory, &m_journal);
     m.blockSignals(false);
 
+    if ( !m.isDisabled() )
+        d.rowsInserted(QModelIndex(), 0, m.rowCount());
+
+    onItemsLoaded();
+}
+
+void ClipboardBrowser::loadItemsInBackground()
+{
+    // Don't decrypt tab automatically if the operation was cancelled/unsuccessful previously.
+    if ( m.isDisabled() || m_backgroundLoader.isLoading() )
+        return;
+
+    restartExpiring();
+
+    if ( isLoaded() )
+        return;
+
+    m_backgroundSaver.waitForFinished();
+
+    ItemLoaderInterface *loader = ::backgroundItemLoader(m, m_sharedData->itemFactory);
+    if (loader == NULL) {
+        loadItemsAgain();
+        return;
+    }
+
+    m_timerSave.stop();
+    m_backgroundLoader.start(loader);
+}
+
+void ClipboardBrowser::finishLoadingItems()
+{
+    if ( m_backgroundLoader.isLoading() )
+        loadItemsAgain();
+}
+
+void ClipboardBrowser::cancelLoadingItems()
+{
+    if ( !m_backgroundLoader.isLoading() )
+        return;
+
+    m_backgroundLoader.abort();
+
+    // Tab would be loaded again from the beginning.
+    m.removeRows( 0, m.rowCount() );
+
+    updateLoadProgress();
+}
+
+void ClipboardBrowser::onItemsLoadedInBackground(ItemLoaderInterface *loader, bool journalReplayed)
+{
+    m_itemLoader = ::finishLoadingItems(
+                m, loader, journalReplayed, m_sharedData->itemFactory, &m_journal);
+
+    updateLoadProgress();
+    onItemsLoaded();
+}
+
+void ClipboardBrowser::onItemsLoaded()
+{
+    // Item data (e.g. thumbnails) can be cached unencrypted only if the loader stores items unchanged.
+    m.setCacheOnDisk( m_itemLoader && m_itemLoader->canJournalItems() );
+
     // Show lock button if model is disabled.
     if ( !m.isDisabled() ) {
         delete m_loadButton;
         m_loadButton = NULL;
-        d.rowsInserted(QModelIndex(), 0, m.rowCount());
+        d.setEstimatedRowHeights( loadItemHeights(tabName(), m, &m_savedRowHeights) );
         if ( !d.searchExpression().isEmpty() )
             refilterItems();
         scheduleDelayedItemsLayout();
         updateCurrentPage();
-        setCurrent(0);
+        if ( !currentIndex().isValid() )
+            setCurrent(0);
         onItemCountChanged();
         emit updateContextMenu();
     } else if (m_loadButton == NULL) {
@@ -1733,7 +1966,15 @@ bool ClipboardBrowser::saveItems()
     if ( !isLoaded() || tabName().isEmpty() )
         return false;
 
-    ::saveItems(m, m_itemLoader);
+    TraceScope trace(m_traceIdToSave, "server: save items");
+    m_traceIdToSave.clear();
+
+    if ( m_itemLoader->canSaveItemsInBackground() )
+        m_backgroundSaver.start(m_itemLoader);
+    else
+        ::saveItems(m, m_itemLoader, &m_journal);
+
+    saveRowHeights();
     return true;
 }
 
@@ -1761,7 +2002,11 @@ void ClipboardBrowser::purgeItems()
     if ( tabName().isEmpty() )
         return;
 
+    cancelLoadingItems();
+    m_backgroundSaver.waitForFinished();
+    m_journal.setEnabled(false);
     removeItems(tabName());
+    m_savedRowHeights.clear();
     m_timerSave.stop();
 }
 
@@ -1790,6 +2035,7 @@ void ClipboardBrowser::otherItemLoader(bool next)
 
 void ClipboardBrowser::move(int key)
 {
+    finishLoadingItems();
     m.moveItemsWithKeyboard(selectedIndexes(), key);
     scrollTo( currentIndex() );
 }
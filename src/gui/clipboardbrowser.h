@@ -23,7 +23,12 @@
 #include "common/command.h"
 #include "gui/configtabshortcuts.h"
 #include "item/clipboardmodel.h"
+#include "item/itembackgroundloader.h"
+#include "item/itembackgroundsaver.h"
 #include "item/itemdelegate.h"
+#include "item/itemjournal.h"
+#include "item/itemsearch.h"
+#include "item/itemtextindex.h"
 #include "item/itemwidget.h"
 
 #include <QListView>
@@ -54,6 +59,8 @@ struct ClipboardBrowserShared {
 
     QString editor;
     int maxItems;
+    bool mapItemData;
+    bool deduplicateItemData;
     bool textWrap;
     bool viMode;
     bool saveOnReturnKey;
@@ -175,6 +182,13 @@ class ClipboardBrowser : public QListView
                 int row = 0 //!< Target row for the new item (negative to append item).
                 );
 
+        /**
+         * Add new items to the browser.
+         *
+         * First item in @a items is added to @a row (negative to append items).
+         */
+        bool add(const QList<QVariantMap> &items, int row);
+
         /**
          * Add item and remove duplicates.
          */
@@ -200,6 +214,9 @@ class ClipboardBrowser : public QListView
 
         void removeRow(int row);
 
+        /** Remove @a count items starting at @a row. */
+        void removeRows(int row, int count);
+
         /** Set current item. */
         void setCurrent(
                 int row, //!< Row of the item.
@@ -351,7 +368,11 @@ class ClipboardBrowser : public QListView
 
         void onEditorNeedsChangeClipboard(const QByteArray &bytes, const QString &mime);
 
-        void filterItems();
+        void onItemsMatched(const QList<int> &rows);
+
+        void updateLoadProgress();
+
+        void onItemsLoadedInBackground(ItemLoaderInterface *loader, bool journalReplayed);
 
     private:
         /**
@@ -359,6 +380,12 @@ class ClipboardBrowser : public QListView
          */
         void delayedSaveItems();
 
+        /**
+         * Save row heights for next time the tab is loaded
+         * (or remove them if items are not cached on disk).
+         */
+        void saveRowHeights();
+
         bool isFiltered(int row) const;
 
         /**
@@ -404,6 +431,21 @@ class ClipboardBrowser : public QListView
 
         void updateSearchProgress();
 
+        /**
+         * Load items in background if possible (see ItemBackgroundLoader),
+         * otherwise load them immediately.
+         */
+        void loadItemsInBackground();
+
+        /** Insert all items loaded in background (this must be done before changing items). */
+        void finishLoadingItems();
+
+        /** Stop loading items in background and remove items loaded so far. */
+        void cancelLoadingItems();
+
+        /** Update browser after items are loaded. */
+        void onItemsLoaded();
+
         int getDropRow(const QPoint &position);
 
         void connectModelAndDelegate();
@@ -419,15 +461,24 @@ class ClipboardBrowser : public QListView
 
         ItemLoaderInterface *m_itemLoader;
         QString m_tabName;
-        int m_lastFiltered;
         ClipboardModel m;
         ItemDelegate d;
+        ItemJournal m_journal;
+        ItemBackgroundLoader m_backgroundLoader;
+        ItemBackgroundSaver m_backgroundSaver;
+        ItemTextIndex m_textIndex;
+        ItemSearch m_search;
         QTimer m_timerSave;
         QTimer m_timerScroll;
         QTimer m_timerUpdate;
-        QTimer m_timerFilter;
         QTimer m_timerExpire;
 
+        /// Correlation ID of last traced item to add (see trace.h).
+        QByteArray m_traceIdToSave;
+
+        /// Content of item heights file last saved or loaded.
+        QByteArray m_savedRowHeights;
+
         bool m_invalidateCache;
         bool m_expireAfterEditing;
 
@@ -438,6 +489,7 @@ class ClipboardBrowser : public QListView
 
         QPushButton *m_loadButton;
         QProgressBar *m_searchProgress;
+        QProgressBar *m_loadProgress;
 
         int m_dragTargetRow;
         QPoint m_dragStartPosition;
@@ -244,6 +244,8 @@ void ConfigurationManager::initOptions()
 
     /* other options */
     bind<Config::command_history_size>();
+    bind<Config::map_item_data>();
+    bind<Config::deduplicate_item_data>();
 #ifdef HAS_MOUSE_SELECTIONS
     /* X11 clipboard selection monitoring and synchronization */
     bind<Config::check_selection>(ui->checkBoxSel);
@@ -346,6 +348,9 @@ QString ConfigurationManager::optionToolTip(const QString &name) const
 
 void ConfigurationManager::loadSettings()
 {
+    // Options changed using AppConfig need to be saved first.
+    AppConfig::saveChanges();
+
     QSettings settings;
 
     settings.beginGroup("Options");
@@ -424,13 +429,12 @@ void ConfigurationManager::setVisible(bool visible)
 
 void ConfigurationManager::apply()
 {
-    Settings settings;
+    AppConfig appConfig;
+    foreach ( const QString &key, m_options.keys() )
+        appConfig.setOption( key, m_options[key].value() );
+    AppConfig::saveChanges();
 
-    settings.beginGroup("Options");
-    foreach ( const QString &key, m_options.keys() ) {
-        settings.setValue( key, m_options[key].value() );
-    }
-    settings.endGroup();
+    Settings settings;
 
     // Save configuration without command line alternatives only if option widgets are initialized
     // (i.e. clicked OK or Apply in configuration dialog).
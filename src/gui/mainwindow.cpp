@@ -28,6 +28,7 @@
 #include "common/contenttype.h"
 #include "common/log.h"
 #include "common/mimetypes.h"
+#include "common/trace.h"
 #include "gui/aboutdialog.h"
 #include "gui/actiondialog.h"
 #include "gui/actionhandler.h"
@@ -822,6 +823,10 @@ void MainWindow::action()
 
 void MainWindow::automaticCommandTestFinished(const Command &command, bool passed)
 {
+    traceInstant( m_automaticCommandTester.data(),
+                  passed ? "server: automatic command matched" : "server: automatic command skipped",
+                  command.name );
+
     if (passed)
         runAutomaticCommand(command);
     else
@@ -1271,6 +1276,7 @@ void MainWindow::runAutomaticCommand(const Command &command)
     Q_ASSERT(!m_currentAutomaticCommand);
 
     const QVariantMap data = m_automaticCommandTester.data();
+    TraceScope trace(data, "server: run automatic command", command.name);
 
     if (command.remove || command.transform) {
         COPYQ_LOG("Clipboard ignored by \"" + command.name + "\"");
@@ -1397,6 +1403,11 @@ bool MainWindow::hasRunningAction() const
     return m_actionHandler->hasRunningAction();
 }
 
+void MainWindow::setActionScriptRunner(ActionScriptRunner *runner)
+{
+    m_actionHandler->setScriptRunner(runner);
+}
+
 bool MainWindow::maybeCloseCommandDialog()
 {
     return !m_commandDialog || m_commandDialog->maybeClose(this);
@@ -1979,6 +1990,8 @@ void MainWindow::addToTab(const QVariantMap &data, const QString &tabName)
 
 void MainWindow::updateFirstItem(const QVariantMap &data)
 {
+    TraceScope trace(data, "server: update first item");
+
     // Synchronize clipboard and X11 selection.
     if (needSyncClipboardToSelection(data))
         emit changeClipboard(data, QClipboard::Selection);
@@ -2024,6 +2037,20 @@ bool MainWindow::hasUserOption(const QString &name) const
     return configurationManager.options().contains(name);
 }
 
+void MainWindow::startTracing()
+{
+    ::startTracing("CopyQ server");
+    emit tracingChanged();
+}
+
+QByteArray MainWindow::stopTracing()
+{
+    const QByteArray json = traceEventsToJson();
+    ::stopTracing();
+    emit tracingChanged();
+    return json;
+}
+
 QString syncCommand(const QString &type)
 {
     return "try {"
@@ -2034,6 +2061,8 @@ QString syncCommand(const QString &type)
 
 void MainWindow::runAutomaticCommands(const QVariantMap &data)
 {
+    TraceScope trace(data, "server: run automatic commands");
+
     bool isClipboard = isClipboardData(data);
 
     // Don't abort currently commands if X11 selection changes rapidly.
@@ -2087,6 +2116,8 @@ void MainWindow::previousTab()
 
 void MainWindow::clipboardChanged(const QVariantMap &data)
 {
+    TraceScope trace(data, "server: clipboard changed");
+
     // Don't process the data further if any running clipboard monitor set the clipboard.
     if ( !ownsClipboardData(data)
          && !isClipboardDataHidden(data)
@@ -34,6 +34,7 @@
 
 class Action;
 class ActionHandler;
+class ActionScriptRunner;
 class CommandDialog;
 class ConfigurationManager;
 class NotificationDaemon;
@@ -136,6 +137,9 @@ public:
 
     bool hasRunningAction() const;
 
+    /** Run "copyq:" scripts of actions using @a runner instead of starting new process. */
+    void setActionScriptRunner(ActionScriptRunner *runner);
+
     /**
      * Try to close command dialog and return true on success.
      *
@@ -275,6 +279,12 @@ public:
     /// Return true only if user option is available (used by config() command).
     bool hasUserOption(const QString &name) const;
 
+    /// Start tracing clipboard changes in server and monitor (used by trace() command).
+    void startTracing();
+
+    /// Stop tracing and return recorded events in JSON (used by trace() command).
+    QByteArray stopTracing();
+
 public slots:
     /** Close main window and exit the application. */
     void exit();
@@ -420,6 +430,9 @@ signals:
 
     void configurationChanged();
 
+    /** Tracing was started or stopped. */
+    void tracingChanged();
+
 protected:
     void keyPressEvent(QKeyEvent *event);
     void keyReleaseEvent(QKeyEvent *event);
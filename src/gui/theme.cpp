@@ -172,6 +172,11 @@ void Theme::decorateBrowser(QListView *c, ItemDelegate *d) const
 
     QPalette p;
 
+    // style of items painted without widget
+    p.setColor(QPalette::Text, color("fg"));
+    p.setColor(QPalette::HighlightedText, color("sel_fg"));
+    d->setItemStyle(font("font"), p);
+
     // search style
     p.setColor(QPalette::Base, color("find_bg"));
     p.setColor(QPalette::Text, color("find_fg"));
@@ -0,0 +1,300 @@
+/*
+    Copyright (c) 2016, Lukas Holecek <hluk@email.cz>
+
+    This file is part of CopyQ.
+
+    CopyQ is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    CopyQ is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with CopyQ.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#include "thumbnailcache.h"
+
+#include "common/config.h"
+#include "common/datafingerprint.h"
+#include "common/log.h"
+
+#include <QBuffer>
+#include <QCoreApplication>
+#include <QCryptographicHash>
+#include <QDir>
+#include <QFileInfo>
+#include <QImage>
+#include <QImageReader>
+#include <QPointer>
+#include <QRegExp>
+#include <QRunnable>
+#include <QStringList>
+
+namespace {
+
+/// Maximum memory used by thumbnails in kilobytes.
+const int maxThumbnailCacheCostKb = 32 * 1024;
+
+/// Maximum number of thumbnail files kept on disk.
+const int maxThumbnailFiles = 2000;
+
+/// Text in thumbnail file with checksum of source image data.
+const char thumbnailChecksumKey[] = "CopyQ-Source";
+
+QString thumbnailDirectoryPath()
+{
+    return getConfigurationFilePath("_thumbnails");
+}
+
+QString thumbnailFileName(const QString &key)
+{
+    return thumbnailDirectoryPath() + '/' + key + ".png";
+}
+
+QString thumbnailKey(uint itemHash, const QSize &size, bool crop)
+{
+    return QString("%1_%2x%3%4")
+            .arg(itemHash)
+            .arg(size.width())
+            .arg(size.height())
+            .arg(crop ? "c" : "");
+}
+
+QString thumbnailFileKey(const QByteArray &bytes, const QSize &size, bool crop)
+{
+    const DataFingerprint fingerprint = dataFingerprint(bytes);
+    return QString("%1-%2_%3x%4%5")
+            .arg(fingerprint.hash, 16, 16, QChar('0'))
+            .arg(fingerprint.size)
+            .arg(size.width())
+            .arg(size.height())
+            .arg(crop ? "c" : "");
+}
+
+QString thumbnailChecksum(const QByteArray &bytes)
+{
+    return QString::fromLatin1(
+                QCryptographicHash::hash(bytes, QCryptographicHash::Md5).toHex() );
+}
+
+QImage loadThumbnailFile(const QString &fileName, const QString &checksum)
+{
+    QImageReader reader(fileName, "PNG");
+    if ( reader.text(thumbnailChecksumKey) != checksum )
+        return QImage();
+
+    return reader.read();
+}
+
+QString findImageFormat(const QVariantMap &data)
+{
+    // Check formats in this order.
+    static const QStringList imageFormats = QStringList()
+            << QString("image/png")
+            << QString("image/bmp")
+            << QString("image/jpeg")
+            << QString("image/gif")
+            << QString("image/svg+xml");
+
+    foreach (const QString &format, imageFormats) {
+        if ( data.contains(format) )
+            return format;
+    }
+
+    foreach (const QString &format, data.keys()) {
+        if ( format.startsWith("image/") )
+            return format;
+    }
+
+    return QString();
+}
+
+QSize scaledImageSize(const QSize &imageSize, const QSize &size, bool crop)
+{
+    if (crop)
+        return imageSize.scaled(size, Qt::KeepAspectRatioByExpanding);
+
+    const QSize maxSize(
+                size.width() > 0 ? size.width() : imageSize.width(),
+                size.height() > 0 ? size.height() : imageSize.height() );
+
+    if (imageSize.width() <= maxSize.width() && imageSize.height() <= maxSize.height())
+        return imageSize;
+
+    return imageSize.scaled(maxSize, Qt::KeepAspectRatio);
+}
+
+QImage createThumbnail(const QByteArray &bytes, const QSize &size, bool crop)
+{
+    QBuffer buffer;
+    buffer.setData(bytes);
+    buffer.open(QIODevice::ReadOnly);
+
+    QImageReader reader(&buffer);
+
+    // Let image plugin decode smaller image if possible (e.g. JPEG).
+    const QSize imageSize = reader.size();
+    const QSize targetSize = imageSize.isValid() ? scaledImageSize(imageSize, size, crop) : QSize();
+    if ( targetSize.isValid() && reader.supportsOption(QImageIOHandler::ScaledSize) )
+        reader.setScaledSize(targetSize);
+
+    QImage image = reader.read();
+    if ( image.isNull() )
+        return image;
+
+    const QSize newSize = scaledImageSize(image.size(), size, crop);
+    if (newSize != image.size())
+        image = image.scaled(newSize, Qt::IgnoreAspectRatio, Qt::SmoothTransformation);
+
+    if (crop) {
+        const int x = (image.width() - size.width()) / 2;
+        const int y = (image.height() - size.height()) / 2;
+        image = image.copy(x, y, size.width(), size.height());
+    }
+
+    return image;
+}
+
+class ThumbnailLoader : public QRunnable
+{
+public:
+    ThumbnailLoader(
+            ThumbnailCache *cache, uint itemHash, const QString &key,
+            const QByteArray &bytes, const QSize &size, bool crop, bool cacheOnDisk)
+        : m_cache(cache)
+        , m_itemHash(itemHash)
+        , m_key(key)
+        , m_bytes(bytes)
+        , m_size(size)
+        , m_crop(crop)
+        , m_cacheOnDisk(cacheOnDisk)
+    {
+    }
+
+    void run()
+    {
+        QImage image;
+        QString fileName;
+        QString checksum;
+
+        if (m_cacheOnDisk) {
+            fileName = thumbnailFileName( thumbnailFileKey(m_bytes, m_size, m_crop) );
+            checksum = thumbnailChecksum(m_bytes);
+            image = loadThumbnailFile(fileName, checksum);
+        }
+
+        if ( image.isNull() ) {
+            image = createThumbnail(m_bytes, m_size, m_crop);
+            if ( m_cacheOnDisk && !image.isNull() && QDir().mkpath(thumbnailDirectoryPath()) ) {
+                image.setText(thumbnailChecksumKey, checksum);
+                if ( !image.save(fileName, "PNG") )
+                    COPYQ_LOG( QString("Failed to save thumbnail \"%1\"").arg(fileName) );
+            }
+        }
+
+        QMetaObject::invokeMethod(
+                    m_cache, "onThumbnailLoaded", Qt::QueuedConnection,
+                    Q_ARG(uint, m_itemHash), Q_ARG(QString, m_key), Q_ARG(QImage, image) );
+    }
+
+private:
+    ThumbnailCache *m_cache;
+    uint m_itemHash;
+    QString m_key;
+    QByteArray m_bytes;
+    QSize m_size;
+    bool m_crop;
+    bool m_cacheOnDisk;
+};
+
+/// Removes oldest thumbnail files if there are too many.
+class ThumbnailDirectoryCleaner : public QRunnable
+{
+public:
+    void run()
+    {
+        const QDir dir( thumbnailDirectoryPath() );
+        const QFileInfoList files =
+                dir.entryInfoList(QStringList("*.png"), QDir::Files, QDir::Time);
+
+        // Files from older versions are named by item hash only.
+        const QRegExp thumbnailFileNameRe("[0-9a-f]{16}-\\d+_\\d+x\\d+c?\\.png");
+
+        int count = 0;
+        foreach (const QFileInfo &file, files) {
+            if ( !thumbnailFileNameRe.exactMatch(file.fileName()) || ++count > maxThumbnailFiles )
+                QFile::remove( file.absoluteFilePath() );
+        }
+    }
+};
+
+} // namespace
+
+ThumbnailCache *ThumbnailCache::instance()
+{
+    static QPointer<ThumbnailCache> cache;
+    if (!cache) {
+        cache = new ThumbnailCache(qApp);
+        // Plugins access the instance using sharedThumbnailCache().
+        qApp->setProperty( "CopyQ_thumbnail_cache", QVariant::fromValue<QObject*>(cache) );
+    }
+    return cache;
+}
+
+ThumbnailCache::~ThumbnailCache()
+{
+    m_threadPool.waitForDone();
+}
+
+QPixmap ThumbnailCache::thumbnail(
+        uint itemHash, const QVariantMap &data, const QSize &size, bool crop, bool cacheOnDisk)
+{
+    const QString key = thumbnailKey(itemHash, size, crop);
+
+    const QPixmap *pixmap = m_cache.object(key);
+    if (pixmap)
+        return *pixmap;
+
+    if ( m_pending.contains(key) )
+        return QPixmap();
+
+    const QString format = findImageFormat(data);
+    if ( format.isEmpty() )
+        return QPixmap();
+
+    m_pending.insert(key);
+    m_threadPool.start(
+                new ThumbnailLoader(
+                    this, itemHash, key, data[format].toByteArray(), size, crop, cacheOnDisk) );
+
+    return QPixmap();
+}
+
+void ThumbnailCache::onThumbnailLoaded(uint itemHash, const QString &key, const QImage &image)
+{
+    m_pending.remove(key);
+
+    // Failed images are also cached so these are not loaded again.
+    const int cost = qMax(1, image.byteCount() / 1024);
+    m_cache.insert( key, new QPixmap(QPixmap::fromImage(image)), cost );
+
+    if ( !image.isNull() )
+        emit thumbnailReady(itemHash);
+}
+
+ThumbnailCache::ThumbnailCache(QObject *parent)
+    : QObject(parent)
+    , m_cache(maxThumbnailCacheCostKb)
+    , m_pending()
+    , m_threadPool()
+{
+    // Decoding images is not time critical and shouldn't slow down other threads.
+    m_threadPool.setMaxThreadCount(1);
+    m_threadPool.start( new ThumbnailDirectoryCleaner() );
+}
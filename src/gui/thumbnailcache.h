@@ -0,0 +1,122 @@
+/*
+    Copyright (c) 2016, Lukas Holecek <hluk@email.cz>
+
+    This file is part of CopyQ.
+
+    CopyQ is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    CopyQ is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with CopyQ.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#ifndef THUMBNAILCACHE_H
+#define THUMBNAILCACHE_H
+
+#include <QCache>
+#include <QCoreApplication>
+#include <QObject>
+#include <QPixmap>
+#include <QSet>
+#include <QSize>
+#include <QThreadPool>
+#include <QVariantMap>
+
+class QImage;
+
+/**
+ * Cache of scaled images for items (used in tray menu and item list).
+ *
+ * Thumbnails in memory are identified by item hash and size. Images are
+ * decoded and scaled in worker thread and can be stored in a directory next
+ * to tab data so the full image doesn't need to be decoded again after restart.
+ * Files are identified by fingerprint of image data and contain checksum of
+ * the data to detect collisions.
+ *
+ * Number of thumbnails in memory and on disk is limited.
+ *
+ * Single instance is shared with plugins (see thumbnailFromSharedCache()).
+ */
+class ThumbnailCache : public QObject
+{
+    Q_OBJECT
+public:
+    /// Return shared cache (can be used only in GUI thread).
+    static ThumbnailCache *instance();
+
+    ~ThumbnailCache();
+
+    /**
+     * Return thumbnail for image in item @a data with @a itemHash.
+     *
+     * Image is scaled down to fit @a size (zero width or height is not limited).
+     * If @a crop is true, image is scaled to fill whole @a size and cropped.
+     *
+     * If thumbnail is not in memory, null pixmap is returned and thumbnail
+     * is loaded in background; thumbnailReady() is emitted afterwards.
+     *
+     * Thumbnail is stored on disk only if @a cacheOnDisk is true
+     * (see ClipboardModel::cacheOnDisk()).
+     *
+     * Null pixmap is also returned if item has no image.
+     */
+    Q_INVOKABLE QPixmap thumbnail(
+            uint itemHash, const QVariantMap &data, const QSize &size,
+            bool crop = false, bool cacheOnDisk = false);
+
+signals:
+    /// Thumbnail for item was loaded (call thumbnail() to get it).
+    void thumbnailReady(uint itemHash);
+
+private slots:
+    void onThumbnailLoaded(uint itemHash, const QString &key, const QImage &image);
+
+private:
+    explicit ThumbnailCache(QObject *parent = NULL);
+
+    QCache<QString, QPixmap> m_cache;
+    QSet<QString> m_pending;
+    QThreadPool m_threadPool;
+};
+
+/**
+ * Return ThumbnailCache instance created by application (NULL if not available).
+ *
+ * Plugins don't link ThumbnailCache so they need to use this and
+ * thumbnailFromSharedCache() instead of ThumbnailCache::instance().
+ */
+inline QObject *sharedThumbnailCache()
+{
+    return qApp ? qvariant_cast<QObject*>( qApp->property("CopyQ_thumbnail_cache") ) : NULL;
+}
+
+/// Call ThumbnailCache::thumbnail() for shared instance (see sharedThumbnailCache()).
+inline QPixmap thumbnailFromSharedCache(
+        uint itemHash, const QVariantMap &data, const QSize &size, bool crop, bool cacheOnDisk)
+{
+    QPixmap pixmap;
+
+    QObject *cache = sharedThumbnailCache();
+    if (cache) {
+        QMetaObject::invokeMethod(
+                    cache, "thumbnail", Qt::DirectConnection,
+                    Q_RETURN_ARG(QPixmap, pixmap),
+                    Q_ARG(uint, itemHash),
+                    Q_ARG(QVariantMap, data),
+                    Q_ARG(QSize, size),
+                    Q_ARG(bool, crop),
+                    Q_ARG(bool, cacheOnDisk) );
+    }
+
+    return pixmap;
+}
+
+#endif // THUMBNAILCACHE_H
@@ -22,6 +22,7 @@
 #include "common/contenttype.h"
 #include "common/common.h"
 #include "gui/icons.h"
+#include "gui/thumbnailcache.h"
 #include "platform/platformnativeinterface.h"
 #include "platform/platformwindow.h"
 
@@ -70,6 +71,8 @@ TrayMenu::TrayMenu(QWidget *parent)
     , m_omitPaste(false)
     , m_viMode(false)
 {
+    connect( ThumbnailCache::instance(), SIGNAL(thumbnailReady(uint)),
+             this, SLOT(onThumbnailReady(uint)) );
 }
 
 void TrayMenu::toggle()
@@ -116,27 +119,14 @@ void TrayMenu::addClipboardItemAction(const QModelIndex &index, bool showImages,
     const QString label = textLabelForData( data, act->font(), format, true );
     act->setText(label);
 
-    // Menu item icon from image.
+    // Menu item icon from image (loaded later if not cached, see onThumbnailReady()).
     if (showImages) {
-        const QStringList formats = data.keys();
-        const int imageIndex = formats.indexOf( QRegExp("^image/.*") );
-        if (imageIndex != -1) {
-            const QString &format = formats[imageIndex];
-            QPixmap pix;
-            pix.loadFromData( data.value(format).toByteArray(), format.toLatin1().data() );
-            const int iconSize = smallIconSize();
-            int x = 0;
-            int y = 0;
-            if (pix.width() > pix.height()) {
-                pix = pix.scaledToHeight(iconSize);
-                x = (pix.width() - iconSize) / 2;
-            } else {
-                pix = pix.scaledToWidth(iconSize);
-                y = (pix.height() - iconSize) / 2;
-            }
-            pix = pix.copy(x, y, iconSize, iconSize);
+        const bool cacheOnDisk = index.model()->property("cacheOnDisk").toBool();
+        const QPixmap pix = ThumbnailCache::instance()->thumbnail(
+                    act->data().toUInt(), data, QSize(smallIconSize(), smallIconSize()), true,
+                    cacheOnDisk);
+        if ( !pix.isNull() )
             act->setIcon(pix);
-        }
     }
 
     connect(act, SIGNAL(triggered()), this, SLOT(onClipboardItemActionTriggered()));
@@ -145,6 +135,21 @@ void TrayMenu::addClipboardItemAction(const QModelIndex &index, bool showImages,
         setActiveAction(act);
 }
 
+void TrayMenu::onThumbnailReady(uint itemHash)
+{
+    const QSize size(smallIconSize(), smallIconSize());
+
+    foreach (QAction *act, actions()) {
+        if ( act->data().toUInt() != itemHash || !act->icon().isNull() )
+            continue;
+
+        // Only cached thumbnail is returned for empty data.
+        const QPixmap pix = ThumbnailCache::instance()->thumbnail(itemHash, QVariantMap(), size, true);
+        if ( !pix.isNull() )
+            act->setIcon(pix);
+    }
+}
+
 void TrayMenu::addCustomAction(QAction *action)
 {
     resetSeparators();
@@ -59,6 +59,7 @@ signals:
 
 private slots:
     void onClipboardItemActionTriggered();
+    void onThumbnailReady(uint itemHash);
 
 protected:
     void keyPressEvent(QKeyEvent *event);
@@ -22,6 +22,7 @@
 #include "common/common.h"
 #include "common/contenttype.h"
 #include "common/mimetypes.h"
+#include "item/mappeditemdata.h"
 #include "item/serialize.h"
 
 #include <QBrush>
@@ -40,11 +41,25 @@ void clearDataExceptInternal(QVariantMap *data)
     }
 }
 
+void loadMappedFormats(QVariantMap *data)
+{
+    // Avoid detaching the map if there is nothing to load.
+    QStringList formats;
+    for ( QVariantMap::const_iterator it = data->constBegin(); it != data->constEnd(); ++it ) {
+        if ( isMappedItemFormat(it.value()) )
+            formats.append(it.key());
+    }
+
+    foreach ( const QString &format, formats )
+        data->insert( format, loadItemFormat(data->value(format)) );
+}
+
 } // namespace
 
 ClipboardItem::ClipboardItem()
     : m_data()
     , m_hash(0)
+    , m_hashValid(false)
 {
 }
 
@@ -72,11 +87,19 @@ bool ClipboardItem::setData(const QVariantMap &data)
 
     m_data = data;
     invalidateDataHash();
+
+    // Compute hash for new (e.g. deserialized) item if it doesn't need to load any data.
+    if ( canComputeDataHashWithoutLoading() )
+        dataHash();
+
     return true;
 }
 
 bool ClipboardItem::updateData(const QVariantMap &data)
 {
+    // Load formats before comparing with new data.
+    loadMappedFormats(&m_data);
+
     const int oldSize = m_data.size();
     foreach ( const QString &format, data.keys() ) {
         if ( !format.startsWith(COPYQ_MIME_PREFIX) ) {
@@ -132,12 +155,12 @@ QVariant ClipboardItem::data(int role) const
 {
     if (role == Qt::DisplayRole || role == Qt::EditRole) {
         if ( m_data.contains(mimeText) )
-            return getTextData(m_data);
+            return getTextData( data(mimeText) );
         if ( m_data.contains(mimeUriList) )
-            return getTextData(m_data, mimeUriList);
+            return getTextData( data(mimeUriList) );
     } else if (role >= Qt::UserRole) {
         if (role == contentType::data) {
-            return m_data; // copy-on-write, so this should be fast
+            return loadedData();
         } else if (role == contentType::hash) {
             return dataHash();
         } else if (role == contentType::hasText) {
@@ -147,13 +170,13 @@ QVariant ClipboardItem::data(int role) const
         } else if (role == contentType::hasNotes) {
             return m_data.contains(mimeItemNotes);
         } else if (role == contentType::text) {
-            return getTextData(m_data);
+            return getTextData( data(m_data.contains(mimeText) ? mimeText : mimeUriList) );
         } else if (role == contentType::html) {
-            return getTextData(m_data, mimeHtml);
+            return getTextData( data(mimeHtml) );
         } else if (role == contentType::notes) {
-            return getTextData(m_data, mimeItemNotes);
+            return getTextData( data(mimeItemNotes) );
         } else if (role == contentType::color) {
-            return getTextData(m_data, mimeColor);
+            return getTextData( data(mimeColor) );
         }
     }
 
@@ -162,13 +185,42 @@ QVariant ClipboardItem::data(int role) const
 
 unsigned int ClipboardItem::dataHash() const
 {
-    if (m_hash == 0)
-        m_hash = hash(m_data);
+    if (!m_hashValid) {
+        // Same as hash( loadedData() ) but formats with stored fingerprint are not loaded.
+        m_hash = 0;
+        for ( QVariantMap::const_iterator it = m_data.constBegin(); it != m_data.constEnd(); ++it ) {
+            if ( isHashedFormat(it.key()) )
+                m_hash ^= formatHash( it.key(), itemFormatFingerprint(it.value()) );
+        }
+        m_hashValid = true;
+    }
 
     return m_hash;
 }
 
+QByteArray ClipboardItem::data(const QString &format) const
+{
+    return loadItemFormat( m_data.value(format) );
+}
+
 void ClipboardItem::invalidateDataHash()
 {
-    m_hash = 0;
+    m_hashValid = false;
+}
+
+bool ClipboardItem::canComputeDataHashWithoutLoading() const
+{
+    for ( QVariantMap::const_iterator it = m_data.constBegin(); it != m_data.constEnd(); ++it ) {
+        if ( isHashedFormat(it.key()) && !hasItemFormatFingerprint(it.value()) )
+            return false;
+    }
+
+    return true;
+}
+
+QVariantMap ClipboardItem::loadedData() const
+{
+    QVariantMap data = m_data; // copy-on-write, so this should be fast
+    loadMappedFormats(&data);
+    return data;
 }
@@ -30,6 +30,9 @@ class QString;
  *
  * Clipboard item stores data of different MIME types and has single default
  * MIME type for displaying the contents.
+ *
+ * Some formats may not be loaded into memory (values are MappedItemFormat).
+ * These are loaded only when requested.
  */
 class ClipboardItem
 {
@@ -70,16 +73,31 @@ public:
     QVariant data(int role) const;
 
     /** Return data for format. */
-    QByteArray data(const QString &format) const { return m_data.value(format).toByteArray(); }
+    QByteArray data(const QString &format) const;
+
+    /** Return data without loading formats which are not in memory yet. */
+    const QVariantMap &rawData() const { return m_data; }
 
-    /** Return hash for item's data. */
+    /**
+     * Return hash for item's data (computed only once until data change).
+     *
+     * Formats which are not in memory are loaded only if their fingerprint
+     * was not stored with the data.
+     */
     unsigned int dataHash() const;
 
 private:
     void invalidateDataHash();
 
+    /** Return true if all hashed formats are in memory or have stored fingerprint. */
+    bool canComputeDataHashWithoutLoading() const;
+
+    /** Return all data (loads formats which are not in memory). */
+    QVariantMap loadedData() const;
+
     QVariantMap m_data;
     mutable unsigned int m_hash;
+    mutable bool m_hashValid;
 };
 
 #endif // CLIPBOARDITEM_H
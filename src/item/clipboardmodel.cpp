@@ -55,7 +55,13 @@ ClipboardModel::ClipboardModel(QObject *parent)
     : QAbstractListModel(parent)
     , m_max(100)
     , m_clipboardList(m_max)
+    , m_hashIndex()
+    , m_hashIndexValid(false)
+    , m_hashIndexBase(0)
     , m_disabled(false)
+    , m_mapItemData(false)
+    , m_deduplicateItemData(false)
+    , m_cacheOnDisk(false)
     , m_tabName()
 {
 }
@@ -87,6 +93,7 @@ bool ClipboardModel::setData(const QModelIndex &index, const QVariant &value, in
         return false;
 
     int row = index.row();
+    const uint oldHash = m_hashIndexValid ? m_clipboardList[row].dataHash() : 0;
 
     if (role == Qt::EditRole) {
         m_clipboardList[row].setText(value.toString());
@@ -111,6 +118,12 @@ bool ClipboardModel::setData(const QModelIndex &index, const QVariant &value, in
         return false;
     }
 
+    if (m_hashIndexValid) {
+        const int key = hashIndexKey(row);
+        m_hashIndex.remove(oldHash, key);
+        m_hashIndex.insert(m_clipboardList[row].dataHash(), key);
+    }
+
     emit dataChanged(index, index);
 
     return true;
@@ -124,10 +137,34 @@ void ClipboardModel::insertItem(const QVariantMap &data, int row)
     beginInsertRows(QModelIndex(), row, row);
 
     m_clipboardList.insert(row, item);
+    if (m_hashIndexValid)
+        updateHashIndexAfterInsert(row, 1);
 
     endInsertRows();
 }
 
+void ClipboardModel::insertItems(const QList<QVariantMap> &dataList, int row)
+{
+    if ( dataList.isEmpty() )
+        return;
+
+    beginInsertRows(QModelIndex(), row, row + dataList.size() - 1);
+
+    m_clipboardList.insert(row, dataList.size());
+    for (int i = 0; i < dataList.size(); ++i)
+        m_clipboardList[row + i].setData(dataList[i]);
+    if (m_hashIndexValid)
+        updateHashIndexAfterInsert(row, dataList.size());
+
+    endInsertRows();
+}
+
+bool ClipboardModel::submit()
+{
+    emit itemsSubmitted();
+    return true;
+}
+
 bool ClipboardModel::insertRows(int position, int rows, const QModelIndex&)
 {
     if ( rows <= 0 || position < 0 )
@@ -137,6 +174,8 @@ bool ClipboardModel::insertRows(int position, int rows, const QModelIndex&)
 
     for (int row = 0; row < rows; ++row)
         m_clipboardList.insert(position, ClipboardItem());
+    if (m_hashIndexValid)
+        updateHashIndexAfterInsert(position, rows);
 
     endInsertRows();
 
@@ -152,7 +191,17 @@ bool ClipboardModel::removeRows(int position, int rows, const QModelIndex&)
 
     beginRemoveRows(QModelIndex(), position, last);
 
-    m_clipboardList.remove(position, last - position + 1);
+    const int count = last - position + 1;
+    if ( count == m_clipboardList.size() ) {
+        invalidateHashIndex();
+    } else if (m_hashIndexValid) {
+        removeFromHashIndex(position, last);
+    }
+
+    m_clipboardList.remove(position, count);
+
+    if (m_hashIndexValid)
+        updateHashIndexAfterRemove(position, count);
 
     endRemoveRows();
 
@@ -185,9 +234,7 @@ void ClipboardModel::setMaxItems(int max)
     m_max = qMax(0, max);
 
     if ( m_max < m_clipboardList.size() ) {
-        beginRemoveRows(QModelIndex(), m_max + 1, m_clipboardList.size() - 1);
-        m_clipboardList.resize(m_max);
-        endRemoveRows();
+        removeRows(m_max, m_clipboardList.size() - m_max);
     } else {
         m_clipboardList.reserve(m_max);
     }
@@ -220,8 +267,16 @@ bool ClipboardModel::move(int pos, int newpos)
     if ( !beginMoveRows(QModelIndex(), from, from, QModelIndex(), to) )
         return false;
 
+    const int first = qMin(sourceRow, targetRow);
+    const int last = qMax(sourceRow, targetRow);
+    if (m_hashIndexValid)
+        removeFromHashIndex(first, last);
+
     m_clipboardList.move(sourceRow, targetRow);
 
+    if (m_hashIndexValid)
+        addToHashIndex(first, last);
+
     endMoveRows();
 
     return true;
@@ -285,7 +340,13 @@ void ClipboardModel::sortItems(const QModelIndexList &indexList, CompareItems *c
 
             if (targetRow != sourceRow) {
                 beginMoveRows(QModelIndex(), sourceRow, sourceRow, QModelIndex(), targetRow);
+                const int first = qMin(sourceRow, targetRow);
+                const int last = qMax(sourceRow, targetRow);
+                if (m_hashIndexValid)
+                    removeFromHashIndex(first, last);
                 m_clipboardList.move(sourceRow, targetRow);
+                if (m_hashIndexValid)
+                    addToHashIndex(first, last);
                 endMoveRows();
 
                 // If the moved item was removed or moved further (as reaction on moving the item),
@@ -301,10 +362,83 @@ void ClipboardModel::sortItems(const QModelIndexList &indexList, CompareItems *c
 
 int ClipboardModel::findItem(uint item_hash) const
 {
-    for (int i = 0; i < m_clipboardList.size(); ++i) {
-        if ( m_clipboardList[i].dataHash() == item_hash )
-            return i;
+    if (!m_hashIndexValid)
+        buildHashIndex();
+
+    QMultiHash<uint, int>::const_iterator it = m_hashIndex.constFind(item_hash);
+    if ( it == m_hashIndex.constEnd() )
+        return -1;
+
+    // Top-most item has the highest key.
+    int key = it.value();
+    for ( ++it; it != m_hashIndex.constEnd() && it.key() == item_hash; ++it )
+        key = qMax(key, it.value());
+
+    return m_clipboardList.size() - 1 - (key - m_hashIndexBase);
+}
+
+void ClipboardModel::buildHashIndex() const
+{
+    m_hashIndex.clear();
+    m_hashIndex.reserve( m_clipboardList.size() );
+    m_hashIndexBase = 0;
+
+    for (int row = 0; row < m_clipboardList.size(); ++row)
+        m_hashIndex.insert( m_clipboardList[row].dataHash(), hashIndexKey(row) );
+
+    m_hashIndexValid = true;
+}
+
+void ClipboardModel::invalidateHashIndex()
+{
+    m_hashIndex.clear();
+    m_hashIndexValid = false;
+}
+
+void ClipboardModel::addToHashIndex(int first, int last)
+{
+    for (int row = first; row <= last; ++row)
+        m_hashIndex.insert( m_clipboardList[row].dataHash(), hashIndexKey(row) );
+}
+
+void ClipboardModel::removeFromHashIndex(int first, int last)
+{
+    for (int row = first; row <= last; ++row)
+        m_hashIndex.remove( m_clipboardList[row].dataHash(), hashIndexKey(row) );
+}
+
+void ClipboardModel::rekeyHashIndex(int first, int last, int oldKeyOffset)
+{
+    for (int row = first; row <= last; ++row) {
+        const uint itemHash = m_clipboardList[row].dataHash();
+        const int key = hashIndexKey(row);
+        m_hashIndex.remove(itemHash, key + oldKeyOffset);
+        m_hashIndex.insert(itemHash, key);
+    }
+}
+
+void ClipboardModel::updateHashIndexAfterInsert(int row, int count)
+{
+    // Either update keys of items above inserted ones or shift all keys and
+    // update keys of items below, whichever is less work.
+    const int rowsBelow = m_clipboardList.size() - row - count;
+    if (row <= rowsBelow) {
+        rekeyHashIndex(0, row - 1, -count);
+    } else {
+        m_hashIndexBase -= count;
+        rekeyHashIndex(row + count, m_clipboardList.size() - 1, count);
     }
 
-    return -1;
+    addToHashIndex(row, row + count - 1);
+}
+
+void ClipboardModel::updateHashIndexAfterRemove(int row, int count)
+{
+    const int rowsBelow = m_clipboardList.size() - row;
+    if (row <= rowsBelow) {
+        rekeyHashIndex(0, row - 1, count);
+    } else {
+        m_hashIndexBase += count;
+        rekeyHashIndex(row, m_clipboardList.size() - 1, -count);
+    }
 }
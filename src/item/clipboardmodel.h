@@ -23,6 +23,7 @@
 #include "item/clipboarditem.h"
 
 #include <QAbstractListModel>
+#include <QHash>
 #include <QVector>
 
 /**
@@ -52,6 +53,11 @@ public:
         m_items.insert(toIndex(row) + 1, item);
     }
 
+    void insert(int row, int count)
+    {
+        m_items.insert(toIndex(row) + 1, count, ClipboardItem());
+    }
+
     void remove(int row, int count)
     {
         m_items.remove(toIndex(row) + 1 - count, count);
@@ -103,6 +109,9 @@ class ClipboardModel : public QAbstractListModel
     Q_OBJECT
     Q_PROPERTY(int maxItems READ maxItems WRITE setMaxItems)
     Q_PROPERTY(bool disabled READ isDisabled WRITE setDisabled)
+    Q_PROPERTY(bool mapItemData READ mapItemData WRITE setMapItemData)
+    Q_PROPERTY(bool deduplicateItemData READ deduplicateItemData WRITE setDeduplicateItemData)
+    Q_PROPERTY(bool cacheOnDisk READ cacheOnDisk WRITE setCacheOnDisk)
     Q_PROPERTY(QString tabName READ tabName WRITE setTabName NOTIFY tabNameChanged)
 
 public:
@@ -130,6 +139,24 @@ public:
     /** insert new item to model. */
     void insertItem(const QVariantMap &data, int row);
 
+    /** Insert new items to model (all at once). */
+    void insertItems(const QList<QVariantMap> &dataList, int row);
+
+    /**
+     * Notify that all items inserted so far have their data set.
+     *
+     * Item loaders can call this after each batch of loaded items so the items can
+     * be shown before loading finishes (see ItemLoaderInterface::loadItems()).
+     */
+    bool submit();
+
+    /**
+     * Return item data in given @a row without loading data not yet in memory.
+     *
+     * The data should be only passed to insertItem() (e.g. to model in other thread).
+     */
+    QVariantMap rawItemData(int row) const { return m_clipboardList[row].rawData(); }
+
     /**
      * Set maximum number of items in model.
      *
@@ -146,6 +173,31 @@ public:
 
     void setDisabled(bool disabled) { m_disabled = disabled; }
 
+    /**
+     * If true, big item data are not loaded from tab data file into memory until
+     * needed (file is mapped to memory instead).
+     */
+    bool mapItemData() const { return m_mapItemData; }
+
+    void setMapItemData(bool map) { m_mapItemData = map; }
+
+    /**
+     * If true, big item data are saved in blobs shared with other tabs
+     * instead of tab data file (see itemblobstore.h).
+     */
+    bool deduplicateItemData() const { return m_deduplicateItemData; }
+
+    void setDeduplicateItemData(bool deduplicate) { m_deduplicateItemData = deduplicate; }
+
+    /**
+     * If true, data derived from items (e.g. image thumbnails) can be cached on disk.
+     *
+     * This is false if items must not be stored unchanged (e.g. encrypted tab).
+     */
+    bool cacheOnDisk() const { return m_cacheOnDisk; }
+
+    void setCacheOnDisk(bool cache) { m_cacheOnDisk = cache; }
+
     /** Tab name associated with model. */
     const QString &tabName() const { return m_tabName; }
 
@@ -179,7 +231,10 @@ public:
 
     /**
      * Find item with given @a hash.
-     * @return Row number with found item or -1 if no item was found.
+     *
+     * Uses hash index which is built on first call and kept up to date afterwards.
+     *
+     * @return Row number of top-most item found or -1 if no item was found.
      */
     int findItem(uint hash) const;
 
@@ -199,12 +254,42 @@ public:
 
 signals:
     void unloaded();
+    void itemsSubmitted();
     void tabNameChanged(const QString &tabName);
 
 private:
+    /**
+     * Return hash index key for item in @a row.
+     *
+     * Key is position of item in ClipboardItemList counted from bottom, so
+     * it doesn't change when items are added to top. Removing items from bottom
+     * only changes m_hashIndexBase.
+     */
+    int hashIndexKey(int row) const { return m_clipboardList.size() - row - 1 + m_hashIndexBase; }
+
+    void buildHashIndex() const;
+    void invalidateHashIndex();
+    void addToHashIndex(int first, int last);
+    void removeFromHashIndex(int first, int last);
+
+    /** Replace keys in hash index for items in given rows (old key is current key + @a oldKeyOffset). */
+    void rekeyHashIndex(int first, int last, int oldKeyOffset);
+
+    /** Update hash index after inserting @a count rows at @a row. */
+    void updateHashIndexAfterInsert(int row, int count);
+
+    /** Update hash index after removing @a count rows at @a row. */
+    void updateHashIndexAfterRemove(int row, int count);
+
     int m_max;
     ClipboardItemList m_clipboardList;
+    mutable QMultiHash<uint, int> m_hashIndex;
+    mutable bool m_hashIndexValid;
+    mutable int m_hashIndexBase;
     bool m_disabled;
+    bool m_mapItemData;
+    bool m_deduplicateItemData;
+    bool m_cacheOnDisk;
     QString m_tabName;
 };
 
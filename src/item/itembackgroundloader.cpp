@@ -0,0 +1,275 @@
+/*
+    Copyright (c) 2016, Lukas Holecek <hluk@email.cz>
+
+    This file is part of CopyQ.
+
+    CopyQ is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    CopyQ is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with CopyQ.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "itembackgroundloader.h"
+
+#include "common/common.h"
+#include "item/clipboardmodel.h"
+#include "item/itemstore.h"
+#include "item/itemwidget.h"
+
+#include <QCoreApplication>
+#include <QEvent>
+#include <QRunnable>
+#include <QScopedPointer>
+
+namespace {
+
+/// Number of items inserted into model at once.
+const int insertBatchSize = 200;
+
+/// Passes items submitted by loader (see ClipboardModel::submit()) to ItemBackgroundLoader.
+class ItemLoadProgress : public QObject
+{
+    Q_OBJECT
+
+public:
+    ItemLoadProgress(const ClipboardModel &model, ItemBackgroundLoader *target, int loadId)
+        : QObject()
+        , m_model(model)
+        , m_target(target)
+        , m_loadId(loadId)
+        , m_submittedCount(0)
+    {
+        connect( &model, SIGNAL(itemsSubmitted()),
+                 this, SLOT(submitItems()), Qt::DirectConnection );
+    }
+
+    /// Number of items already passed to ItemBackgroundLoader.
+    int submittedCount() const { return m_submittedCount; }
+
+private slots:
+    void submitItems()
+    {
+        QVariantList items;
+        for (int row = m_submittedCount; row < m_model.rowCount(); ++row)
+            items.append( m_model.rawItemData(row) );
+
+        if ( items.isEmpty() )
+            return;
+
+        m_submittedCount = m_model.rowCount();
+
+        QMetaObject::invokeMethod( m_target, "onItemsSubmitted", Qt::QueuedConnection,
+                                   Q_ARG(int, m_loadId),
+                                   Q_ARG(QVariantList, items) );
+    }
+
+private:
+    const ClipboardModel &m_model;
+    ItemBackgroundLoader *m_target;
+    int m_loadId;
+    int m_submittedCount;
+};
+
+/// Loads items to temporary model in background and passes them to ItemBackgroundLoader.
+class ItemLoadTask : public QRunnable
+{
+public:
+    ItemLoadTask(
+            ItemBackgroundLoader *target, int loadId, ItemLoaderInterface *loader,
+            const ClipboardModel &model)
+        : QRunnable()
+        , m_target(target)
+        , m_loadId(loadId)
+        , m_loader(loader)
+        , m_tabName(model.tabName())
+        , m_maxItems(model.maxItems())
+        , m_mapItemData(model.mapItemData())
+    {
+    }
+
+    void run()
+    {
+        // Model must be created in this thread.
+        ClipboardModel model;
+        model.setTabName(m_tabName);
+        model.setMaxItems(m_maxItems);
+        model.setMapItemData(m_mapItemData);
+
+        // Items can be shown early only if these won't be changed by journal later.
+        QScopedPointer<ItemLoadProgress> progress;
+        if ( !m_loader->canJournalItems() )
+            progress.reset( new ItemLoadProgress(model, m_target, m_loadId) );
+
+        bool journalReplayed = true;
+        const bool loaded = loadItemsInBackground(&model, m_loader, &journalReplayed);
+
+        // Data are implicitly shared so this is fast.
+        QVariantList items;
+        if (loaded) {
+            const int submittedCount = progress ? progress->submittedCount() : 0;
+            for (int row = submittedCount; row < model.rowCount(); ++row)
+                items.append( model.rawItemData(row) );
+        }
+
+        QMetaObject::invokeMethod( m_target, "onItemsLoaded", Qt::QueuedConnection,
+                                   Q_ARG(int, m_loadId),
+                                   Q_ARG(bool, loaded),
+                                   Q_ARG(bool, journalReplayed),
+                                   Q_ARG(QVariantList, items) );
+    }
+
+private:
+    ItemBackgroundLoader *m_target;
+    int m_loadId;
+    ItemLoaderInterface *m_loader;
+    QString m_tabName;
+    int m_maxItems;
+    bool m_mapItemData;
+};
+
+} // namespace
+
+ItemBackgroundLoader::ItemBackgroundLoader(ClipboardModel *model)
+    : QObject()
+    , m_model(model)
+    , m_loader(NULL)
+    , m_loaded(false)
+    , m_journalReplayed(true)
+    , m_items()
+    , m_loadedCount(0)
+    , m_itemCount(-1)
+    , m_loadId(0)
+    , m_loadPool()
+    , m_timerInsert()
+{
+    m_loadPool.setMaxThreadCount(1);
+    initSingleShotTimer( &m_timerInsert, 0, this, SLOT(insertNextItems()) );
+}
+
+ItemBackgroundLoader::~ItemBackgroundLoader()
+{
+    abort();
+}
+
+void ItemBackgroundLoader::start(ItemLoaderInterface *loader)
+{
+    abort();
+
+    m_loader = loader;
+    m_loaded = false;
+    m_journalReplayed = true;
+    m_loadedCount = 0;
+    m_itemCount = -1;
+
+    m_loadPool.start( new ItemLoadTask(this, m_loadId, loader, *m_model) );
+
+    emit progressChanged();
+}
+
+void ItemBackgroundLoader::waitForFinished()
+{
+    if ( !isLoading() )
+        return;
+
+    m_timerInsert.stop();
+    m_loadPool.waitForDone();
+
+    // Receive loaded items from the thread.
+    QCoreApplication::sendPostedEvents(this, QEvent::MetaCall);
+    m_timerInsert.stop();
+
+    Q_ASSERT(m_itemCount != -1);
+    insertItems(m_itemCount - m_loadedCount);
+}
+
+void ItemBackgroundLoader::abort()
+{
+    if ( !isLoading() )
+        return;
+
+    m_timerInsert.stop();
+    m_loadPool.waitForDone();
+
+    // Ignore items if these were already passed from the thread.
+    ++m_loadId;
+
+    m_loader = NULL;
+    m_items.clear();
+}
+
+void ItemBackgroundLoader::onItemsLoaded(
+        int loadId, bool loaded, bool journalReplayed, const QVariantList &items)
+{
+    if (loadId != m_loadId)
+        return;
+
+    m_loaded = loaded;
+    m_journalReplayed = journalReplayed;
+    m_items.append(items);
+    m_itemCount = m_items.size();
+
+    emit progressChanged();
+
+    m_timerInsert.start();
+}
+
+void ItemBackgroundLoader::onItemsSubmitted(int loadId, const QVariantList &items)
+{
+    if (loadId != m_loadId)
+        return;
+
+    m_items.append(items);
+
+    emit progressChanged();
+
+    if ( !m_timerInsert.isActive() )
+        m_timerInsert.start();
+}
+
+void ItemBackgroundLoader::insertNextItems()
+{
+    const int loadId = m_loadId;
+
+    insertItems(insertBatchSize);
+
+    // Continue if not finished (or restarted) and more items are available.
+    if ( loadId == m_loadId && m_loadedCount < m_items.size() )
+        m_timerInsert.start();
+}
+
+void ItemBackgroundLoader::insertItems(int count)
+{
+    const int end = qMin(m_loadedCount + count, m_items.size());
+
+    QList<QVariantMap> dataList;
+    for (int i = m_loadedCount; i < end; ++i) {
+        dataList.append( m_items[i].toMap() );
+        m_items[i] = QVariant();
+    }
+
+    m_model->insertItems( dataList, m_model->rowCount() );
+    m_loadedCount = end;
+
+    emit progressChanged();
+
+    // Wait for rest of the items if loading didn't finish yet.
+    if (m_itemCount == -1 || m_loadedCount < m_itemCount)
+        return;
+
+    ItemLoaderInterface *loader = m_loaded ? m_loader : NULL;
+    m_loader = NULL;
+    m_items.clear();
+    ++m_loadId;
+
+    emit finished(loader, m_journalReplayed);
+}
+
+#include "itembackgroundloader.moc"
@@ -0,0 +1,104 @@
+/*
+    Copyright (c) 2016, Lukas Holecek <hluk@email.cz>
+
+    This file is part of CopyQ.
+
+    CopyQ is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    CopyQ is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with CopyQ.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef ITEMBACKGROUNDLOADER_H
+#define ITEMBACKGROUNDLOADER_H
+
+#include <QObject>
+#include <QThreadPool>
+#include <QTimer>
+#include <QVariantList>
+
+class ClipboardModel;
+class ItemLoaderInterface;
+
+/**
+ * Loads items for ClipboardModel in other thread.
+ *
+ * Items are deserialized in background (see loadItemsInBackground()) and then
+ * inserted into the model in small batches so the GUI stays responsive.
+ *
+ * Items submitted by loader before loading finishes (see ClipboardModel::submit())
+ * are inserted early.
+ */
+class ItemBackgroundLoader : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit ItemBackgroundLoader(ClipboardModel *model);
+
+    /** Waits for loading thread and drops loaded items. */
+    ~ItemBackgroundLoader();
+
+    /**
+     * Start loading items using @a loader (see backgroundItemLoader()).
+     *
+     * Model should be empty.
+     */
+    void start(ItemLoaderInterface *loader);
+
+    bool isLoading() const { return m_loader != NULL; }
+
+    /** Number of items inserted into model so far. */
+    int loadedItemCount() const { return m_loadedCount; }
+
+    /** Number of all items to load or -1 if not yet known. */
+    int itemCount() const { return m_itemCount; }
+
+    /** Wait for items to load and insert all remaining items into model. */
+    void waitForFinished();
+
+    /** Wait for loading thread and drop items not yet inserted into model. */
+    void abort();
+
+signals:
+    /** Emitted when items are loaded and inserted to model. */
+    void progressChanged();
+
+    /**
+     * Emitted when all items were inserted into model.
+     *
+     * Loading should be finished using finishLoadingItems().
+     */
+    void finished(ItemLoaderInterface *loader, bool journalReplayed);
+
+private slots:
+    void onItemsLoaded(int loadId, bool loaded, bool journalReplayed, const QVariantList &items);
+    void onItemsSubmitted(int loadId, const QVariantList &items);
+    void insertNextItems();
+
+private:
+    /** Insert up to @a count items. */
+    void insertItems(int count);
+
+    ClipboardModel *m_model;
+    ItemLoaderInterface *m_loader;
+    bool m_loaded;
+    bool m_journalReplayed;
+    QVariantList m_items;
+    int m_loadedCount;
+    int m_itemCount;
+    int m_loadId;
+
+    QThreadPool m_loadPool;
+    QTimer m_timerInsert;
+};
+
+#endif // ITEMBACKGROUNDLOADER_H
@@ -0,0 +1,90 @@
+/*
+    Copyright (c) 2016, Lukas Holecek <hluk@email.cz>
+
+    This file is part of CopyQ.
+
+    CopyQ is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    CopyQ is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with CopyQ.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "itembackgroundsaver.h"
+
+#include "item/clipboardmodel.h"
+#include "item/itemstore.h"
+
+#include <QRunnable>
+
+namespace {
+
+/// Saves copy of items from tab model in background.
+class ItemSaveTask : public QRunnable
+{
+public:
+    ItemSaveTask(ItemLoaderInterface *loader, const ClipboardModel &model)
+        : QRunnable()
+        , m_loader(loader)
+        , m_tabName(model.tabName())
+        , m_deduplicateItemData(model.deduplicateItemData())
+        , m_mapItemData(model.mapItemData())
+        , m_items()
+    {
+        m_items.reserve( model.rowCount() );
+        for (int row = 0; row < model.rowCount(); ++row)
+            m_items.append( model.rawItemData(row) );
+    }
+
+    void run()
+    {
+        // Model must be created in this thread.
+        ClipboardModel model;
+        model.setTabName(m_tabName);
+        model.setMaxItems( m_items.size() );
+        model.setDeduplicateItemData(m_deduplicateItemData);
+        model.setMapItemData(m_mapItemData);
+        model.insertItems(m_items, 0);
+        m_items.clear();
+
+        saveItems(model, m_loader);
+    }
+
+private:
+    ItemLoaderInterface *m_loader;
+    QString m_tabName;
+    bool m_deduplicateItemData;
+    bool m_mapItemData;
+    QList<QVariantMap> m_items;
+};
+
+} // namespace
+
+ItemBackgroundSaver::ItemBackgroundSaver(const ClipboardModel *model)
+    : m_model(model)
+    , m_savePool()
+{
+    m_savePool.setMaxThreadCount(1);
+}
+
+ItemBackgroundSaver::~ItemBackgroundSaver()
+{
+    waitForFinished();
+}
+
+void ItemBackgroundSaver::start(ItemLoaderInterface *loader)
+{
+    m_savePool.start( new ItemSaveTask(loader, *m_model) );
+}
+
+void ItemBackgroundSaver::waitForFinished()
+{
+    m_savePool.waitForDone();
+}
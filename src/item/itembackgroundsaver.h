@@ -0,0 +1,61 @@
+/*
+    Copyright (c) 2016, Lukas Holecek <hluk@email.cz>
+
+    This file is part of CopyQ.
+
+    CopyQ is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    CopyQ is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with CopyQ.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef ITEMBACKGROUNDSAVER_H
+#define ITEMBACKGROUNDSAVER_H
+
+#include <QThreadPool>
+
+class ClipboardModel;
+class ItemLoaderInterface;
+
+/**
+ * Saves items of ClipboardModel in other thread.
+ *
+ * Used for tabs with ItemLoaderInterface::canSaveItemsInBackground() so GUI
+ * doesn't wait until items are saved (e.g. encrypted).
+ *
+ * Items are copied when saving starts (data are implicitly shared so this is
+ * fast) and tab data file is replaced in the saving thread. Saves are processed
+ * in order so the last one always wins.
+ */
+class ItemBackgroundSaver
+{
+public:
+    explicit ItemBackgroundSaver(const ClipboardModel *model);
+
+    /** Waits until all items are saved. */
+    ~ItemBackgroundSaver();
+
+    /** Start saving current items in model using @a loader. */
+    void start(ItemLoaderInterface *loader);
+
+    /**
+     * Wait until all items are saved.
+     *
+     * Must be called before tab data file is read, moved or removed.
+     */
+    void waitForFinished();
+
+private:
+    const ClipboardModel *m_model;
+    QThreadPool m_savePool;
+};
+
+#endif // ITEMBACKGROUNDSAVER_H
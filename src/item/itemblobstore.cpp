@@ -0,0 +1,314 @@
+/*
+    Copyright (c) 2016, Lukas Holecek <hluk@email.cz>
+
+    This file is part of CopyQ.
+
+    CopyQ is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    CopyQ is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with CopyQ.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#include "itemblobstore.h"
+
+#include "common/config.h"
+#include "common/log.h"
+#include "item/mappeditemdata.h"
+
+#include <QCryptographicHash>
+#include <QDataStream>
+#include <QDateTime>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QHash>
+#include <QMutex>
+#include <QMutexLocker>
+#include <QSet>
+
+namespace {
+
+/// Unused blobs newer than this are not removed (may be referenced by file being saved).
+const int minAgeOfUnusedBlobSeconds = 60 * 60;
+
+/// Interval for removing unused blobs.
+const int removeUnusedBlobsIntervalSeconds = 60 * 60;
+
+/// Blob file starts with this byte if the data are compressed.
+const char blobCompressed = 1;
+const char blobUncompressed = 0;
+
+QMutex blobMutex;
+
+/// Blobs which may be referenced by tab data files being saved.
+QHash<QByteArray, int> &pendingBlobs()
+{
+    static QHash<QByteArray, int> blobs;
+    return blobs;
+}
+
+/// Blob IDs referenced by tab data file.
+struct TabFileBlobReferences
+{
+    QDateTime lastModified;
+    qint64 size;
+    /// Time when the file was read.
+    QDateTime readTime;
+    QList<QByteArray> ids;
+};
+
+/// Referenced blobs by tab data file path so unchanged files are not read again.
+QHash<QString, TabFileBlobReferences> &tabFileBlobReferences()
+{
+    static QHash<QString, TabFileBlobReferences> references;
+    return references;
+}
+
+QString itemBlobDirectoryPath()
+{
+    return getConfigurationFilePath("_blobs");
+}
+
+QString itemBlobFileName(const QByteArray &id)
+{
+    return itemBlobDirectoryPath() + '/' + QString::fromLatin1(id);
+}
+
+bool isValidItemBlobId(const QByteArray &id)
+{
+    if (id.size() != 40)
+        return false;
+
+    for (int i = 0; i < id.size(); ++i) {
+        const char c = id[i];
+        if ( !(c >= '0' && c <= '9') && !(c >= 'a' && c <= 'f') )
+            return false;
+    }
+
+    return true;
+}
+
+/**
+ * Return true if cached blob references for file are up to date.
+ *
+ * File modified shortly before it was read could have been modified again
+ * without changing its time and size so it's always read again.
+ */
+bool isUpToDate(const TabFileBlobReferences &references, const QFileInfo &info)
+{
+    return references.lastModified == info.lastModified()
+            && references.size == info.size()
+            && references.lastModified.secsTo(references.readTime) > 2;
+}
+
+/**
+ * Read IDs of blobs referenced by tab data file to @a references.
+ *
+ * @return false if file cannot be read
+ */
+bool readReferencedItemBlobs(const QFileInfo &info, TabFileBlobReferences *references)
+{
+    references->lastModified = info.lastModified();
+    references->size = info.size();
+    references->readTime = QDateTime::currentDateTime();
+    references->ids.clear();
+
+    QFile file( info.absoluteFilePath() );
+    if ( !file.open(QIODevice::ReadOnly) ) {
+        log( QString("Failed to read item blob references from \"%1\": %2")
+             .arg(file.fileName(), file.errorString()), LogError );
+        return false;
+    }
+
+    QDataStream stream(&file);
+    stream.setVersion(QDataStream::Qt_4_7);
+
+    qint32 mark;
+    stream >> mark;
+    if ( stream.status() != QDataStream::Ok || mark != itemBlobsMark )
+        return true;
+
+    if ( !readItemBlobIds(&stream, &references->ids) ) {
+        log( QString("Failed to read item blob references from \"%1\"")
+             .arg(file.fileName()), LogError );
+        return false;
+    }
+
+    return true;
+}
+
+/**
+ * Add IDs of blobs referenced by tab data files in settings directory to @a ids.
+ *
+ * @return false if some file cannot be read
+ */
+bool addReferencedItemBlobs(QSet<QByteArray> *ids)
+{
+    const QFileInfo tabFilePrefix( getConfigurationFilePath("_tab_") );
+    const QDir settingsDir( tabFilePrefix.absolutePath() );
+    const QStringList nameFilters( tabFilePrefix.fileName() + '*' );
+
+    // Keep only references of existing files.
+    QHash<QString, TabFileBlobReferences> &cachedReferences = tabFileBlobReferences();
+    QHash<QString, TabFileBlobReferences> references;
+
+    foreach ( const QFileInfo &info, settingsDir.entryInfoList(nameFilters, QDir::Files) ) {
+        const QString fileName = info.fileName();
+        // Skip item journals.
+        if ( !fileName.endsWith(".dat") && !fileName.endsWith(".tmp") )
+            continue;
+
+        TabFileBlobReferences &fileReferences = references[fileName];
+        const QHash<QString, TabFileBlobReferences>::const_iterator cached =
+                cachedReferences.constFind(fileName);
+        if ( cached != cachedReferences.constEnd() && isUpToDate(cached.value(), info) ) {
+            fileReferences = cached.value();
+        } else if ( !readReferencedItemBlobs(info, &fileReferences) ) {
+            cachedReferences.clear();
+            return false;
+        }
+
+        foreach (const QByteArray &id, fileReferences.ids)
+            ids->insert(id);
+    }
+
+    cachedReferences = references;
+    return true;
+}
+
+} // namespace
+
+QByteArray itemBlobId(const QByteArray &bytes)
+{
+    return QCryptographicHash::hash(bytes, QCryptographicHash::Sha1).toHex();
+}
+
+bool storeItemBlob(const QByteArray &id, const QByteArray &bytes, bool compress)
+{
+    QMutexLocker lock(&blobMutex);
+
+    const QString fileName = itemBlobFileName(id);
+    if ( QFile::exists(fileName) ) {
+        ++pendingBlobs()[id];
+        return true;
+    }
+
+    if ( !QDir().mkpath(itemBlobDirectoryPath()) ) {
+        log( QString("Failed to create directory for item blobs \"%1\"")
+             .arg(itemBlobDirectoryPath()), LogError );
+        return false;
+    }
+
+    // Write to temporary file first so incomplete blob is never used.
+    QFile file(fileName + ".tmp");
+    const QByteArray data = compress ? qCompress(bytes) : bytes;
+    const bool written = file.open(QIODevice::WriteOnly)
+            && file.putChar(compress ? blobCompressed : blobUncompressed)
+            && file.write(data) == data.size();
+    file.close();
+
+    if ( !written || !file.rename(fileName) ) {
+        log( QString("Failed to store item blob \"%1\": %2")
+             .arg(fileName, file.errorString()), LogError );
+        file.remove();
+        return false;
+    }
+
+    ++pendingBlobs()[id];
+    return true;
+}
+
+void releaseItemBlobs(const QList<QByteArray> &ids)
+{
+    QMutexLocker lock(&blobMutex);
+
+    QHash<QByteArray, int> &blobs = pendingBlobs();
+    foreach (const QByteArray &id, ids) {
+        QHash<QByteArray, int>::iterator it = blobs.find(id);
+        if ( it != blobs.end() && --it.value() <= 0 )
+            blobs.erase(it);
+    }
+}
+
+QVariant loadItemBlob(const QByteArray &id)
+{
+    if ( !isValidItemBlobId(id) )
+        return QVariant();
+
+    QFile file( itemBlobFileName(id) );
+    char compressed;
+    if ( !file.open(QIODevice::ReadOnly) || !file.getChar(&compressed) || file.size() > 0x7fffffff ) {
+        log( QString("Failed to load item blob \"%1\": %2")
+             .arg(file.fileName(), file.errorString()), LogError );
+        return QVariant();
+    }
+
+    MappedItemFormat format(
+                file.fileName(), 1, static_cast<int>(file.size() - 1), compressed == blobCompressed );
+    // Items referring to same blob share loaded data.
+    format.cacheKey = id;
+    return QVariant::fromValue(format);
+}
+
+void writeItemBlobIds(QDataStream *stream, const QList<QByteArray> &ids)
+{
+    *stream << ids;
+}
+
+bool readItemBlobIds(QDataStream *stream, QList<QByteArray> *ids)
+{
+    *stream >> *ids;
+    if ( stream->status() != QDataStream::Ok )
+        return false;
+
+    foreach (const QByteArray &id, *ids) {
+        if ( !isValidItemBlobId(id) )
+            return false;
+    }
+
+    return true;
+}
+
+void removeUnusedItemBlobs()
+{
+    QMutexLocker lock(&blobMutex);
+
+    static QDateTime lastRemoved;
+    const QDateTime now = QDateTime::currentDateTime();
+    if ( lastRemoved.isValid()
+         && lastRemoved.secsTo(now) < removeUnusedBlobsIntervalSeconds )
+    {
+        return;
+    }
+    lastRemoved = now;
+
+    const QDir blobDir( itemBlobDirectoryPath() );
+    if ( !blobDir.exists() )
+        return;
+
+    // Don't remove anything if it's not certain which blobs are used.
+    QSet<QByteArray> usedIds = pendingBlobs().keys().toSet();
+    if ( !addReferencedItemBlobs(&usedIds) )
+        return;
+
+    int removedCount = 0;
+    foreach ( const QFileInfo &info, blobDir.entryInfoList(QDir::Files) ) {
+        const QByteArray id = info.fileName().toLatin1();
+        if ( usedIds.contains(id) || info.lastModified().secsTo(now) < minAgeOfUnusedBlobSeconds )
+            continue;
+
+        if ( QFile::remove(info.absoluteFilePath()) )
+            ++removedCount;
+    }
+
+    COPYQ_LOG( QString("Removed %1 unused item blobs").arg(removedCount) );
+}
@@ -0,0 +1,84 @@
+/*
+    Copyright (c) 2016, Lukas Holecek <hluk@email.cz>
+
+    This file is part of CopyQ.
+
+    CopyQ is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    CopyQ is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with CopyQ.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#ifndef ITEMBLOBSTORE_H
+#define ITEMBLOBSTORE_H
+
+#include <QByteArray>
+#include <QList>
+#include <QVariant>
+
+class QDataStream;
+class QString;
+
+/**
+ * Content-addressed store of big item data shared by tabs.
+ *
+ * Each blob is a file in a directory next to tab data files named by SHA-1
+ * hash of the data, so same data saved in multiple tabs are stored only once.
+ *
+ * Tab data file referring to blobs starts with itemBlobsMark followed by list
+ * of referenced blob IDs. Blobs not referenced by any tab data file are removed
+ * by removeUnusedItemBlobs().
+ */
+
+/// Tab data file starts with this value (instead of number of items) if it refers to blobs.
+const qint32 itemBlobsMark = -3;
+
+/// Return ID of blob for @a bytes.
+QByteArray itemBlobId(const QByteArray &bytes);
+
+/**
+ * Store @a bytes as blob with given @a id (unless it already exists).
+ *
+ * The blob is not removed as unused until released with releaseItemBlobs().
+ *
+ * This function is thread-safe.
+ *
+ * @return false if the blob cannot be stored
+ */
+bool storeItemBlob(const QByteArray &id, const QByteArray &bytes, bool compress);
+
+/** Allow to remove blobs stored with storeItemBlob() if unused. */
+void releaseItemBlobs(const QList<QByteArray> &ids);
+
+/**
+ * Return data of blob which are loaded only when needed (see MappedItemFormat).
+ *
+ * @return invalid value if blob doesn't exist
+ */
+QVariant loadItemBlob(const QByteArray &id);
+
+/** Write list of blobs referenced from tab data file (after itemBlobsMark). */
+void writeItemBlobIds(QDataStream *stream, const QList<QByteArray> &ids);
+
+/** Read list of blobs referenced from tab data file (after itemBlobsMark). */
+bool readItemBlobIds(QDataStream *stream, QList<QByteArray> *ids);
+
+/**
+ * Remove blobs not referenced by any tab data file.
+ *
+ * Recently stored blobs are kept since these may be referenced by data file
+ * being saved. Runs at most once per hour; only tab data files changed since
+ * the last run are read again.
+ */
+void removeUnusedItemBlobs();
+
+#endif // ITEMBLOBSTORE_H
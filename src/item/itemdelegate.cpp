@@ -37,11 +37,8 @@ namespace {
 
 const char propertySelectedItem[] = "CopyQ_selected";
 
-inline void reset(ItemWidget **ptr, ItemWidget *value = NULL)
-{
-    delete *ptr;
-    *ptr = value != NULL ? value : NULL;
-}
+/// Height of rows if there is nothing better to estimate from.
+const int defaultRowHeight = 512;
 
 int itemMargin()
 {
@@ -61,6 +58,8 @@ ItemDelegate::ItemDelegate(QAbstractItemView *view, ItemFactory *itemFactory, QW
     , m_idealWidth(0)
     , m_vMargin( itemMargin() )
     , m_hMargin( m_vMargin * 2 + 6 )
+    , m_itemFont()
+    , m_itemPalette()
     , m_foundFont()
     , m_foundPalette()
     , m_rowNumberFont()
@@ -70,25 +69,32 @@ ItemDelegate::ItemDelegate(QAbstractItemView *view, ItemFactory *itemFactory, QW
     , m_antialiasing(true)
     , m_createSimpleItems(false)
     , m_cache()
+    , m_rowHeights()
+    , m_widgets()
+    , m_preloadedWidgets()
+    , m_editedItem(NULL)
 {
 }
 
 ItemDelegate::~ItemDelegate()
 {
+    invalidateCache();
 }
 
 QSize ItemDelegate::sizeHint(const QModelIndex &index) const
 {
     int row = index.row();
     if ( row < m_cache.size() ) {
-        const ItemWidget *w = m_cache[row];
-        if (w != NULL) {
-            QWidget *ww = w->widget();
-            return QSize( ww->width() + 2 * m_hMargin + rowNumberWidth(),
-                          qMax(ww->height() + 2 * m_vMargin, rowNumberHeight()) );
+        const CachedItem &item = m_cache[row];
+        const QSize size = item.widget != NULL ? item.widget->widget()->size() : item.size;
+        if ( size.isValid() ) {
+            const int height = qMax(size.height() + 2 * m_vMargin, rowNumberHeight());
+            m_rowHeights.setHeight(row, height);
+            return QSize( size.width() + 2 * m_hMargin + rowNumberWidth(), height );
         }
+        return QSize( 0, m_rowHeights.height(row) );
     }
-    return QSize(0, 512);
+    return QSize(0, defaultRowHeight);
 }
 
 QSize ItemDelegate::sizeHint(const QStyleOptionViewItem &,
@@ -113,7 +119,7 @@ void ItemDelegate::dataChanged(const QModelIndex &a, const QModelIndex &b)
     // - recalculate size only if item edited
     int row = a.row();
     if ( row == b.row() ) {
-        reset(&m_cache[row]);
+        resetCache(row);
         emit rowSizeChanged();
     }
 }
@@ -121,8 +127,10 @@ void ItemDelegate::dataChanged(const QModelIndex &a, const QModelIndex &b)
 void ItemDelegate::rowsRemoved(const QModelIndex &, int start, int end)
 {
     for( int i = end; i >= start; --i ) {
-        delete m_cache.takeAt(i);
+        resetCache(i);
+        m_cache.removeAt(i);
     }
+    m_rowHeights.remove(start, end - start + 1);
 }
 
 void ItemDelegate::rowsMoved(const QModelIndex &, int sourceStart, int sourceEnd,
@@ -131,6 +139,7 @@ void ItemDelegate::rowsMoved(const QModelIndex &, int sourceStart, int sourceEnd
     int dest = sourceStart < destinationRow ? destinationRow-1 : destinationRow;
     for( int i = sourceStart; i <= sourceEnd; ++i ) {
         m_cache.move(i,dest);
+        m_rowHeights.move(i,dest);
         ++dest;
     }
 }
@@ -138,14 +147,15 @@ void ItemDelegate::rowsMoved(const QModelIndex &, int sourceStart, int sourceEnd
 void ItemDelegate::rowsInserted(const QModelIndex &, int start, int end)
 {
     for( int i = start; i <= end; ++i )
-        m_cache.insert(i, NULL);
+        m_cache.insert( i, CachedItem() );
+    m_rowHeights.insert( start, end - start + 1, estimatedRowHeight() );
 }
 
 ItemWidget *ItemDelegate::cache(const QModelIndex &index)
 {
     int n = index.row();
 
-    ItemWidget *w = m_cache[n];
+    ItemWidget *w = m_cache[n].widget;
     if (w == NULL) {
         QWidget *parent = m_view->viewport();
         w = m_createSimpleItems
@@ -157,41 +167,120 @@ ItemWidget *ItemDelegate::cache(const QModelIndex &index)
     return w;
 }
 
+void ItemDelegate::preloadRow(const QModelIndex &index)
+{
+    const int row = index.row();
+
+    // Current and edited items are interactive so they need widget.
+    ItemWidget *w = m_cache[row].widget;
+    if ( m_view->currentIndex() == index || (w != NULL && w == m_editedItem) ) {
+        cache(index);
+        return;
+    }
+
+    if ( !updateRenderer(index) )
+        cache(index);
+}
+
+void ItemDelegate::releaseItemWidget(const QModelIndex &index)
+{
+    ItemWidget *w = m_cache[index.row()].widget;
+    if (w != NULL) {
+        w->setCurrent(false);
+        if (w != m_editedItem)
+            updateRenderer(index);
+    }
+}
+
 bool ItemDelegate::hasCache(const QModelIndex &index) const
 {
-    return m_cache[index.row()] != NULL;
+    const CachedItem &item = m_cache[index.row()];
+    return item.widget != NULL || item.size.isValid();
 }
 
 void ItemDelegate::setItemSizes(const QSize &size, int idealWidth)
 {
     const int margins = 2 * m_hMargin + rowNumberWidth();
-    m_maxSize.setWidth(size.width() - margins);
-    m_idealWidth = idealWidth - margins;
+    const int maxWidth = size.width() - margins;
+    idealWidth -= margins;
+    if ( m_maxSize.width() == maxWidth && m_idealWidth == idealWidth )
+        return;
+
+    m_maxSize.setWidth(maxWidth);
+    m_idealWidth = idealWidth;
 
+    // Items painted by renderers are laid out again lazily once they are preloaded.
     for( int i = 0; i < m_cache.length(); ++i ) {
-        ItemWidget *w = m_cache[i];
-        if (w != NULL)
-            w->updateSize(m_maxSize, m_idealWidth);
+        CachedItem &item = m_cache[i];
+        if (item.widget != NULL)
+            item.widget->updateSize(m_maxSize, m_idealWidth);
+        item.outdated = true;
     }
 }
 
 void ItemDelegate::updateRowPosition(int row, int y)
 {
-    ItemWidget *w = m_cache[row];
+    ItemWidget *w = m_cache[row].widget;
     if (w != NULL)
         w->widget()->move( QPoint(rowNumberWidth() + m_hMargin, y + m_vMargin) );
 }
 
 void ItemDelegate::setRowVisible(int row, bool visible)
 {
-    ItemWidget *w = m_cache[row];
-    if (w != NULL)
+    ItemWidget *w = m_cache[row].widget;
+    if (w != NULL) {
         w->widget()->setVisible(visible);
+        if (visible)
+            m_preloadedWidgets.insert(w);
+    }
+}
+
+void ItemDelegate::beginPreload()
+{
+    m_preloadedWidgets.clear();
+}
+
+void ItemDelegate::endPreload()
+{
+    foreach (ItemWidget *w, m_widgets) {
+        if ( !m_preloadedWidgets.contains(w) )
+            w->widget()->hide();
+    }
+
+    m_preloadedWidgets.clear();
+}
+
+int ItemDelegate::rowAt(int y, int spacing) const
+{
+    return m_rowHeights.rowAt(y, spacing);
+}
+
+int ItemDelegate::rowOffset(int row, int spacing) const
+{
+    return m_rowHeights.offset(row, spacing);
+}
+
+QVector<int> ItemDelegate::rowHeights(int rowCount) const
+{
+    QVector<int> heights( qMin(rowCount, m_rowHeights.count()) );
+    for (int i = 0; i < heights.size(); ++i)
+        heights[i] = m_rowHeights.height(i);
+    return heights;
+}
+
+void ItemDelegate::setEstimatedRowHeights(const QVector<int> &heights)
+{
+    const int count = qMin( heights.size(), m_cache.size() );
+    for (int i = 0; i < count; ++i) {
+        const CachedItem &item = m_cache[i];
+        if ( item.widget == NULL && !item.size.isValid() && heights[i] > 0 )
+            m_rowHeights.setHeight(i, heights[i]);
+    }
 }
 
 bool ItemDelegate::otherItemLoader(const QModelIndex &index, bool next)
 {
-    ItemWidget *w = m_cache[index.row()];
+    ItemWidget *w = cache(index);
     if (w != NULL) {
         ItemWidget *w2 = m_itemFactory->otherItemLoader(index, w, next, m_antialiasing);
         if (w2 != NULL) {
@@ -206,8 +295,9 @@ bool ItemDelegate::otherItemLoader(const QModelIndex &index, bool next)
 ItemEditorWidget *ItemDelegate::createCustomEditor(QWidget *parent, const QModelIndex &index,
                                                    bool editNotes)
 {
-    cache(index);
-    ItemEditorWidget *editor = new ItemEditorWidget(m_cache[index.row()], index, editNotes, parent);
+    m_editedItem = cache(index);
+    ItemEditorWidget *editor = new ItemEditorWidget(m_editedItem, index, editNotes, parent);
+    connect( editor, SIGNAL(destroyed()), this, SLOT(onEditorDestroyed()) );
     loadEditorSettings(editor);
     return editor;
 }
@@ -224,12 +314,20 @@ void ItemDelegate::highlightMatches(ItemWidget *itemWidget) const
     itemWidget->setHighlight(m_re, m_foundFont, m_foundPalette);
 }
 
+void ItemDelegate::onEditorDestroyed()
+{
+    m_editedItem = NULL;
+}
+
 void ItemDelegate::setIndexWidget(const QModelIndex &index, ItemWidget *w)
 {
-    reset(&m_cache[index.row()], w);
+    resetCache( index.row() );
+    m_cache[index.row()].widget = w;
     if (w == NULL)
         return;
 
+    m_widgets.insert(w);
+
     QWidget *ww = w->widget();
 
     // Try to get proper size by showing item momentarily.
@@ -244,6 +342,80 @@ void ItemDelegate::setIndexWidget(const QModelIndex &index, ItemWidget *w)
     emit rowSizeChanged();
 }
 
+bool ItemDelegate::updateRenderer(const QModelIndex &index)
+{
+    CachedItem &item = m_cache[index.row()];
+    if (item.noRenderer || m_createSimpleItems)
+        return false;
+
+    if (item.renderer == NULL) {
+        item.renderer = m_itemFactory->createRenderer(index);
+        if (item.renderer == NULL) {
+            item.noRenderer = true;
+            return false;
+        }
+        item.outdated = true;
+    }
+
+    if (item.outdated) {
+        const QSize size = item.renderer->layout(m_itemFont, m_maxSize, m_idealWidth);
+        // Try again later if item cannot be painted yet.
+        if ( !size.isValid() )
+            return false;
+        item.outdated = false;
+
+        const QSize oldSize = item.widget != NULL ? item.widget->widget()->size() : item.size;
+        item.size = size;
+        if (size != oldSize)
+            emit rowSizeChanged();
+    }
+
+    if (item.widget != NULL)
+        deleteWidget(&item);
+
+    return true;
+}
+
+void ItemDelegate::deleteWidget(CachedItem *item)
+{
+    ItemWidget *w = item->widget;
+    if (w == NULL)
+        return;
+
+    if (w == m_editedItem)
+        m_editedItem = NULL;
+    m_widgets.remove(w);
+    m_preloadedWidgets.remove(w);
+    item->widget = NULL;
+
+    // Widget can be in the middle of handling an event.
+    w->widget()->hide();
+    w->widget()->deleteLater();
+}
+
+void ItemDelegate::resetCache(int row)
+{
+    CachedItem &item = m_cache[row];
+    deleteWidget(&item);
+    delete item.renderer;
+    item = CachedItem();
+}
+
+void ItemDelegate::setWidgetSelected(QWidget *widget, bool selected) const
+{
+    if ( widget->property(propertySelectedItem) == selected )
+        return;
+
+    widget->setProperty(propertySelectedItem, selected);
+    if ( !widget->property("CopyQ_no_style").toBool() ) {
+        QStyle *style = m_view->style();
+        widget->setStyle(style);
+        foreach (QWidget *child, widget->findChildren<QWidget *>())
+            child->setStyle(style);
+        widget->update();
+    }
+}
+
 int ItemDelegate::rowNumberWidth() const
 {
     return m_showRowNumber ? m_rowNumberSize.width() : 0;
@@ -254,10 +426,16 @@ int ItemDelegate::rowNumberHeight() const
     return m_showRowNumber ? m_rowNumberSize.height() : 0;
 }
 
+int ItemDelegate::estimatedRowHeight() const
+{
+    const int count = m_rowHeights.count();
+    return count > 0 ? m_rowHeights.totalHeight() / count : defaultRowHeight;
+}
+
 void ItemDelegate::invalidateCache()
 {
     for( int i = 0; i < m_cache.length(); ++i )
-        reset(&m_cache[i]);
+        resetCache(i);
 }
 
 void ItemDelegate::setSearch(const QRegExp &re)
@@ -277,6 +455,15 @@ void ItemDelegate::setEditorStyle(const QFont &font, const QPalette &palette)
     m_editorPalette = palette;
 }
 
+void ItemDelegate::setItemStyle(const QFont &font, const QPalette &palette)
+{
+    m_itemFont = font;
+    m_itemPalette = palette;
+
+    for( int i = 0; i < m_cache.length(); ++i )
+        m_cache[i].outdated = true;
+}
+
 void ItemDelegate::setNumberStyle(const QFont &font, const QPalette &palette)
 {
     m_rowNumberFont = font;
@@ -303,8 +490,9 @@ void ItemDelegate::paint(QPainter *painter, const QStyleOptionViewItem &option,
                          const QModelIndex &index) const
 {
     int row = index.row();
-    ItemWidget *w = m_cache[row];
-    if (w == NULL)
+    const CachedItem &item = m_cache[row];
+    ItemWidget *w = item.widget;
+    if ( w == NULL && (item.renderer == NULL || !item.size.isValid()) )
         return;
 
     const QRect &rect = option.rect;
@@ -341,17 +529,19 @@ void ItemDelegate::paint(QPainter *painter, const QStyleOptionViewItem &option,
         painter->restore();
     }
 
+    /* paint item without widget */
+    if (w == NULL) {
+        item.renderer->setHighlight(m_re, m_foundFont, m_foundPalette);
+        painter->save();
+        painter->setFont(m_itemFont);
+        painter->setPen( m_itemPalette.color(isSelected ? QPalette::HighlightedText : QPalette::Text) );
+        item.renderer->paint( painter, QPoint(rowNumberWidth() + m_hMargin, rect.y() + m_vMargin) );
+        painter->restore();
+        return;
+    }
+
     highlightMatches(w);
 
     /* text color for selected/unselected item */
-    QWidget *ww = w->widget();
-    if ( ww->property(propertySelectedItem) != isSelected ) {
-        ww->setProperty(propertySelectedItem, isSelected);
-        if ( !ww->property("CopyQ_no_style").toBool() ) {
-            ww->setStyle(style);
-            foreach (QWidget *child, ww->findChildren<QWidget *>())
-                child->setStyle(style);
-            ww->update();
-        }
-    }
+    setWidgetSelected(w->widget(), isSelected);
 }
@@ -21,13 +21,16 @@
 #define ITEMDELEGATE_H
 
 #include "gui/theme.h"
+#include "item/rowheights.h"
 
 #include <QItemDelegate>
 #include <QRegExp>
+#include <QSet>
 
 class Item;
 class ItemEditorWidget;
 class ItemFactory;
+class ItemRenderer;
 class ItemWidget;
 class QAbstractItemView;
 
@@ -40,7 +43,14 @@ class QAbstractItemView;
  * an item returns some default value (so it doesn't have to render all items).
  *
  * Before calling paint() for an index item on given index must be cached
- * using cache().
+ * using preloadRow() or cache().
+ *
+ * Items which are not current or edited are painted directly in paint() by
+ * renderers provided by item loaders (see ItemLoaderInterface::createRenderer()).
+ * Other items are shown in item widgets.
+ *
+ * Row heights (measured or estimated) are kept in prefix-sum tree so row at
+ * given scroll offset is found in logarithmic time.
  */
 class ItemDelegate : public QItemDelegate
 {
@@ -73,6 +83,9 @@ class ItemDelegate : public QItemDelegate
         /** Editor widget style. */
         void setEditorStyle(const QFont &font, const QPalette &palette);
 
+        /** Style for items painted without widget (Text and HighlightedText colors). */
+        void setItemStyle(const QFont &font, const QPalette &palette);
+
         /** Item number style. */
         void setNumberStyle(const QFont &font, const QPalette &palette);
 
@@ -82,9 +95,19 @@ class ItemDelegate : public QItemDelegate
         /** Show simple items (single line describing content). */
         void setShowSimpleItems(bool showSimpleItems);
 
-        /** Return cached item, create it if it doesn't exist. */
+        /** Return item widget, create it if it doesn't exist. */
         ItemWidget *cache(const QModelIndex &index);
 
+        /**
+         * Prepare item for painting.
+         *
+         * Widget is created only for current item or if item cannot be painted by renderer.
+         */
+        void preloadRow(const QModelIndex &index);
+
+        /** Item is no longer current; replace its widget with renderer if possible. */
+        void releaseItemWidget(const QModelIndex &index);
+
         /** Return true only if item at index is already in cache. */
         bool hasCache(const QModelIndex &index) const;
 
@@ -106,6 +129,29 @@ class ItemDelegate : public QItemDelegate
         /** Show/hide row. */
         void setRowVisible(int row, bool visible);
 
+        /** Start preloading rows; widgets not shown until endPreload() are hidden. */
+        void beginPreload();
+
+        /** Hide widgets of rows not shown since beginPreload(). */
+        void endPreload();
+
+        /**
+         * Return first row which ends below @a y
+         * (@a spacing is added to height of each row).
+         *
+         * Returns row count if there is no such row.
+         */
+        int rowAt(int y, int spacing) const;
+
+        /** Return top of @a row (@a spacing is added to height of each preceding row). */
+        int rowOffset(int row, int spacing) const;
+
+        /** Return heights of all rows for given number of rows (measured or estimated). */
+        QVector<int> rowHeights(int rowCount) const;
+
+        /** Use estimated heights for rows which were not measured yet. */
+        void setEstimatedRowHeights(const QVector<int> &heights);
+
         /** Use next/previous item loader available for @a index. */
         bool otherItemLoader(const QModelIndex &index, bool next);
 
@@ -129,16 +175,43 @@ class ItemDelegate : public QItemDelegate
         /** Emitted if size of a widget has changed. */
         void rowSizeChanged();
 
+    private slots:
+        void onEditorDestroyed();
+
     protected:
         void paint(QPainter *painter, const QStyleOptionViewItem &option,
                    const QModelIndex &index) const;
 
     private:
+        /// Item widget and/or renderer with size of laid out item.
+        struct CachedItem {
+            CachedItem() : widget(NULL), renderer(NULL), noRenderer(false), outdated(false) {}
+            ItemWidget *widget;
+            ItemRenderer *renderer;
+            /// Size of item laid out by renderer.
+            QSize size;
+            /// Renderer is not available for the item.
+            bool noRenderer;
+            /// Item needs to be laid out again by renderer (e.g. item size changed).
+            bool outdated;
+        };
+
         void setIndexWidget(const QModelIndex &index, ItemWidget *w);
 
+        /// Lay out item by renderer and delete its widget; return false if item needs widget.
+        bool updateRenderer(const QModelIndex &index);
+
+        void deleteWidget(CachedItem *item);
+
+        void resetCache(int row);
+
+        void setWidgetSelected(QWidget *widget, bool selected) const;
+
         int rowNumberWidth() const;
         int rowNumberHeight() const;
 
+        int estimatedRowHeight() const;
+
         QAbstractItemView *m_view;
         ItemFactory *m_itemFactory;
         bool m_saveOnReturnKey;
@@ -148,6 +221,8 @@ class ItemDelegate : public QItemDelegate
         int m_vMargin;
         int m_hMargin;
 
+        QFont m_itemFont;
+        QPalette m_itemPalette;
         QFont m_foundFont;
         QPalette m_foundPalette;
         QFont m_editorFont;
@@ -159,7 +234,17 @@ class ItemDelegate : public QItemDelegate
         bool m_antialiasing;
         bool m_createSimpleItems;
 
-        QList<ItemWidget*> m_cache;
+        QList<CachedItem> m_cache;
+
+        /// Height of each row in m_cache; updated in sizeHint() once row is measured.
+        mutable RowHeights m_rowHeights;
+
+        /// Existing item widgets and widgets shown since beginPreload().
+        QSet<ItemWidget*> m_widgets;
+        QSet<ItemWidget*> m_preloadedWidgets;
+
+        /// Widget of item with open editor must be kept.
+        ItemWidget *m_editedItem;
 
         Theme m_theme;
 };
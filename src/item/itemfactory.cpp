@@ -24,7 +24,9 @@
 #include "common/contenttype.h"
 #include "common/log.h"
 #include "common/mimetypes.h"
+#include "gui/thumbnailcache.h"
 #include "item/itemwidget.h"
+#include "item/mappeditemdata.h"
 #include "item/serialize.h"
 #include "platform/platformnativeinterface.h"
 
@@ -48,25 +50,6 @@ bool priorityLessThan(const ItemLoaderInterface *lhs, const ItemLoaderInterface
     return lhs->priority() > rhs->priority();
 }
 
-void trySetPixmap(QLabel *label, const QVariantMap &data)
-{
-    static const QStringList imageFormats = QStringList()
-            << QString("image/svg+xml")
-            << QString("image/png")
-            << QString("image/bmp")
-            << QString("image/jpeg")
-            << QString("image/gif");
-
-    foreach (const QString &format, imageFormats) {
-        QPixmap pixmap;
-        if (pixmap.loadFromData(data.value(format).toByteArray())) {
-            const int height = label->contentsRect().height();
-            label->setPixmap(pixmap.scaledToHeight(height, Qt::SmoothTransformation));
-            break;
-        }
-    }
-}
-
 
 /** Sort plugins by prioritized list of names. */
 class PluginSorter {
@@ -98,12 +81,16 @@ private:
 };
 
 class DummyItem : public QLabel, public ItemWidget {
+    Q_OBJECT
+
 public:
     DummyItem(const QModelIndex &index, QWidget *parent)
         : QLabel(parent)
         , ItemWidget(this)
         , m_hasText(false)
         , m_data(index.data(contentType::data).toMap())
+        , m_itemHash(index.data(contentType::hash).toUInt())
+        , m_cacheOnDisk( index.model() && index.model()->property("cacheOnDisk").toBool() )
     {
         m_hasText = index.data(contentType::hasText).toBool();
         setMargin(0);
@@ -113,7 +100,12 @@ public:
         setFocusPolicy(Qt::NoFocus);
         setFixedHeight(sizeHint().height());
         setContextMenuPolicy(Qt::NoContextMenu);
-        trySetPixmap(this, m_data);
+
+        // Image is decoded in background if it's not cached.
+        if ( !trySetThumbnail() ) {
+            connect( ThumbnailCache::instance(), SIGNAL(thumbnailReady(uint)),
+                     this, SLOT(onThumbnailReady(uint)) );
+        }
     }
 
     QWidget *createEditor(QWidget *parent) const
@@ -133,10 +125,31 @@ public:
         }
     }
 
+private slots:
+    void onThumbnailReady(uint itemHash)
+    {
+        if (itemHash == m_itemHash)
+            trySetThumbnail();
+    }
+
 private:
+    bool trySetThumbnail()
+    {
+        const QSize size(0, contentsRect().height());
+        const QPixmap pixmap =
+                ThumbnailCache::instance()->thumbnail(m_itemHash, m_data, size, false, m_cacheOnDisk);
+        if ( pixmap.isNull() )
+            return false;
+
+        setPixmap(pixmap);
+        return true;
+    }
+
     bool m_hasText;
     QVariantMap m_data;
     QString m_imageFormat;
+    uint m_itemHash;
+    bool m_cacheOnDisk;
 };
 
 class DummyLoader : public ItemLoaderInterface
@@ -179,6 +192,10 @@ public:
         return serializeData(model, file);
     }
 
+    bool canJournalItems() const { return true; }
+
+    bool canLoadItemsInBackground() const { return true; }
+
     bool initializeTab(QAbstractItemModel *)
     {
         return true;
@@ -190,10 +207,37 @@ public:
         return re.indexIn(text) != -1;
     }
 
+    QString searchableText(const QVariantMap &itemData) const
+    {
+        return getTextData(itemData);
+    }
+
+    bool providesSearchableText() const { return true; }
+
 private:
     ItemFactory *m_factory;
 };
 
+/**
+ * Load text formats of item which are still in tab data file mapped to memory.
+ *
+ * Only big text can be mapped; other mapped formats (e.g. images) are not searched.
+ */
+QVariantMap withSearchedTextLoaded(const QVariantMap &itemData)
+{
+    QVariantMap data = itemData;
+
+    const char *formats[] = { mimeText, mimeUriList, mimeItemNotes };
+    for (size_t i = 0; i < sizeof(formats) / sizeof(formats[0]); ++i) {
+        const QString format(formats[i]);
+        const QVariant value = itemData.value(format);
+        if ( isMappedItemFormat(value) )
+            data.insert( format, loadItemFormat(value) );
+    }
+
+    return data;
+}
+
 } // namespace
 
 ItemFactory::ItemFactory(QObject *parent)
@@ -203,6 +247,9 @@ ItemFactory::ItemFactory(QObject *parent)
     , m_disabledLoaders()
     , m_loaderChildren()
 {
+    // Create thumbnail cache shared with plugins.
+    ThumbnailCache::instance();
+
     loadPlugins();
 
     if ( m_loaders.isEmpty() )
@@ -262,6 +309,29 @@ ItemWidget *ItemFactory::createSimpleItem(
     return createItem(m_dummyLoader, index, parent, antialiasing);
 }
 
+ItemRenderer *ItemFactory::createRenderer(const QModelIndex &index) const
+{
+    // Notes are shown in tool tip of item widget.
+    if ( index.data(contentType::hasNotes).toBool() )
+        return NULL;
+
+    const ItemLoaderList loaders = enabledLoaders();
+
+    foreach ( const ItemLoaderInterface *loader, loaders ) {
+        if ( loader->transformsItem(index) )
+            return NULL;
+    }
+
+    foreach ( const ItemLoaderInterface *loader, loaders ) {
+        bool handled = true;
+        ItemRenderer *renderer = loader->createRenderer(index, &handled);
+        if (renderer != NULL || handled)
+            return renderer;
+    }
+
+    return NULL;
+}
+
 QStringList ItemFactory::formatsToSave() const
 {
     QStringList formats;
@@ -303,13 +373,21 @@ bool ItemFactory::isLoaderEnabled(const ItemLoaderInterface *loader) const
 }
 
 ItemLoaderInterface *ItemFactory::loadItems(QAbstractItemModel *model, QFile *file)
+{
+    ItemLoaderInterface *loader = loaderForItems(file);
+    if (loader == NULL)
+        return NULL;
+
+    file->seek(0);
+    return loader->loadItems(model, file) ? loader : NULL;
+}
+
+ItemLoaderInterface *ItemFactory::loaderForItems(QFile *file) const
 {
     foreach ( ItemLoaderInterface *loader, enabledLoaders() ) {
         file->seek(0);
-        if ( loader->canLoadItems(file) ) {
-            file->seek(0);
-            return loader->loadItems(model, file) ? loader : NULL;
-        }
+        if ( loader->canLoadItems(file) )
+            return loader;
     }
 
     return NULL;
@@ -344,6 +422,53 @@ bool ItemFactory::matches(const QModelIndex &index, const QRegExp &re) const
     return false;
 }
 
+bool ItemFactory::matches(
+        const QVariantMap &itemData, const QRegExp &re, const ItemLoaderList &loaders)
+{
+    // Match formats if the filter expression contains single '/'.
+    if (re.pattern().count('/') == 1) {
+        foreach (const QString &format, itemData.keys()) {
+            if (re.exactMatch(format))
+                return true;
+        }
+    }
+
+    const QVariantMap data = withSearchedTextLoaded(itemData);
+    foreach ( const ItemLoaderInterface *loader, loaders ) {
+        if ( loader->providesSearchableText() && re.indexIn(loader->searchableText(data)) != -1 )
+            return true;
+    }
+
+    return false;
+}
+
+ItemLoaderList ItemFactory::loadersWithoutSearchableText() const
+{
+    ItemLoaderList loaders;
+    foreach ( ItemLoaderInterface *loader, enabledLoaders() ) {
+        if ( !loader->providesSearchableText() )
+            loaders.append(loader);
+    }
+    return loaders;
+}
+
+QString ItemFactory::searchableText(const QVariantMap &itemData) const
+{
+    const QVariantMap data = withSearchedTextLoaded(itemData);
+    QString text;
+
+    foreach ( const ItemLoaderInterface *loader, enabledLoaders() ) {
+        const QString loaderText = loader->searchableText(data);
+        if ( !loaderText.isEmpty() ) {
+            if ( !text.isEmpty() )
+                text.append('\n');
+            text.append(loaderText);
+        }
+    }
+
+    return text;
+}
+
 QString ItemFactory::scripts() const
 {
     QString script = "var plugins = {}\n";
@@ -354,6 +479,19 @@ QString ItemFactory::scripts() const
     return script;
 }
 
+QMap<QString, QObject*> ItemFactory::scriptableObjects() const
+{
+    QMap<QString, QObject*> objects;
+
+    foreach ( ItemLoaderInterface *loader, m_loaders ) {
+        QObject *object = loader->scriptableObject();
+        if (object)
+            objects.insert( loader->id(), object );
+    }
+
+    return objects;
+}
+
 QList<Command> ItemFactory::commands() const
 {
     QList<Command> commands;
@@ -483,3 +621,5 @@ void ItemFactory::addLoader(ItemLoaderInterface *loader)
     if (signaler)
         connect( signaler, SIGNAL(error(QString)), this, SIGNAL(error(QString)) );
 }
+
+#include "itemfactory.moc"
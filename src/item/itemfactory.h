@@ -28,6 +28,7 @@
 #include <QVector>
 
 class ItemLoaderInterface;
+class ItemRenderer;
 class ItemWidget;
 class QAbstractItemModel;
 class QFile;
@@ -71,6 +72,13 @@ public:
     ItemWidget *createSimpleItem(
             const QModelIndex &index, QWidget *parent, bool antialiasing);
 
+    /**
+     * Create renderer for item using appropriate loader (see ItemLoaderInterface::createRenderer()).
+     *
+     * @return NULL if item widget needs to be created instead
+     */
+    ItemRenderer *createRenderer(const QModelIndex &index) const;
+
     /**
      * Uses next/previous item loader to instantiate ItemWidget.
      */
@@ -118,6 +126,12 @@ public:
      */
     ItemLoaderInterface *loadItems(QAbstractItemModel *model, QFile *file);
 
+    /**
+     * Return plugin which can load items from @a file.
+     * @return NULL if no enabled plugin can load the items
+     */
+    ItemLoaderInterface *loaderForItems(QFile *file) const;
+
     /**
      * Initialize tab.
      * @return true only if any plugin (ItemLoaderInterface::initializeTab()) returned true
@@ -129,11 +143,43 @@ public:
      */
     bool matches(const QModelIndex &index, const QRegExp &re) const;
 
+    /**
+     * Return true if any of @a loaders matches item data (ItemLoaderInterface::searchableText()).
+     *
+     * Unlike matches(const QModelIndex &, const QRegExp &) this can be called
+     * from any thread with list of loaders from enabledLoaders(). Each thread
+     * must use its own copy of @a re.
+     *
+     * Loaders which don't provide searchable text are skipped
+     * (see ItemLoaderInterface::providesSearchableText()).
+     */
+    static bool matches(
+            const QVariantMap &itemData, const QRegExp &re, const ItemLoaderList &loaders);
+
+    /**
+     * Return enabled plugins which match items only in main thread
+     * (ItemLoaderInterface::providesSearchableText() is false).
+     */
+    ItemLoaderList loadersWithoutSearchableText() const;
+
+    /**
+     * Return text searched by enabled plugins (ItemLoaderInterface::searchableText()).
+     */
+    QString searchableText(const QVariantMap &itemData) const;
+
+    /** Return enabled plugins with dummy item loader. */
+    ItemLoaderList enabledLoaders() const;
+
     /**
      * Return script to run before client scripts.
      */
     QString scripts() const;
 
+    /**
+     * Return objects callable from scripts by plugin ID (see ItemLoaderInterface::scriptableObject()).
+     */
+    QMap<QString, QObject*> scriptableObjects() const;
+
     /**
      * Adds commands from scripts for command dialog.
      */
@@ -151,9 +197,6 @@ private slots:
 private:
     bool loadPlugins();
 
-    /** Return enabled plugins with dummy item loader. */
-    ItemLoaderList enabledLoaders() const;
-
     /** Calls ItemLoaderInterface::transform() for all plugins in reverse order. */
     ItemWidget *transformItem(ItemWidget *item, const QModelIndex &index);
 
@@ -0,0 +1,537 @@
+/*
+    Copyright (c) 2016, Lukas Holecek <hluk@email.cz>
+
+    This file is part of CopyQ.
+
+    CopyQ is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    CopyQ is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with CopyQ.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "itemjournal.h"
+
+#include "common/contenttype.h"
+#include "common/log.h"
+#include "item/clipboardmodel.h"
+#include "item/itemwidget.h"
+#include "item/serialize.h"
+
+#include <QCryptographicHash>
+#include <QDataStream>
+#include <QFile>
+#include <QFileInfo>
+#include <QRunnable>
+
+namespace {
+
+const quint32 journalMagic = 0xC09C7A11;
+const qint32 journalVersion = 1;
+
+/// Size of data file parts used to identify the file.
+const qint64 digestBlockSize = 1024 * 1024;
+
+/// Minimal journal size for compaction.
+const qint64 minJournalSizeToCompact = 512 * 1024;
+
+enum JournalRecordType {
+    RecordInsert = 1,
+    RecordUpdate = 2,
+    RecordRemove = 3,
+    RecordMove = 4
+};
+
+QString journalFileName(const QString &fileName)
+{
+    return fileName + ".journal";
+}
+
+void initStream(QDataStream *stream)
+{
+    stream->setVersion(QDataStream::Qt_4_7);
+}
+
+/// Identifies content of tab data file (size, beginning and end of the file).
+QByteArray dataFileDigest(const QString &fileName)
+{
+    QFile file(fileName);
+    if ( !file.open(QIODevice::ReadOnly) )
+        return QByteArray();
+
+    const qint64 size = file.size();
+
+    QCryptographicHash hash(QCryptographicHash::Sha1);
+    hash.addData( QByteArray::number(size) );
+    hash.addData( file.read(digestBlockSize) );
+
+    if (size > digestBlockSize) {
+        file.seek( qMax(digestBlockSize, size - digestBlockSize) );
+        hash.addData( file.readAll() );
+    }
+
+    return hash.result();
+}
+
+QByteArray journalHeader(const QByteArray &digest)
+{
+    QByteArray bytes;
+    QDataStream stream(&bytes, QIODevice::WriteOnly);
+    initStream(&stream);
+    stream << journalMagic << journalVersion << digest;
+    return bytes;
+}
+
+/// Opens journal and reads header; returns true only if journal belongs to data file.
+bool openJournal(QFile *journal, QDataStream *stream, const QByteArray &digest)
+{
+    if ( digest.isEmpty() || !journal->open(QIODevice::ReadOnly) )
+        return false;
+
+    stream->setDevice(journal);
+    initStream(stream);
+
+    quint32 magic;
+    qint32 version;
+    QByteArray journalDigest;
+    *stream >> magic >> version >> journalDigest;
+
+    return stream->status() == QDataStream::Ok
+            && magic == journalMagic
+            && version == journalVersion
+            && journalDigest == digest;
+}
+
+QByteArray createRecord(JournalRecordType type, int row, const QVariantMap &data)
+{
+    QByteArray bytes;
+    QDataStream stream(&bytes, QIODevice::WriteOnly);
+    initStream(&stream);
+    stream << static_cast<quint8>(type) << static_cast<qint32>(row);
+    serializeData(&stream, data);
+    return bytes;
+}
+
+QByteArray createRecord(JournalRecordType type, int row, int count)
+{
+    QByteArray bytes;
+    QDataStream stream(&bytes, QIODevice::WriteOnly);
+    initStream(&stream);
+    stream << static_cast<quint8>(type) << static_cast<qint32>(row) << static_cast<qint32>(count);
+    return bytes;
+}
+
+bool applyRecord(ClipboardModel *model, const QByteArray &record)
+{
+    QDataStream stream(record);
+    initStream(&stream);
+
+    quint8 type;
+    qint32 row;
+    stream >> type >> row;
+
+    const int rowCount = model->rowCount();
+
+    if (type == RecordInsert || type == RecordUpdate) {
+        QVariantMap data;
+        deserializeData(&stream, &data);
+        if ( stream.status() != QDataStream::Ok )
+            return false;
+
+        if (type == RecordInsert) {
+            if (row < 0 || row > rowCount)
+                return false;
+            model->insertItem(data, row);
+        } else {
+            if (row < 0 || row >= rowCount)
+                return false;
+            model->setData( model->index(row), data, contentType::data );
+        }
+
+        return true;
+    }
+
+    qint32 value;
+    stream >> value;
+    if ( stream.status() != QDataStream::Ok )
+        return false;
+
+    if (type == RecordRemove)
+        return row >= 0 && value > 0 && row + value <= rowCount && model->removeRows(row, value);
+
+    if (type == RecordMove)
+        return row >= 0 && row < rowCount && value >= 0 && value < rowCount && model->move(row, value);
+
+    return false;
+}
+
+bool replaceFile(const QString &fileName, QFile *newFile)
+{
+    QFile oldFile(fileName);
+    if ( oldFile.exists() && !oldFile.remove() ) {
+        log( QString("Failed to remove \"%1\": %2").arg(fileName, oldFile.errorString()), LogError );
+        return false;
+    }
+
+    if ( !newFile->rename(fileName) ) {
+        log( QString("Failed to rename \"%1\": %2").arg(newFile->fileName(), newFile->errorString()), LogError );
+        return false;
+    }
+
+    return true;
+}
+
+/// Saves items to temporary tab data file in background.
+class ItemJournalCompaction : public QRunnable
+{
+public:
+    ItemJournalCompaction(
+            ItemJournal *journal, int compactionId, const QString &fileName,
+            ItemLoaderInterface *loader, const QList<QVariantMap> &items,
+            bool deduplicateItemData, bool mapItemData)
+        : QRunnable()
+        , m_journal(journal)
+        , m_compactionId(compactionId)
+        , m_fileName(fileName)
+        , m_loader(loader)
+        , m_items(items)
+        , m_deduplicateItemData(deduplicateItemData)
+        , m_mapItemData(mapItemData)
+    {
+    }
+
+    void run()
+    {
+        // Model must be created in this thread.
+        ClipboardModel model;
+        model.setMaxItems( m_items.size() );
+        model.setDeduplicateItemData(m_deduplicateItemData);
+        model.setMapItemData(m_mapItemData);
+        for (int row = 0; row < m_items.size(); ++row)
+            model.insertItem( m_items[row], row );
+        m_items.clear();
+
+        QFile file(m_fileName + ".tmp");
+        bool saved = file.open(QIODevice::WriteOnly) && m_loader->saveItems(model, &file);
+        file.close();
+
+        const QByteArray digest = saved ? dataFileDigest(file.fileName()) : QByteArray();
+        saved = saved && !digest.isEmpty();
+
+        QMetaObject::invokeMethod( m_journal, "onCompactionFinished", Qt::QueuedConnection,
+                                   Q_ARG(int, m_compactionId),
+                                   Q_ARG(bool, saved),
+                                   Q_ARG(QByteArray, digest) );
+    }
+
+private:
+    ItemJournal *m_journal;
+    int m_compactionId;
+    QString m_fileName;
+    ItemLoaderInterface *m_loader;
+    QList<QVariantMap> m_items;
+    bool m_deduplicateItemData;
+    bool m_mapItemData;
+};
+
+} // namespace
+
+ItemJournal::ItemJournal(ClipboardModel *model)
+    : QObject()
+    , m_model(model)
+    , m_enabled(false)
+    , m_pending()
+    , m_compactionPool()
+    , m_compactedFileName()
+    , m_compactedJournalSize(0)
+    , m_compactionId(0)
+{
+    m_compactionPool.setMaxThreadCount(1);
+
+    connect( m_model, SIGNAL(rowsInserted(QModelIndex,int,int)),
+             SLOT(onRowsInserted(QModelIndex,int,int)) );
+    connect( m_model, SIGNAL(rowsAboutToBeRemoved(QModelIndex,int,int)),
+             SLOT(onRowsAboutToBeRemoved(QModelIndex,int,int)) );
+    connect( m_model, SIGNAL(rowsAboutToBeMoved(QModelIndex,int,int,QModelIndex,int)),
+             SLOT(onRowsAboutToBeMoved(QModelIndex,int,int,QModelIndex,int)) );
+    connect( m_model, SIGNAL(dataChanged(QModelIndex,QModelIndex)),
+             SLOT(onDataChanged(QModelIndex,QModelIndex)) );
+    connect( m_model, SIGNAL(unloaded()),
+             SLOT(onModelUnloaded()) );
+}
+
+ItemJournal::~ItemJournal()
+{
+    abortCompaction();
+}
+
+void ItemJournal::setEnabled(bool enabled)
+{
+    m_pending.clear();
+    abortCompaction();
+    m_enabled = enabled;
+}
+
+bool ItemJournal::flush(const QString &fileName)
+{
+    if (!m_enabled)
+        return false;
+
+    if ( m_pending.isEmpty() )
+        return true;
+
+    QFile journal( journalFileName(fileName) );
+    if ( !journal.open(QIODevice::Append) )
+        return false;
+
+    if ( journal.size() == 0 ) {
+        const QByteArray digest = dataFileDigest(fileName);
+        if ( digest.isEmpty() || journal.write(journalHeader(digest)) == -1 )
+            return false;
+    }
+
+    if ( journal.write(m_pending) != m_pending.size() ) {
+        log( QString("Failed to write item journal \"%1\": %2")
+             .arg(journal.fileName(), journal.errorString()), LogError );
+        return false;
+    }
+
+    COPYQ_LOG( QString("Tab \"%1\": Item changes appended to journal (%2 bytes)")
+               .arg(m_model->tabName()).arg(m_pending.size()) );
+
+    m_pending.clear();
+    return true;
+}
+
+bool ItemJournal::needsCompaction(const QString &fileName) const
+{
+    if ( isCompacting() )
+        return false;
+
+    const qint64 journalSize = QFileInfo( journalFileName(fileName) ).size();
+    return journalSize > minJournalSizeToCompact
+            && journalSize > QFileInfo(fileName).size() / 2;
+}
+
+void ItemJournal::compact(const QString &fileName, ItemLoaderInterface *loader)
+{
+    if ( !m_enabled || isCompacting() )
+        return;
+
+    // Snapshot items (data are implicitly shared and not loaded if mapped, so this is fast).
+    QList<QVariantMap> items;
+    items.reserve( m_model->rowCount() );
+    for (int row = 0; row < m_model->rowCount(); ++row)
+        items.append( m_model->rawItemData(row) );
+
+    m_compactedFileName = fileName;
+    m_compactedJournalSize = QFileInfo( journalFileName(fileName) ).size();
+
+    COPYQ_LOG( QString("Tab \"%1\": Compacting item journal").arg(m_model->tabName()) );
+
+    m_compactionPool.start(
+                new ItemJournalCompaction(
+                    this, ++m_compactionId, fileName, loader, items,
+                    m_model->deduplicateItemData(), m_model->mapItemData()) );
+}
+
+void ItemJournal::abortCompaction()
+{
+    if ( !isCompacting() )
+        return;
+
+    m_compactionPool.waitForDone();
+
+    // Tab data file and journal are still consistent without the new data file.
+    QFile::remove(m_compactedFileName + ".tmp");
+
+    m_compactedFileName.clear();
+    ++m_compactionId;
+}
+
+bool ItemJournal::replay(ClipboardModel *model, const QString &fileName)
+{
+    const QByteArray digest = dataFileDigest(fileName);
+    const QString journalName = journalFileName(fileName);
+
+    QFile journal(journalName);
+    QDataStream stream;
+
+    if ( !openJournal(&journal, &stream, digest) ) {
+        journal.close();
+
+        // New journal remains in temporary file if compaction was interrupted.
+        QFile journalTmp(journalName + ".tmp");
+        if ( !openJournal(&journalTmp, &stream, digest) ) {
+            journalTmp.close();
+            if ( journal.exists() || journalTmp.exists() ) {
+                COPYQ_LOG( QString("Tab \"%1\": Removing stale item journal").arg(model->tabName()) );
+                remove(fileName);
+            }
+            return true;
+        }
+
+        journalTmp.close();
+        if ( !replaceFile(journalName, &journalTmp) )
+            return false;
+
+        if ( !openJournal(&journal, &stream, digest) )
+            return false;
+    }
+
+    qint64 validSize = journal.pos();
+    int count = 0;
+    bool applied = true;
+
+    while ( !stream.atEnd() ) {
+        QByteArray record;
+        quint16 checksum;
+        stream >> record >> checksum;
+
+        // Tail of journal can be incomplete if application crashed while writing to it.
+        if ( stream.status() != QDataStream::Ok
+             || checksum != qChecksum(record.constData(), record.size()) )
+        {
+            log( QString("Tab \"%1\": Item journal is corrupted, dropping %2 bytes")
+                 .arg(model->tabName()).arg(journal.size() - validSize), LogWarning );
+            break;
+        }
+
+        if ( !applyRecord(model, record) ) {
+            log( QString("Tab \"%1\": Failed to apply item journal").arg(model->tabName()), LogError );
+            applied = false;
+            break;
+        }
+
+        validSize = journal.pos();
+        ++count;
+    }
+
+    const bool truncate = validSize < journal.size();
+    journal.close();
+
+    if (truncate)
+        journal.resize(validSize);
+
+    COPYQ_LOG( QString("Tab \"%1\": %2 changes loaded from item journal")
+               .arg(model->tabName()).arg(count) );
+
+    return applied;
+}
+
+void ItemJournal::remove(const QString &fileName)
+{
+    const QString journalName = journalFileName(fileName);
+    QFile::remove(journalName);
+    QFile::remove(journalName + ".tmp");
+}
+
+void ItemJournal::move(const QString &oldFileName, const QString &newFileName)
+{
+    const QString oldJournalName = journalFileName(oldFileName);
+    if ( !QFile::exists(oldJournalName) )
+        return;
+
+    const QString newJournalName = journalFileName(newFileName);
+    QFile::remove(newJournalName);
+    QFile::rename(oldJournalName, newJournalName);
+}
+
+void ItemJournal::onRowsInserted(const QModelIndex &, int start, int end)
+{
+    for (int row = start; row <= end; ++row) {
+        const QVariantMap data = m_model->data(m_model->index(row), contentType::data).toMap();
+        appendRecord( createRecord(RecordInsert, row, data) );
+    }
+}
+
+void ItemJournal::onRowsAboutToBeRemoved(const QModelIndex &, int start, int end)
+{
+    appendRecord( createRecord(RecordRemove, start, end - start + 1) );
+}
+
+void ItemJournal::onRowsAboutToBeMoved(
+        const QModelIndex &, int sourceStart, int sourceEnd,
+        const QModelIndex &, int destinationRow)
+{
+    // Record moves of single rows to their final positions (see ClipboardModel::move()).
+    const int count = sourceEnd - sourceStart + 1;
+    if (destinationRow < sourceStart) {
+        for (int i = 0; i < count; ++i)
+            appendRecord( createRecord(RecordMove, sourceStart + i, destinationRow + i) );
+    } else {
+        const int targetRow = destinationRow - count;
+        for (int i = count - 1; i >= 0; --i)
+            appendRecord( createRecord(RecordMove, sourceStart + i, targetRow + i) );
+    }
+}
+
+void ItemJournal::onDataChanged(const QModelIndex &topLeft, const QModelIndex &bottomRight)
+{
+    for (int row = topLeft.row(); row <= bottomRight.row(); ++row) {
+        const QVariantMap data = m_model->data(m_model->index(row), contentType::data).toMap();
+        appendRecord( createRecord(RecordUpdate, row, data) );
+    }
+}
+
+void ItemJournal::onModelUnloaded()
+{
+    setEnabled(false);
+}
+
+void ItemJournal::onCompactionFinished(int compactionId, bool saved, const QByteArray &digest)
+{
+    if (compactionId != m_compactionId)
+        return;
+
+    const QString fileName = m_compactedFileName;
+    m_compactedFileName.clear();
+
+    QFile file(fileName + ".tmp");
+
+    if (!saved) {
+        log( QString("Tab \"%1\": Failed to compact item journal").arg(m_model->tabName()), LogError );
+        file.remove();
+        return;
+    }
+
+    // New journal contains changes appended during compaction.
+    const QString journalName = journalFileName(fileName);
+    QFile journal(journalName);
+    QFile newJournal(journalName + ".tmp");
+    if ( !journal.open(QIODevice::ReadOnly)
+         || !journal.seek(m_compactedJournalSize)
+         || !newJournal.open(QIODevice::WriteOnly)
+         || newJournal.write(journalHeader(digest)) == -1
+         || newJournal.write(journal.readAll()) == -1 )
+    {
+        log( QString("Tab \"%1\": Failed to write item journal").arg(m_model->tabName()), LogError );
+        file.remove();
+        newJournal.remove();
+        return;
+    }
+    journal.close();
+    newJournal.close();
+
+    // Old journal is ignored (not matching the new data file) if this is interrupted.
+    if ( replaceFile(fileName, &file) && replaceFile(journalName, &newJournal) ) {
+        COPYQ_LOG( QString("Tab \"%1\": Item journal compacted").arg(m_model->tabName()) );
+    }
+}
+
+void ItemJournal::appendRecord(const QByteArray &record)
+{
+    if (!m_enabled)
+        return;
+
+    QDataStream stream(&m_pending, QIODevice::Append);
+    initStream(&stream);
+    stream << record << qChecksum( record.constData(), record.size() );
+}
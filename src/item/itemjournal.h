@@ -0,0 +1,127 @@
+/*
+    Copyright (c) 2016, Lukas Holecek <hluk@email.cz>
+
+    This file is part of CopyQ.
+
+    CopyQ is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    CopyQ is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with CopyQ.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef ITEMJOURNAL_H
+#define ITEMJOURNAL_H
+
+#include <QByteArray>
+#include <QObject>
+#include <QString>
+#include <QThreadPool>
+
+class ClipboardModel;
+class ItemLoaderInterface;
+class QModelIndex;
+
+/**
+ * Journal of changes in ClipboardModel appended to file next to tab data file.
+ *
+ * Instead of saving all items on every change, records for inserted, changed,
+ * moved and removed items are appended to the journal. Once the journal grows
+ * too big, all items are saved again (compacted) in a background thread.
+ *
+ * Journal header identifies the tab data file it applies to, so a stale journal
+ * (e.g. after crash while saving items) is never replayed.
+ *
+ * Journal is used only for tabs with ItemLoaderInterface::canJournalItems().
+ */
+class ItemJournal : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit ItemJournal(ClipboardModel *model);
+
+    /** Waits for compaction and drops its result if not yet finished. */
+    ~ItemJournal();
+
+    /**
+     * Start or stop recording changes.
+     *
+     * Stopping drops recorded changes and aborts compaction.
+     */
+    void setEnabled(bool enabled);
+
+    bool isEnabled() const { return m_enabled; }
+
+    /** Return true if there are recorded changes not yet in journal file. */
+    bool hasPendingChanges() const { return !m_pending.isEmpty(); }
+
+    /**
+     * Append recorded changes to journal for tab data file @a fileName.
+     *
+     * @return false if items must be saved using ItemLoaderInterface::saveItems()
+     */
+    bool flush(const QString &fileName);
+
+    /** Return true if journal for @a fileName is too big compared to the data file. */
+    bool needsCompaction(const QString &fileName) const;
+
+    /**
+     * Save all items using @a loader in background and start new journal afterwards.
+     *
+     * Changes recorded in the meantime are appended to the new journal.
+     */
+    void compact(const QString &fileName, ItemLoaderInterface *loader);
+
+    bool isCompacting() const { return !m_compactedFileName.isEmpty(); }
+
+    /** Wait for compaction to finish and drop its result. */
+    void abortCompaction();
+
+    /**
+     * Apply journal for tab data file @a fileName to @a model.
+     *
+     * Stale journal is removed, corrupted tail of journal (e.g. after crash) is truncated.
+     *
+     * @return false if journal couldn't be fully applied
+     */
+    static bool replay(ClipboardModel *model, const QString &fileName);
+
+    /** Remove journal (after all items were saved to @a fileName). */
+    static void remove(const QString &fileName);
+
+    /** Move journal along with tab data file. */
+    static void move(const QString &oldFileName, const QString &newFileName);
+
+private slots:
+    void onRowsInserted(const QModelIndex &parent, int start, int end);
+    void onRowsAboutToBeRemoved(const QModelIndex &parent, int start, int end);
+    void onRowsAboutToBeMoved(
+            const QModelIndex &sourceParent, int sourceStart, int sourceEnd,
+            const QModelIndex &destinationParent, int destinationRow);
+    void onDataChanged(const QModelIndex &topLeft, const QModelIndex &bottomRight);
+    void onModelUnloaded();
+
+    void onCompactionFinished(int compactionId, bool saved, const QByteArray &digest);
+
+private:
+    void appendRecord(const QByteArray &record);
+
+    ClipboardModel *m_model;
+    bool m_enabled;
+    QByteArray m_pending;
+
+    QThreadPool m_compactionPool;
+    QString m_compactedFileName;
+    qint64 m_compactedJournalSize;
+    int m_compactionId;
+};
+
+#endif // ITEMJOURNAL_H
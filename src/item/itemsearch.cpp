@@ -0,0 +1,306 @@
+/*
+    Copyright (c) 2016, Lukas Holecek <hluk@email.cz>
+
+    This file is part of CopyQ.
+
+    CopyQ is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    CopyQ is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with CopyQ.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#include "itemsearch.h"
+
+#include "item/clipboardmodel.h"
+#include "item/itemfactory.h"
+#include "item/itemwidget.h"
+
+#include <QRunnable>
+
+namespace {
+
+/// Number of items searched in single thread task.
+const int searchChunkSize = 256;
+
+typedef QSharedPointer<QAtomicInt> CancelFlag;
+
+bool isCancelled(const CancelFlag &cancelled)
+{
+    return cancelled->fetchAndAddRelaxed(0) != 0;
+}
+
+int rowAfterMove(int row, int sourceStart, int sourceEnd, int destinationRow)
+{
+    const int count = sourceEnd - sourceStart + 1;
+
+    if (row >= sourceStart && row <= sourceEnd) {
+        const int targetRow = destinationRow > sourceStart ? destinationRow - count : destinationRow;
+        return targetRow + row - sourceStart;
+    }
+
+    if (destinationRow > sourceEnd && row > sourceEnd && row < destinationRow)
+        return row - count;
+
+    if (destinationRow < sourceStart && row >= destinationRow && row < sourceStart)
+        return row + count;
+
+    return row;
+}
+
+class ItemSearchTask : public QRunnable
+{
+public:
+    ItemSearchTask(
+            ItemSearch *target, int searchId, int chunk, int firstItem,
+            const QList<QVariantMap> &items, const QRegExp &re,
+            const ItemLoaderList &loaders, const CancelFlag &cancelled)
+        : QRunnable()
+        , m_target(target)
+        , m_searchId(searchId)
+        , m_chunk(chunk)
+        , m_firstItem(firstItem)
+        , m_items(items)
+        , m_re(re)
+        , m_loaders(loaders)
+        , m_cancelled(cancelled)
+    {
+    }
+
+    void run()
+    {
+        // Each thread needs its own copy of regular expression.
+        const QRegExp re(m_re.pattern(), m_re.caseSensitivity(), m_re.patternSyntax());
+
+        QVariantList matchedItems;
+        for (int i = 0; i < m_items.size(); ++i) {
+            if ( isCancelled(m_cancelled) )
+                return;
+
+            if ( ItemFactory::matches(m_items[i], re, m_loaders) )
+                matchedItems.append(m_firstItem + i);
+        }
+
+        QMetaObject::invokeMethod( m_target, "onChunkSearched", Qt::QueuedConnection,
+                                   Q_ARG(int, m_searchId),
+                                   Q_ARG(int, m_chunk),
+                                   Q_ARG(QVariantList, matchedItems) );
+    }
+
+private:
+    ItemSearch *m_target;
+    int m_searchId;
+    int m_chunk;
+    int m_firstItem;
+    QList<QVariantMap> m_items;
+    QRegExp m_re;
+    ItemLoaderList m_loaders;
+    CancelFlag m_cancelled;
+};
+
+} // namespace
+
+ItemSearch::ItemSearch(ClipboardModel *model, ItemFactory *factory)
+    : QObject()
+    , m_model(model)
+    , m_factory(factory)
+    , m_searching(false)
+    , m_searchId(0)
+    , m_cancelled()
+    , m_re()
+    , m_mainThreadLoaders()
+    , m_rows()
+    , m_chunkResults()
+    , m_nextChunk(0)
+    , m_chunkCount(0)
+    , m_searchPool()
+{
+    connect( m_model, SIGNAL(rowsInserted(QModelIndex,int,int)),
+             SLOT(onRowsInserted(QModelIndex,int,int)) );
+    connect( m_model, SIGNAL(rowsAboutToBeRemoved(QModelIndex,int,int)),
+             SLOT(onRowsAboutToBeRemoved(QModelIndex,int,int)) );
+    connect( m_model, SIGNAL(rowsAboutToBeMoved(QModelIndex,int,int,QModelIndex,int)),
+             SLOT(onRowsAboutToBeMoved(QModelIndex,int,int,QModelIndex,int)) );
+    connect( m_model, SIGNAL(dataChanged(QModelIndex,QModelIndex)),
+             SLOT(onDataChanged(QModelIndex,QModelIndex)) );
+    connect( m_model, SIGNAL(unloaded()),
+             SLOT(onModelUnloaded()) );
+}
+
+ItemSearch::~ItemSearch()
+{
+    abort();
+    m_searchPool.waitForDone();
+}
+
+void ItemSearch::start(const QRegExp &re, const QList<int> &rows)
+{
+    abort();
+
+    m_searching = true;
+    m_cancelled = CancelFlag(new QAtomicInt(0));
+    m_rows = rows.toVector();
+    m_nextChunk = 0;
+    m_chunkCount = (rows.size() + searchChunkSize - 1) / searchChunkSize;
+
+    if (m_chunkCount == 0) {
+        m_searching = false;
+        emit finished();
+        return;
+    }
+
+    m_re = re;
+    m_mainThreadLoaders = m_factory->loadersWithoutSearchableText();
+    const ItemLoaderList loaders = m_factory->enabledLoaders();
+
+    for (int chunk = 0; chunk < m_chunkCount; ++chunk) {
+        const int firstItem = chunk * searchChunkSize;
+        const int end = qMin(firstItem + searchChunkSize, m_rows.size());
+
+        // Data are implicitly shared so this is fast.
+        QList<QVariantMap> items;
+        for (int i = firstItem; i < end; ++i)
+            items.append( m_model->rawItemData(m_rows[i]) );
+
+        m_searchPool.start( new ItemSearchTask(
+                    this, m_searchId, chunk, firstItem, items, re, loaders, m_cancelled) );
+    }
+}
+
+void ItemSearch::abort()
+{
+    if (!m_searching)
+        return;
+
+    // Threads stop early and results already passed from threads are ignored.
+    m_cancelled->fetchAndStoreRelaxed(1);
+    ++m_searchId;
+
+    m_searching = false;
+    m_rows.clear();
+    m_chunkResults.clear();
+}
+
+int ItemSearch::searchedItemCount() const
+{
+    return qMin(m_nextChunk * searchChunkSize, m_rows.size());
+}
+
+int ItemSearch::lastSearchedRow() const
+{
+    for (int i = searchedItemCount() - 1; i >= 0; --i) {
+        if (m_rows[i] != -1)
+            return m_rows[i];
+    }
+
+    return -1;
+}
+
+void ItemSearch::onChunkSearched(int searchId, int chunk, const QVariantList &matchedItems)
+{
+    if (searchId != m_searchId)
+        return;
+
+    m_chunkResults.insert(chunk, matchedItems);
+
+    // Report results in order of rows.
+    QList<int> matchedRows;
+    while ( m_chunkResults.contains(m_nextChunk) ) {
+        const QVariantList items = m_chunkResults.take(m_nextChunk);
+
+        if ( m_mainThreadLoaders.isEmpty() ) {
+            foreach (const QVariant &item, items) {
+                const int row = m_rows[item.toInt()];
+                if (row != -1)
+                    matchedRows.append(row);
+            }
+        } else {
+            // Items not matched in other threads can still match in main thread.
+            const int firstItem = m_nextChunk * searchChunkSize;
+            const int end = qMin(firstItem + searchChunkSize, m_rows.size());
+            int j = 0;
+            for (int i = firstItem; i < end; ++i) {
+                const bool matched = j < items.size() && items[j].toInt() == i;
+                if (matched)
+                    ++j;
+
+                const int row = m_rows[i];
+                if ( row != -1 && (matched || matchesInMainThread(row)) )
+                    matchedRows.append(row);
+            }
+        }
+
+        ++m_nextChunk;
+    }
+
+    if (m_nextChunk == m_chunkCount)
+        m_searching = false;
+
+    emit itemsMatched(matchedRows);
+
+    if (!m_searching)
+        emit finished();
+}
+
+void ItemSearch::onRowsInserted(const QModelIndex &, int start, int end)
+{
+    const int count = end - start + 1;
+    for (int i = 0; i < m_rows.size(); ++i) {
+        if (m_rows[i] >= start)
+            m_rows[i] += count;
+    }
+}
+
+void ItemSearch::onRowsAboutToBeRemoved(const QModelIndex &, int start, int end)
+{
+    const int count = end - start + 1;
+    for (int i = 0; i < m_rows.size(); ++i) {
+        if (m_rows[i] > end)
+            m_rows[i] -= count;
+        else if (m_rows[i] >= start)
+            m_rows[i] = -1;
+    }
+}
+
+void ItemSearch::onRowsAboutToBeMoved(
+        const QModelIndex &, int sourceStart, int sourceEnd,
+        const QModelIndex &, int destinationRow)
+{
+    for (int i = 0; i < m_rows.size(); ++i) {
+        if (m_rows[i] != -1)
+            m_rows[i] = rowAfterMove(m_rows[i], sourceStart, sourceEnd, destinationRow);
+    }
+}
+
+void ItemSearch::onDataChanged(const QModelIndex &topLeft, const QModelIndex &bottomRight)
+{
+    // Changed items are filtered again by the view.
+    for (int i = 0; i < m_rows.size(); ++i) {
+        if (m_rows[i] >= topLeft.row() && m_rows[i] <= bottomRight.row())
+            m_rows[i] = -1;
+    }
+}
+
+void ItemSearch::onModelUnloaded()
+{
+    abort();
+}
+
+bool ItemSearch::matchesInMainThread(int row) const
+{
+    const QModelIndex index = m_model->index(row);
+    foreach ( const ItemLoaderInterface *loader, m_mainThreadLoaders ) {
+        if ( loader->matches(index, m_re) )
+            return true;
+    }
+
+    return false;
+}
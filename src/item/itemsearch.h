@@ -0,0 +1,126 @@
+/*
+    Copyright (c) 2016, Lukas Holecek <hluk@email.cz>
+
+    This file is part of CopyQ.
+
+    CopyQ is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    CopyQ is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with CopyQ.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#ifndef ITEMSEARCH_H
+#define ITEMSEARCH_H
+
+#include <QAtomicInt>
+#include <QList>
+#include <QMap>
+#include <QObject>
+#include <QRegExp>
+#include <QSharedPointer>
+#include <QThreadPool>
+#include <QVariantList>
+#include <QVector>
+
+class ClipboardModel;
+class ItemFactory;
+class ItemLoaderInterface;
+class QModelIndex;
+
+/**
+ * Searches items in ClipboardModel matching a filter using multiple threads.
+ *
+ * Item data are copied (implicitly shared) and split into chunks searched in
+ * parallel (see ItemFactory::matches(const QVariantMap &, const QRegExp &, const ItemLoaderList &)).
+ * Items not matched in other threads are matched in main thread by plugins
+ * which don't provide searchable text.
+ * Matching rows are reported in order of rows; rows are updated as the model
+ * changes during search. Items changed during search are not reported.
+ */
+class ItemSearch : public QObject
+{
+    Q_OBJECT
+
+public:
+    ItemSearch(ClipboardModel *model, ItemFactory *factory);
+
+    /** Cancels search and waits for threads. */
+    ~ItemSearch();
+
+    /**
+     * Start searching items in @a rows (sorted) matching @a re.
+     *
+     * Previous search is cancelled.
+     */
+    void start(const QRegExp &re, const QList<int> &rows);
+
+    /** Cancel search; results not yet reported are dropped. */
+    void abort();
+
+    bool isSearching() const { return m_searching; }
+
+    /** Number of items to search. */
+    int itemCount() const { return m_rows.size(); }
+
+    /** Number of searched items with reported results. */
+    int searchedItemCount() const;
+
+    /**
+     * Return last row for which search result was reported.
+     *
+     * All rows before it are searched. Returns -1 if no result was reported yet.
+     */
+    int lastSearchedRow() const;
+
+signals:
+    /** Emitted with next matching @a rows (ordered). */
+    void itemsMatched(const QList<int> &rows);
+
+    /** Emitted when all items are searched. */
+    void finished();
+
+private slots:
+    void onChunkSearched(int searchId, int chunk, const QVariantList &matchedItems);
+
+    void onRowsInserted(const QModelIndex &parent, int start, int end);
+    void onRowsAboutToBeRemoved(const QModelIndex &parent, int start, int end);
+    void onRowsAboutToBeMoved(
+            const QModelIndex &sourceParent, int sourceStart, int sourceEnd,
+            const QModelIndex &destinationParent, int destinationRow);
+    void onDataChanged(const QModelIndex &topLeft, const QModelIndex &bottomRight);
+    void onModelUnloaded();
+
+private:
+    bool matchesInMainThread(int row) const;
+
+    ClipboardModel *m_model;
+    ItemFactory *m_factory;
+
+    bool m_searching;
+    int m_searchId;
+    QSharedPointer<QAtomicInt> m_cancelled;
+
+    QRegExp m_re;
+    QVector<ItemLoaderInterface*> m_mainThreadLoaders;
+
+    /// Current row of each searched item (-1 if item was removed or changed).
+    QVector<int> m_rows;
+
+    /// Results of chunks searched out of order.
+    QMap<int, QVariantList> m_chunkResults;
+    int m_nextChunk;
+    int m_chunkCount;
+
+    QThreadPool m_searchPool;
+};
+
+#endif // ITEMSEARCH_H
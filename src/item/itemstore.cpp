@@ -21,12 +21,18 @@
 
 #include "common/common.h"
 #include "common/config.h"
+#include "common/contenttype.h"
 #include "common/log.h"
+#include "item/itemblobstore.h"
 #include "item/itemfactory.h"
+#include "item/itemjournal.h"
 #include "item/clipboardmodel.h"
 
+#include <QDataStream>
 #include <QDir>
 #include <QFile>
+#include <QHash>
+#include <QVector>
 
 namespace {
 
@@ -38,6 +44,15 @@ QString itemFileName(const QString &id)
     return getConfigurationFilePath("_tab_") + part + QString(".dat");
 }
 
+/// Version of file with item heights (item hashes since version 2, hash version since version 3).
+const qint32 itemHeightsVersion = 3;
+
+/// @return File name for item heights.
+QString itemHeightsFileName(const QString &tabFileName)
+{
+    return tabFileName + ".heights";
+}
+
 bool createItemDirectory()
 {
     QDir settingsDir( settingsDirectoryPath() );
@@ -78,9 +93,31 @@ bool needToSaveItemsAgain(const QAbstractItemModel &model, const ItemFactory &it
     return !saveWithCurrent;
 }
 
+/// Restore tab data file if saving items was interrupted.
+void restoreTemporaryItemFile(const QString &fileName)
+{
+    // Try to open temporary file if regular file doesn't exist.
+    if ( !QFile::exists(fileName) ) {
+        QFile tmpFile(fileName + ".tmp");
+        if ( tmpFile.exists() )
+            tmpFile.rename(fileName);
+    }
+}
+
+/// Apply journal to loaded items and drop items over the limit.
+bool replayJournal(ClipboardModel *model, const QString &fileName)
+{
+    const bool replayed = ItemJournal::replay(model, fileName);
+
+    if ( model->rowCount() > model->maxItems() )
+        model->removeRows( model->maxItems(), model->rowCount() - model->maxItems() );
+
+    return replayed;
+}
+
 } // namespace
 
-ItemLoaderInterface *loadItems(ClipboardModel &model, ItemFactory *itemFactory)
+ItemLoaderInterface *loadItems(ClipboardModel &model, ItemFactory *itemFactory, ItemJournal *journal)
 {
     if ( !createItemDirectory() )
         return NULL;
@@ -90,14 +127,10 @@ ItemLoaderInterface *loadItems(ClipboardModel &model, ItemFactory *itemFactory)
 
     // Load file with items.
     QFile file(fileName);
-    if ( !file.exists() ) {
-        // Try to open temporary file if regular file doesn't exist.
-        QFile tmpFile(fileName + ".tmp");
-        if ( tmpFile.exists() )
-            tmpFile.rename(fileName);
-    }
+    restoreTemporaryItemFile(fileName);
 
     ItemLoaderInterface *loader = NULL;
+    bool journalReplayed = true;
 
     model.setDisabled(true);
 
@@ -105,18 +138,72 @@ ItemLoaderInterface *loadItems(ClipboardModel &model, ItemFactory *itemFactory)
         COPYQ_LOG( QString("Tab \"%1\": Loading items").arg(tabName) );
         if ( file.open(QIODevice::ReadOnly) )
             loader = itemFactory->loadItems(&model, &file);
-        saveItemsWithOther(model, loader, itemFactory);
+        file.close();
+
+        if ( loader && loader->canJournalItems() )
+            journalReplayed = replayJournal(&model, fileName);
     } else {
         COPYQ_LOG( QString("Tab \"%1\": Creating new tab").arg(tabName) );
         if ( file.open(QIODevice::WriteOnly) ) {
             file.close();
             loader = itemFactory->initializeTab(&model);
-            saveItems(model, loader);
+            saveItems(model, loader, journal);
         }
     }
 
+    return finishLoadingItems(model, loader, journalReplayed, itemFactory, journal);
+}
+
+ItemLoaderInterface *backgroundItemLoader(const ClipboardModel &model, ItemFactory *itemFactory)
+{
+    const QString tabName = model.property("tabName").toString();
+    const QString fileName = itemFileName(tabName);
+
+    restoreTemporaryItemFile(fileName);
+
+    QFile file(fileName);
+    if ( !file.open(QIODevice::ReadOnly) )
+        return NULL;
+
+    ItemLoaderInterface *loader = itemFactory->loaderForItems(&file);
+    return loader && loader->canLoadItemsInBackground() ? loader : NULL;
+}
+
+bool loadItemsInBackground(ClipboardModel *model, ItemLoaderInterface *loader, bool *journalReplayed)
+{
+    const QString tabName = model->property("tabName").toString();
+    const QString fileName = itemFileName(tabName);
+
+    COPYQ_LOG( QString("Tab \"%1\": Loading items in background").arg(tabName) );
+
+    QFile file(fileName);
+    if ( !file.open(QIODevice::ReadOnly) || !loader->loadItems(model, &file) )
+        return false;
     file.close();
 
+    *journalReplayed = !loader->canJournalItems() || replayJournal(model, fileName);
+
+    return true;
+}
+
+ItemLoaderInterface *finishLoadingItems(
+        ClipboardModel &model, ItemLoaderInterface *loader, bool journalReplayed,
+        ItemFactory *itemFactory, ItemJournal *journal)
+{
+    const QString tabName = model.property("tabName").toString();
+
+    if ( loader && loader->canJournalItems() ) {
+        if (journalReplayed) {
+            if (journal)
+                journal->setEnabled(true);
+        } else {
+            // Save consistent state of items and drop rest of the journal.
+            saveItems(model, loader, journal);
+        }
+    }
+
+    saveItemsWithOther(model, loader, itemFactory, journal);
+
     if (loader) {
         COPYQ_LOG( QString("Tab \"%1\": %2 items loaded").arg(tabName).arg(model.rowCount()) );
     } else {
@@ -130,7 +217,7 @@ ItemLoaderInterface *loadItems(ClipboardModel &model, ItemFactory *itemFactory)
 }
 
 bool saveItems(
-        const ClipboardModel &model, ItemLoaderInterface *loader)
+        const ClipboardModel &model, ItemLoaderInterface *loader, ItemJournal *journal)
 {
     const QString tabName = model.property("tabName").toString();
     const QString fileName = itemFileName(tabName);
@@ -138,6 +225,20 @@ bool saveItems(
     if ( !createItemDirectory() )
         return false;
 
+    if ( journal && journal->isEnabled() && loader->canJournalItems() ) {
+        if ( journal->flush(fileName) ) {
+            if ( journal->needsCompaction(fileName) )
+                journal->compact(fileName, loader);
+            return true;
+        }
+
+        COPYQ_LOG( QString("Tab \"%1\": Failed to append to item journal").arg(tabName) );
+    }
+
+    // All items are saved so changes recorded so far are no longer needed.
+    if (journal)
+        journal->setEnabled(false);
+
     // Save to temp file.
     QFile file( fileName + ".tmp" );
     if ( !file.open(QIODevice::WriteOnly) ) {
@@ -150,12 +251,18 @@ bool saveItems(
     if ( loader->saveItems(model, &file) ) {
         // Overwrite previous file.
         QFile oldTabFile(fileName);
-        if (oldTabFile.exists() && !oldTabFile.remove())
+        if (oldTabFile.exists() && !oldTabFile.remove()) {
             printItemFileError(tabName, fileName, oldTabFile);
-        else if ( file.rename(fileName) )
+        } else if ( file.rename(fileName) ) {
+            // Journal would not match the new file but remove it anyway.
+            ItemJournal::remove(fileName);
+            if (journal)
+                journal->setEnabled( loader->canJournalItems() );
             COPYQ_LOG( QString("Tab \"%1\": Items saved").arg(tabName) );
-        else
+            removeUnusedItemBlobs();
+        } else {
             printItemFileError(tabName, fileName, file);
+        }
     } else {
         COPYQ_LOG( QString("Tab \"%1\": Failed to save items!").arg(tabName) );
     }
@@ -164,7 +271,8 @@ bool saveItems(
 }
 
 bool saveItemsWithOther(
-        ClipboardModel &model, ItemLoaderInterface *loader, ItemFactory *itemFactory)
+        ClipboardModel &model, ItemLoaderInterface *loader, ItemFactory *itemFactory,
+        ItemJournal *journal)
 {
     if ( !needToSaveItemsAgain(model, *itemFactory, loader) )
         return false;
@@ -174,9 +282,13 @@ bool saveItemsWithOther(
     COPYQ_LOG( QString("Tab \"%1\": Saving items using other plugin")
                .arg(model.property("tabName").toString()) );
 
+    // Items must be saved again (not only changes) with the other plugin.
+    if (journal)
+        journal->setEnabled(false);
+
     loader->uninitializeTab(&model);
     loader = itemFactory->initializeTab(&model);
-    if ( loader && saveItems(model, loader) ) {
+    if ( loader && saveItems(model, loader, journal) ) {
         model.setDisabled(false);
         return true;
     } else {
@@ -192,6 +304,9 @@ void removeItems(const QString &tabName)
     const QString tabFileName = itemFileName(tabName);
     QFile::remove(tabFileName);
     QFile::remove(tabFileName + ".tmp");
+    ItemJournal::remove(tabFileName);
+    QFile::remove( itemHeightsFileName(tabFileName) );
+    removeUnusedItemBlobs();
 }
 
 void moveItems(const QString &oldId, const QString &newId)
@@ -201,9 +316,96 @@ void moveItems(const QString &oldId, const QString &newId)
 
     if ( oldFileName != newFileName && QFile::copy(oldFileName, newFileName) ) {
         QFile::remove(oldFileName);
+        ItemJournal::move(oldFileName, newFileName);
+        QFile::remove( itemHeightsFileName(newFileName) );
+        QFile::rename( itemHeightsFileName(oldFileName), itemHeightsFileName(newFileName) );
     } else {
         COPYQ_LOG( QString("Failed to move items from \"%1\" (tab \"%2\") to \"%3\" (tab \"%4\")")
                    .arg(oldFileName).arg(oldId)
                    .arg(newFileName).arg(newId) );
     }
 }
+
+void saveItemHeights(
+        const QString &tabName, const ClipboardModel &model, const QVector<int> &heights,
+        QByteArray *savedHeights)
+{
+    const QString fileName = itemHeightsFileName( itemFileName(tabName) );
+
+    if ( heights.isEmpty() ) {
+        if ( !savedHeights->isEmpty() || QFile::exists(fileName) )
+            QFile::remove(fileName);
+        savedHeights->clear();
+        return;
+    }
+
+    // Heights are only estimates, saving them is not critical.
+    QVector<quint32> hashes( heights.size() );
+    QVector<quint16> values( heights.size() );
+    for (int i = 0; i < heights.size(); ++i) {
+        hashes[i] = model.index(i).data(contentType::hash).toUInt();
+        values[i] = static_cast<quint16>( qBound(0, heights[i], 0xffff) );
+    }
+
+    QByteArray bytes;
+    {
+        QDataStream stream(&bytes, QIODevice::WriteOnly);
+        stream << itemHeightsVersion << dataHashVersion << hashes << values;
+    }
+
+    // Avoid rewriting the file if neither items nor heights changed.
+    if (bytes == *savedHeights)
+        return;
+
+    if ( !createItemDirectory() )
+        return;
+
+    QFile file(fileName);
+    if ( !file.open(QIODevice::WriteOnly | QIODevice::Truncate) || file.write(bytes) != bytes.size() ) {
+        COPYQ_LOG( QString("Failed to save item heights to \"%1\": %2")
+                   .arg(fileName, file.errorString()) );
+        savedHeights->clear();
+        return;
+    }
+
+    *savedHeights = bytes;
+}
+
+QVector<int> loadItemHeights(
+        const QString &tabName, const ClipboardModel &model, QByteArray *savedHeights)
+{
+    savedHeights->clear();
+
+    QFile file( itemHeightsFileName(itemFileName(tabName)) );
+    if ( !file.open(QIODevice::ReadOnly) )
+        return QVector<int>();
+
+    const QByteArray bytes = file.readAll();
+    QDataStream stream(bytes);
+    qint32 version;
+    qint32 hashVersion;
+    QVector<quint32> hashes;
+    QVector<quint16> values;
+    stream >> version;
+    if (version != itemHeightsVersion)
+        return QVector<int>();
+    stream >> hashVersion;
+    if (hashVersion != dataHashVersion)
+        return QVector<int>();
+    stream >> hashes >> values;
+    if ( stream.status() != QDataStream::Ok || hashes.size() != values.size() )
+        return QVector<int>();
+
+    *savedHeights = bytes;
+
+    // Rows could have changed since heights were saved so match them by item hash.
+    QHash<quint32, int> heightForHash;
+    for (int i = 0; i < hashes.size(); ++i)
+        heightForHash.insert(hashes[i], values[i]);
+
+    QVector<int> heights( model.rowCount() );
+    for (int i = 0; i < heights.size(); ++i)
+        heights[i] = heightForHash.value( model.index(i).data(contentType::hash).toUInt(), 0 );
+
+    return heights;
+}
@@ -21,20 +21,64 @@
 
 class ClipboardModel;
 class ItemFactory;
+class ItemJournal;
 class ItemLoaderInterface;
+class QByteArray;
 class QString;
+template <typename T> class QVector;
 
-/** Load items from configuration file. */
+/**
+ * Load items from configuration file.
+ *
+ * If @a journal is set and the loader supports it, changes from journal are applied
+ * and @a journal starts recording new changes.
+ */
 ItemLoaderInterface *loadItems(ClipboardModel &model //!< Model for items.
-        , ItemFactory *itemFactory);
+        , ItemFactory *itemFactory, ItemJournal *journal = NULL);
 
-/** Save items to configuration file. */
+/**
+ * Return loader for items in configuration file if the items can be loaded
+ * in other thread using loadItemsInBackground().
+ *
+ * @return NULL if items must be loaded using loadItems()
+ */
+ItemLoaderInterface *backgroundItemLoader(const ClipboardModel &model, ItemFactory *itemFactory);
+
+/**
+ * Load items from configuration file in other thread.
+ *
+ * The @a model must be created in current thread and have same tab name and
+ * maximum number of items as the tab model.
+ *
+ * @a journalReplayed is set to false if items must be saved again because
+ * journal couldn't be applied.
+ *
+ * @return true only if items were loaded successfully
+ */
+bool loadItemsInBackground(ClipboardModel *model //!< Model for items.
+        , ItemLoaderInterface *loader, bool *journalReplayed);
+
+/**
+ * Finish loading items after all items loaded by loadItemsInBackground() were
+ * added to tab model.
+ *
+ * @return @a loader or NULL if loading failed (@a loader is NULL)
+ */
+ItemLoaderInterface *finishLoadingItems(ClipboardModel &model //!< Model for items.
+        , ItemLoaderInterface *loader, bool journalReplayed
+        , ItemFactory *itemFactory, ItemJournal *journal = NULL);
+
+/**
+ * Save items to configuration file.
+ *
+ * If @a journal is enabled, only changes are appended to journal file.
+ */
 bool saveItems(const ClipboardModel &model //!< Model containing items to save.
-        , ItemLoaderInterface *loader);
+        , ItemLoaderInterface *loader, ItemJournal *journal = NULL);
 
 /** Save items with other plugin with higher priority than current one (@a loader). */
 bool saveItemsWithOther(ClipboardModel &model //!< Model containing items to save.
-        , ItemLoaderInterface *loader, ItemFactory *itemFactory);
+        , ItemLoaderInterface *loader, ItemFactory *itemFactory, ItemJournal *journal = NULL);
 
 /** Remove configuration file for items. */
 void removeItems(const QString &tabName //!< See ClipboardBrowser::getID().
@@ -46,4 +90,28 @@ void moveItems(
         const QString &newId //!< See ClipboardBrowser::getID().
         );
 
+/**
+ * Save measured item heights so the tab can be laid out quickly when loaded again.
+ *
+ * Heights are saved with hashes of items in @a model.
+ *
+ * File is written only if its content would differ from @a savedHeights
+ * (content last saved or loaded) which is updated afterwards.
+ */
+void saveItemHeights(
+        const QString &tabName, const ClipboardModel &model, const QVector<int> &heights,
+        QByteArray *savedHeights);
+
+/**
+ * Load item heights saved with saveItemHeights() for items in @a model.
+ *
+ * Items are matched by hash; height of unknown item is 0.
+ *
+ * Content of loaded file is stored in @a savedHeights (see saveItemHeights()).
+ *
+ * @return empty list if heights are not available
+ */
+QVector<int> loadItemHeights(
+        const QString &tabName, const ClipboardModel &model, QByteArray *savedHeights);
+
 #endif // ITEMSTORE_H
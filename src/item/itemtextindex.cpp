@@ -0,0 +1,318 @@
+/*
+    Copyright (c) 2016, Lukas Holecek <hluk@email.cz>
+
+    This file is part of CopyQ.
+
+    CopyQ is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    CopyQ is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with CopyQ.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "itemtextindex.h"
+
+#include "common/log.h"
+#include "item/clipboardmodel.h"
+#include "item/itemfactory.h"
+
+#include <QElapsedTimer>
+#include <QRegExp>
+#include <QSet>
+#include <QStringList>
+#include <QtAlgorithms>
+
+namespace {
+
+/// Longer text is not indexed and such items can always match.
+const int maxIndexedTextLength = 64 * 1024;
+
+/// Rebuild the index if there are more stale items than this (or than current items).
+const int minStaleCountToRebuild = 1000;
+
+/**
+ * Get literal texts which must be matched in given order by @a re.
+ *
+ * Only expressions created from plain text in search bar (escaped words joined
+ * with ".*") are supported.
+ *
+ * @return false if expression is not supported
+ */
+bool literalsInExpression(const QRegExp &re, QStringList *literals)
+{
+    if ( re.patternSyntax() != QRegExp::RegExp && re.patternSyntax() != QRegExp::RegExp2 )
+        return false;
+
+    const QString pattern = re.pattern();
+
+    // Expression with single '/' matches also formats (see ItemFactory::matches()).
+    if ( pattern.count('/') == 1 )
+        return false;
+
+    const QString specialCharacters("$()*+.?[]^{|}");
+    QString literal;
+
+    for (int i = 0; i < pattern.size(); ++i) {
+        const QChar c = pattern[i];
+        if (c == '\\') {
+            ++i;
+            if ( i == pattern.size() || pattern[i].isLetterOrNumber() )
+                return false;
+            literal.append(pattern[i]);
+        } else if ( c == '.' && i + 1 < pattern.size() && pattern[i + 1] == '*' ) {
+            ++i;
+            literals->append(literal);
+            literal.clear();
+        } else if ( specialCharacters.contains(c) ) {
+            return false;
+        } else {
+            literal.append(c);
+        }
+    }
+
+    literals->append(literal);
+    return true;
+}
+
+/// Case-insensitive key for three characters starting at @a text.
+quint64 trigram(const QChar *text)
+{
+    return (quint64(text[0].toLower().unicode()) << 32)
+         | (quint64(text[1].toLower().unicode()) << 16)
+         | quint64(text[2].toLower().unicode());
+}
+
+void addTrigrams(const QString &text, QSet<quint64> *trigrams)
+{
+    const QChar *data = text.constData();
+    for (int i = 0; i + 2 < text.size(); ++i)
+        trigrams->insert( trigram(data + i) );
+}
+
+QVector<quint32> intersected(const QVector<quint32> &a, const QVector<quint32> &b)
+{
+    QVector<quint32> result;
+
+    int i = 0;
+    int j = 0;
+    while ( i < a.size() && j < b.size() ) {
+        if (a[i] < b[j]) {
+            ++i;
+        } else if (b[j] < a[i]) {
+            ++j;
+        } else {
+            result.append(a[i]);
+            ++i;
+            ++j;
+        }
+    }
+
+    return result;
+}
+
+bool hasLessItems(const QVector<quint32> *lhs, const QVector<quint32> *rhs)
+{
+    return lhs->size() < rhs->size();
+}
+
+} // namespace
+
+ItemTextIndex::ItemTextIndex(ClipboardModel *model, ItemFactory *factory)
+    : QObject()
+    , m_model(model)
+    , m_factory(factory)
+    , m_built(false)
+    , m_ids()
+    , m_nextId(0)
+    , m_postings()
+    , m_unindexed()
+    , m_staleCount(0)
+    , m_filterActive(false)
+    , m_filterNextId(0)
+    , m_candidates()
+{
+    connect( m_model, SIGNAL(rowsInserted(QModelIndex,int,int)),
+             SLOT(onRowsInserted(QModelIndex,int,int)) );
+    connect( m_model, SIGNAL(rowsAboutToBeRemoved(QModelIndex,int,int)),
+             SLOT(onRowsAboutToBeRemoved(QModelIndex,int,int)) );
+    connect( m_model, SIGNAL(rowsAboutToBeMoved(QModelIndex,int,int,QModelIndex,int)),
+             SLOT(onRowsAboutToBeMoved(QModelIndex,int,int,QModelIndex,int)) );
+    connect( m_model, SIGNAL(dataChanged(QModelIndex,QModelIndex)),
+             SLOT(onDataChanged(QModelIndex,QModelIndex)) );
+    connect( m_model, SIGNAL(unloaded()),
+             SLOT(onModelUnloaded()) );
+}
+
+void ItemTextIndex::invalidate()
+{
+    clearFilter();
+
+    m_built = false;
+    m_ids.clear();
+    m_postings.clear();
+    m_unindexed.clear();
+    m_staleCount = 0;
+}
+
+bool ItemTextIndex::setFilter(const QRegExp &re)
+{
+    clearFilter();
+
+    if ( re.isEmpty() )
+        return false;
+
+    QStringList literals;
+    if ( !literalsInExpression(re, &literals) )
+        return false;
+
+    QSet<quint64> trigrams;
+    foreach (const QString &literal, literals)
+        addTrigrams(literal, &trigrams);
+
+    if ( trigrams.isEmpty() )
+        return false;
+
+    if ( !m_built || m_staleCount > qMax(minStaleCountToRebuild, m_ids.size()) )
+        build();
+
+    QList<const QVector<quint32> *> postings;
+    foreach (quint64 key, trigrams) {
+        const QHash<quint64, QVector<quint32> >::const_iterator it = m_postings.constFind(key);
+        if ( it == m_postings.constEnd() ) {
+            postings.clear();
+            break;
+        }
+        postings.append( &it.value() );
+    }
+
+    if ( !postings.isEmpty() ) {
+        // Start with the smallest set of items.
+        qSort( postings.begin(), postings.end(), hasLessItems );
+        m_candidates = *postings[0];
+        for (int i = 1; i < postings.size() && !m_candidates.isEmpty(); ++i)
+            m_candidates = intersected(m_candidates, *postings[i]);
+    }
+
+    if ( !m_unindexed.isEmpty() ) {
+        m_candidates += m_unindexed;
+        qSort(m_candidates);
+    }
+
+    m_filterActive = true;
+    m_filterNextId = m_nextId;
+
+    return true;
+}
+
+bool ItemTextIndex::mayMatch(int row) const
+{
+    if ( !m_filterActive || row < 0 || row >= m_ids.size() )
+        return true;
+
+    const quint32 id = m_ids[row];
+    return id >= m_filterNextId
+        || qBinaryFind(m_candidates, id) != m_candidates.constEnd();
+}
+
+void ItemTextIndex::onRowsInserted(const QModelIndex &, int start, int end)
+{
+    if (!m_built)
+        return;
+
+    m_ids.insert(start, end - start + 1, 0);
+    for (int row = start; row <= end; ++row)
+        indexRow(row);
+}
+
+void ItemTextIndex::onRowsAboutToBeRemoved(const QModelIndex &, int start, int end)
+{
+    if (!m_built)
+        return;
+
+    const int count = end - start + 1;
+    m_ids.remove(start, count);
+    m_staleCount += count;
+}
+
+void ItemTextIndex::onRowsAboutToBeMoved(
+        const QModelIndex &, int sourceStart, int sourceEnd,
+        const QModelIndex &, int destinationRow)
+{
+    if (!m_built)
+        return;
+
+    const int count = sourceEnd - sourceStart + 1;
+    const QVector<quint32> ids = m_ids.mid(sourceStart, count);
+    m_ids.remove(sourceStart, count);
+
+    const int targetRow = destinationRow > sourceStart ? destinationRow - count : destinationRow;
+    for (int i = 0; i < count; ++i)
+        m_ids.insert(targetRow + i, ids[i]);
+}
+
+void ItemTextIndex::onDataChanged(const QModelIndex &topLeft, const QModelIndex &bottomRight)
+{
+    if (!m_built)
+        return;
+
+    for (int row = topLeft.row(); row <= bottomRight.row(); ++row) {
+        ++m_staleCount;
+        indexRow(row);
+    }
+}
+
+void ItemTextIndex::onModelUnloaded()
+{
+    invalidate();
+}
+
+void ItemTextIndex::build()
+{
+    QElapsedTimer t;
+    t.start();
+
+    invalidate();
+
+    const int rowCount = m_model->rowCount();
+    m_ids.resize(rowCount);
+    for (int row = 0; row < rowCount; ++row)
+        indexRow(row);
+
+    m_built = true;
+
+    COPYQ_LOG( QString("Tab \"%1\": Text of %2 items indexed in %3 ms")
+               .arg(m_model->tabName())
+               .arg(rowCount)
+               .arg(t.elapsed()) );
+}
+
+void ItemTextIndex::indexRow(int row)
+{
+    // IDs only increase so the lists in m_postings stay sorted.
+    const quint32 id = m_nextId++;
+    m_ids[row] = id;
+
+    const QString text = m_factory->searchableText( m_model->rawItemData(row) );
+    if (text.size() > maxIndexedTextLength) {
+        m_unindexed.append(id);
+        return;
+    }
+
+    QSet<quint64> trigrams;
+    addTrigrams(text, &trigrams);
+    foreach (quint64 key, trigrams)
+        m_postings[key].append(id);
+}
+
+void ItemTextIndex::clearFilter()
+{
+    m_filterActive = false;
+    m_candidates.clear();
+}
@@ -0,0 +1,105 @@
+/*
+    Copyright (c) 2016, Lukas Holecek <hluk@email.cz>
+
+    This file is part of CopyQ.
+
+    CopyQ is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    CopyQ is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with CopyQ.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef ITEMTEXTINDEX_H
+#define ITEMTEXTINDEX_H
+
+#include <QHash>
+#include <QObject>
+#include <QVector>
+
+class ClipboardModel;
+class ItemFactory;
+class QModelIndex;
+class QRegExp;
+class QString;
+
+/**
+ * Trigram index of text searched in items (see ItemFactory::searchableText()).
+ *
+ * Index is used to skip items which cannot match a filter without running
+ * the regular expression on them. Filter must contain literal text at least
+ * three characters long (e.g. filter created from plain text in search bar),
+ * otherwise all items can match.
+ *
+ * Index is created on first use and updated as the items change.
+ * It's dropped if the model is unloaded.
+ */
+class ItemTextIndex : public QObject
+{
+    Q_OBJECT
+
+public:
+    ItemTextIndex(ClipboardModel *model, ItemFactory *factory);
+
+    /** Drop the index (e.g. after plugins are enabled or disabled). */
+    void invalidate();
+
+    /**
+     * Find items which can match @a re (empty expression clears the filter).
+     *
+     * @return false if index cannot be used for @a re
+     */
+    bool setFilter(const QRegExp &re);
+
+    /**
+     * Return false if item in @a row cannot match filter set with setFilter().
+     *
+     * Items added or changed after setting the filter can match.
+     */
+    bool mayMatch(int row) const;
+
+private slots:
+    void onRowsInserted(const QModelIndex &parent, int start, int end);
+    void onRowsAboutToBeRemoved(const QModelIndex &parent, int start, int end);
+    void onRowsAboutToBeMoved(
+            const QModelIndex &sourceParent, int sourceStart, int sourceEnd,
+            const QModelIndex &destinationParent, int destinationRow);
+    void onDataChanged(const QModelIndex &topLeft, const QModelIndex &bottomRight);
+    void onModelUnloaded();
+
+private:
+    void build();
+    void indexRow(int row);
+    void clearFilter();
+
+    ClipboardModel *m_model;
+    ItemFactory *m_factory;
+
+    bool m_built;
+
+    /// Item ID for each row.
+    QVector<quint32> m_ids;
+    quint32 m_nextId;
+
+    /// Sorted item IDs for each trigram.
+    QHash<quint64, QVector<quint32> > m_postings;
+
+    /// Items with text too long to index.
+    QVector<quint32> m_unindexed;
+
+    /// Number of removed or changed items still in m_postings.
+    int m_staleCount;
+
+    bool m_filterActive;
+    quint32 m_filterNextId;
+    QVector<quint32> m_candidates;
+};
+
+#endif // ITEMTEXTINDEX_H
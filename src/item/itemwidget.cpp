@@ -284,6 +284,16 @@ bool ItemLoaderInterface::saveItems(const QAbstractItemModel &, QFile *)
     return false;
 }
 
+bool ItemLoaderInterface::canJournalItems() const
+{
+    return false;
+}
+
+bool ItemLoaderInterface::canLoadItemsInBackground() const
+{
+    return false;
+}
+
 bool ItemLoaderInterface::initializeTab(QAbstractItemModel *)
 {
     return false;
@@ -322,6 +332,11 @@ bool ItemLoaderInterface::matches(const QModelIndex &, const QRegExp &) const
     return false;
 }
 
+QString ItemLoaderInterface::searchableText(const QVariantMap &) const
+{
+    return QString();
+}
+
 QObject *ItemLoaderInterface::tests(const TestInterfacePtr &) const
 {
     return NULL;
@@ -337,7 +352,33 @@ QString ItemLoaderInterface::script() const
     return QString();
 }
 
+QObject *ItemLoaderInterface::scriptableObject()
+{
+    return NULL;
+}
+
 QList<Command> ItemLoaderInterface::commands() const
 {
     return QList<Command>();
 }
+
+bool ItemLoaderInterface::providesSearchableText() const
+{
+    return false;
+}
+
+bool ItemLoaderInterface::canSaveItemsInBackground() const
+{
+    return false;
+}
+
+ItemRenderer *ItemLoaderInterface::createRenderer(const QModelIndex &, bool *handled) const
+{
+    *handled = true;
+    return NULL;
+}
+
+bool ItemLoaderInterface::transformsItem(const QModelIndex &) const
+{
+    return false;
+}
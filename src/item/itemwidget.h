@@ -32,12 +32,17 @@ class QTextEdit;
 class QFile;
 class QFont;
 class QModelIndex;
+class QPainter;
 class QPalette;
+class QPoint;
 class QRegExp;
+class QSize;
 class QWidget;
 struct Command;
 
-#define COPYQ_PLUGIN_ITEM_LOADER_ID "org.CopyQ.ItemPlugin.ItemLoader/1.0"
+// Change version whenever ItemWidget or ItemLoaderInterface changes
+// (new virtual methods must be added at the end of the classes).
+#define COPYQ_PLUGIN_ITEM_LOADER_ID "org.CopyQ.ItemPlugin.ItemLoader/1.2"
 
 #if QT_VERSION < 0x050000
 #   define Q_PLUGIN_METADATA(x)
@@ -145,6 +150,36 @@ private:
     QWidget *m_widget;
 };
 
+/**
+ * Paints item without widget (see ItemLoaderInterface::createRenderer()).
+ */
+class ItemRenderer
+{
+public:
+    virtual ~ItemRenderer() {}
+
+    /**
+     * Lay out item for given maximum size and ideal width (see ItemWidget::updateSize()).
+     *
+     * @return item size or invalid size if item cannot be painted yet
+     *         (e.g. content is loaded asynchronously; widget is used until then)
+     */
+    virtual QSize layout(const QFont &font, const QSize &maximumSize, int idealWidth) = 0;
+
+    /**
+     * Paint laid out item with top-left corner at @a position.
+     *
+     * Painter pen is set to item text color.
+     */
+    virtual void paint(QPainter *painter, const QPoint &position) = 0;
+
+    /**
+     * Highlight matching text with given font and color.
+     * Default implementation does nothing.
+     */
+    virtual void setHighlight(const QRegExp &, const QFont &, const QPalette &) {}
+};
+
 class ItemLoaderInterface
 {
 public:
@@ -227,6 +262,11 @@ public:
 
     /**
      * Load items.
+     *
+     * If loading in background (see canLoadItemsInBackground()) and items are not journaled,
+     * QAbstractItemModel::submit() can be called after each fully loaded batch of items
+     * so these are shown in tab before loading finishes.
+     *
      * @return true only if items were saved by this plugin (or just not to load them any further)
      */
     virtual bool loadItems(QAbstractItemModel *model, QFile *file);
@@ -308,6 +348,92 @@ public:
      * Adds commands from scripts for command dialog.
      */
     virtual QList<Command> commands() const;
+
+    /**
+     * Return true if changes in items saved by saveItems() can be appended to journal file
+     * instead of saving all items each time (see ItemJournal).
+     *
+     * Journal contains item data so this must be false if data shouldn't be stored unchanged.
+     * Method saveItems() can be called from other thread if this returns true.
+     *
+     * Returns false by default.
+     */
+    virtual bool canJournalItems() const;
+
+    /**
+     * Return true if loadItems() can be called from other thread.
+     *
+     * Model passed to loadItems() belongs to that thread and its items are moved
+     * to the tab model afterwards so it must not be referenced after loading.
+     *
+     * Returns false by default.
+     */
+    virtual bool canLoadItemsInBackground() const;
+
+    /**
+     * Return all text searched by matches() in item data.
+     *
+     * If providesSearchableText() returns true, items are filtered using this
+     * text in multiple threads and the text is indexed to quickly skip items
+     * which cannot match a filter.
+     *
+     * This method must be thread-safe.
+     * Returns empty string by default.
+     */
+    virtual QString searchableText(const QVariantMap &itemData) const;
+
+    /**
+     * Return true if searchableText() returns all text matched by matches().
+     *
+     * Otherwise, items are matched using matches() in main thread.
+     *
+     * Returns false by default.
+     */
+    virtual bool providesSearchableText() const;
+
+    /**
+     * Return object with slots callable from scripts (by default null pointer).
+     *
+     * Object is available in scripts as "pluginObjects.<id>" (see id()).
+     * Slots are called from script threads so these must be thread-safe.
+     */
+    virtual QObject *scriptableObject();
+
+    /**
+     * Return true if saveItems() can be called from other thread.
+     *
+     * Items are then saved in background (see ItemBackgroundSaver) so that GUI
+     * doesn't wait for slow saving (e.g. encryption). Model passed to saveItems()
+     * is a copy of the tab model created in that thread.
+     *
+     * Returns false by default.
+     */
+    virtual bool canSaveItemsInBackground() const;
+
+    /**
+     * Create renderer which paints item without creating item widget.
+     *
+     * Items which are not current or edited are painted with renderers if
+     * available so that widgets don't need to be created while scrolling.
+     *
+     * Loaders are asked in same order as with create(). Set @a handled to
+     * false if create() would return NULL for @a index so next loader is
+     * asked; otherwise no other loader is asked and item widget is created
+     * if this returns NULL.
+     *
+     * By default returns NULL and sets @a handled to true.
+     */
+    virtual ItemRenderer *createRenderer(const QModelIndex &index, bool *handled) const;
+
+    /**
+     * Return true if transform() would transform item widget for @a index.
+     *
+     * Transformed items are not painted with renderers (see createRenderer()).
+     * Loaders which implement transform() must implement this too.
+     *
+     * Returns false by default.
+     */
+    virtual bool transformsItem(const QModelIndex &index) const;
 };
 
 Q_DECLARE_INTERFACE(ItemLoaderInterface, COPYQ_PLUGIN_ITEM_LOADER_ID)
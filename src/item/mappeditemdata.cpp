@@ -0,0 +1,205 @@
+/*
+    Copyright (c) 2016, Lukas Holecek <hluk@email.cz>
+
+    This file is part of CopyQ.
+
+    CopyQ is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    CopyQ is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with CopyQ.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "mappeditemdata.h"
+
+#include "common/datafingerprint.h"
+#include "common/log.h"
+
+#include <QHash>
+#include <QMutex>
+#include <QMutexLocker>
+#include <QObject>
+#include <QVariant>
+
+namespace {
+
+/// Guards loadedDataCache().
+QMutex loadedDataMutex;
+
+/**
+ * Loaded data shared by formats with same MappedItemFormat::cacheKey.
+ *
+ * Data are shared while used elsewhere (e.g. by items in multiple tabs
+ * referring to same blob). Data used only by the cache are dropped when new
+ * data are cached.
+ */
+QHash<QByteArray, QByteArray> &loadedDataCache()
+{
+    static QHash<QByteArray, QByteArray> cache;
+    return cache;
+}
+
+QByteArray loadFormat(const MappedItemFormat &format)
+{
+    if ( !format.file && !format.fileName.isEmpty() ) {
+        QFile f(format.fileName);
+        if ( !f.open(QIODevice::ReadOnly) || !f.seek(format.offset) ) {
+            log( QString("Failed to read item data from \"%1\": %2").arg(format.fileName, f.errorString()),
+                 LogError );
+            return QByteArray();
+        }
+
+        const QByteArray bytes = f.read(format.size);
+        if ( bytes.size() != format.size ) {
+            log( QString("Failed to read item data from \"%1\"").arg(format.fileName), LogError );
+            return QByteArray();
+        }
+
+        if (format.compressed) {
+            const QByteArray data = qUncompress(bytes);
+            if ( data.isEmpty() )
+                log( QObject::tr("Failed to decompress item data"), LogError );
+            return data;
+        }
+
+        return bytes;
+    }
+
+    if ( !format.file || !format.file->isMapped() || format.offset + format.size > format.file->size() )
+        return QByteArray();
+
+    const uchar *bytes = format.file->data() + format.offset;
+    if (format.compressed) {
+        const QByteArray data = qUncompress(bytes, format.size);
+        if ( data.isEmpty() )
+            log( QObject::tr("Failed to decompress item data"), LogError );
+        return data;
+    }
+
+    return QByteArray( reinterpret_cast<const char*>(bytes), format.size );
+}
+
+} // namespace
+
+MappedItemFile::MappedItemFile(const QString &fileName)
+    : m_file(fileName)
+    , m_data(NULL)
+    , m_size(0)
+{
+    if ( !m_file.open(QIODevice::ReadOnly) )
+        return;
+
+    m_size = m_file.size();
+    if (m_size > 0)
+        m_data = m_file.map(0, m_size);
+
+    if (m_data == NULL) {
+        COPYQ_LOG( QString("Failed to map file \"%1\": %2")
+                   .arg(fileName, m_file.errorString()) );
+        m_file.close();
+        m_size = 0;
+    }
+}
+
+MappedItemFormat::MappedItemFormat()
+    : file()
+    , fileName()
+    , offset(0)
+    , size(0)
+    , compressed(false)
+    , fingerprint(0)
+    , hasFingerprint(false)
+    , cacheKey()
+{
+}
+
+MappedItemFormat::MappedItemFormat(
+        const MappedItemFilePtr &file, qint64 offset, int size, bool compressed)
+    : file(file)
+    , fileName()
+    , offset(offset)
+    , size(size)
+    , compressed(compressed)
+    , fingerprint(0)
+    , hasFingerprint(false)
+    , cacheKey()
+{
+}
+
+MappedItemFormat::MappedItemFormat(
+        const QString &fileName, qint64 offset, int size, bool compressed)
+    : file()
+    , fileName(fileName)
+    , offset(offset)
+    , size(size)
+    , compressed(compressed)
+    , fingerprint(0)
+    , hasFingerprint(false)
+    , cacheKey()
+{
+}
+
+QByteArray MappedItemFormat::load() const
+{
+    if ( cacheKey.isEmpty() )
+        return loadFormat(*this);
+
+    QMutexLocker lock(&loadedDataMutex);
+
+    QHash<QByteArray, QByteArray> &cache = loadedDataCache();
+    const QHash<QByteArray, QByteArray>::const_iterator cached = cache.constFind(cacheKey);
+    if ( cached != cache.constEnd() )
+        return cached.value();
+
+    // Drop data no longer referenced from outside of the cache.
+    for ( QHash<QByteArray, QByteArray>::iterator it = cache.begin(); it != cache.end(); ) {
+        if ( it.value().isDetached() )
+            it = cache.erase(it);
+        else
+            ++it;
+    }
+
+    const QByteArray bytes = loadFormat(*this);
+    if ( !bytes.isEmpty() )
+        cache.insert(cacheKey, bytes);
+
+    return bytes;
+}
+
+void MappedItemFormat::setFingerprint(quint64 dataFingerprint)
+{
+    fingerprint = dataFingerprint;
+    hasFingerprint = true;
+}
+
+bool isMappedItemFormat(const QVariant &value)
+{
+    return value.userType() == qMetaTypeId<MappedItemFormat>();
+}
+
+QByteArray loadItemFormat(const QVariant &value)
+{
+    return isMappedItemFormat(value) ? value.value<MappedItemFormat>().load() : value.toByteArray();
+}
+
+bool hasItemFormatFingerprint(const QVariant &value)
+{
+    return !isMappedItemFormat(value) || value.value<MappedItemFormat>().hasFingerprint;
+}
+
+quint64 itemFormatFingerprint(const QVariant &value)
+{
+    if ( isMappedItemFormat(value) ) {
+        const MappedItemFormat format = value.value<MappedItemFormat>();
+        return format.hasFingerprint ? format.fingerprint : fingerprintHash( format.load() );
+    }
+
+    return fingerprintHash( value.toByteArray() );
+}
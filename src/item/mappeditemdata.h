@@ -0,0 +1,109 @@
+/*
+    Copyright (c) 2016, Lukas Holecek <hluk@email.cz>
+
+    This file is part of CopyQ.
+
+    CopyQ is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    CopyQ is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with CopyQ.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef MAPPEDITEMDATA_H
+#define MAPPEDITEMDATA_H
+
+#include <QByteArray>
+#include <QFile>
+#include <QMetaType>
+#include <QSharedPointer>
+
+class QVariant;
+
+/**
+ * Tab data file mapped to memory.
+ *
+ * Mapping is kept valid while any MappedItemFormat refers to it, even if the file
+ * is replaced by a newer version (this is not supported on Windows).
+ */
+class MappedItemFile
+{
+public:
+    explicit MappedItemFile(const QString &fileName);
+
+    bool isMapped() const { return m_data != NULL; }
+
+    const uchar *data() const { return m_data; }
+
+    qint64 size() const { return m_size; }
+
+private:
+    Q_DISABLE_COPY(MappedItemFile)
+
+    QFile m_file;
+    uchar *m_data;
+    qint64 m_size;
+};
+
+typedef QSharedPointer<MappedItemFile> MappedItemFilePtr;
+
+/**
+ * Item format data which are not loaded into memory.
+ *
+ * Data are decompressed from mapped tab data file or read from other file
+ * (e.g. shared item blob, see loadItemBlob()) only when requested.
+ */
+struct MappedItemFormat
+{
+    MappedItemFormat();
+
+    MappedItemFormat(const MappedItemFilePtr &file, qint64 offset, int size, bool compressed);
+
+    MappedItemFormat(const QString &fileName, qint64 offset, int size, bool compressed);
+
+    /**
+     * Load data.
+     *
+     * Data with cacheKey set are shared with other formats with same key
+     * while the loaded data are still used somewhere.
+     */
+    QByteArray load() const;
+
+    /// Set fingerprint of data stored with the data (see fingerprintHash()).
+    void setFingerprint(quint64 dataFingerprint);
+
+    MappedItemFilePtr file;
+    /// File to read data from if not mapped.
+    QString fileName;
+    qint64 offset;
+    int size;
+    bool compressed;
+    /// Fingerprint of (uncompressed) data; valid only if hasFingerprint is true.
+    quint64 fingerprint;
+    bool hasFingerprint;
+    /// Key for sharing loaded data (e.g. item blob ID); empty if data are not shared.
+    QByteArray cacheKey;
+};
+
+Q_DECLARE_METATYPE(MappedItemFormat)
+
+/** Return true if @a value is format data not yet loaded (MappedItemFormat). */
+bool isMappedItemFormat(const QVariant &value);
+
+/** Return format data from @a value, loading them if needed. */
+QByteArray loadItemFormat(const QVariant &value);
+
+/** Return true if itemFormatFingerprint() doesn't need to load data. */
+bool hasItemFormatFingerprint(const QVariant &value);
+
+/** Return fingerprint of format data (see fingerprintHash()), loading data only if not known. */
+quint64 itemFormatFingerprint(const QVariant &value);
+
+#endif // MAPPEDITEMDATA_H
@@ -0,0 +1,133 @@
+/*
+    Copyright (c) 2016, Lukas Holecek <hluk@email.cz>
+
+    This file is part of CopyQ.
+
+    CopyQ is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    CopyQ is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with CopyQ.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#include "rowheights.h"
+
+namespace {
+
+inline int lowestBit(int i)
+{
+    return i & -i;
+}
+
+} // namespace
+
+RowHeights::RowHeights()
+    : m_heights()
+    , m_totalHeight(0)
+    , m_tree()
+    , m_treeValid(false)
+{
+}
+
+void RowHeights::setHeight(int row, int height)
+{
+    const int diff = height - m_heights[row];
+    if (diff == 0)
+        return;
+
+    m_heights[row] = height;
+    m_totalHeight += diff;
+
+    if (m_treeValid) {
+        for (int i = row + 1; i < m_tree.size(); i += lowestBit(i))
+            m_tree[i] += diff;
+    }
+}
+
+void RowHeights::insert(int row, int count, int height)
+{
+    m_heights.insert(row, count, height);
+    m_totalHeight += count * height;
+    m_treeValid = false;
+}
+
+void RowHeights::remove(int row, int count)
+{
+    for (int i = row; i < row + count; ++i)
+        m_totalHeight -= m_heights[i];
+    m_heights.remove(row, count);
+    m_treeValid = false;
+}
+
+void RowHeights::move(int from, int to)
+{
+    const int height = m_heights[from];
+    m_heights.remove(from);
+    m_heights.insert(to, height);
+    m_treeValid = false;
+}
+
+int RowHeights::offset(int row, int spacing) const
+{
+    ensureTree();
+
+    int sum = row * spacing;
+    for (int i = row; i > 0; i -= lowestBit(i))
+        sum += m_tree[i];
+
+    return sum;
+}
+
+int RowHeights::rowAt(int y, int spacing) const
+{
+    ensureTree();
+
+    const int n = count();
+    int step = 1;
+    while (step * 2 <= n)
+        step *= 2;
+
+    // Find number of rows which end above or at y.
+    int row = 0;
+    int remaining = y;
+    for ( ; step > 0; step /= 2) {
+        const int i = row + step;
+        if (i <= n) {
+            const int h = m_tree[i] + step * spacing;
+            if (h <= remaining) {
+                row = i;
+                remaining -= h;
+            }
+        }
+    }
+
+    return row;
+}
+
+void RowHeights::ensureTree() const
+{
+    if (m_treeValid)
+        return;
+
+    const int n = count();
+    m_tree.resize(n + 1);
+    m_tree[0] = 0;
+    for (int i = 1; i <= n; ++i)
+        m_tree[i] = m_heights[i - 1];
+
+    for (int i = 1; i <= n; ++i) {
+        const int parent = i + lowestBit(i);
+        if (parent <= n)
+            m_tree[parent] += m_tree[i];
+    }
+
+    m_treeValid = true;
+}
@@ -0,0 +1,75 @@
+/*
+    Copyright (c) 2016, Lukas Holecek <hluk@email.cz>
+
+    This file is part of CopyQ.
+
+    CopyQ is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    CopyQ is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with CopyQ.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#ifndef ROWHEIGHTS_H
+#define ROWHEIGHTS_H
+
+#include <QVector>
+
+/**
+ * Heights of rows in item list with fast lookup of row positions.
+ *
+ * Prefix sums of heights are kept in a Fenwick tree so changing height of
+ * a row, getting row offset and finding row at an offset take O(log n).
+ *
+ * Inserting, removing and moving rows invalidates the tree which is rebuilt
+ * in O(n) on next lookup.
+ */
+class RowHeights
+{
+public:
+    RowHeights();
+
+    int count() const { return m_heights.size(); }
+
+    int height(int row) const { return m_heights[row]; }
+
+    /// Sum of all row heights.
+    int totalHeight() const { return m_totalHeight; }
+
+    void setHeight(int row, int height);
+
+    void insert(int row, int count, int height);
+
+    void remove(int row, int count);
+
+    /// Move row like QList::move().
+    void move(int from, int to);
+
+    /// Return top of @a row if rows are separated by @a spacing.
+    int offset(int row, int spacing = 0) const;
+
+    /**
+     * Return first row with bottom below @a y if rows are separated by @a spacing.
+     *
+     * Returns count() if there is no such row.
+     */
+    int rowAt(int y, int spacing = 0) const;
+
+private:
+    void ensureTree() const;
+
+    QVector<int> m_heights;
+    int m_totalHeight;
+    mutable QVector<int> m_tree;
+    mutable bool m_treeValid;
+};
+
+#endif // ROWHEIGHTS_H
@@ -20,8 +20,11 @@
 #include "serialize.h"
 
 #include "common/contenttype.h"
+#include "common/datafingerprint.h"
 #include "common/log.h"
 #include "common/mimetypes.h"
+#include "item/itemblobstore.h"
+#include "item/mappeditemdata.h"
 
 #include <QAbstractItemModel>
 #include <QByteArray>
@@ -34,6 +37,33 @@
 
 namespace {
 
+/// Format data bigger than this are stored in blobs if enabled (see itemblobstore.h).
+const int minItemBlobSize = 16 * 1024;
+
+/// How format data are stored in serialized item.
+enum ItemDataStorage {
+    StoredRaw = 0,
+    StoredCompressed = 1,
+    /// Item blob ID is stored instead of data (only in items with version -3 or -4).
+    StoredInBlob = 2
+};
+
+/**
+ * Item version with blobs (see StoredInBlob) and with fingerprint of each format
+ * data stored before the data (so item hash can be computed without loading data).
+ */
+const qint32 itemVersionWithFingerprints = -4;
+
+QVariant withFingerprint(const QVariant &value, quint64 fingerprint)
+{
+    if ( !isMappedItemFormat(value) )
+        return value;
+
+    MappedItemFormat format = value.value<MappedItemFormat>();
+    format.setFingerprint(fingerprint);
+    return QVariant::fromValue(format);
+}
+
 typedef QList< QPair<QString, QString> > MimeToCompressed;
 
 void addMime(MimeToCompressed &m, const QString &mime, int value)
@@ -95,17 +125,33 @@ bool shouldCompress(const QByteArray &bytes, const QString &mime)
             && ( !mime.startsWith("image/") || mime.contains("bmp") || mime.contains("xml") || mime.contains("svg") );
 }
 
-bool deserializeDataV2(QDataStream *out, QVariantMap *data)
+bool deserializeDataV2(QDataStream *out, QVariantMap *data, qint32 version)
 {
+    const bool withBlobs = version != -2;
+    const bool withFingerprints = version == itemVersionWithFingerprints;
+
     qint32 size;
     *out >> size;
 
     QString mime;
     QByteArray tmpBytes;
-    bool compress;
+    quint8 storage;
+    quint64 fingerprint = 0;
     for (qint32 i = 0; i < size && out->status() == QDataStream::Ok; ++i) {
-        *out >> mime >> compress >> tmpBytes;
-        if(compress) {
+        *out >> mime >> storage;
+        if (withFingerprints)
+            *out >> fingerprint;
+        *out >> tmpBytes;
+
+        if (withBlobs && storage == StoredInBlob) {
+            // Missing blob drops only the format, not the whole item.
+            const QVariant value = loadItemBlob(tmpBytes);
+            if ( value.isValid() )
+                data->insert( decompressMime(mime), withFingerprints ? withFingerprint(value, fingerprint) : value );
+            continue;
+        }
+
+        if (storage != StoredRaw) {
             tmpBytes = qUncompress(tmpBytes);
             if ( tmpBytes.isEmpty() ) {
                 out->setStatus(QDataStream::ReadCorruptData);
@@ -119,6 +165,213 @@ bool deserializeDataV2(QDataStream *out, QVariantMap *data)
     return out->status() == QDataStream::Ok;
 }
 
+/**
+ * Return true if format data should be loaded into memory even if tab data file is mapped.
+ *
+ * Small data and text needed for displaying and filtering items are always in memory.
+ */
+bool keepInMemory(const QString &mime, quint32 storedSize)
+{
+    if (storedSize <= 1024)
+        return true;
+
+    return storedSize <= 64 * 1024
+            && (mime == mimeText || mime == mimeUriList || mime == mimeItemNotes);
+}
+
+/// Reads item from stream of mapped file data without loading big formats.
+bool deserializeMappedData(
+        QDataStream *stream, const MappedItemFilePtr &file, QVariantMap *data)
+{
+    qint32 version;
+    *stream >> version;
+
+    // Deprecated format is not supported.
+    if (version != -2 && version != -3 && version != itemVersionWithFingerprints)
+        return false;
+
+    const bool withFingerprints = version == itemVersionWithFingerprints;
+
+    qint32 size;
+    *stream >> size;
+
+    QString mime;
+    quint8 storage;
+    quint64 fingerprint = 0;
+    quint32 storedSize;
+    for (qint32 i = 0; i < size && stream->status() == QDataStream::Ok; ++i) {
+        *stream >> mime >> storage;
+        if (withFingerprints)
+            *stream >> fingerprint;
+
+        if (version != -2 && storage == StoredInBlob) {
+            QByteArray id;
+            *stream >> id;
+            const QVariant value = loadItemBlob(id);
+            if ( value.isValid() )
+                data->insert( decompressMime(mime), withFingerprints ? withFingerprint(value, fingerprint) : value );
+            continue;
+        }
+
+        // Same as reading QByteArray but without copying the data.
+        const bool compress = storage != StoredRaw;
+        *stream >> storedSize;
+        if (storedSize == 0xffffffff)
+            storedSize = 0;
+
+        const qint64 offset = stream->device()->pos();
+        if ( stream->skipRawData(storedSize) != static_cast<int>(storedSize) )
+            return false;
+
+        mime = decompressMime(mime);
+        MappedItemFormat format(file, offset, storedSize, compress);
+        if (withFingerprints)
+            format.setFingerprint(fingerprint);
+
+        if ( keepInMemory(mime, storedSize) ) {
+            const QByteArray bytes = format.load();
+            if ( compress && bytes.isEmpty() )
+                return false;
+            data->insert(mime, bytes);
+        } else {
+            data->insert( mime, QVariant::fromValue(format) );
+        }
+    }
+
+    return stream->status() == QDataStream::Ok;
+}
+
+/**
+ * Loads items from mapped tab data file.
+ *
+ * Only small formats are loaded into memory, other formats refer to the mapped file.
+ */
+bool deserializeMappedData(QAbstractItemModel *model, QFile *file)
+{
+#ifdef Q_OS_WIN
+    // Mapped file cannot be replaced when saving items.
+    Q_UNUSED(model);
+    Q_UNUSED(file);
+    return false;
+#else
+    const MappedItemFilePtr mappedFile( new MappedItemFile(file->fileName()) );
+    if ( !mappedFile->isMapped() || mappedFile->size() > 0x7fffffff )
+        return false;
+
+    const QByteArray bytes = QByteArray::fromRawData(
+                reinterpret_cast<const char*>(mappedFile->data()),
+                static_cast<int>(mappedFile->size()) );
+    QDataStream stream(bytes);
+    if ( !stream.device()->seek(file->pos()) )
+        return false;
+
+    qint32 length;
+    stream >> length;
+    if (length == itemBlobsMark) {
+        QList<QByteArray> blobIds;
+        if ( !readItemBlobIds(&stream, &blobIds) )
+            return false;
+        stream >> length;
+    }
+
+    if ( stream.status() != QDataStream::Ok || length < 0 )
+        return false;
+
+    const QVariant maxItems = model->property("maxItems");
+    Q_ASSERT( maxItems.isValid() );
+    length = qMin( length, maxItems.toInt() ) - model->rowCount();
+
+    QList<QVariantMap> items;
+    for (qint32 i = 0; i < length; ++i) {
+        QVariantMap data;
+        if ( !deserializeMappedData(&stream, mappedFile, &data) )
+            return false;
+        items.append(data);
+    }
+
+    if ( length > 0 && !model->insertRows(0, length) )
+        return false;
+
+    for (qint32 i = 0; i < length; ++i)
+        model->setData( model->index(i, 0), items[i], contentType::data );
+
+    return true;
+#endif
+}
+
+/**
+ * Serialize item with fingerprints of format data.
+ *
+ * If @a blobIds is not NULL, big format data are stored in blobs and their IDs
+ * are added to @a blobIds.
+ *
+ * @return false if a blob cannot be stored
+ */
+bool serializeDataWithFingerprints(
+        QDataStream *stream, const QVariantMap &data, QList<QByteArray> *blobIds)
+{
+    *stream << itemVersionWithFingerprints;
+
+    const qint32 size = data.size();
+    *stream << size;
+
+    QByteArray bytes;
+    foreach (const QString &mime, data.keys()) {
+        bytes = data[mime].toByteArray();
+        const bool compress = shouldCompress(bytes, mime);
+        const quint64 fingerprint = fingerprintHash(bytes);
+        if ( blobIds && bytes.size() >= minItemBlobSize ) {
+            const QByteArray id = itemBlobId(bytes);
+            if ( !storeItemBlob(id, bytes, compress) )
+                return false;
+            blobIds->append(id);
+            *stream << compressMime(mime) << static_cast<quint8>(StoredInBlob) << fingerprint << id;
+        } else {
+            *stream << compressMime(mime)
+                    << static_cast<quint8>(compress ? StoredCompressed : StoredRaw)
+                    << fingerprint
+                    << ( compress ? qCompress(bytes) : bytes );
+        }
+    }
+
+    return true;
+}
+
+/**
+ * Serialize items with fingerprints of format data.
+ *
+ * If @a blobIds is not NULL, big format data are stored in blobs shared with
+ * other tabs. Referenced blobs are listed before the items. Stored blobs are
+ * added to @a blobIds.
+ */
+bool serializeDataWithFingerprints(
+        const QAbstractItemModel &model, QDataStream *stream, QList<QByteArray> *blobIds)
+{
+    QByteArray bytes;
+    QDataStream itemStream(&bytes, QIODevice::WriteOnly);
+    itemStream.setVersion( stream->version() );
+
+    const qint32 length = model.rowCount();
+    itemStream << length;
+
+    bool saved = true;
+    for (qint32 i = 0; i < length && saved; ++i) {
+        const QVariantMap data = model.data(model.index(i, 0), contentType::data).toMap();
+        saved = serializeDataWithFingerprints(&itemStream, data, blobIds);
+    }
+
+    if (!saved)
+        return false;
+
+    if ( blobIds && !blobIds->isEmpty() ) {
+        *stream << itemBlobsMark;
+        writeItemBlobIds( stream, blobIds->toSet().toList() );
+    }
+    stream->writeRawData( bytes.constData(), bytes.size() );
+
+    return stream->status() == QDataStream::Ok;
+}
+
 } // namespace
 
 void serializeData(QDataStream *stream, const QVariantMap &data)
@@ -145,8 +398,8 @@ void deserializeData(QDataStream *stream, QVariantMap *data)
         if ( stream->status() != QDataStream::Ok )
             return;
 
-        if (length == -2) {
-            deserializeDataV2(stream, data);
+        if (length == -2 || length == -3 || length == itemVersionWithFingerprints) {
+            deserializeDataV2(stream, data, length);
             return;
         }
 
@@ -207,6 +460,13 @@ bool deserializeData(QAbstractItemModel *model, QDataStream *stream)
     qint32 length;
     *stream >> length;
 
+    if (length == itemBlobsMark) {
+        QList<QByteArray> blobIds;
+        if ( !readItemBlobIds(stream, &blobIds) )
+            return false;
+        *stream >> length;
+    }
+
     if ( stream->status() != QDataStream::Ok )
         return false;
 
@@ -236,11 +496,28 @@ bool serializeData(const QAbstractItemModel &model, QFile *file)
 {
     QDataStream stream(file);
     stream.setVersion(QDataStream::Qt_4_7);
+
+    // Fingerprints are needed for item hash only if data are not loaded into memory.
+    const bool deduplicate = model.property("deduplicateItemData").toBool();
+    if ( deduplicate || model.property("mapItemData").toBool() ) {
+        QList<QByteArray> blobIds;
+        const bool saved = serializeDataWithFingerprints(model, &stream, deduplicate ? &blobIds : NULL)
+                && file->flush();
+
+        // Blobs can be removed once these are not referenced by the saved file.
+        releaseItemBlobs(blobIds);
+
+        return saved;
+    }
+
     return serializeData(model, &stream);
 }
 
 bool deserializeData(QAbstractItemModel *model, QFile *file)
 {
+    if ( model->property("mapItemData").toBool() && deserializeMappedData(model, file) )
+        return true;
+
     QDataStream stream(file);
     return deserializeData(model, &stream);
 }
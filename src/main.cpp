@@ -18,6 +18,7 @@
 */
 
 #include "app/app.h"
+#include "app/clipboardbatchclient.h"
 #include "app/clipboardclient.h"
 #include "app/clipboardmonitor.h"
 #include "app/clipboardserver.h"
@@ -79,6 +80,18 @@ int startClient(int argc, char *argv[], int skipArguments, const QString &sessio
     return app.exec();
 }
 
+int startBatchClient(int argc, char *argv[], const QString &sessionName)
+{
+    ClipboardBatchClient app(argc, argv, sessionName);
+    return app.exec();
+}
+
+bool needsBatch(const QString &arg)
+{
+    return arg == "--batch" ||
+           arg == "batch";
+}
+
 bool needsHelp(const QString &arg)
 {
     return arg == "-h" ||
@@ -99,6 +112,12 @@ bool needsTests(const QString &arg)
     return arg == "--tests" ||
            arg == "tests";
 }
+
+bool needsBenchmarks(const QString &arg)
+{
+    return arg == "--benchmarks" ||
+           arg == "benchmarks";
+}
 #endif
 
 bool containsOnlyValidCharacters(const QString &sessionName)
@@ -156,6 +175,11 @@ int main(int argc, char **argv)
             // Skip the "tests" argument and pass the rest to tests.
             return runTests(argc - 1, argv + 1);
         }
+
+        if ( needsBenchmarks(arguments.first()) ) {
+            // Skip the "benchmarks" argument and pass the rest to benchmarks.
+            return runBenchmarks(argc - 1, argv + 1);
+        }
 #endif
     }
 
@@ -179,6 +203,11 @@ int main(int argc, char **argv)
     if ( arguments.size() == 2 && arguments[0] == "monitor" )
         return startMonitor(argc, argv);
 
+    // If the only argument is "batch" then read commands from standard input
+    // and run them over single connection.
+    if ( arguments.size() - skipArguments == 1 && needsBatch(arguments[skipArguments]) )
+        return startBatchClient(argc, argv, sessionName);
+
     // If argument was specified and server is running
     // then run this process as client.
     return startClient(argc, argv, skipArguments, sessionName);
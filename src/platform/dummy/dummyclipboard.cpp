@@ -53,6 +53,14 @@ QVariantMap DummyClipboard::data(Mode mode, const QStringList &formats) const
     return data ? cloneData(*data, formats) : QVariantMap();
 }
 
+QVariantMap DummyClipboard::dataWithoutImageConversion(
+        Mode mode, const QStringList &formats,
+        QImage *imageToConvert, QStringList *imageFormats) const
+{
+    const QMimeData *data = clipboardData(modeToQClipboardMode(mode));
+    return data ? cloneData(*data, formats, imageToConvert, imageFormats) : QVariantMap();
+}
+
 void DummyClipboard::setData(Mode mode, const QVariantMap &dataMap)
 {
     Q_ASSERT( isMainThread() );
@@ -34,6 +34,10 @@ public:
 
     QVariantMap data(Mode mode, const QStringList &formats) const;
 
+    QVariantMap dataWithoutImageConversion(
+            Mode mode, const QStringList &formats,
+            QImage *imageToConvert, QStringList *imageFormats) const;
+
     void setData(Mode mode, const QVariantMap &dataMap);
 
 signals:
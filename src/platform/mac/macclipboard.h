@@ -33,6 +33,10 @@ public:
 
     QVariantMap data(Mode mode, const QStringList &formats) const;
 
+    QVariantMap dataWithoutImageConversion(
+            Mode mode, const QStringList &formats,
+            QImage *imageToConvert, QStringList *imageFormats) const;
+
 signals:
     void changed(PlatformClipboard::Mode mode);
 
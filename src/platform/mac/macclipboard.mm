@@ -31,6 +31,27 @@
 #include <Cocoa/Cocoa.h>
 #include <Carbon/Carbon.h>
 
+namespace {
+
+QStringList macFormats(PlatformClipboard::Mode mode, const QStringList &formats) {
+    // On OS X, when you copy files in Finder, etc. you get:
+    // - The file name(s) (not paths) as plain text
+    // - The file URI(s)
+    // - The icon (not thumbnail) for the type of item you have in various image formants
+    // We really only want the URI list, so throw the rest away
+    if (mode == PlatformClipboard::Clipboard) {
+        const QMimeData *data = clipboardData(QClipboard::Clipboard);
+
+        if (data && data->formats().contains(mimeUriList) && formats.contains(mimeUriList)) {
+            return QStringList() << mimeUriList;
+        }
+    }
+
+    return formats;
+}
+
+} // namespace
+
 MacClipboard::MacClipboard():
         m_prevChangeCount(0)
         , m_clipboardCheckTimer(new MacTimer(this)) {
@@ -44,26 +65,15 @@ MacClipboard::MacClipboard():
 }
 
 QVariantMap MacClipboard::data(Mode mode, const QStringList &formats) const {
-    Q_UNUSED(mode);
-
-    // On OS X, when you copy files in Finder, etc. you get:
-    // - The file name(s) (not paths) as plain text
-    // - The file URI(s)
-    // - The icon (not thumbnail) for the type of item you have in various image formants
-    // We really only want the URI list, so throw the rest away
-
-    QStringList macFormats = QStringList(formats); // Copy so we can modify
-    if (mode == PlatformClipboard::Clipboard) {
-        const QMimeData *data = clipboardData(QClipboard::Clipboard);
-
-        if (data && data->formats().contains(mimeUriList) && macFormats.contains(mimeUriList)) {
-            macFormats = QStringList() << mimeUriList;
-        }
-    }
-
-    return DummyClipboard::data(mode, macFormats);
+    return DummyClipboard::data(mode, macFormats(mode, formats));
 }
 
+QVariantMap MacClipboard::dataWithoutImageConversion(
+        Mode mode, const QStringList &formats,
+        QImage *imageToConvert, QStringList *imageFormats) const {
+    return DummyClipboard::dataWithoutImageConversion(
+                mode, macFormats(mode, formats), imageToConvert, imageFormats);
+}
 
 void MacClipboard::clipboardTimeout() {
     NSPasteboard *pasteboard = [NSPasteboard generalPasteboard];
@@ -20,7 +20,9 @@
 #ifndef PLATFORMCLIPBOARD_H
 #define PLATFORMCLIPBOARD_H
 
+#include <QImage>
 #include <QObject>
+#include <QStringList>
 #include <QVariantMap>
 
 /**
@@ -53,6 +55,21 @@ public:
      */
     virtual QVariantMap data(Mode mode, const QStringList &formats) const = 0;
 
+    /**
+     * Return clipboard data like data() but without slow image conversion.
+     *
+     * Image and formats it should be converted to are returned in
+     * @a imageToConvert and @a imageFormats (see convertImageData()).
+     */
+    virtual QVariantMap dataWithoutImageConversion(
+            Mode mode, const QStringList &formats,
+            QImage *imageToConvert, QStringList *imageFormats) const
+    {
+        Q_UNUSED(imageToConvert);
+        Q_UNUSED(imageFormats);
+        return data(mode, formats);
+    }
+
     /**
      * Set data to clipboard.
      */
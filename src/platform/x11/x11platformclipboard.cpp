@@ -26,6 +26,7 @@
 #include "common/common.h"
 #include "common/mimetypes.h"
 #include "common/log.h"
+#include "common/trace.h"
 
 #include <X11/Xlib.h>
 #include <X11/Xatom.h>
@@ -76,7 +77,20 @@ void X11PlatformClipboard::loadSettings(const QVariantMap &settings)
 
 QVariantMap X11PlatformClipboard::data(Mode mode, const QStringList &) const
 {
-    return mode == PlatformClipboard::Clipboard ? m_clipboardData : m_selectionData;
+    const ClipboardData &clipData = cachedData(mode);
+    QVariantMap data = clipData.data;
+    convertImageData(clipData.imageToConvert, clipData.imageFormats, &data);
+    return data;
+}
+
+QVariantMap X11PlatformClipboard::dataWithoutImageConversion(
+        Mode mode, const QStringList &,
+        QImage *imageToConvert, QStringList *imageFormats) const
+{
+    const ClipboardData &clipData = cachedData(mode);
+    *imageToConvert = clipData.imageToConvert;
+    *imageFormats = clipData.imageFormats;
+    return clipData.data;
 }
 
 void X11PlatformClipboard::setData(Mode mode, const QVariantMap &dataMap)
@@ -87,44 +101,68 @@ void X11PlatformClipboard::setData(Mode mode, const QVariantMap &dataMap)
 void X11PlatformClipboard::onChanged(QClipboard::Mode mode)
 {
     bool isClip = (mode == QClipboard::Clipboard);
+    traceInstant( QByteArray(), isClip ? "X11: clipboard changed" : "X11: selection changed" );
     m_resetClipboard = m_resetClipboard && !isClip;
     m_resetSelection = m_resetSelection && isClip;
 
-    if ( mode == QClipboard::Selection && waitIfSelectionIncomplete() )
-        return;
-
-    QVariantMap data = DummyClipboard::data(isClip ? Clipboard : Selection, m_formats);
-    bool foreignData = !ownsClipboardData(data);
-
-    if ( foreignData && maybeResetClipboard(mode) )
-        return;
-
-    QVariantMap &targetData = isClip ? m_clipboardData : m_selectionData;
-    targetData = data;
-
-    emit changed(isClip ? Clipboard : Selection);
+    if (isClip) {
+        updateData(mode);
+    } else {
+        // Coalesce bursts of selection changes (e.g. selecting text with keyboard)
+        // and fetch the data only after selection settles.
+        m_timerIncompleteSelection.start();
+    }
 }
 
 void X11PlatformClipboard::checkSelectionComplete()
 {
-    onChanged(QClipboard::Selection);
+    if ( !waitIfSelectionIncomplete() )
+        updateData(QClipboard::Selection);
 }
 
 void X11PlatformClipboard::resetClipboard()
 {
-    if (m_resetSelection && !m_selectionData.isEmpty()) {
+    if (m_resetSelection && !m_selectionData.data.isEmpty()) {
         COPYQ_LOG("Resetting selection");
-        DummyClipboard::setData(Selection, m_selectionData);
+        DummyClipboard::setData( Selection, data(Selection, m_formats) );
         m_resetSelection = false;
     }
 
-    if (m_resetClipboard && !m_clipboardData.isEmpty()) {
+    if (m_resetClipboard && !m_clipboardData.data.isEmpty()) {
         COPYQ_LOG("Resetting clipboard");
-        DummyClipboard::setData(Clipboard, m_clipboardData);
+        DummyClipboard::setData( Clipboard, data(Clipboard, m_formats) );
         m_resetClipboard = false;
     }
 }
 
+void X11PlatformClipboard::updateData(QClipboard::Mode mode)
+{
+    bool isClip = (mode == QClipboard::Clipboard);
+    const Mode platformMode = isClip ? Clipboard : Selection;
+
+    // Images are converted later in the monitor so it stays responsive.
+    ClipboardData clipData;
+    {
+        TraceScope trace( QByteArray(), "X11: fetch clipboard data" );
+        clipData.data = DummyClipboard::dataWithoutImageConversion(
+                    platformMode, m_formats, &clipData.imageToConvert, &clipData.imageFormats);
+    }
+    bool foreignData = !ownsClipboardData(clipData.data);
+
+    if ( foreignData && maybeResetClipboard(mode) )
+        return;
+
+    ClipboardData &targetData = isClip ? m_clipboardData : m_selectionData;
+    targetData = clipData;
+
+    emit changed(platformMode);
+}
+
+const X11PlatformClipboard::ClipboardData &X11PlatformClipboard::cachedData(Mode mode) const
+{
+    return mode == PlatformClipboard::Clipboard ? m_clipboardData : m_selectionData;
+}
+
 bool X11PlatformClipboard::waitIfSelectionIncomplete()
 {
     if (!d->display())
@@ -148,10 +186,10 @@ bool X11PlatformClipboard::maybeResetClipboard(QClipboard::Mode mode)
             ? isClipboardEmpty(d->display())
             : isSelectionEmpty(d->display());
 
-    QVariantMap &clipData = isClip ? m_clipboardData : m_selectionData;
+    const ClipboardData &clipData = isClip ? m_clipboardData : m_selectionData;
 
     bool &reset = isClip ? m_resetClipboard : m_resetSelection;
-    reset = isEmpty && !clipData.isEmpty();
+    reset = isEmpty && !clipData.data.isEmpty();
 
     // No need reset?
     if (!reset)
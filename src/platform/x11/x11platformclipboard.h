@@ -39,6 +39,10 @@ public:
 
     QVariantMap data(Mode mode, const QStringList &formats) const;
 
+    QVariantMap dataWithoutImageConversion(
+            Mode mode, const QStringList &formats,
+            QImage *imageToConvert, QStringList *imageFormats) const;
+
     void setData(Mode mode, const QVariantMap &dataMap);
 
 private slots:
@@ -47,6 +51,16 @@ private slots:
     void resetClipboard();
 
 private:
+    struct ClipboardData {
+        QVariantMap data;
+        QImage imageToConvert;
+        QStringList imageFormats;
+    };
+
+    void updateData(QClipboard::Mode mode);
+
+    const ClipboardData &cachedData(Mode mode) const;
+
     bool waitIfSelectionIncomplete();
 
     /**
@@ -66,8 +80,8 @@ private:
     QTimer m_timerIncompleteSelection;
     QTimer m_timerReset;
 
-    QVariantMap m_clipboardData;
-    QVariantMap m_selectionData;
+    ClipboardData m_clipboardData;
+    ClipboardData m_selectionData;
 };
 
 #endif // X11PLATFORMCLIPBOARD_H
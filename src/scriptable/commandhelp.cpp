@@ -174,6 +174,14 @@ QList<CommandHelp> commandHelp()
                .addArg(Scriptable::tr("OPTION"))
                .addArg(Scriptable::tr("VALUE"))
             << CommandHelp()
+            << CommandHelp("trace",
+                           Scriptable::tr("Start tracing processing of clipboard changes."))
+               .addArg("start")
+            << CommandHelp("trace",
+                           Scriptable::tr("Stop tracing and print recorded events\n"
+                                          "(in Chrome trace event format)."))
+               .addArg("stop")
+            << CommandHelp()
             << CommandHelp("eval, -e",
                            Scriptable::tr("\nEvaluate ECMAScript program.\n"
                                           "Arguments are accessible using with \"arguments[0..N]\"."))
@@ -182,6 +190,11 @@ QList<CommandHelp> commandHelp()
             << CommandHelp("session, -s, --session",
                            Scriptable::tr("\nStarts or connects to application instance with given session name."))
                .addArg(Scriptable::tr("SESSION"))
+            << CommandHelp("batch, --batch",
+                           Scriptable::tr("\nRun commands read from standard input over single connection.\n"
+                                          "Each line contains ID, command and arguments separated by tab.\n"
+                                          "For each finished command, line with ID, exit code and escaped\n"
+                                          "output separated by tab is printed."))
             << CommandHelp("help, -h, --help",
                            Scriptable::tr("\nPrint help for COMMAND or all commands."))
                .addArg("[" + Scriptable::tr("COMMAND") + "]...")
@@ -190,6 +203,9 @@ QList<CommandHelp> commandHelp()
 #ifdef HAS_TESTS
             << CommandHelp("tests, --tests",
                            Scriptable::tr("Run application tests (append --help argument for more info)."))
+            << CommandHelp("benchmarks, --benchmarks",
+                           Scriptable::tr("Run benchmarks and print results in JSON"
+                                          " (append -json FILE to save results to a file)."))
 #endif
                ;
 
@@ -217,6 +217,17 @@ void Scriptable::initEngine(
     addScriptableClass(&obj, m_dirClass);
 }
 
+void Scriptable::reset(
+        ScriptableProxy *proxy, const QString &currentPath, const QVariantMap &data)
+{
+    m_proxy = proxy;
+    m_data = data;
+    m_inputSeparator = "\n";
+    m_input = QScriptValue();
+    m_abort = false;
+    setCurrentPath(currentPath);
+}
+
 QScriptValue Scriptable::newByteArray(const QByteArray &bytes)
 {
     return m_baClass->newInstance(bytes);
@@ -827,6 +838,22 @@ QScriptValue Scriptable::config()
     return output.isEmpty() ? QScriptValue() : output;
 }
 
+QScriptValue Scriptable::trace()
+{
+    const QString command = arg(0);
+
+    if ( argumentCount() == 1 && command == "start" ) {
+        m_proxy->startTracing();
+        return QScriptValue();
+    }
+
+    if ( argumentCount() == 1 && command == "stop" )
+        return newByteArray( m_proxy->stopTracing() );
+
+    throwError(argumentError());
+    return QScriptValue();
+}
+
 QScriptValue Scriptable::info()
 {
     typedef QMap<QString, QString> InfoMap;
@@ -1109,6 +1136,74 @@ void Scriptable::setItem()
     m_proxy->browserAdd(data, row);
 }
 
+QScriptValue Scriptable::readItems()
+{
+    int row = 0;
+    int count = -1;
+    if ( argumentCount() > 0 && !toInt(argument(0), row) ) {
+        throwError(argumentError());
+        return QScriptValue();
+    }
+    if ( argumentCount() > 1 && !toInt(argument(1), count) ) {
+        throwError(argumentError());
+        return QScriptValue();
+    }
+
+    QStringList formats;
+    for ( int i = 2; i < argumentCount(); ++i )
+        formats.append( toString(argument(i)) );
+
+    const QVariantList items = m_proxy->browserItemsData(row, count, formats);
+
+    QScriptValue array = engine()->newArray( static_cast<uint>(items.size()) );
+    for ( int i = 0; i < items.size(); ++i )
+        array.setProperty( static_cast<quint32>(i), toScriptValue(items[i].toMap(), this) );
+
+    return array;
+}
+
+void Scriptable::writeItems()
+{
+    int row;
+    const QScriptValue array = argument(1);
+    if ( !toInt(argument(0), row) || !array.isArray() ) {
+        throwError(argumentError());
+        return;
+    }
+
+    const quint32 len = array.property("length").toUInt32();
+    QVariantList items;
+    items.reserve( static_cast<int>(len) );
+    for ( quint32 i = 0; i < len; ++i )
+        items.append( toDataMap(array.property(i)) );
+
+    if ( !m_proxy->browserAddItems(items, row) )
+        throwError( tr("Failed to add items!") );
+}
+
+void Scriptable::removeItems()
+{
+    const int args = argumentCount();
+    if (args % 2 != 0) {
+        throwError(argumentError());
+        return;
+    }
+
+    QList<int> rowsAndCounts;
+    for ( int i = 0; i < args; i += 2 ) {
+        int row;
+        int count;
+        if ( !toInt(argument(i), row) || !toInt(argument(i + 1), count) ) {
+            throwError(argumentError());
+            return;
+        }
+
+        rowsAndCounts << row << count;
+    }
+
+    m_proxy->browserRemoveRanges(rowsAndCounts);
+}
+
 QScriptValue Scriptable::toBase64()
 {
     return QString::fromLatin1(makeByteArray(argument(0)).toBase64());
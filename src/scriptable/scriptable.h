@@ -48,6 +48,9 @@ public:
     void initEngine(
             QScriptEngine *engine, const QString &currentPath, const QVariantMap &data);
 
+    /** Reset state so initialized engine can be used to run next command. */
+    void reset(ScriptableProxy *proxy, const QString &currentPath, const QVariantMap &data);
+
     QScriptValue newByteArray(const QByteArray &bytes);
 
     QScriptValue newVariant(const QVariant &value);
@@ -160,6 +163,8 @@ public slots:
 
     QScriptValue config();
 
+    QScriptValue trace();
+
     QScriptValue info();
 
     QScriptValue eval();
@@ -203,6 +208,10 @@ public slots:
     void setItem();
     void setitem() { setItem(); }
 
+    QScriptValue readItems();
+    void writeItems();
+    void removeItems();
+
     QScriptValue toBase64();
     QScriptValue tobase64() { return toBase64(); }
     QScriptValue fromBase64();
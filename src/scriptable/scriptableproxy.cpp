@@ -46,11 +46,14 @@
 #include <QLabel>
 #include <QLineEdit>
 #include <QMimeData>
+#include <QPair>
 #include <QPushButton>
 #include <QShortcut>
 #include <QSpinBox>
 #include <QTextEdit>
 
+#include <limits>
+
 #define INVOKE(call) \
     if (isValueUnset()) \
       return setValue(v, (call))
@@ -495,9 +498,51 @@ void ScriptableProxyHelper::browserRemoveRows(QList<int> rows)
 
     qSort( rows.begin(), rows.end(), qGreater<int>() );
 
+    // Remove continuous ranges of rows at once.
+    ClipboardBrowser::Lock lock(c);
+    for (int i = 0; i < rows.size(); ) {
+        const int last = rows[i];
+        int first = last;
+        for (++i; i < rows.size() && rows[i] >= first - 1; ++i)
+            first = rows[i];
+        c->removeRows(first, last - first + 1);
+    }
+}
+
+void ScriptableProxyHelper::browserRemoveRanges(const QList<int> &rowsAndCounts)
+{
+    ClipboardBrowser *c = fetchBrowser();
+    if (!c)
+        return;
+
+    // Ranges as [begin, end); rows past the end are ignored by ClipboardBrowser::removeRows().
+    const qint64 maxEnd = std::numeric_limits<int>::max();
+    QList< QPair<int, int> > ranges;
+    for (int i = 0; i + 1 < rowsAndCounts.size(); i += 2) {
+        const int begin = qMax(0, rowsAndCounts[i]);
+        const qint64 end = qMin( maxEnd, static_cast<qint64>(rowsAndCounts[i]) + rowsAndCounts[i + 1] );
+        if (begin < end)
+            ranges.append( qMakePair(begin, static_cast<int>(end)) );
+    }
+
+    if ( ranges.isEmpty() )
+        return;
+
+    // Merge overlapping ranges so removing one doesn't shift rows of other.
+    qSort(ranges);
+    QList< QPair<int, int> > merged;
+    merged.append(ranges.first());
+    for (int i = 1; i < ranges.size(); ++i) {
+        if ( ranges[i].first <= merged.last().second )
+            merged.last().second = qMax(merged.last().second, ranges[i].second);
+        else
+            merged.append(ranges[i]);
+    }
+
+    // Remove from the end so preceding ranges stay valid.
     ClipboardBrowser::Lock lock(c);
-    foreach (int row, rows)
-        c->removeRow(row);
+    for (int i = merged.size() - 1; i >= 0; --i)
+        c->removeRows( merged[i].first, merged[i].second - merged[i].first );
 }
 
 void ScriptableProxyHelper::browserEditRow(int arg1)
@@ -594,6 +639,17 @@ QVariant ScriptableProxyHelper::config(const QString &name, const QString &value
     return QVariant();
 }
 
+void ScriptableProxyHelper::startTracing()
+{
+    m_wnd->startTracing();
+}
+
+QByteArray ScriptableProxyHelper::stopTracing()
+{
+    INVOKE(stopTracing());
+    return m_wnd->stopTracing();
+}
+
 QByteArray ScriptableProxyHelper::getClipboardData(const QString &mime, QClipboard::Mode mode)
 {
     INVOKE(getClipboardData(mime, mode));
@@ -658,6 +714,21 @@ bool ScriptableProxyHelper::browserChange(const QVariantMap &data, int row)
     return c->model()->setData(index, itemData, contentType::data);
 }
 
+bool ScriptableProxyHelper::browserAddItems(const QVariantList &items, int row)
+{
+    INVOKE(browserAddItems(items, row));
+    ClipboardBrowser *c = fetchBrowser();
+    if (!c)
+        return false;
+
+    QList<QVariantMap> dataList;
+    dataList.reserve( items.size() );
+    foreach (const QVariant &item, items)
+        dataList.append( item.toMap() );
+
+    return c->add(dataList, row);
+}
+
 QByteArray ScriptableProxyHelper::browserItemData(int arg1, const QString &arg2)
 {
     INVOKE(browserItemData(arg1, arg2));
@@ -670,6 +741,37 @@ QVariantMap ScriptableProxyHelper::browserItemData(int arg1)
     return itemData(arg1);
 }
 
+QVariantList ScriptableProxyHelper::browserItemsData(int row, int count, const QStringList &formats)
+{
+    INVOKE(browserItemsData(row, count, formats));
+    ClipboardBrowser *c = fetchBrowser();
+    if (!c)
+        return QVariantList();
+
+    const int length = c->length();
+    const int first = qMax(0, row);
+    const int last = (count < 0 || count > length - row) ? length - 1 : row + count - 1;
+
+    // Item data are implicitly shared so only references are copied here.
+    QVariantList items;
+    items.reserve( qMax(0, last - first + 1) );
+    for (int i = first; i <= last; ++i) {
+        const QVariantMap data = ::itemData( c->index(i) );
+        if ( formats.isEmpty() ) {
+            items.append(data);
+        } else {
+            QVariantMap filteredData;
+            foreach (const QString &format, formats) {
+                if ( data.contains(format) )
+                    filteredData.insert( format, data[format] );
+            }
+            items.append(filteredData);
+        }
+    }
+
+    return items;
+}
+
 void ScriptableProxyHelper::setCurrentTab(const QString &tabName)
 {
     ClipboardBrowser *c = fetchBrowser(tabName);
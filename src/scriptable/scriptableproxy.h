@@ -207,6 +207,9 @@ public slots:
     void browserSetCurrent(int arg1);
     void browserRemoveRows(QList<int> rows);
 
+    /// Remove ranges of rows given as pairs of first row and row count.
+    void browserRemoveRanges(const QList<int> &rowsAndCounts);
+
     void browserEditRow(int arg1);
     void browserEditNew(const QString &arg1, bool changeClipboard);
 
@@ -225,6 +228,9 @@ public slots:
 
     QVariant config(const QString &name, const QString &value);
 
+    void startTracing();
+    QByteArray stopTracing();
+
     QByteArray getClipboardData(const QString &mime, QClipboard::Mode mode = QClipboard::Clipboard);
 
     int browserLength();
@@ -234,9 +240,11 @@ public slots:
     bool browserAdd(const QStringList &texts);
     bool browserAdd(const QVariantMap &arg1, int arg2);
     bool browserChange(const QVariantMap &data, int row);
+    bool browserAddItems(const QVariantList &items, int row);
 
     QByteArray browserItemData(int arg1, const QString &arg2);
     QVariantMap browserItemData(int arg1);
+    QVariantList browserItemsData(int row, int count, const QStringList &formats);
 
     void setCurrentTab(const QString &tabName);
 
@@ -349,6 +357,9 @@ public:
 
     PROXY_METHOD_2(QVariant, config, const QString &, const QString &)
 
+    PROXY_METHOD(startTracing)
+    PROXY_METHOD_0(QByteArray, stopTracing)
+
     PROXY_METHOD_VOID_4(showMessage, const QString &, const QString &,
                         QSystemTrayIcon::MessageIcon, int)
 
@@ -360,6 +371,7 @@ public:
     PROXY_METHOD_1(QVariantMap, nextItem, int)
     PROXY_METHOD_VOID_1(browserMoveToClipboard, int)
     PROXY_METHOD_VOID_1(browserRemoveRows, const QList<int> &)
+    PROXY_METHOD_VOID_1(browserRemoveRanges, const QList<int> &)
     PROXY_METHOD_VOID_1(browserSetCurrent, int)
     PROXY_METHOD_0(int, browserLength)
     PROXY_METHOD_2(bool, browserOpenEditor, const QByteArray &, bool)
@@ -368,11 +380,13 @@ public:
     PROXY_METHOD_1(bool, browserAdd, const QStringList &)
     PROXY_METHOD_2(bool, browserAdd, const QVariantMap &, int)
     PROXY_METHOD_2(bool, browserChange, const QVariantMap &, int)
+    PROXY_METHOD_2(bool, browserAddItems, const QVariantList &, int)
     PROXY_METHOD_VOID_1(browserEditRow, int)
     PROXY_METHOD_VOID_2(browserEditNew, const QString &, bool)
 
     PROXY_METHOD_2(QByteArray, browserItemData, int, const QString &)
     PROXY_METHOD_1(QVariantMap, browserItemData, int)
+    PROXY_METHOD_3(QVariantList, browserItemsData, int, int, const QStringList &)
 
     PROXY_METHOD_VOID_1(setCurrentTab, const QString &)
 
@@ -24,6 +24,7 @@
 #include "common/clientsocket.h"
 #include "common/commandstatus.h"
 #include "common/log.h"
+#include "scriptable/scriptenginepool.h"
 #include "../qt/bytearrayclass.h"
 
 #include <QApplication>
@@ -56,8 +57,82 @@ QByteArray serializeScriptValue(const QScriptValue &value)
     return data;
 }
 
+/**
+ * Returns Scriptable to pool after command finishes.
+ *
+ * Client socket is deleted after it's disconnected.
+ */
+class ScriptableGuard
+{
+public:
+    ScriptableGuard(Scriptable *scriptable, ClientSocket *socket)
+        : m_scriptable(scriptable)
+        , m_socket(socket)
+    {
+    }
+
+    ~ScriptableGuard()
+    {
+        if (m_socket) {
+            QObject::disconnect(m_socket, NULL, m_scriptable, NULL);
+            QMetaObject::invokeMethod(m_socket, "deleteAfterDisconnected", Qt::QueuedConnection);
+        }
+
+        releaseScriptable(m_scriptable);
+    }
+
+private:
+    Scriptable *m_scriptable;
+    ClientSocket *m_socket;
+};
+
+bool isFinalMessage(int messageCode)
+{
+    return messageCode == CommandFinished
+            || messageCode == CommandError
+            || messageCode == CommandBadSyntax;
+}
+
 } // namespace
 
+ScriptableActionRelay::ScriptableActionRelay(Action *action, Scriptable *scriptable)
+    : QObject()
+    , m_action(action)
+    , m_scriptable(scriptable)
+{
+    if (m_action) {
+        connect( m_action, SIGNAL(scriptAborted()),
+                 this, SLOT(abort()) );
+    }
+}
+
+bool ScriptableActionRelay::isAborted() const
+{
+    return m_action && m_action->isScriptAborted();
+}
+
+void ScriptableActionRelay::sendMessage(const QByteArray &message, int messageCode)
+{
+    if (!m_action)
+        return;
+
+    Action *action = m_action;
+
+    // Action can be deleted as soon as it gets final message.
+    if ( isFinalMessage(messageCode) ) {
+        disconnect( m_action, NULL, this, NULL );
+        m_action = NULL;
+    }
+
+    QMetaObject::invokeMethod( action, "onScriptMessage", Qt::QueuedConnection,
+                               Q_ARG(QByteArray, message), Q_ARG(int, messageCode) );
+}
+
+void ScriptableActionRelay::abort()
+{
+    m_scriptable->abort();
+}
+
 ScriptableWorker::ScriptableWorker(
         MainWindow *mainWindow, const Arguments &args, ClientSocket *socket,
         const QString &pluginScript)
@@ -65,12 +140,29 @@ ScriptableWorker::ScriptableWorker(
     , m_wnd(mainWindow)
     , m_args(args)
     , m_socket(socket)
+    , m_action(NULL)
+    , m_input()
     , m_pluginScript(pluginScript)
 {
     if ( hasLogLevel(LogDebug) )
         m_id = m_socket->property("id").toString();
 }
 
+ScriptableWorker::ScriptableWorker(
+        MainWindow *mainWindow, const Arguments &args, Action *action,
+        const QString &pluginScript)
+    : QRunnable()
+    , m_wnd(mainWindow)
+    , m_args(args)
+    , m_socket(NULL)
+    , m_action(action)
+    , m_input(action->input())
+    , m_pluginScript(pluginScript)
+{
+    if ( hasLogLevel(LogDebug) )
+        m_id = QString("action \"%1\"").arg(action->name());
+}
+
 void ScriptableWorker::run()
 {
     if ( hasLogLevel(LogDebug) ) {
@@ -93,10 +185,11 @@ void ScriptableWorker::run()
 
     const QString currentPath = getTextData(m_args.at(Arguments::CurrentPath));
 
-    QScriptEngine engine;
     ScriptableProxy proxy(m_wnd, data);
-    Scriptable scriptable(&proxy);
-    scriptable.initEngine(&engine, currentPath, data);
+    Scriptable &scriptable = *acquireScriptable(&proxy, currentPath, data, m_pluginScript);
+    const ScriptableGuard guard(&scriptable, m_socket);
+    ScriptableActionRelay actionRelay(m_action, &scriptable);
+    QScriptEngine &engine = *scriptable.engine();
 
     if (m_socket) {
         QObject::connect( proxy.signaler(), SIGNAL(sendMessage(QByteArray,int)),
@@ -109,8 +202,6 @@ void ScriptableWorker::run()
 
         QObject::connect( m_socket, SIGNAL(disconnected()),
                           &scriptable, SLOT(abort()) );
-        QObject::connect( &scriptable, SIGNAL(destroyed()),
-                          m_socket, SLOT(deleteAfterDisconnected()) );
 
         if ( m_socket->isClosed() ) {
             SCRIPT_LOG("TERMINATED");
@@ -118,6 +209,22 @@ void ScriptableWorker::run()
         }
 
         QMetaObject::invokeMethod(m_socket, "start", Qt::QueuedConnection);
+    } else if (m_action) {
+        QObject::connect( proxy.signaler(), SIGNAL(sendMessage(QByteArray,int)),
+                          m_action, SLOT(onScriptMessage(QByteArray,int)) );
+
+        // Action is accessed through relay only until it gets final message.
+        QObject::connect( &scriptable, SIGNAL(sendMessage(QByteArray,int)),
+                          &actionRelay, SLOT(sendMessage(QByteArray,int)), Qt::DirectConnection );
+
+        // Action could be terminated before relay was connected.
+        if ( actionRelay.isAborted() ) {
+            SCRIPT_LOG("TERMINATED");
+            scriptable.sendMessageToClient(QByteArray(), CommandError);
+            return;
+        }
+
+        scriptable.setInput(m_input);
     }
 
     QObject::connect( &scriptable, SIGNAL(requestApplicationQuit()),
@@ -166,7 +273,6 @@ void ScriptableWorker::run()
                 }
             }
 
-            engine.evaluate(m_pluginScript);
             QScriptValue result = fn.call(QScriptValue(), fnArgs);
 
             if ( engine.hasUncaughtException() ) {
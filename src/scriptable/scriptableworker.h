@@ -26,10 +26,41 @@
 #include "scriptable/scriptable.h"
 #include "scriptable/scriptableproxy.h"
 
+#include <QObject>
 #include <QRunnable>
 
+class Action;
 class ClientSocket;
 
+/**
+ * Passes messages from script to Action which started it and aborts the script
+ * on Action::scriptAborted().
+ *
+ * Action is not accessed after it gets final message since it can be deleted
+ * afterwards. Connection for abort is removed with relay after script finishes.
+ */
+class ScriptableActionRelay : public QObject
+{
+    Q_OBJECT
+
+public:
+    /// Relay doesn't do anything if @a action is NULL.
+    ScriptableActionRelay(Action *action, Scriptable *scriptable);
+
+    /// Return true if action was terminated before script started.
+    bool isAborted() const;
+
+public slots:
+    void sendMessage(const QByteArray &message, int messageCode);
+
+private slots:
+    void abort();
+
+private:
+    Action *m_action;
+    Scriptable *m_scriptable;
+};
+
 class ScriptableWorker : public QRunnable
 {
 public:
@@ -37,12 +68,24 @@ public:
             MainWindow *mainWindow, const Arguments &args, ClientSocket *socket,
             const QString &pluginScript);
 
+    /**
+     * Run script for @a action without client process.
+     *
+     * Action input is passed to script directly and messages for client
+     * are passed to Action::onScriptMessage().
+     */
+    ScriptableWorker(
+            MainWindow *mainWindow, const Arguments &args, Action *action,
+            const QString &pluginScript);
+
     void run();
 
 private:
     MainWindow *m_wnd;
     Arguments m_args;
     ClientSocket *m_socket;
+    Action *m_action;
+    QByteArray m_input;
     QString m_pluginScript;
     QString m_id;
 };
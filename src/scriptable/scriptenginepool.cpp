@@ -0,0 +1,283 @@
+/*
+    Copyright (c) 2016, Lukas Holecek <hluk@email.cz>
+
+    This file is part of CopyQ.
+
+    CopyQ is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    CopyQ is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with CopyQ.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#include "scriptenginepool.h"
+
+#include "common/log.h"
+#include "scriptable/scriptable.h"
+
+#include <QCoreApplication>
+#include <QElapsedTimer>
+#include <QEvent>
+#include <QHash>
+#include <QMap>
+#include <QMutex>
+#include <QMutexLocker>
+#include <QPair>
+#include <QScriptEngine>
+#include <QScriptValueIterator>
+#include <QSet>
+#include <QThreadStorage>
+
+namespace {
+
+typedef QPair<QScriptValue, QScriptValue::PropertyFlags> PropertyValue;
+typedef QHash<QString, PropertyValue> PropertyValues;
+
+/// Prototype and own properties of an object reachable from global object.
+struct ObjectSnapshot {
+    QScriptValue object;
+    QScriptValue prototype;
+    PropertyValues properties;
+};
+
+bool isAccessor(QScriptValue::PropertyFlags flags)
+{
+    return flags & (QScriptValue::PropertyGetter | QScriptValue::PropertySetter);
+}
+
+/// Return true for plain script objects (properties of other objects are not restored).
+bool canRestoreObject(const QScriptValue &value)
+{
+    return value.isObject()
+            && !value.isQObject()
+            && !value.isQMetaObject()
+            && !value.isVariant()
+            && value.scriptClass() == NULL;
+}
+
+PropertyValues saveProperties(const QScriptValue &object)
+{
+    PropertyValues properties;
+
+    QScriptValueIterator it(object);
+    while ( it.hasNext() ) {
+        it.next();
+        if ( !isAccessor(it.flags()) )
+            properties.insert( it.name(), PropertyValue(it.value(), it.flags()) );
+    }
+
+    return properties;
+}
+
+void restoreProperties(QScriptValue object, const PropertyValues &properties)
+{
+    QSet<QString> restored;
+
+    QScriptValueIterator it(object);
+    while ( it.hasNext() ) {
+        it.next();
+        if ( isAccessor(it.flags()) )
+            continue;
+
+        const QString name = it.name();
+        PropertyValues::const_iterator saved = properties.constFind(name);
+        if ( saved == properties.constEnd() ) {
+            it.remove();
+        } else {
+            restored.insert(name);
+            if ( !it.value().strictlyEquals(saved->first) )
+                it.setValue(saved->first);
+        }
+    }
+
+    if ( restored.size() != properties.size() ) {
+        for ( PropertyValues::const_iterator saved = properties.constBegin();
+              saved != properties.constEnd(); ++saved )
+        {
+            if ( !restored.contains(saved.key()) )
+                object.setProperty(saved.key(), saved->first, saved->second);
+        }
+    }
+}
+
+/**
+ * Initialized engine for a thread with state of global object and objects
+ * reachable from it saved after evaluating plugin scripts.
+ */
+class ThreadScriptEngine
+{
+public:
+    explicit ThreadScriptEngine(const QString &pluginScript)
+        : m_engine()
+        , m_scriptable(NULL)
+        , m_pluginScript(pluginScript)
+        , m_objects()
+    {
+        m_scriptable.initEngine(&m_engine, QString(), QVariantMap());
+        initPluginObjects();
+        m_engine.evaluate(pluginScript);
+        m_engine.clearExceptions();
+        saveObjects();
+    }
+
+    Scriptable *scriptable() { return &m_scriptable; }
+
+    const QString &pluginScript() const { return m_pluginScript; }
+
+    /**
+     * Restore global variables, prototypes and properties of objects
+     * reachable from global object changed by last command.
+     */
+    void restoreGlobals()
+    {
+        m_engine.clearExceptions();
+
+        for (int i = 0; i < m_objects.size(); ++i) {
+            ObjectSnapshot &snapshot = m_objects[i];
+            if ( !snapshot.object.prototype().strictlyEquals(snapshot.prototype) )
+                snapshot.object.setPrototype(snapshot.prototype);
+            restoreProperties(snapshot.object, snapshot.properties);
+        }
+    }
+
+private:
+    void initPluginObjects();
+
+    /// Save state of global object and all plain objects reachable from it.
+    void saveObjects()
+    {
+        QList<QScriptValue> queue;
+        queue.append( m_engine.globalObject() );
+
+        QSet<qint64> visited;
+        visited.insert( queue.first().objectId() );
+
+        while ( !queue.isEmpty() ) {
+            ObjectSnapshot snapshot;
+            snapshot.object = queue.takeFirst();
+            snapshot.prototype = snapshot.object.prototype();
+            snapshot.properties = saveProperties(snapshot.object);
+            m_objects.append(snapshot);
+
+            QList<QScriptValue> children;
+            children.append(snapshot.prototype);
+            foreach ( const PropertyValue &value, snapshot.properties )
+                children.append(value.first);
+
+            foreach ( const QScriptValue &child, children ) {
+                if ( canRestoreObject(child) && !visited.contains(child.objectId()) ) {
+                    visited.insert( child.objectId() );
+                    queue.append(child);
+                }
+            }
+        }
+
+        COPYQ_LOG( QString("Script engine state saved for %1 objects").arg(m_objects.size()) );
+    }
+
+    // Scriptable must be destroyed before engine.
+    QScriptEngine m_engine;
+    Scriptable m_scriptable;
+    QString m_pluginScript;
+    QList<ObjectSnapshot> m_objects;
+};
+
+QThreadStorage<ThreadScriptEngine*> threadEngines;
+
+QMutex pluginObjectsMutex;
+QMap<QString, QObject*> pluginObjects;
+
+void ThreadScriptEngine::initPluginObjects()
+{
+    QScriptValue objects = m_engine.newObject();
+
+    const QMutexLocker lock(&pluginObjectsMutex);
+    for ( QMap<QString, QObject*>::const_iterator it = pluginObjects.constBegin();
+          it != pluginObjects.constEnd(); ++it )
+    {
+        objects.setProperty( it.key(), m_engine.newQObject(it.value(), QScriptEngine::QtOwnership) );
+    }
+
+    m_engine.globalObject().setProperty("pluginObjects", objects);
+}
+
+QMutex statsMutex;
+ScriptEngineStats engineStats;
+
+ThreadScriptEngine *engineForCurrentThread(const QString &pluginScript)
+{
+    ThreadScriptEngine *engine = threadEngines.localData();
+    if ( engine && engine->pluginScript() == pluginScript ) {
+        const QMutexLocker lock(&statsMutex);
+        ++engineStats.reusedCount;
+        return engine;
+    }
+
+    QElapsedTimer t;
+    t.start();
+
+    // Setting new value deletes old one.
+    engine = new ThreadScriptEngine(pluginScript);
+    threadEngines.setLocalData(engine);
+
+    const qint64 elapsed = t.elapsed();
+    COPYQ_LOG( QString("Script engine initialized in %1 ms").arg(elapsed) );
+
+    const QMutexLocker lock(&statsMutex);
+    ++engineStats.createdCount;
+    engineStats.totalInitTimeMs += elapsed;
+    engineStats.maxInitTimeMs = qMax(engineStats.maxInitTimeMs, elapsed);
+
+    return engine;
+}
+
+} // namespace
+
+Scriptable *acquireScriptable(
+        ScriptableProxy *proxy, const QString &currentPath, const QVariantMap &data,
+        const QString &pluginScript)
+{
+    Scriptable *scriptable = engineForCurrentThread(pluginScript)->scriptable();
+    scriptable->reset(proxy, currentPath, data);
+    return scriptable;
+}
+
+void releaseScriptable(Scriptable *scriptable)
+{
+    ThreadScriptEngine *engine = threadEngines.localData();
+    Q_ASSERT(engine && engine->scriptable() == scriptable);
+
+    scriptable->disconnect();
+
+    // Drop queued calls (e.g. abort() after client disconnects) for finished command.
+    QCoreApplication::removePostedEvents(scriptable, QEvent::MetaCall);
+
+    scriptable->reset(NULL, QString(), QVariantMap());
+    engine->restoreGlobals();
+}
+
+void setScriptablePluginObjects(const QMap<QString, QObject*> &objects)
+{
+    const QMutexLocker lock(&pluginObjectsMutex);
+    pluginObjects = objects;
+}
+
+void warmUpScriptEngine(const QString &pluginScript)
+{
+    if ( !threadEngines.hasLocalData() )
+        engineForCurrentThread(pluginScript);
+}
+
+ScriptEngineStats scriptEngineStats()
+{
+    const QMutexLocker lock(&statsMutex);
+    return engineStats;
+}
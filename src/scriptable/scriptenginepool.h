@@ -0,0 +1,88 @@
+/*
+    Copyright (c) 2016, Lukas Holecek <hluk@email.cz>
+
+    This file is part of CopyQ.
+
+    CopyQ is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    CopyQ is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with CopyQ.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#ifndef SCRIPTENGINEPOOL_H
+#define SCRIPTENGINEPOOL_H
+
+#include <QMap>
+#include <QString>
+#include <QVariantMap>
+
+class QObject;
+class Scriptable;
+class ScriptableProxy;
+
+/**
+ * Statistics for script engines created by acquireScriptable().
+ */
+struct ScriptEngineStats {
+    ScriptEngineStats()
+        : createdCount(0)
+        , reusedCount(0)
+        , totalInitTimeMs(0)
+        , maxInitTimeMs(0)
+    {
+    }
+
+    /// Number of initialized engines (including re-created engines).
+    int createdCount;
+    /// Number of commands which used already initialized engine.
+    int reusedCount;
+    /// Total time spent initializing engines (including plugin scripts).
+    qint64 totalInitTimeMs;
+    qint64 maxInitTimeMs;
+};
+
+/**
+ * Return Scriptable with initialized script engine for current thread.
+ *
+ * Engine (with evaluated @a pluginScript) is created for each thread on first
+ * use and reused for following commands. It's re-created only if @a pluginScript
+ * changes.
+ *
+ * Call releaseScriptable() after command finishes.
+ */
+Scriptable *acquireScriptable(
+        ScriptableProxy *proxy, const QString &currentPath, const QVariantMap &data,
+        const QString &pluginScript);
+
+/**
+ * Reset global variables (and objects reachable from them) of engine,
+ * disconnect signals of @a scriptable and drop its pending queued calls
+ * so it can be used for next command.
+ *
+ * Signals connected to @a scriptable must be disconnected before this call.
+ */
+void releaseScriptable(Scriptable *scriptable);
+
+/**
+ * Set objects available in scripts as properties of global "pluginObjects".
+ *
+ * Slots are called from script threads so objects must be thread-safe.
+ * This affects only engines created later.
+ */
+void setScriptablePluginObjects(const QMap<QString, QObject*> &objects);
+
+/** Initialize script engine for current thread in advance. */
+void warmUpScriptEngine(const QString &pluginScript);
+
+ScriptEngineStats scriptEngineStats();
+
+#endif // SCRIPTENGINEPOOL_H
@@ -27,10 +27,12 @@ FORMS += \
     ui/logdialog.ui
 HEADERS += \
     app/app.h \
+    app/clipboardbatchclient.h \
     app/clipboardclient.h \
     app/clipboardmonitor.h \
     app/clipboardserver.h \
     app/remoteprocess.h \
+    app/shareddatatransfer.h \
     common/action.h \
     common/arguments.h \
     common/client_server.h \
@@ -69,6 +71,7 @@ HEADERS += \
     gui/tabdialog.h \
     gui/tabtree.h \
     gui/tabwidget.h \
+    gui/thumbnailcache.h \
     gui/traymenu.h \
     item/clipboarditem.h \
     item/clipboardmodel.h \
@@ -89,6 +92,7 @@ HEADERS += \
     scriptable/scriptable.h \
     scriptable/scriptableproxy.h \
     scriptable/scriptableworker.h \
+    scriptable/scriptenginepool.h \
     tests/testinterface.h \
     app/client.h \
     common/mimetypes.h \
@@ -118,14 +122,26 @@ HEADERS += \
     common/appconfig.h \
     gui/tabicons.h \
     item/itemstore.h \
+    item/itemjournal.h \
+    item/mappeditemdata.h \
+    item/itembackgroundloader.h \
+    item/itembackgroundsaver.h \
+    item/itemtextindex.h \
+    item/itemsearch.h \
+    item/itemblobstore.h \
     gui/theme.h \
-    gui/menuitems.h
+    gui/menuitems.h \
+    common/datafingerprint.h \
+    item/rowheights.h \
+    common/trace.h
 SOURCES += \
     app/app.cpp \
+    app/clipboardbatchclient.cpp \
     app/clipboardclient.cpp \
     app/clipboardmonitor.cpp \
     app/clipboardserver.cpp \
     app/remoteprocess.cpp \
+    app/shareddatatransfer.cpp \
     common/action.cpp \
     common/arguments.cpp \
     common/client_server.cpp \
@@ -161,6 +177,7 @@ SOURCES += \
     gui/tabdialog.cpp \
     gui/tabtree.cpp \
     gui/tabwidget.cpp \
+    gui/thumbnailcache.cpp \
     gui/traymenu.cpp \
     item/clipboarditem.cpp \
     item/clipboardmodel.cpp \
@@ -180,6 +197,7 @@ SOURCES += \
     scriptable/scriptable.cpp \
     scriptable/scriptableproxy.cpp \
     scriptable/scriptableworker.cpp \
+    scriptable/scriptenginepool.cpp \
     app/client.cpp \
     common/mimetypes.cpp \
     common/log.cpp \
@@ -204,8 +222,18 @@ SOURCES += \
     common/appconfig.cpp \
     gui/tabicons.cpp \
     item/itemstore.cpp \
+    item/itemjournal.cpp \
+    item/mappeditemdata.cpp \
+    item/itembackgroundloader.cpp \
+    item/itembackgroundsaver.cpp \
+    item/itemtextindex.cpp \
+    item/itemsearch.cpp \
+    item/itemblobstore.cpp \
     gui/theme.cpp \
-    gui/menuitems.cpp
+    gui/menuitems.cpp \
+    common/datafingerprint.cpp \
+    item/rowheights.cpp \
+    common/trace.cpp
 
 macx {
     # Copy the custom Info.plist to the app bundle
@@ -221,8 +249,8 @@ greaterThan(QT_MAJOR_VERSION, 4): QT += widgets
 CONFIG(debug, debug|release) {
     DEFINES += HAS_TESTS COPYQ_DEBUG
     QT += testlib
-    SOURCES += tests/tests.cpp
-    HEADERS += tests/tests.h
+    SOURCES += tests/tests.cpp tests/benchmarks.cpp
+    HEADERS += tests/tests.h tests/benchmarks.h
 }
 
 include(platform/platform.pri)
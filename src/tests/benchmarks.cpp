@@ -0,0 +1,442 @@
+/*
+    Copyright (c) 2016, Lukas Holecek <hluk@email.cz>
+
+    This file is part of CopyQ.
+
+    CopyQ is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    CopyQ is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with CopyQ.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#include "benchmarks.h"
+#include "test_utils.h"
+
+#include "common/common.h"
+#include "common/mimetypes.h"
+#include "common/version.h"
+#include "item/clipboarditem.h"
+#include "item/clipboardmodel.h"
+#include "item/itemfactory.h"
+#include "item/serialize.h"
+
+#include <QApplication>
+#include <QBuffer>
+#include <QClipboard>
+#include <QDataStream>
+#include <QImage>
+#include <QMap>
+#include <QRegExp>
+#include <QTest>
+#include <QXmlStreamReader>
+
+namespace {
+
+QByteArray imageData(int i)
+{
+    static QList<QByteArray> images;
+
+    if ( images.isEmpty() ) {
+        for (int j = 0; j < 16; ++j) {
+            QImage image(32, 32, QImage::Format_RGB32);
+            image.fill( qRgb(j * 16, 255 - j * 16, 128) );
+
+            QByteArray bytes;
+            QBuffer buffer(&bytes);
+            buffer.open(QIODevice::WriteOnly);
+            image.save(&buffer, "PNG");
+            images.append(bytes);
+        }
+    }
+
+    return images[i % images.size()];
+}
+
+/// Create data for synthetic item of given @a kind ("text", "html" or "image").
+QVariantMap createItemData(const QString &kind, int i)
+{
+    QVariantMap data;
+
+    if (kind == "image") {
+        data.insert("image/png", imageData(i));
+    } else {
+        const QString text =
+                QString("Item %1: The quick brown fox jumps over the lazy dog.").arg(i);
+        data.insert(mimeText, text.toUtf8());
+        if (kind == "html")
+            data.insert(mimeHtml, QString("<p><b>%1</b></p>").arg(text).toUtf8());
+    }
+
+    return data;
+}
+
+QList<QVariantMap> createItems(const QString &kind, int count)
+{
+    QList<QVariantMap> items;
+    items.reserve(count);
+    for (int i = 0; i < count; ++i)
+        items.append( createItemData(kind, i) );
+    return items;
+}
+
+void fillModel(ClipboardModel *model, const QString &kind, int count)
+{
+    model->setMaxItems(count);
+    model->insertItems( createItems(kind, count), 0 );
+}
+
+/// Add data rows for each item kind and tab size.
+void addItemsData()
+{
+    QTest::addColumn<QString>("kind");
+    QTest::addColumn<int>("count");
+
+    const char *kinds[] = {"text", "html", "image"};
+    const int counts[] = {1000, 10000, 100000};
+
+    for (int i = 0; i < 3; ++i) {
+        for (int j = 0; j < 3; ++j) {
+            const QByteArray tag = QByteArray(kinds[i]) + " " + QByteArray::number(counts[j]);
+            QTest::newRow( tag.constData() ) << QString(kinds[i]) << counts[j];
+        }
+    }
+}
+
+/// Return raw value of string or number field @a name in JSON object on single line.
+QString jsonField(const QString &line, const QString &name)
+{
+    QRegExp re( QRegExp::escape(jsonString(name)) + ": (\"[^\"]*\"|\\d+)" );
+    return re.indexIn(line) == -1 ? QString() : re.cap(1);
+}
+
+/**
+ * Return time (in microseconds) from first recorded event of each clipboard
+ * change until new item was added to server.
+ *
+ * Parses events (one per line) from trace JSON (see traceEventsToJson()).
+ */
+QList<qint64> clipboardToItemLatencies(const QByteArray &traceJson)
+{
+    QMap<QString, qint64> startUs;
+    QMap<QString, qint64> endUs;
+
+    foreach ( const QByteArray &bytes, traceJson.split('\n') ) {
+        const QString line = QString::fromUtf8(bytes);
+        const QString id = jsonField(line, "id");
+        if ( id.isEmpty() )
+            continue;
+
+        const qint64 ts = jsonField(line, "ts").toLongLong();
+        if ( !startUs.contains(id) || ts < startUs[id] )
+            startUs[id] = ts;
+
+        if ( jsonField(line, "name") == jsonString("server: add item") )
+            endUs[id] = ts + jsonField(line, "dur").toLongLong();
+    }
+
+    QList<qint64> latencies;
+    for ( QMap<QString, qint64>::const_iterator it = endUs.constBegin(); it != endUs.constEnd(); ++it )
+        latencies.append( it.value() - startUs[it.key()] );
+
+    return latencies;
+}
+
+QString jsonNumber(double value)
+{
+    return QString::number(value, 'g', 12);
+}
+
+/// Append benchmark results from QtTest XML output as JSON objects.
+bool readBenchmarkResults(QIODevice *xmlInput, QStringList *results)
+{
+    QXmlStreamReader xml(xmlInput);
+    QString testFunction;
+
+    while ( !xml.atEnd() ) {
+        xml.readNext();
+        if ( !xml.isStartElement() )
+            continue;
+
+        const QXmlStreamAttributes attributes = xml.attributes();
+        if ( xml.name() == QLatin1String("TestFunction") ) {
+            testFunction = attributes.value(QLatin1String("name")).toString();
+        } else if ( xml.name() == QLatin1String("BenchmarkResult") ) {
+            const double value = attributes.value(QLatin1String("value")).toString().toDouble();
+            const int iterations = attributes.value(QLatin1String("iterations")).toString().toInt();
+            results->append(
+                        QString("    {\"name\": %1, \"tag\": %2, \"metric\": %3,"
+                                " \"value\": %4, \"iterations\": %5, \"valuePerIteration\": %6}")
+                        .arg( jsonString(testFunction) )
+                        .arg( jsonString(attributes.value(QLatin1String("tag")).toString()) )
+                        .arg( jsonString(attributes.value(QLatin1String("metric")).toString()) )
+                        .arg( jsonNumber(value) )
+                        .arg(iterations)
+                        .arg( jsonNumber(iterations > 0 ? value / iterations : value) ) );
+        }
+    }
+
+    return !xml.hasError();
+}
+
+} // namespace
+
+Benchmarks::Benchmarks(const TestInterfacePtr &test, QObject *parent)
+    : QObject(parent)
+    , m_test(test)
+{
+}
+
+void Benchmarks::cleanupTestCase()
+{
+    if ( m_test->isServerRunning() )
+        TEST( m_test->stopServer() );
+}
+
+void Benchmarks::serializeTab_data()
+{
+    addItemsData();
+}
+
+void Benchmarks::serializeTab()
+{
+    QFETCH(QString, kind);
+    QFETCH(int, count);
+
+    ClipboardModel model;
+    fillModel(&model, kind, count);
+
+    QByteArray bytes;
+    QBENCHMARK {
+        bytes.clear();
+        QDataStream stream(&bytes, QIODevice::WriteOnly);
+        QVERIFY( serializeData(model, &stream) );
+    }
+}
+
+void Benchmarks::deserializeTab_data()
+{
+    addItemsData();
+}
+
+void Benchmarks::deserializeTab()
+{
+    QFETCH(QString, kind);
+    QFETCH(int, count);
+
+    QByteArray bytes;
+    {
+        ClipboardModel model;
+        fillModel(&model, kind, count);
+        QDataStream stream(&bytes, QIODevice::WriteOnly);
+        QVERIFY( serializeData(model, &stream) );
+    }
+
+    QBENCHMARK {
+        ClipboardModel model;
+        model.setMaxItems(count);
+        QDataStream stream(bytes);
+        QVERIFY( deserializeData(&model, &stream) );
+        QCOMPARE( model.rowCount(), count );
+    }
+}
+
+void Benchmarks::insertItems_data()
+{
+    addItemsData();
+}
+
+void Benchmarks::insertItems()
+{
+    QFETCH(QString, kind);
+    QFETCH(int, count);
+
+    const QList<QVariantMap> items = createItems(kind, count);
+
+    // New items are added to the top as with clipboard changes.
+    QBENCHMARK {
+        ClipboardModel model;
+        model.setMaxItems(count);
+        foreach (const QVariantMap &data, items)
+            model.insertItem(data, 0);
+        QCOMPARE( model.rowCount(), count );
+    }
+}
+
+void Benchmarks::moveItems_data()
+{
+    addItemsData();
+}
+
+void Benchmarks::moveItems()
+{
+    QFETCH(QString, kind);
+    QFETCH(int, count);
+
+    ClipboardModel model;
+    fillModel(&model, kind, count);
+
+    // Move last item to the top (e.g. activated old item).
+    QBENCHMARK {
+        for (int i = 0; i < 1000; ++i)
+            QVERIFY( model.move(count - 1, 0) );
+    }
+}
+
+void Benchmarks::removeItems_data()
+{
+    addItemsData();
+}
+
+void Benchmarks::removeItems()
+{
+    QFETCH(QString, kind);
+    QFETCH(int, count);
+
+    ClipboardModel model;
+    fillModel(&model, kind, count);
+
+    // Remove items one by one from the middle of the list.
+    QBENCHMARK_ONCE {
+        for (int i = 0; i < 1000; ++i)
+            QVERIFY( model.removeRows(model.rowCount() / 2, 1) );
+    }
+}
+
+void Benchmarks::dataHash_data()
+{
+    addItemsData();
+}
+
+void Benchmarks::dataHash()
+{
+    QFETCH(QString, kind);
+    QFETCH(int, count);
+
+    const QList<QVariantMap> items = createItems(kind, count);
+
+    // Hash is cached in item so new items need to be created.
+    QBENCHMARK {
+        uint hash = 0;
+        foreach (const QVariantMap &data, items) {
+            ClipboardItem item;
+            item.setData(data);
+            hash ^= item.dataHash();
+        }
+        Q_UNUSED(hash);
+    }
+}
+
+void Benchmarks::matchItems_data()
+{
+    addItemsData();
+}
+
+void Benchmarks::matchItems()
+{
+    QFETCH(QString, kind);
+    QFETCH(int, count);
+
+    ItemFactory itemFactory;
+    ClipboardModel model;
+    fillModel(&model, kind, count);
+
+    const QRegExp re("item 12.*fox", Qt::CaseInsensitive);
+
+    QBENCHMARK {
+        int matched = 0;
+        for (int row = 0; row < count; ++row) {
+            if ( itemFactory.matches(model.index(row), re) )
+                ++matched;
+        }
+        Q_UNUSED(matched);
+    }
+}
+
+void Benchmarks::addCommand()
+{
+    TEST( m_test->init() );
+
+    QBENCHMARK {
+        QCOMPARE( m_test->run(Args("add") << "A"), 0 );
+    }
+}
+
+void Benchmarks::readCommand()
+{
+    TEST( m_test->init() );
+    RUN("add" << "A", "");
+
+    QBENCHMARK {
+        QByteArray out;
+        QCOMPARE( m_test->run(Args("read") << "0", &out), 0 );
+        QCOMPARE( out, QByteArray("A") );
+    }
+}
+
+void Benchmarks::evalCommand()
+{
+    TEST( m_test->init() );
+
+    QBENCHMARK {
+        QByteArray out;
+        QCOMPARE( m_test->run(Args("eval") << "1+1", &out), 0 );
+        QCOMPARE( out, QByteArray("2\n") );
+    }
+}
+
+void Benchmarks::clipboardToItem()
+{
+    TEST( m_test->init() );
+    RUN("trace" << "start", "");
+
+    // Clipboard is changed repeatedly; waiting for the item doesn't affect the result
+    // since latencies are read from recorded trace events.
+    QClipboard *clipboard = QApplication::clipboard();
+    const int count = 20;
+    for (int i = 0; i < count; ++i) {
+        const QByteArray text = "Clipboard " + QByteArray::number(i);
+        clipboard->setText( QString::fromUtf8(text) );
+        WAIT_ON_OUTPUT("read" << "0", text);
+    }
+
+    QByteArray trace;
+    TEST( m_test->getClientOutput(Args("trace") << "stop", &trace) );
+
+    const QList<qint64> latencies = clipboardToItemLatencies(trace);
+    QCOMPARE( latencies.size(), count );
+
+    qint64 sumUs = 0;
+    foreach (qint64 latencyUs, latencies)
+        sumUs += latencyUs;
+
+    QTest::setBenchmarkResult( sumUs / 1000.0 / count, QTest::WalltimeMilliseconds );
+}
+
+bool writeBenchmarkResultsAsJson(const QList<QIODevice*> &xmlInputs, QIODevice *jsonOutput)
+{
+    QStringList results;
+    foreach (QIODevice *xmlInput, xmlInputs) {
+        if ( !readBenchmarkResults(xmlInput, &results) )
+            return false;
+    }
+
+    const QString json =
+            "{\n"
+            "  \"version\": " + jsonString(COPYQ_VERSION) + ",\n"
+            "  \"qt\": " + jsonString(qVersion()) + ",\n"
+            "  \"results\": [\n"
+            + results.join(",\n") + "\n"
+            "  ]\n"
+            "}\n";
+
+    return jsonOutput->write( json.toUtf8() ) != -1;
+}
@@ -0,0 +1,84 @@
+/*
+    Copyright (c) 2016, Lukas Holecek <hluk@email.cz>
+
+    This file is part of CopyQ.
+
+    CopyQ is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    CopyQ is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with CopyQ.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#ifndef BENCHMARKS_H
+#define BENCHMARKS_H
+
+#include "tests/testinterface.h"
+
+#include <QList>
+#include <QObject>
+
+class QIODevice;
+
+/**
+ * Benchmarks for item data handling and for client/server round-trips.
+ *
+ * Run with "copyq benchmarks [-json FILE] [QtTest arguments]".
+ *
+ * Test functions of plugin tests with "benchmark" prefix are run as well
+ * (if no core benchmarks are selected in arguments).
+ */
+class Benchmarks : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit Benchmarks(const TestInterfacePtr &test, QObject *parent = NULL);
+
+private slots:
+    void cleanupTestCase();
+
+    void serializeTab_data();
+    void serializeTab();
+    void deserializeTab_data();
+    void deserializeTab();
+
+    void insertItems_data();
+    void insertItems();
+    void moveItems_data();
+    void moveItems();
+    void removeItems_data();
+    void removeItems();
+
+    void dataHash_data();
+    void dataHash();
+
+    void matchItems_data();
+    void matchItems();
+
+    void addCommand();
+    void readCommand();
+    void evalCommand();
+
+    void clipboardToItem();
+
+private:
+    TestInterfacePtr m_test;
+};
+
+/**
+ * Convert benchmark results from QtTest XML outputs to JSON.
+ *
+ * @return false if XML cannot be parsed
+ */
+bool writeBenchmarkResultsAsJson(const QList<QIODevice*> &xmlInputs, QIODevice *jsonOutput);
+
+#endif // BENCHMARKS_H
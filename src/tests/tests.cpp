@@ -19,23 +19,31 @@
 
 #include "tests.h"
 #include "test_utils.h"
+#include "benchmarks.h"
 
 #include "app/remoteprocess.h"
 #include "common/client_server.h"
 #include "common/common.h"
+#include "common/contenttype.h"
+#include "common/datafingerprint.h"
 #include "common/mimetypes.h"
 #include "common/monitormessagecode.h"
 #include "common/version.h"
+#include "item/clipboardmodel.h"
 #include "item/itemfactory.h"
 #include "item/itemwidget.h"
+#include "item/mappeditemdata.h"
+#include "item/rowheights.h"
 #include "item/serialize.h"
 #include "gui/configtabshortcuts.h"
 
 #include <QApplication>
 #include <QClipboard>
 #include <QDir>
+#include <QFile>
 #include <QFileInfo>
 #include <QMap>
+#include <QMetaMethod>
 #include <QMimeData>
 #include <QProcess>
 #include <QRegExp>
@@ -43,6 +51,7 @@
 #include <QTemporaryFile>
 #include <QTest>
 #include <QThread>
+#include <QVector>
 
 namespace {
 
@@ -525,6 +534,50 @@ QString keyNameFor(QKeySequence::StandardKey standardKey)
     return QKeySequence(standardKey).toString();
 }
 
+/**
+ * Run benchmarks in @a testObject with QtTest @a arguments
+ * and save results in XML to @a xmlFile.
+ */
+int execBenchmarks(QObject *testObject, QList<QByteArray> arguments, QTemporaryFile *xmlFile)
+{
+    if ( !xmlFile->open() ) {
+        qWarning() << "Failed to create temporary file for benchmark results";
+        return 1;
+    }
+    xmlFile->close();
+    arguments << "-xml" << "-o" << QFile::encodeName( xmlFile->fileName() );
+
+    QVector<char*> benchmarkArgv;
+    for (int i = 0; i < arguments.size(); ++i)
+        benchmarkArgv.append( arguments[i].data() );
+
+    return QTest::qExec(testObject, benchmarkArgv.size(), benchmarkArgv.data());
+}
+
+/// Return names of test functions with "benchmark" prefix.
+QList<QByteArray> benchmarkNames(const QObject *testObject)
+{
+    QList<QByteArray> names;
+
+    const QMetaObject *metaObject = testObject->metaObject();
+    for (int i = metaObject->methodOffset(); i < metaObject->methodCount(); ++i) {
+        const QMetaMethod method = metaObject->method(i);
+        if ( method.methodType() != QMetaMethod::Slot )
+            continue;
+
+#if QT_VERSION < 0x050000
+        const QByteArray signature = method.signature();
+#else
+        const QByteArray signature = method.methodSignature();
+#endif
+        const QByteArray name = signature.left( signature.indexOf('(') );
+        if ( name.startsWith("benchmark") )
+            names.append(name);
+    }
+
+    return names;
+}
+
 } // namespace
 
 Tests::Tests(const TestInterfacePtr &test, QObject *parent)
@@ -684,6 +737,50 @@ void Tests::searchItems()
     RUN(args << "size", "2\n");
 }
 
+void Tests::searchItemsWithTextIndex()
+{
+    const QString tab = testTab(1);
+    const Args args = Args("tab") << tab << "separator" << " ";
+
+    RUN(args << "add" << "ABCD DEF" << "xyz abc" << "bcd" << "abcdef", "");
+
+    // search and delete (text is indexed on first search);
+    // filter is case-insensitive regular expression by default
+    RUN(args << "keys" << "RIGHT" << ":abcd" << "TAB", "");
+    waitFor(waitMsSearch);
+    RUN(args << "keys" << "CTRL+A" << m_test->shortcutToRemove() << "ESC", "");
+    RUN(args << "read" << "0" << "1", "bcd xyz abc");
+    RUN(args << "size", "2\n");
+
+    // search again with updated index
+    RUN(args << "add" << "xyz bcd", "");
+    RUN(args << "keys" << ":xyz" << "TAB", "");
+    waitFor(waitMsSearch);
+    RUN(args << "keys" << "CTRL+A" << m_test->shortcutToRemove() << "ESC", "");
+    RUN(args << "read" << "0", "bcd");
+    RUN(args << "size", "1\n");
+}
+
+void Tests::searchManyItems()
+{
+    const QString tab = testTab(1);
+    const Args args = Args("tab") << tab;
+
+    RUN("config" << "maxitems" << "1000", "");
+
+    // Items are searched in multiple threads.
+    RUN(args << "eval" << "for (i = 0; i < 1000; ++i) add('item ' + i)", "");
+    RUN(args << "size", "1000\n");
+    RUN(args << "keys" << "RIGHT" << ":item 99" << "TAB", "");
+    waitFor(waitMsSearch);
+    RUN(args << "keys" << "CTRL+A" << m_test->shortcutToRemove() << "ESC", "");
+    // Filter "item 99" matches "item 99" and "item 990" ... "item 999".
+    RUN(args << "size", "989\n");
+    RUN(args << "read" << "0" << "1" << "2", "item 989\nitem 988\nitem 987");
+
+    RUN("config" << "maxitems" << "200", "");
+}
+
 void Tests::copyItems()
 {
     const QString tab = testTab(1);
@@ -927,6 +1024,62 @@ void Tests::clipboardToItem()
     RUN("read" << "0", bytes);
 }
 
+void Tests::clipboardBigData()
+{
+    // Big data are passed between server and monitor in shared memory.
+    const int size = 2 * 1024 * 1024;
+
+    const QByteArray data1 = QByteArray(size, 'x') + generateData();
+    TEST( m_test->setClipboard(data1) );
+    RUN("read" << "0", data1);
+
+    const QByteArray data2 = QByteArray(size, 'y');
+    RUN("eval" << "copy(new Array(" + QString::number(size + 1) + ").join('y'))", "true\n");
+    QVERIFY( waitUntilClipboardSet(data2) );
+    RUN("clipboard", data2);
+}
+
+void Tests::clipboardTrace()
+{
+    RUN("trace" << "start", "");
+
+    const QByteArray data = generateData();
+    TEST( m_test->setClipboard(data) );
+    RUN("read" << "0", data);
+
+    QByteArray stdoutActual;
+    QByteArray stderrActual;
+    QCOMPARE( run(Args("trace") << "stop", &stdoutActual, &stderrActual), 0 );
+    QVERIFY2( testStderr(stderrActual), stderrActual );
+    QVERIFY( stdoutActual.startsWith("{\"traceEvents\":") );
+    QVERIFY( stdoutActual.contains("\"CopyQ server\"") );
+    QVERIFY( stdoutActual.contains("\"server: clipboard changed\"") );
+    QVERIFY( stdoutActual.contains("\"server: add item\"") );
+
+    // Recorded events are dropped after tracing stops.
+    RUN("trace" << "stop", "{\"traceEvents\": [\n], \"displayTimeUnit\": \"ms\"}\n");
+}
+
+void Tests::moveDuplicateClipboardItemToTop()
+{
+    RUN("add" << "A" << "B" << "C" << "D", "");
+
+    TEST( m_test->setClipboard("B") );
+    RUN("clipboard", "B");
+    RUN("read" << "0" << "1" << "2" << "3", "B\nD\nC\nA");
+
+    // Existing items are still found after other items are removed and moved.
+    RUN("remove" << "1", "");
+    TEST( m_test->setClipboard("A") );
+    RUN("clipboard", "A");
+    RUN("read" << "0" << "1" << "2", "A\nB\nC");
+
+    TEST( m_test->setClipboard("C") );
+    RUN("clipboard", "C");
+    RUN("read" << "0" << "1" << "2", "C\nA\nB");
+    RUN("size", "3\n");
+}
+
 void Tests::itemToClipboard()
 {
     RUN("add" << "TESTING2" << "TESTING1", "");
@@ -1029,6 +1182,11 @@ void Tests::action()
     RUN(argsAction << action.arg("read 0") << ",", "");
     WAIT_ON_OUTPUT(args << "size", "6\n");
     RUN(args << "read" << "0" << "1" << "2", "C\nB\nA");
+
+    // action with script (runs in server process) reading input
+    RUN(argsAction << "0" << "copyq: print(str(input()).toLowerCase())" << "", "");
+    WAIT_ON_OUTPUT(args << "size", "7\n");
+    RUN(args << "read" << "0", "c");
 }
 
 void Tests::insertRemoveItems()
@@ -1050,6 +1208,126 @@ void Tests::insertRemoveItems()
     RUN(args << "read" << "0" << "1" << "2" << "3" << "4", "abc,ABC,ghi,,");
 }
 
+void Tests::readWriteRemoveItems()
+{
+    const Args args = Args("tab") << testTab(1) << "separator" << ",";
+
+    RUN(args << "eval" << "writeItems(0, [{'text/plain': 'a'}, {'text/plain': 'b', 'DATA': 'x'}, {'text/plain': 'c'}])", "");
+    RUN(args << "read" << "0" << "1" << "2" << "3", "a,b,c,");
+    RUN(args << "read" << "DATA" << "1", "x");
+
+    RUN(args << "eval" << "print(readItems().map(function(item) { return str(item['text/plain']) }))", "a,b,c");
+    RUN(args << "eval" << "print(readItems(1, 2, 'DATA').map(function(item) { return item['DATA'] ? str(item['DATA']) : '' }))", "x,");
+    RUN(args << "eval" << "print(readItems(1, 2147483647).map(function(item) { return str(item['text/plain']) }))", "b,c");
+
+    RUN(args << "eval" << "writeItems(1, readItems(0, 2))", "");
+    RUN(args << "read" << "0" << "1" << "2" << "3" << "4" << "5", "a,a,b,b,c,");
+
+    RUN(args << "eval" << "removeItems(0, 2, 3, 1)", "");
+    RUN(args << "read" << "0" << "1" << "2", "b,c,");
+
+    // Overlapping ranges are removed at once and huge count removes all remaining items.
+    RUN(args << "eval" << "writeItems(0, [{'text/plain': '1'}, {'text/plain': '2'}, {'text/plain': '3'}, {'text/plain': '4'}])", "");
+    RUN(args << "eval" << "removeItems(1, 2, 2, 2)", "");
+    RUN(args << "read" << "0" << "1" << "2" << "3", "1,b,c,");
+    RUN(args << "eval" << "removeItems(1, 2147483647)", "");
+    RUN(args << "read" << "0" << "1", "1,");
+}
+
+void Tests::restoreItemsAfterRestart()
+{
+    const Args args = Args("tab") << testTab(1) << "separator" << ",";
+
+    RUN(args << "add" << "ghi" << "def" << "abc", "");
+    RUN(args << "insert" << "1" << "ABC", "");
+    RUN(args << "remove" << "3", "");
+    RUN(args << "write" << "0" << "text/plain" << "012", "");
+    RUN(args << "change" << "1" << "text/plain" << "xyz", "");
+    RUN(args << "read" << "0" << "1" << "2" << "3" << "4", "012,xyz,ABC,def,");
+
+    // Items are saved when server exits.
+    TEST( m_test->stopServer() );
+    TEST( m_test->startServer() );
+
+    RUN(args << "read" << "0" << "1" << "2" << "3" << "4", "012,xyz,ABC,def,");
+    RUN(args << "size", "4\n");
+}
+
+void Tests::restoreMappedItemsAfterRestart()
+{
+    RUN("config" << "map_item_data" << "true", "");
+
+    const Args args = Args("tab") << testTab(1);
+    const QString image = QString("0123456789").repeated(200);
+
+    RUN(args << "write" << "image/png" << image, "");
+    RUN(args << "add" << "abc", "");
+    TEST( m_test->stopServer() );
+    TEST( m_test->startServer() );
+
+    // Item data are loaded on demand.
+    RUN(args << "read" << "image/png" << "1", image);
+    RUN(args << "read" << "0", "abc");
+
+    // Changing item keeps data which were not loaded yet.
+    RUN(args << "change" << "1" << "text/plain" << "xyz", "");
+    TEST( m_test->stopServer() );
+    TEST( m_test->startServer() );
+
+    RUN(args << "read" << "image/png" << "1", image);
+    RUN(args << "read" << "1", "xyz");
+    RUN(args << "size", "2\n");
+
+    RUN("config" << "map_item_data" << "false", "");
+}
+
+void Tests::shareItemDataBetweenTabs()
+{
+    RUN("config" << "deduplicate_item_data" << "true", "");
+
+    const Args args1 = Args("tab") << testTab(1);
+    const Args args2 = Args("tab") << testTab(2);
+    const QString image = QString("0123456789").repeated(2000);
+
+    // Big data are saved only once for both tabs.
+    RUN(args1 << "write" << "image/png" << image, "");
+    RUN(args2 << "write" << "image/png" << image, "");
+    RUN(args2 << "add" << "abc", "");
+    TEST( m_test->stopServer() );
+    TEST( m_test->startServer() );
+
+    RUN(args1 << "read" << "image/png" << "0", image);
+    RUN(args2 << "read" << "image/png" << "1", image);
+
+    // Removing item from one tab keeps data in the other tab.
+    RUN(args1 << "remove" << "0", "");
+    TEST( m_test->stopServer() );
+    TEST( m_test->startServer() );
+
+    RUN(args1 << "size", "0\n");
+    RUN(args2 << "read" << "image/png" << "1", image);
+    RUN(args2 << "read" << "0", "abc");
+
+    RUN("config" << "deduplicate_item_data" << "false", "");
+}
+
+void Tests::loadItemsInBackground()
+{
+    RUN("eval" << "for (i = 0; i < 150; ++i) add(i)", "");
+    TEST( m_test->stopServer() );
+    TEST( m_test->startServer() );
+
+    // Items in visible tab are loaded in background.
+    RUN("show", "");
+
+    // Commands wait for all items to load.
+    RUN("size", "150\n");
+    RUN("read" << "0" << "149", "149\n0");
+    RUN("remove" << "0", "");
+    RUN("read" << "0", "148");
+    RUN("size", "149\n");
+}
+
 void Tests::renameTab()
 {
     const QString tab1 = testTab(1);
@@ -1141,6 +1419,52 @@ void Tests::eval()
     RUN("eval" << QString("tab('%1');if (size() === 1) print('ok')").arg(tab2), "ok");
     RUN("eval" << QString("tab('%1');if (str(read(0)) === 'abc') print('ok')").arg(tab1), "ok");
     RUN("eval" << QString("tab('%1');if (str(read(0)) === 'def') print('ok')").arg(tab2), "ok");
+
+    // Global variables are not shared between commands.
+    RUN("eval" << "var x = 1; print(typeof x)", "number");
+    RUN("eval" << "print(typeof x)", "undefined");
+
+    // Changes in built-in objects are not shared between commands.
+    RUN("eval" << "Array.prototype.x = 1; Math.max = function() { return -1 }; print(Math.max(1, 2))", "-1");
+    RUN("eval" << "print(typeof [].x + ' ' + Math.max(1, 2))", "undefined 2");
+}
+
+void Tests::batchCommands()
+{
+    const QString tab = testTab(1);
+    RUN(Args("tab") << tab << "add" << "A" << "B", "");
+
+    const QByteArray input = QString(
+            "1\ttab\t%1\tread\t0\n"
+            "2\ttab\t%1\tsize\n"
+            "3\teval\tx\n").arg(tab).toUtf8();
+
+    QByteArray stdoutActual;
+    QByteArray stderrActual;
+    QCOMPARE( run(Args("--batch"), &stdoutActual, &stderrActual, input), 0 );
+    QVERIFY2( testStderr(stderrActual), stderrActual );
+
+    // Responses can be in any order.
+    QList<QByteArray> responses = stdoutActual.split('\n');
+    QCOMPARE( responses.takeLast(), QByteArray() );
+    qSort(responses);
+    QCOMPARE( responses.size(), 3 );
+    QCOMPARE( responses[0], QByteArray("1\t0\tB") );
+    QCOMPARE( responses[1], QByteArray("2\t0\t2\\n") );
+    QVERIFY2( responses[2].startsWith("3\t1\t"), responses[2] );
+
+    // Arguments are unescaped the same way as output is escaped.
+    const QByteArray escapedText = "a\\tb\\\\c\\nd\\r";
+    const QByteArray addInput = "1\ttab\t" + tab.toUtf8() + "\tadd\t" + escapedText + "\n";
+    QCOMPARE( run(Args("--batch"), &stdoutActual, &stderrActual, addInput), 0 );
+    QVERIFY2( testStderr(stderrActual), stderrActual );
+    QCOMPARE( stdoutActual, QByteArray("1\t0\t\n") );
+    RUN(Args("tab") << tab << "read" << "0", "a\tb\\c\nd\r");
+
+    const QByteArray readInput = "1\ttab\t" + tab.toUtf8() + "\tread\t0\n";
+    QCOMPARE( run(Args("--batch"), &stdoutActual, &stderrActual, readInput), 0 );
+    QVERIFY2( testStderr(stderrActual), stderrActual );
+    QCOMPARE( stdoutActual, "1\t0\t" + escapedText + "\n" );
 }
 
 void Tests::rawData()
@@ -1689,6 +2013,108 @@ void Tests::setEnvCommand()
         );
 }
 
+void Tests::rowHeights()
+{
+    RowHeights heights;
+    heights.insert(0, 3, 10);
+    heights.setHeight(1, 20);
+    heights.setHeight(2, 30);
+    QCOMPARE( heights.count(), 3 );
+    QCOMPARE( heights.totalHeight(), 60 );
+
+    // Each row takes its height and spacing.
+    QCOMPARE( heights.offset(0, 2), 0 );
+    QCOMPARE( heights.offset(1, 2), 12 );
+    QCOMPARE( heights.offset(2, 2), 34 );
+    QCOMPARE( heights.offset(3, 2), 66 );
+
+    QCOMPARE( heights.rowAt(0, 2), 0 );
+    QCOMPARE( heights.rowAt(11, 2), 0 );
+    QCOMPARE( heights.rowAt(12, 2), 1 );
+    QCOMPARE( heights.rowAt(33, 2), 1 );
+    QCOMPARE( heights.rowAt(34, 2), 2 );
+    QCOMPARE( heights.rowAt(65, 2), 2 );
+    QCOMPARE( heights.rowAt(66, 2), 3 );
+
+    // Heights: 10 5 5 20 30
+    heights.insert(1, 2, 5);
+    QCOMPARE( heights.count(), 5 );
+    QCOMPARE( heights.totalHeight(), 70 );
+    QCOMPARE( heights.offset(3), 20 );
+    QCOMPARE( heights.rowAt(19), 2 );
+    QCOMPARE( heights.rowAt(20), 3 );
+
+    // Heights: 10 15 5 20 30
+    heights.setHeight(1, 15);
+    QCOMPARE( heights.totalHeight(), 80 );
+    QCOMPARE( heights.offset(4), 50 );
+    QCOMPARE( heights.rowAt(49), 3 );
+    QCOMPARE( heights.rowAt(50), 4 );
+
+    // Heights: 10 20 30
+    heights.remove(1, 2);
+    QCOMPARE( heights.count(), 3 );
+    QCOMPARE( heights.totalHeight(), 60 );
+    QCOMPARE( heights.offset(2), 30 );
+    QCOMPARE( heights.rowAt(29), 1 );
+
+    // Heights: 20 30 10
+    heights.move(0, 2);
+    QCOMPARE( heights.height(0), 20 );
+    QCOMPARE( heights.height(2), 10 );
+    QCOMPARE( heights.offset(2, 1), 52 );
+    QCOMPARE( heights.rowAt(52, 1), 2 );
+    QCOMPARE( heights.totalHeight(), 60 );
+
+    // Heights: 10 20 30
+    heights.move(2, 0);
+    QCOMPARE( heights.height(0), 10 );
+    QCOMPARE( heights.offset(2), 30 );
+}
+
+void Tests::fingerprintHashValues()
+{
+    // Known values of XXH64 with seed 0.
+    QCOMPARE( fingerprintHash(QByteArray()), Q_UINT64_C(0xEF46DB3751D8E999) );
+    QCOMPARE( fingerprintHash("abc"), Q_UINT64_C(0x44BC2CF5AD770999) );
+    QCOMPARE( fingerprintHash("Nobody inspects the spammish repetition"),
+              Q_UINT64_C(0xFBCEA83C8A378BF1) );
+
+    const DataFingerprint fingerprint = dataFingerprint("abc");
+    QCOMPARE( fingerprint.size, 3 );
+    QVERIFY( fingerprint == dataFingerprint("abc") );
+    QVERIFY( fingerprint != dataFingerprint("abd") );
+}
+
+void Tests::hashMappedItemsWithoutLoading()
+{
+    QVariantMap data;
+    data.insert(mimeText, QByteArray("TEST"));
+    data.insert("image/png", QByteArray(4096, 'x'));
+    data.insert(mimeWindowTitle, QByteArray("Window"));
+
+    QTemporaryFile file;
+    QVERIFY( file.open() );
+
+    ClipboardModel model;
+    model.setMapItemData(true);
+    model.insertItem(data, 0);
+    QVERIFY( serializeData(model, &file) );
+    QVERIFY( file.flush() );
+    QVERIFY( file.seek(0) );
+
+    ClipboardModel loadedModel;
+    loadedModel.setMapItemData(true);
+    QVERIFY( deserializeData(&loadedModel, &file) );
+    QCOMPARE( loadedModel.rowCount(), 1 );
+    QVERIFY( isMappedItemFormat(loadedModel.rawItemData(0).value("image/png")) );
+
+    // Hash is computed from stored fingerprints, mapped format stays unloaded.
+    const QModelIndex index = loadedModel.index(0);
+    QCOMPARE( loadedModel.data(index, contentType::hash).toUInt(), hash(data) );
+    QVERIFY( isMappedItemFormat(loadedModel.rawItemData(0).value("image/png")) );
+}
+
 int Tests::run(const QStringList &arguments, QByteArray *stdoutData, QByteArray *stderrData, const QByteArray &in)
 {
     return m_test->run(arguments, stdoutData, stderrData, in);
@@ -1748,3 +2174,81 @@ int runTests(int argc, char *argv[])
 
     return exitCode;
 }
+
+int runBenchmarks(int argc, char *argv[])
+{
+    // Option "-json FILE" sets file for results (default is standard output).
+    QString jsonFileName;
+    QList<QByteArray> arguments;
+    for (int i = 0; i < argc; ++i) {
+        if ( qstrcmp(argv[i], "-json") == 0 && i + 1 < argc )
+            jsonFileName = QString::fromLocal8Bit(argv[++i]);
+        else
+            arguments.append(argv[i]);
+    }
+
+    // Omit plugin benchmarks if specific core benchmarks requested.
+    const bool runPluginBenchmarks = arguments.size() <= 1 || arguments.last().startsWith("-");
+
+    QApplication app(argc, argv);
+
+    // Results are converted to JSON from QtTest XML output.
+    QList< QSharedPointer<QTemporaryFile> > xmlFiles;
+
+    QSharedPointer<TestInterfaceImpl> test(new TestInterfaceImpl);
+    test->setupTest("CORE", QVariant());
+    Benchmarks benchmarks(test);
+    xmlFiles.append( QSharedPointer<QTemporaryFile>(new QTemporaryFile) );
+    int exitCode = execBenchmarks(&benchmarks, arguments, xmlFiles.last().data());
+
+    if (runPluginBenchmarks) {
+        ItemFactory itemFactory;
+        foreach( const ItemLoaderInterface *loader, itemFactory.loaders() ) {
+            QScopedPointer<QObject> pluginTests( loader->tests(test) );
+            if ( pluginTests.isNull() )
+                continue;
+
+            const QList<QByteArray> names = benchmarkNames(pluginTests.data());
+            if ( names.isEmpty() )
+                continue;
+
+            pluginTests->setProperty("CopyQ_benchmarks", true);
+            test->setupTest(loader->id(), pluginTests->property("CopyQ_test_settings"));
+            xmlFiles.append( QSharedPointer<QTemporaryFile>(new QTemporaryFile) );
+            const int pluginExitCode =
+                    execBenchmarks(pluginTests.data(), arguments + names, xmlFiles.last().data());
+            exitCode = qMax(exitCode, pluginExitCode);
+            test->stopServer();
+        }
+    }
+
+    QList<QIODevice*> xmlInputs;
+    foreach ( const QSharedPointer<QTemporaryFile> &xml, xmlFiles ) {
+        if ( !xml->open() ) {
+            qWarning() << "Failed to read benchmark results";
+            return 1;
+        }
+
+        // Print failures.
+        if (exitCode != 0) {
+            QFile ferr;
+            ferr.open(stderr, QIODevice::WriteOnly);
+            ferr.write( xml->readAll() );
+            xml->seek(0);
+        }
+
+        xmlInputs.append( xml.data() );
+    }
+
+    QFile json(jsonFileName);
+    const bool opened = jsonFileName.isEmpty()
+            ? json.open(stdout, QIODevice::WriteOnly)
+            : json.open(QIODevice::WriteOnly | QIODevice::Truncate);
+
+    if ( !opened || !writeBenchmarkResultsAsJson(xmlInputs, &json) ) {
+        qWarning() << "Failed to write benchmark results";
+        exitCode = qMax(exitCode, 1);
+    }
+
+    return exitCode;
+}
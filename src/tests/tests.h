@@ -58,6 +58,8 @@ private slots:
     void moveItems();
     void deleteItems();
     void searchItems();
+    void searchItemsWithTextIndex();
+    void searchManyItems();
     void copyItems();
 
     void helpCommand();
@@ -73,15 +75,24 @@ private slots:
     void toggleClipboardMonitoring();
 
     void clipboardToItem();
+    void clipboardBigData();
+    void clipboardTrace();
+    void moveDuplicateClipboardItemToTop();
     void itemToClipboard();
     void tabAdd();
     void tabRemove();
     void tabIcon();
     void action();
     void insertRemoveItems();
+    void readWriteRemoveItems();
+    void restoreItemsAfterRestart();
+    void restoreMappedItemsAfterRestart();
+    void shareItemDataBetweenTabs();
+    void loadItemsInBackground();
     void renameTab();
     void importExportTab();
     void eval();
+    void batchCommands();
     void rawData();
 
     void nextPrevious();
@@ -118,6 +129,12 @@ private slots:
 
     void setEnvCommand();
 
+    void rowHeights();
+
+    void fingerprintHashValues();
+
+    void hashMappedItemsWithoutLoading();
+
 private:
     void clearServerErrors();
     int run(const QStringList &arguments, QByteArray *stdoutData = NULL,
@@ -129,4 +146,6 @@ private:
 
 int runTests(int argc, char *argv[]);
 
+int runBenchmarks(int argc, char *argv[]);
+
 #endif // TESTS_H